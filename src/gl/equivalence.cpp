@@ -0,0 +1,594 @@
+/*
+ * 等价性测试 harness:
+ * the scenes of triangle / glVertexPointer / glOrtho / glTexCoordPointer / textureDisplayByShader, rendered through
+ * the glLegacy, gl and gles paths in one process, each api in its own pbuffer context, into an offscreen RGBA8 target,
+ * and by the CPU reference rasterizer, see softRaster.h.
+ * gl, gles and soft are compared with glLegacy, the fixed-function reference, see Golden_Compare().
+ *
+ * glad function pointers are reloaded with egl_LoadGL() after switching to the context of another api,
+ * the glad_gl table also drives the GLES context.
+ *
+ * --scene <name>: only this scene
+ * --golden 1: also check every image against its golden image, see golden.h
+ * exit status: number of failed comparisons
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include "linmath.h"
+#include "glad.h"
+#include "glUtils.h"
+#include "eglUtils.h"
+#include "myUtils.h"
+#include "softRaster.h"
+
+
+typedef struct{
+    vec3 pos;
+    vec3 col;
+}Vertex;
+
+#define NumApis 3
+static const int Apis[NumApis] = { API_GLLegacy, API_GL, API_GLES };
+static char Renderers[NumApis][128];
+// image columns: the apis, then the soft rasterizer
+#define SoftColumn NumApis
+#define NumColumns (NumApis + 1)
+
+static const char* ColumnName( int column )
+{
+    return (column == SoftColumn) ? "soft" : apiName( Apis[column] );
+}
+
+static const char *colorVertexShaderBody =
+    "uniform mat4 MVP;\n"
+    "layout (location = 0) in vec3 vPos;\n"
+    "layout (location = 1) in vec3 vCol;\n"
+    "out vec3 Color;\n"
+    "void main()\n"
+    "{\n"
+    "   gl_Position = MVP * vec4(vPos, 1.0);\n"
+    "   Color = vCol;\n"
+    "}\n";
+
+static const char *colorFragmentShaderBody =
+    "in vec3 Color;\n"
+    "layout (location = 0) out vec4 FragColor;\n"
+    "void main()\n"
+    "{\n"
+    "   FragColor = vec4( Color, 1.0 );\n"
+    "}\n";
+
+static const char *textureVertexShaderBody =
+    "layout (location = 0) in vec3 vPos;\n"
+    "layout (location = 1) in vec2 vTexCoord;\n"
+    "out vec2 v_texCoord;\n"
+    "void main()\n"
+    "{\n"
+    "   gl_Position = vec4( vPos, 1.0 );\n"
+    "   v_texCoord = vTexCoord;\n"
+    "}\n";
+
+static const char *textureFragmentShaderBody =
+    "in vec2 v_texCoord;\n"
+    "layout (location = 0) out vec4 outColor;\n"
+    "uniform sampler2D s_texture;\n"
+    "void main()\n"
+    "{\n"
+    "   outColor = texture( s_texture, v_texCoord );\n"
+    "}\n";
+
+/* legacy: client arrays with the current matrices; modern: VAO + VBO + shader with mvp */
+static void DrawColored( api_t api, GLenum mode, const Vertex *vertices, int count, mat4x4 mvp )
+{
+    if( api.api == API_GLLegacy ){
+        glVertexPointer( 3, GL_FLOAT, sizeof(Vertex), &vertices[0].pos );
+        glColorPointer( 3, GL_FLOAT, sizeof(Vertex), &vertices[0].col );
+        glEnableClientState( GL_VERTEX_ARRAY );
+        glEnableClientState( GL_COLOR_ARRAY );
+        glDrawArrays( mode, 0, count );
+        glDisableClientState( GL_VERTEX_ARRAY );
+        glDisableClientState( GL_COLOR_ARRAY );
+        return;
+    }
+
+    const GLuint program = CreateProgramFromBody( api, colorVertexShaderBody, colorFragmentShaderBody );
+    GLuint vertex_array, vertex_buffer;
+    glGenVertexArrays( 1, &vertex_array );
+    glBindVertexArray( vertex_array );
+    glGenBuffers( 1, &vertex_buffer );
+    glBindBuffer( GL_ARRAY_BUFFER, vertex_buffer );
+    glBufferData( GL_ARRAY_BUFFER, sizeof(Vertex) * count, vertices, GL_STATIC_DRAW );
+    glVertexAttribPointer( 0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*) offsetof(Vertex, pos) );
+    glVertexAttribPointer( 1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*) offsetof(Vertex, col) );
+    glEnableVertexAttribArray( 0 );
+    glEnableVertexAttribArray( 1 );
+
+    glUseProgram( program );
+    glUniformMatrix4fv( glGetUniformLocation( program, "MVP" ), 1, GL_FALSE, (const GLfloat*) mvp );
+    glDrawArrays( mode, 0, count );
+
+    glBindVertexArray( 0 );
+    glDeleteVertexArrays( 1, &vertex_array );
+    glDeleteBuffers( 1, &vertex_buffer );
+    glUseProgram( 0 );
+    glDeleteProgram( program );
+}
+
+static void DrawSoftColored( SoftRaster *sr, SoftRasterMode mode, const Vertex *vertices, int count, mat4x4 mvp )
+{
+    SoftRasterVertex v[8];
+    for( int i=0; i < count; i++ ){
+        v[i] = SoftRasterVertex{ { vertices[i].pos[0], vertices[i].pos[1], vertices[i].pos[2], 1.0f },
+                                   { vertices[i].col[0], vertices[i].col[1], vertices[i].col[2], 1.0f }, { 0.0f, 0.0f } };
+    }
+    SoftRaster_SetMatrix( sr, (const float*) mvp );
+    SoftRaster_SetTexture( sr, NULL );
+    SoftRaster_Draw( sr, mode, v, count );
+}
+
+/* position xyz + texcoord st, white, nearest and GL_REPEAT as the samples leave it */
+static void DrawSoftTextured( SoftRaster *sr, const GLfloat *vertices, int count, const GLushort *indices, int indexCount,
+                              const uint8_t *rgba, int width, int height )
+{
+    SoftRasterVertex v[8];
+    for( int i=0; i < count; i++ ){
+        const GLfloat *in = vertices + i * 5;
+        v[i] = SoftRasterVertex{ { in[0], in[1], in[2], 1.0f }, { 1.0f, 1.0f, 1.0f, 1.0f }, { in[3], in[4] } };
+    }
+    const SoftRasterTexture texture = { rgba, width, height, 0, 1 };
+    SoftRaster_SetMatrix( sr, NULL );
+    SoftRaster_SetTexture( sr, &texture );
+    SoftRaster_DrawElements( sr, SR_TRIANGLES, v, indices, indexCount );
+}
+
+//-----------------------------------------------------------------------------------------
+//  scenes, the first frame of each sample with the animation frozen
+//-----------------------------------------------------------------------------------------
+/* triangle.cpp: glRotatef + glOrtho, at 0.5 radian */
+static const Vertex TriangleVertices[3] = {
+    { { -0.6f, -0.4f, 0.f }, { 1.f, 0.f, 0.f } },
+    { {  0.6f, -0.4f, 0.f }, { 0.f, 1.f, 0.f } },
+    { {   0.f,  0.6f, 0.f }, { 0.f, 0.f, 1.f } }
+};
+static const float TriangleAngle = 0.5f;
+
+static void TriangleMvp( mat4x4 mvp, int width, int height )
+{
+    const float ratio = width / (float) height;
+    mat4x4 m, p;
+    mat4x4_identity( m );
+    mat4x4_rotate_Z( m, m, TriangleAngle );
+    mat4x4_ortho( p, -ratio, ratio, -1.f, 1.f, 1.f, -1.f );
+    mat4x4_mul( mvp, p, m );
+}
+
+static void DrawTriangle( api_t api, int width, int height )
+{
+    const float ratio = width / (float) height;
+
+    glClearColor( 0.0, 0.0, 0.0, 0.0 );
+    glClear( GL_COLOR_BUFFER_BIT );
+
+    mat4x4 mvp;
+    mat4x4_identity( mvp );
+    if( api.api == API_GLLegacy ){
+        glMatrixMode( GL_MODELVIEW );
+        glLoadIdentity();
+        glRotatef( DegreeFromRadian( TriangleAngle ), 0.0, 0.0, 1.0 );
+        glMatrixMode( GL_PROJECTION );
+        glLoadIdentity();
+        glOrtho( -ratio, ratio, -1.0, 1.0, 1.0, -1.0 );
+    }else{
+        TriangleMvp( mvp, width, height );
+    }
+    DrawColored( api, GL_TRIANGLES, TriangleVertices, 3, mvp );
+}
+
+static void SoftTriangle( SoftRaster *sr, int width, int height )
+{
+    mat4x4 mvp;
+    TriangleMvp( mvp, width, height );
+    SoftRaster_Clear( sr, 0.0, 0.0, 0.0, 0.0 );
+    DrawSoftColored( sr, SR_TRIANGLES, TriangleVertices, 3, mvp );
+}
+
+/* glVertexPointer.cpp */
+static const Vertex VertexPointerVertices[3] = {
+    { { -1, -1, 0 }, { 1, 0, 0 } },
+    { {  1, -1, 0 }, { 0, 1, 0 } },
+    { {  0,  1, 0 }, { 0, 0, 1 } }
+};
+
+static void DrawVertexPointer( api_t api, int width, int height )
+{
+    (void)width;
+    (void)height;
+
+    glClearColor( 0.4, 0.4, 0.4, 0.0 );
+    glClear( GL_COLOR_BUFFER_BIT );
+
+    mat4x4 mvp;
+    mat4x4_identity( mvp );
+    DrawColored( api, GL_TRIANGLES, VertexPointerVertices, 3, mvp );
+}
+
+static void SoftVertexPointer( SoftRaster *sr, int width, int height )
+{
+    (void)width;
+    (void)height;
+
+    mat4x4 mvp;
+    mat4x4_identity( mvp );
+    SoftRaster_Clear( sr, 0.4, 0.4, 0.4, 0.0 );
+    DrawSoftColored( sr, SR_TRIANGLES, VertexPointerVertices, 3, mvp );
+}
+
+/* glOrtho.cpp, frame 0 shows the top right quarter, frame 90 the default volume */
+#define OrthoZ 30.0f
+static const Vertex OrthoVertices[4] = {
+    { { 0.25, 0.25, OrthoZ }, { 1, 0, 0 } },
+    { { 0.75, 0.25, OrthoZ }, { 1, 1, 0 } },
+    { { 0.75, 0.75, OrthoZ }, { 1, 0, 1 } },
+    { { 0.25, 0.75, OrthoZ }, { 0, 1, 1 } },
+};
+
+static void DrawOrtho( api_t api, GLdouble left, GLdouble bottom )
+{
+    const GLdouble zNear = -OrthoZ;
+    const GLdouble zFar = OrthoZ;
+
+    glClearColor( 0.0, 0.0, 0.0, 0.0 );
+    glClear( GL_COLOR_BUFFER_BIT );
+
+    mat4x4 mvp;
+    mat4x4_identity( mvp );
+    if( api.api == API_GLLegacy ){
+        glMatrixMode( GL_PROJECTION );
+        glLoadIdentity();
+        glOrtho( left, 1.0, bottom, 1.0, zNear, zFar );
+    }else{
+        mat4x4_ortho( mvp, left, 1.0, bottom, 1.0, zNear, zFar );
+    }
+    DrawColored( api, GL_TRIANGLE_FAN, OrthoVertices, 4, mvp );
+}
+
+static void SoftOrtho( SoftRaster *sr, float left, float bottom )
+{
+    mat4x4 mvp;
+    mat4x4_ortho( mvp, left, 1.0f, bottom, 1.0f, -OrthoZ, OrthoZ );
+    SoftRaster_Clear( sr, 0.0, 0.0, 0.0, 0.0 );
+    DrawSoftColored( sr, SR_TRIANGLE_FAN, OrthoVertices, 4, mvp );
+}
+
+static void DrawOrthoCorner( api_t api, int width, int height )
+{
+    (void)width;
+    (void)height;
+    DrawOrtho( api, 0.0, 0.0 );
+}
+
+static void DrawOrthoDefault( api_t api, int width, int height )
+{
+    (void)width;
+    (void)height;
+    DrawOrtho( api, -1.0, -1.0 );
+}
+
+static void SoftOrthoCorner( SoftRaster *sr, int width, int height )
+{
+    (void)width;
+    (void)height;
+    SoftOrtho( sr, 0.0f, 0.0f );
+}
+
+static void SoftOrthoDefault( SoftRaster *sr, int width, int height )
+{
+    (void)width;
+    (void)height;
+    SoftOrtho( sr, -1.0f, -1.0f );
+}
+
+/* position xyz + texcoord st, indexed; nearest texture, GL_REPEAT */
+static void DrawTextured( api_t api, const GLfloat *vertices, int count, const GLushort *indices, int indexCount,
+                          const GLubyte *pixels, GLenum format, int width, int height )
+{
+    GLuint textureId;
+    glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+    glGenTextures( 1, &textureId );
+    glActiveTexture( GL_TEXTURE0 );
+    glBindTexture( GL_TEXTURE_2D, textureId );
+    glTexImage2D( GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, pixels );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+    glPixelStorei( GL_UNPACK_ALIGNMENT, 4 );
+
+    if( api.api == API_GLLegacy ){
+        glVertexPointer( 3, GL_FLOAT, 5 * sizeof(GLfloat), vertices );
+        glTexCoordPointer( 2, GL_FLOAT, 5 * sizeof(GLfloat), &vertices[3] );
+        glEnableClientState( GL_VERTEX_ARRAY );
+        glEnableClientState( GL_TEXTURE_COORD_ARRAY );
+        glEnable( GL_TEXTURE_2D );
+        glDrawElements( GL_TRIANGLES, indexCount, GL_UNSIGNED_SHORT, indices );
+        glDisable( GL_TEXTURE_2D );
+        glDisableClientState( GL_VERTEX_ARRAY );
+        glDisableClientState( GL_TEXTURE_COORD_ARRAY );
+    }else{
+        const GLuint program = CreateProgramFromBody( api, textureVertexShaderBody, textureFragmentShaderBody );
+        GLuint vertex_array, buffers[2];
+        glGenVertexArrays( 1, &vertex_array );
+        glBindVertexArray( vertex_array );
+        glGenBuffers( 2, buffers );
+        glBindBuffer( GL_ARRAY_BUFFER, buffers[0] );
+        glBufferData( GL_ARRAY_BUFFER, sizeof(GLfloat) * 5 * count, vertices, GL_STATIC_DRAW );
+        glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, buffers[1] );
+        glBufferData( GL_ELEMENT_ARRAY_BUFFER, sizeof(GLushort) * indexCount, indices, GL_STATIC_DRAW );
+        glVertexAttribPointer( 0, 3, GL_FLOAT, GL_FALSE, sizeof(GLfloat) * 5, (void*)0 );
+        glVertexAttribPointer( 1, 2, GL_FLOAT, GL_FALSE, sizeof(GLfloat) * 5, (void*)(sizeof(GLfloat) * 3) );
+        glEnableVertexAttribArray( 0 );
+        glEnableVertexAttribArray( 1 );
+
+        glUseProgram( program );
+        glUniform1i( glGetUniformLocation( program, "s_texture" ), 0 );
+        glDrawElements( GL_TRIANGLES, indexCount, GL_UNSIGNED_SHORT, (void*)0 );
+
+        glBindVertexArray( 0 );
+        glDeleteVertexArrays( 1, &vertex_array );
+        glDeleteBuffers( 2, buffers );
+        glUseProgram( 0 );
+        glDeleteProgram( program );
+    }
+    glDeleteTextures( 1, &textureId );
+}
+
+static const GLushort QuadIndices[6] = {
+    0, 1, 2, 0, 2, 3
+};
+
+/* glTexCoordPointer.cpp: 2x2 RGB texture, indexed quad */
+static const GLubyte TexCoordPointerPixels[4 * 4] = {
+    255,   0,   0, 255,
+      0, 255,   0, 255,
+      0,   0, 255, 255,
+    255, 255,   0, 255
+};
+static const GLfloat TexCoordPointerVertices[4 * 5] = {
+    -0.5f,  0.5f, 0.0f,  0.0f, 0.0f,
+    -0.5f, -0.5f, 0.0f,  0.0f, 1.0f,
+     0.5f, -0.5f, 0.0f,  1.0f, 1.0f,
+     0.5f,  0.5f, 0.0f,  1.0f, 0.0f,
+};
+
+static void DrawTexCoordPointer( api_t api, int width, int height )
+{
+    // the sample uploads RGB
+    GLubyte rgb[4 * 3];
+    for( int i=0; i < 4; i++ )
+        memcpy( &rgb[i * 3], &TexCoordPointerPixels[i * 4], 3 );
+    (void)width;
+    (void)height;
+
+    glClearColor( 0.0, 0.0, 0.0, 0.0 );
+    glClear( GL_COLOR_BUFFER_BIT );
+    DrawTextured( api, TexCoordPointerVertices, 4, QuadIndices, 6, rgb, GL_RGB, 2, 2 );
+}
+
+static void SoftTexCoordPointer( SoftRaster *sr, int width, int height )
+{
+    (void)width;
+    (void)height;
+    SoftRaster_Clear( sr, 0.0, 0.0, 0.0, 0.0 );
+    DrawSoftTextured( sr, TexCoordPointerVertices, 4, QuadIndices, 6, TexCoordPointerPixels, 2, 2 );
+}
+
+/* textureDisplayByShader.cpp: data/basemap.tga on the whole viewport */
+static const GLfloat DisplayVertices[4 * 5] = {
+    -1.0f,  1.0f, 0.0f,  0.0f, 0.0f,
+    -1.0f, -1.0f, 0.0f,  0.0f, 1.0f,
+     1.0f, -1.0f, 0.0f,  1.0f, 1.0f,
+     1.0f,  1.0f, 0.0f,  1.0f, 0.0f,
+};
+static GLubyte *BasemapRgba;
+static int BasemapWidth, BasemapHeight;
+
+/* loaded once, expanded to RGBA for the soft rasterizer */
+static void LoadBasemap()
+{
+    if( BasemapRgba != NULL )
+        return;
+    GLsizei channels;
+    GLubyte *data = imageFromFile( PROJECT_SOURCE_DIR "data/basemap.tga", &BasemapWidth, &BasemapHeight, NULL, &channels );
+    const size_t pixels = (size_t)BasemapWidth * BasemapHeight;
+    BasemapRgba = (GLubyte*) malloc( pixels * 4 );
+    for( size_t i=0; i < pixels; i++ ){
+        for( int c=0; c < 4; c++ )
+            BasemapRgba[i * 4 + c] = (c < channels) ? data[i * channels + c] : 255;
+    }
+    free( data );
+}
+
+static void DrawDisplayByShader( api_t api, int width, int height )
+{
+    (void)width;
+    (void)height;
+    LoadBasemap();
+
+    glClearColor( 0.0, 0.0, 0.0, 0.0 );
+    glClear( GL_COLOR_BUFFER_BIT );
+    DrawTextured( api, DisplayVertices, 4, QuadIndices, 6, BasemapRgba, GL_RGBA, BasemapWidth, BasemapHeight );
+}
+
+static void SoftDisplayByShader( SoftRaster *sr, int width, int height )
+{
+    (void)width;
+    (void)height;
+    LoadBasemap();
+    SoftRaster_Clear( sr, 0.0, 0.0, 0.0, 0.0 );
+    DrawSoftTextured( sr, DisplayVertices, 4, QuadIndices, 6, BasemapRgba, BasemapWidth, BasemapHeight );
+}
+
+typedef struct{
+    const char *name;
+    int width, height;
+    void (*draw)( api_t api, int width, int height );
+    void (*soft)( SoftRaster *sr, int width, int height );
+    int nearestTexture;     // samples a GL_NEAREST magnified texture
+}Scene;
+
+static const Scene Scenes[] = {
+    { "triangle",               640, 480, DrawTriangle,        SoftTriangle,        0 },
+    { "glVertexPointer",        800, 600, DrawVertexPointer,   SoftVertexPointer,   0 },
+    { "glOrtho_corner",         800, 800, DrawOrthoCorner,     SoftOrthoCorner,     0 },
+    { "glOrtho",                800, 800, DrawOrthoDefault,    SoftOrthoDefault,    0 },
+    { "glTexCoordPointer",      800, 600, DrawTexCoordPointer, SoftTexCoordPointer, 1 },
+    { "textureDisplayByShader", 800, 600, DrawDisplayByShader, SoftDisplayByShader, 1 },
+};
+#define NumScenes (int)(sizeof(Scenes) / sizeof(Scenes[0]))
+
+/* every scene of one api, NULL images when the api or the target is not available */
+static void RenderApi( int apiIndex, const char *only, uint8_t *images[NumScenes][NumColumns] )
+{
+    const api_t api = apiDefault( Apis[apiIndex] );
+    eglContext_t *ctx = egl_CreateContextEx( api, NULL, NULL, 16, 16, NULL );
+    if( ctx == NULL || !egl_MakeCurrent( ctx ) ){
+        printf("%s: no context\n", apiName(api));
+        egl_DestroyContext( ctx );
+        return;
+    }
+    egl_LoadGL();
+    printf("%s: GL_VERSION = %s, GL_RENDERER = %s\n", apiName(api), glGetString(GL_VERSION), glGetString(GL_RENDERER));
+    snprintf( Renderers[apiIndex], sizeof(Renderers[apiIndex]), "%s", (const char*)glGetString(GL_RENDERER) );
+
+    for( int s=0; s < NumScenes; s++ ){
+        const Scene *scene = &Scenes[s];
+        if( only != NULL && strcmp( only, scene->name ) != 0 )
+            continue;
+
+        RenderTarget rt;
+        if( !RenderTarget_Create( &rt, scene->width, scene->height, GL_RGBA8, GL_NONE, 0 ) ){
+            printf("%s: %s: RenderTarget_Create() fail\n", apiName(api), scene->name);
+            continue;
+        }
+        RenderTarget_Bind( &rt );
+        if( api.api == API_GLLegacy ){
+            glMatrixMode( GL_PROJECTION );
+            glLoadIdentity();
+            glMatrixMode( GL_MODELVIEW );
+            glLoadIdentity();
+        }
+        scene->draw( api, scene->width, scene->height );
+        glErrorCheck();
+
+        uint8_t *pixels = (uint8_t*) malloc( (size_t)scene->width * scene->height * 4 );
+        glPixelStorei( GL_PACK_ALIGNMENT, 4 );
+        glReadPixels( 0, 0, scene->width, scene->height, GL_RGBA, GL_UNSIGNED_BYTE, pixels );
+        images[s][apiIndex] = pixels;
+        RenderTarget_Destroy( &rt );
+    }
+
+    egl_MakeCurrent( NULL );
+    egl_DestroyContext( ctx );
+}
+
+/* every scene on the CPU, no GL involved */
+static void RenderSoft( const char *only, uint8_t *images[NumScenes][NumColumns] )
+{
+    for( int s=0; s < NumScenes; s++ ){
+        const Scene *scene = &Scenes[s];
+        if( only != NULL && strcmp( only, scene->name ) != 0 )
+            continue;
+
+        SoftRaster *sr = SoftRaster_Create( scene->width, scene->height );
+        if( sr == NULL )
+            continue;
+        scene->soft( sr, scene->width, scene->height );
+        const size_t size = (size_t)scene->width * scene->height * 4;
+        uint8_t *pixels = (uint8_t*) malloc( size );
+        memcpy( pixels, SoftRaster_Finish( sr ), size );
+        images[s][SoftColumn] = pixels;
+        SoftRaster_Destroy( sr );
+    }
+}
+
+int main( int argc, const char* argv[] )
+{
+    const char *__scene = stringFromArgs( "--scene", argc, argv );
+    const int __golden = integerFromArgs( "--golden", argc, argv, NULL ) > 0;
+
+    uint8_t *images[NumScenes][NumColumns];
+    memset( images, 0, sizeof(images) );
+    for( int a=0; a < NumApis; a++ )
+        RenderApi( a, __scene, images );
+    RenderSoft( __scene, images );
+
+    // glLegacy is the reference
+    // -------------------------
+    const GoldenTolerance tolerance = Golden_DefaultTolerance();
+    // nearest texels exactly on a texel boundary go either way with the float error of the interpolation:
+    // whole rows and columns of a magnified texture may pick the next texel, soft vs nearestTexture scenes only
+    GoldenTolerance softTolerance = tolerance;
+    softTolerance.maxBadPixels = 0.01;
+    int failures = 0;
+    printf("\n%-24s %-10s", "scene", "size");
+    for( int a=0; a < NumColumns; a++ )
+        printf(" %-44s", ColumnName(a));
+    printf("\n");
+    for( int s=0; s < NumScenes; s++ ){
+        const Scene *scene = &Scenes[s];
+        if( __scene != NULL && strcmp( __scene, scene->name ) != 0 )
+            continue;
+
+        char size[32];
+        snprintf( size, sizeof(size), "%dx%d", scene->width, scene->height );
+        printf("%-24s %-10s", scene->name, size);
+        const uint8_t *reference = images[s][0];
+        for( int a=0; a < NumColumns; a++ ){
+            char cell[64];
+            if( images[s][a] == NULL ){
+                snprintf( cell, sizeof(cell), "n/a" );
+            }else if( a == 0 ){
+                snprintf( cell, sizeof(cell), "reference" );
+            }else if( reference == NULL ){
+                snprintf( cell, sizeof(cell), "no reference" );
+            }else{
+                GoldenResult result;
+                const GoldenTolerance *t = (a == SoftColumn && scene->nearestTexture) ? &softTolerance : &tolerance;
+                const int pass = Golden_Compare( images[s][a], reference, scene->width, scene->height, t, &result );
+                if( result.compare.mismatches == 0 )
+                    snprintf( cell, sizeof(cell), "same" );
+                else
+                    snprintf( cell, sizeof(cell), "%s max %u, %llu px over %d, SSIM %.4f", pass ? "ok" : "DIFF !!!",
+                              result.compare.maxError, (unsigned long long)result.badPixels, t->maxChannelDelta, result.ssim );
+                failures += !pass;
+            }
+            printf(" %-44s", cell);
+        }
+        printf("\n");
+    }
+    printf("\n");
+
+    // golden images, one per scene and api
+    // ------------------------------------
+    if( __golden ){
+        for( int s=0; s < NumScenes; s++ ){
+            for( int a=0; a < NumColumns; a++ ){
+                if( images[s][a] == NULL )
+                    continue;
+                char test[64];
+                snprintf( test, sizeof(test), "equivalence_%s", Scenes[s].name );
+                Golden_Submit( test, ColumnName(a), (a == SoftColumn) ? "softRaster" : Renderers[a],
+                               images[s][a], Scenes[s].width, Scenes[s].height, NULL );
+            }
+        }
+        failures += Golden_Finish();
+    }
+
+    for( int s=0; s < NumScenes; s++ ){
+        for( int a=0; a < NumColumns; a++ )
+            free( images[s][a] );
+    }
+    free( BasemapRgba );
+    egl_Terminate();
+    return failures;
+}
@@ -3,10 +3,10 @@
  * glVertexPointer + glColorPointer
  * VertexArray + VertexBuffer + glVertexAttribPointer + glEnableVertexAttribArray
  *
+ * the first frame is compared with data/golden/glVertexPointer/<api>/<renderer>.png, see golden.h,
+ * and its PBO readback with data/golden/glVertexPointer_PBO/<api>/<renderer>.png
+ * --golden 1: exit after the first frame, the exit status is the number of failures
  */
-#define STB_IMAGE_WRITE_IMPLEMENTATION
-#include "stb_image_write.h"
-
 #include <stdio.h>
 #include <stddef.h>
 #include "linmath.h"
@@ -59,6 +59,7 @@ int main( int argc, const char* argv[] )
 {
     api_t api = apiInitial( API_Current, argc, argv );
     printf("%s: %s\n", argv[0], apiName(api));
+    const int goldenOnly = integerFromArgs( "--golden", argc, argv, NULL ) > 0;
 
     // initialize and configure
     // ------------------------------
@@ -124,30 +125,19 @@ int main( int argc, const char* argv[] )
         glDrawArrays(GL_TRIANGLES, 0, 3);
 #endif
 
-        // dump to disk
-        // ------------
+        // compare with the golden image
+        // -------------------------------
         static int i = 0;
         if( i == 0 ){
             i = 1;
 
             glFinish();
-            GLubyte* pixels = (GLubyte*)malloc( WinWidth * WinHeight * 4 );
-            glReadPixels(0, 0, WinWidth, WinHeight, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
-
-            // Write image Y-flipped because OpenGL
-            stbi_flip_vertically_on_write( 1 );
-            stbi_write_png("/tmp/glVertexPointer.png", WinWidth, WinHeight, 4, pixels, WinWidth*4);
-            printf("dump to /tmp/glVertexPointer.png\n");
-
-            stbi_write_jpg("/tmp/glVertexPointer.jpg", WinWidth, WinHeight, 4, pixels, 95);
-            printf("dump to /tmp/glVertexPointer.jpg\n");
-
-            free( pixels );
+            Golden_SubmitFramebuffer( "glVertexPointer", API_CurrentName, 0, 0, WinWidth, WinHeight, NULL );
             //------------------
 
             if( 1 ){
-                // glReadPixels by PBO
-                // --------------------
+                // glReadPixels by PBO, a golden image of its own
+                // ----------------------------------------------
                 GLuint pbo;
                 glGenBuffers( 1, &pbo );
 
@@ -164,16 +154,17 @@ int main( int argc, const char* argv[] )
                 GLubyte *pixels = (GLubyte*) glMapBuffer( GL_PIXEL_PACK_BUFFER, GL_READ_ONLY );
 #endif
                 if( pixels ){
-                    // Write image Y-flipped because OpenGL
-                    stbi_flip_vertically_on_write( 1 );
-                    stbi_write_png("/tmp/glVertexPointer_PBO.png", WinWidth, WinHeight, 4, pixels, WinWidth*4);
-                    printf("dump to /tmp/glVertexPointer_PBO.png\n");
-
-                    stbi_write_jpg("/tmp/glVertexPointer_PBO.jpg", WinWidth, WinHeight, 4, pixels, 95);
-                    printf("dump to /tmp/glVertexPointer_PBO.jpg\n");
-
+                    Golden_Submit( "glVertexPointer_PBO", API_CurrentName, (const char*)glGetString( GL_RENDERER ), pixels, WinWidth, WinHeight, NULL );
                     glUnmapBuffer( GL_PIXEL_PACK_BUFFER );
                 }
+                glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+                glDeleteBuffers( 1, &pbo );
+            }
+
+            const int failures = Golden_Finish();
+            if( goldenOnly ){
+                eglx_Terminate();
+                return failures;
             }
         }
 
@@ -0,0 +1,330 @@
+/**
+ * Measure compute shader performance, needs GL 4.3 or GLES 3.1, one build for both: --api gl43 or gles31
+ *   --mode 0: dispatch overhead
+ *   --mode 1: SSBO write / copy bandwidth
+ *   --mode 2: shared memory reduction
+ *   --mode 3: image load/store fill rate
+ *   --mode 4: compute mipmap generation vs glGenerateMipmap()
+ */
+#include <stdio.h>
+#include <string.h>
+#include "glad.h"
+#include "glUtils.h"
+#include "eglUtils.h"
+#include "myUtils.h"
+
+
+// settings
+static const int WinWidth = 200;
+static const int WinHeight = 200;
+
+static const GLuint BufferElements = 1024 * 1024;   // vec4, 16MB per buffer
+static const GLint ImageSize = 2048;
+static const GLint ReduceGroupSize = 256;
+
+static GLuint emptyProgram;
+static GLuint fillProgram;
+static GLuint copyProgram;
+static GLuint reduceProgram;
+static GLuint imageFillProgram;
+static GLuint imageInvertProgram;
+
+static GLuint srcBuffer, dstBuffer, partialBuffer;
+static GLuint imageTex[2];     // the invert pass reads one and writes the other
+static GLuint mipmapTex;
+static GLint MaxLevel;
+static GLboolean UseBarrier = GL_FALSE;
+
+// #version and precisions from CreateComputeProgramFromBody()
+const char *emptyShaderBody =
+    "layout (local_size_x = 64) in;\n"
+    "void main()\n"
+    "{\n"
+    "}\n";
+
+const char *fillShaderBody =
+    "layout (local_size_x = 256) in;\n"
+    "layout (std430, binding = 1) writeonly buffer Dst { vec4 dst[]; };\n"
+    "void main()\n"
+    "{\n"
+    "    dst[gl_GlobalInvocationID.x] = vec4( float(gl_GlobalInvocationID.x) );\n"
+    "}\n";
+
+const char *copyShaderBody =
+    "layout (local_size_x = 256) in;\n"
+    "layout (std430, binding = 0) readonly buffer Src { vec4 src[]; };\n"
+    "layout (std430, binding = 1) writeonly buffer Dst { vec4 dst[]; };\n"
+    "void main()\n"
+    "{\n"
+    "    dst[gl_GlobalInvocationID.x] = src[gl_GlobalInvocationID.x];\n"
+    "}\n";
+
+// one partial sum per work group, tree reduction in shared memory
+const char *reduceShaderBody =
+    "layout (local_size_x = 256) in;\n"
+    "layout (std430, binding = 0) readonly buffer Src { vec4 src[]; };\n"
+    "layout (std430, binding = 2) writeonly buffer Partial { vec4 partial[]; };\n"
+    "shared vec4 sums[256];\n"
+    "void main()\n"
+    "{\n"
+    "    uint i = gl_LocalInvocationID.x;\n"
+    "    sums[i] = src[gl_GlobalInvocationID.x];\n"
+    "    barrier();\n"
+    "    for( uint s = 128u; s > 0u; s >>= 1 ){\n"
+    "        if( i < s )\n"
+    "            sums[i] += sums[i + s];\n"
+    "        barrier();\n"
+    "    }\n"
+    "    if( i == 0u )\n"
+    "        partial[gl_WorkGroupID.x] = sums[0];\n"
+    "}\n";
+
+const char *imageFillShaderBody =
+    "layout (local_size_x = 8, local_size_y = 8) in;\n"
+    "layout (rgba8, binding = 0) writeonly uniform image2D dstImage;\n"
+    "void main()\n"
+    "{\n"
+    "    ivec2 p = ivec2( gl_GlobalInvocationID.xy );\n"
+    "    imageStore( dstImage, p, vec4( vec2(p & 0xFF) / 255.0, 0.5, 1.0 ) );\n"
+    "}\n";
+
+// GLES 3.1 only allows read-write images of r32f / r32i / r32ui: a readonly source and a writeonly destination
+const char *imageInvertShaderBody =
+    "layout (local_size_x = 8, local_size_y = 8) in;\n"
+    "layout (rgba8, binding = 0) readonly uniform image2D srcImage;\n"
+    "layout (rgba8, binding = 1) writeonly uniform image2D dstImage;\n"
+    "void main()\n"
+    "{\n"
+    "    ivec2 p = ivec2( gl_GlobalInvocationID.xy );\n"
+    "    imageStore( dstImage, p, vec4(1.0) - imageLoad( srcImage, p ) );\n"
+    "}\n";
+
+static void PerfInit()
+{
+    // build and compile our shader program
+    // ------------------------------------
+    emptyProgram = CreateComputeProgramFromBody( emptyShaderBody );
+    fillProgram = CreateComputeProgramFromBody( fillShaderBody );
+    copyProgram = CreateComputeProgramFromBody( copyShaderBody );
+    reduceProgram = CreateComputeProgramFromBody( reduceShaderBody );
+    imageFillProgram = CreateComputeProgramFromBody( imageFillShaderBody );
+    imageInvertProgram = CreateComputeProgramFromBody( imageInvertShaderBody );
+
+    GLint maxInvocations, maxSharedSize;
+    glGetIntegerv( GL_MAX_COMPUTE_WORK_GROUP_INVOCATIONS, &maxInvocations );
+    glGetIntegerv( GL_MAX_COMPUTE_SHARED_MEMORY_SIZE, &maxSharedSize );
+    printf("GL_MAX_COMPUTE_WORK_GROUP_INVOCATIONS = %d\n", maxInvocations);
+    printf("GL_MAX_COMPUTE_SHARED_MEMORY_SIZE = %d\n", maxSharedSize);
+
+    // buffers
+    // ------------------------------------------------------------------
+    const GLsizeiptr size = BufferElements * 4 * sizeof(GLfloat);
+    GLfloat *data = (GLfloat*) malloc( size );
+    for( GLuint i = 0; i < BufferElements * 4; i++ )
+        data[i] = (GLfloat)(i & 0xFF);
+
+    glGenBuffers( 1, &srcBuffer );
+    glBindBuffer( GL_SHADER_STORAGE_BUFFER, srcBuffer );
+    glBufferData( GL_SHADER_STORAGE_BUFFER, size, data, GL_STATIC_DRAW );
+    free( data );
+
+    glGenBuffers( 1, &dstBuffer );
+    glBindBuffer( GL_SHADER_STORAGE_BUFFER, dstBuffer );
+    glBufferData( GL_SHADER_STORAGE_BUFFER, size, NULL, GL_DYNAMIC_COPY );
+
+    glGenBuffers( 1, &partialBuffer );
+    glBindBuffer( GL_SHADER_STORAGE_BUFFER, partialBuffer );
+    glBufferData( GL_SHADER_STORAGE_BUFFER, BufferElements / ReduceGroupSize * 4 * sizeof(GLfloat), NULL, GL_DYNAMIC_COPY );
+
+    glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 0, srcBuffer );
+    glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 1, dstBuffer );
+    glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 2, partialBuffer );
+
+    // images, immutable so that GLES can bind them as images
+    // ------------------------------------------------------------------
+    glGenTextures( 2, imageTex );
+    for( int i = 0; i < 2; i++ ){
+        glBindTexture( GL_TEXTURE_2D, imageTex[i] );
+        glTexStorage2D( GL_TEXTURE_2D, 1, GL_RGBA8, ImageSize, ImageSize );
+    }
+
+    const GLint numLevels = 12;
+    GLubyte *img = GenerateCheckboard_RGBA( ImageSize, ImageSize, 8 );
+    glGenTextures( 1, &mipmapTex );
+    glBindTexture( GL_TEXTURE_2D, mipmapTex );
+    glTexStorage2D( GL_TEXTURE_2D, numLevels, GL_RGBA8, ImageSize, ImageSize );
+    glTexSubImage2D( GL_TEXTURE_2D, 0, 0, 0, ImageSize, ImageSize, GL_RGBA, GL_UNSIGNED_BYTE, img );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+    free( img );
+
+    glErrorCheck();
+}
+
+static void DispatchEmpty(unsigned count)
+{
+    glUseProgram( emptyProgram );
+    for (unsigned i = 0; i < count; i++) {
+        glDispatchCompute( 1, 1, 1 );
+        if (UseBarrier)
+            glMemoryBarrier( GL_SHADER_STORAGE_BARRIER_BIT );
+    }
+    glFinish();
+}
+
+static void DispatchFill(unsigned count)
+{
+    glUseProgram( fillProgram );
+    for (unsigned i = 0; i < count; i++)
+        glDispatchCompute( BufferElements / 256, 1, 1 );
+    glFinish();
+}
+
+static void DispatchCopy(unsigned count)
+{
+    glUseProgram( copyProgram );
+    for (unsigned i = 0; i < count; i++)
+        glDispatchCompute( BufferElements / 256, 1, 1 );
+    glFinish();
+}
+
+static void DispatchReduce(unsigned count)
+{
+    glUseProgram( reduceProgram );
+    for (unsigned i = 0; i < count; i++)
+        glDispatchCompute( BufferElements / ReduceGroupSize, 1, 1 );
+    glFinish();
+}
+
+static void DispatchImageFill(unsigned count)
+{
+    glUseProgram( imageFillProgram );
+    glBindImageTexture( 0, imageTex[0], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8 );
+    for (unsigned i = 0; i < count; i++)
+        glDispatchCompute( ImageSize / 8, ImageSize / 8, 1 );
+    glFinish();
+}
+
+static void DispatchImageInvert(unsigned count)
+{
+    glUseProgram( imageInvertProgram );
+    for (unsigned i = 0; i < count; i++) {
+        // ping-pong, each pass reads what the previous one wrote
+        glBindImageTexture( 0, imageTex[i & 1], 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA8 );
+        glBindImageTexture( 1, imageTex[(i & 1) ^ 1], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8 );
+        glDispatchCompute( ImageSize / 8, ImageSize / 8, 1 );
+        glMemoryBarrier( GL_SHADER_IMAGE_ACCESS_BARRIER_BIT );
+    }
+    glFinish();
+}
+
+static void GenMipmap(unsigned count)
+{
+    glActiveTexture( GL_TEXTURE0 );
+    glBindTexture( GL_TEXTURE_2D, mipmapTex );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, MaxLevel );
+    for (unsigned i = 0; i < count; i++)
+        glGenerateMipmap( GL_TEXTURE_2D );
+    glFinish();
+}
+
+static void GenMipmapCompute(unsigned count)
+{
+    for (unsigned i = 0; i < count; i++)
+        GenerateMipmap_Compute( mipmapTex, ImageSize, ImageSize, 0, MaxLevel );
+    glFinish();
+}
+
+static void PerfDraw(int mode)
+{
+    double rate;
+    const double bufferBytes = BufferElements * 4.0 * sizeof(GLfloat);
+    const double imagePixels = (double)ImageSize * ImageSize;
+
+    if( mode == -1 || mode == 0 ) {
+        printf("Dispatch overhead\n");
+        UseBarrier = GL_FALSE;
+        rate = PerfMeasureRate( DispatchEmpty, eglx_PollEvents );
+        printf("   glDispatchCompute(1,1,1): %s dispatches/sec\n", PerfHumanFloat(rate));
+        UseBarrier = GL_TRUE;
+        rate = PerfMeasureRate( DispatchEmpty, eglx_PollEvents );
+        printf("   glDispatchCompute(1,1,1) + glMemoryBarrier: %s dispatches/sec\n", PerfHumanFloat(rate));
+    }
+
+    if( mode == -1 || mode == 1 ) {
+        printf("SSBO bandwidth, %d MB per buffer\n", (int)(bufferBytes / (1024 * 1024)));
+        rate = PerfMeasureRate( DispatchFill, eglx_PollEvents );
+        printf("   write: %s GB/sec\n", PerfHumanFloat(rate * bufferBytes / 1e9));
+        rate = PerfMeasureRate( DispatchCopy, eglx_PollEvents );
+        printf("   copy (read + write): %s GB/sec\n", PerfHumanFloat(rate * bufferBytes * 2 / 1e9));
+    }
+
+    if( mode == -1 || mode == 2 ) {
+        printf("Shared memory reduction, work group size %d\n", ReduceGroupSize);
+        rate = PerfMeasureRate( DispatchReduce, eglx_PollEvents );
+        printf("   %s vec4/sec, %s GB/sec\n",
+               PerfHumanFloat(rate * BufferElements), PerfHumanFloat(rate * bufferBytes / 1e9));
+    }
+
+    if( mode == -1 || mode == 3 ) {
+        printf("Image load/store, %d x %d RGBA8\n", ImageSize, ImageSize);
+        rate = PerfMeasureRate( DispatchImageFill, eglx_PollEvents );
+        printf("   imageStore: %s pixels/sec\n", PerfHumanFloat(rate * imagePixels));
+        rate = PerfMeasureRate( DispatchImageInvert, eglx_PollEvents );
+        printf("   imageLoad + imageStore: %s pixels/sec\n", PerfHumanFloat(rate * imagePixels));
+    }
+
+    if( mode == -1 || mode == 4 ) {
+        printf("Mipmap generation, level[0] size: %d x %d\n", ImageSize, ImageSize);
+        for (MaxLevel = 11; MaxLevel > 0; MaxLevel -= 2) {
+            rate = PerfMeasureRate( GenMipmap, eglx_PollEvents );
+            printf("   glGenerateMipmap(levels 1..%d): %.2f gens/sec\n", MaxLevel, rate);
+            rate = PerfMeasureRate( GenMipmapCompute, eglx_PollEvents );
+            printf("   compute         (levels 1..%d): %.2f gens/sec\n", MaxLevel, rate);
+        }
+    }
+
+    glErrorCheck();
+    exit(0);
+}
+
+int main( int argc, const char* argv[] )
+{
+    api_t api = apiInitial( API_AnyShader, argc, argv );
+    printf("%s: %s\n", argv[0], apiName(api));
+
+    if( (api.api == API_GL && api.major * 10 + api.minor < 43)
+        || (api.api == API_GLES && api.major * 10 + api.minor < 31) ){
+        printf("compute shader needs gl43 or gles31, try \"--api %s\"\n", api.api == API_GL ? "gl43" : "gles31");
+        exit(EXIT_FAILURE);
+    }
+
+    int __mode = integerFromArgs("--mode", argc, argv, NULL );
+
+    // initialize and configure
+    // ------------------------------
+    eglx_CreateWindow( api, WinWidth, WinHeight );
+
+    // init
+    // -----------
+    PerfInit();
+
+    // render loop
+    // -----------
+    while (!eglx_ShouldClose())
+    {
+        // render
+        // ------
+        PerfDraw( __mode );
+
+        // swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
+        // -------------------------------------------------------------------------------
+        eglx_SwapBuffers();
+        eglx_PollEvents();
+    }
+
+    // terminate, clearing all previously allocated resources.
+    // ------------------------------------------------------------------
+    eglx_Terminate();
+    return 0;
+}
@@ -3,6 +3,9 @@
  * Create a large, off-screen framebuffer object for rendering and
  * copying the texture data from it since we can't make really large
  * on-screen windows.
+ *   --format 0|1|2: render target and texture format, RGBA8 (default), RGB10_A2, RGBA16F
+ *   --maxsize N: largest texture, default RenderTarget_MaxSize()
+ * One build for all apis: --api gl30 (glLegacy), gl33 or gles32
  */
 #include <stdio.h>
 #include <stddef.h>
@@ -16,13 +19,17 @@
 static int WinWidth = 200;
 static int WinHeight = 200;
 
-static GLuint VAO, VBO, FBO, RBO, Tex, FBTex;
+static api_t Api;
+static GLuint VAO, VBO, Tex;
+static RenderTarget Target;
 static GLuint program;
 static GLint samplerLoc;
 
 static const GLsizei MinSize = 16;
-static const GLsizei MaxSize = 4096;
+static GLsizei MaxSize;
 static GLsizei TexSize;
+static const GLenum Formats[] = { GL_RGBA8, GL_RGB10_A2, GL_RGBA16F };
+static const RenderTargetFormat *Format;
 
 static GLboolean DrawPoint = GL_TRUE;
 static const GLboolean TexSubImage4 = GL_FALSE;
@@ -39,12 +46,7 @@ static const struct vertex vertices[1] = {
 #define VOFFSET(F) ((void *) offsetof(struct vertex, F))
 
 
-const char *vertexShaderSource =
-#if IS_GlEs
-    "#version 320 es\n"
-#else
-    "#version 330\n"
-#endif
+const char *vertexShaderBody =
     "layout (location = 0) in vec2 vPos;\n"
     "layout (location = 1) in vec2 vTexCoord;\n"
     "out vec2 v_texCoord;\n"
@@ -52,18 +54,12 @@ const char *vertexShaderSource =
     "{\n"
     "   gl_Position = vec4( vPos.x, vPos.y, 0.0f, 1.0f );\n"
     "   v_texCoord = vTexCoord;\n"
-    #if IS_GlEs
+    "#ifdef GL_ES\n"
     "   gl_PointSize = 1.0;\n" // make IMG gpu happy
-    #endif
+    "#endif\n"
     "}\n\0";
 
-const char *fragmentShaderSource =
-#if IS_GlEs
-    "#version 320 es\n"
-    "precision mediump float;\n"
-#else
-    "#version 330\n"
-#endif
+const char *fragmentShaderBody =
     "in vec2 v_texCoord;\n"
     "layout (location = 0) out vec4 outColor;\n"
     "uniform sampler2D s_texture;\n"
@@ -75,85 +71,43 @@ const char *fragmentShaderSource =
 static void PerfInit()
 {
     const GLenum filter = GL_LINEAR;
-    GLenum stat;
 
     // build and compile our shader program
     // ------------------------------------
-#if !IS_GlLegacy
-    program = CreateProgramFromSource( vertexShaderSource, fragmentShaderSource );
-#endif
+    if( Api.api != API_GLLegacy )
+        program = CreateProgramFromBody( Api, vertexShaderBody, fragmentShaderBody );
 
     // set up vertex data (and buffer(s)) and configure vertex attributes
     // ------------------------------------------------------------------
-#if IS_GlLegacy
-    glGenBuffers(1, &VBO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-    glVertexPointer(2, GL_FLOAT, sizeof(struct vertex), VOFFSET(x));
-    glTexCoordPointer(2, GL_FLOAT, sizeof(struct vertex), VOFFSET(s));
-    glEnableClientState(GL_VERTEX_ARRAY);
-    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-#else
-    glGenVertexArrays(1, &VAO);
-    glBindVertexArray(VAO);
-
-    glGenBuffers(1, &VBO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-    const GLint vPos_location = glGetAttribLocation(program, "vPos");
-    const GLint vTexCoord_location = glGetAttribLocation(program, "vTexCoord");
-    printf("Attrib location: vPos=%d\n", vPos_location);
-    printf("Attrib location: vTexCoord=%d\n", vTexCoord_location);
-    glVertexAttribPointer(vPos_location, 2, GL_FLOAT, GL_FALSE,
-                          sizeof(struct vertex), (void*)VOFFSET(x));
-    glVertexAttribPointer(vTexCoord_location, 2, GL_FLOAT, GL_FALSE,
-                          sizeof(struct vertex), (void *)VOFFSET(s) );
-    glEnableVertexAttribArray(vPos_location);
-    glEnableVertexAttribArray(vTexCoord_location);
-#endif
-
-    // setup fbo
-    // ------------------------------------
-    glGenFramebuffers(1, &FBO);
-    glBindFramebuffer(GL_FRAMEBUFFER, FBO);
-
-    /* setup rbo */
-#if IS_GlLegacy
-    glGenRenderbuffers(1, &RBO);
-    glBindRenderbuffer(GL_RENDERBUFFER, RBO);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA, MaxSize, MaxSize);
-
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, RBO);
-#else
-    glGenTextures( 1, &FBTex );
-    glBindTexture( GL_TEXTURE_2D, FBTex );
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA,
-                 MaxSize, MaxSize, 0,
-                 GL_RGBA, GL_UNSIGNED_BYTE, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
-
-    glFramebufferTexture2D ( GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
-                             GL_TEXTURE_2D, FBTex, 0 );
-#endif
-
-
-    stat = glCheckFramebufferStatus(GL_FRAMEBUFFER);
-    if (stat != GL_FRAMEBUFFER_COMPLETE) {
-        printf("Error: incomplete FBO!: 0x%X, %s\n", stat, framebufferStatusName(stat));
-        exit(1);
+    if( Api.api == API_GLLegacy ){
+        glGenBuffers(1, &VBO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+
+        glVertexPointer(2, GL_FLOAT, sizeof(struct vertex), VOFFSET(x));
+        glTexCoordPointer(2, GL_FLOAT, sizeof(struct vertex), VOFFSET(s));
+        glEnableClientState(GL_VERTEX_ARRAY);
+        glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    }else{
+        glGenVertexArrays(1, &VAO);
+        glBindVertexArray(VAO);
+
+        glGenBuffers(1, &VBO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+
+        const GLint vPos_location = glGetAttribLocation(program, "vPos");
+        const GLint vTexCoord_location = glGetAttribLocation(program, "vTexCoord");
+        printf("Attrib location: vPos=%d\n", vPos_location);
+        printf("Attrib location: vTexCoord=%d\n", vTexCoord_location);
+        glVertexAttribPointer(vPos_location, 2, GL_FLOAT, GL_FALSE,
+                              sizeof(struct vertex), (void*)VOFFSET(x));
+        glVertexAttribPointer(vTexCoord_location, 2, GL_FLOAT, GL_FALSE,
+                              sizeof(struct vertex), (void *)VOFFSET(s) );
+        glEnableVertexAttribArray(vPos_location);
+        glEnableVertexAttribArray(vTexCoord_location);
     }
 
-    /* clear the FBO */
-    static const GLenum attachments[1] = {
-        GL_COLOR_ATTACHMENT0,
-    };
-    glDrawBuffers( 1, attachments);
-    glViewport(0, 0, MaxSize, MaxSize);
-    glClear(GL_COLOR_BUFFER_BIT);
-
     // set up texture data and configure texture attributes
     // ------------------------------------------------------------------
     glGenTextures(1, &Tex);
@@ -161,20 +115,29 @@ static void PerfInit()
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
 
-#if IS_GlLegacy
-    glEnable(GL_TEXTURE_2D);
-#else
-    glActiveTexture( GL_TEXTURE0 );
-    glBindTexture( GL_TEXTURE_2D, Tex );
-
-    // set the sampler texture unit to 0
-    glUseProgram(program);
-    samplerLoc = glGetUniformLocation( program, "s_texture" );
-    glUniform1i( samplerLoc, 0 );
-#endif
+    if( Api.api == API_GLLegacy ){
+        glEnable(GL_TEXTURE_2D);
+    }else{
+        glActiveTexture( GL_TEXTURE0 );
+        glBindTexture( GL_TEXTURE_2D, Tex );
+
+        // set the sampler texture unit to 0
+        glUseProgram(program);
+        samplerLoc = glGetUniformLocation( program, "s_texture" );
+        glUniform1i( samplerLoc, 0 );
+    }
 }
 
 
+/* the source, a render target of TexSize x TexSize, created per size so that large sizes don't stay allocated */
+static int CreateTarget()
+{
+    if( !RenderTarget_Create( &Target, TexSize, TexSize, Format->internalFormat, GL_NONE, 0 ) )
+        return 0;
+    glClear(GL_COLOR_BUFFER_BIT);
+    return 1;
+}
+
 static void CopyTexImage(unsigned count)
 {
     glBindTexture(GL_TEXTURE_2D, Tex);
@@ -188,7 +151,7 @@ static void CopyTexImage(unsigned count)
 
         /* copy whole texture */
         glCopyTexImage2D(GL_TEXTURE_2D, 0,
-                         GL_RGBA, 0, 0, TexSize, TexSize, 0);
+                         Format->internalFormat, 0, 0, TexSize, TexSize, 0);
     }
     glFinish();
 }
@@ -238,7 +201,7 @@ void PerfDraw()
     GLint sub, maxTexSize;
 
     glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTexSize);
-    printf("GL_MAX_TEXTURE_SIZE = %d\n", maxTexSize);
+    printf("GL_MAX_TEXTURE_SIZE = %d, RenderTarget_MaxSize = %d, %s\n", maxTexSize, RenderTarget_MaxSize(), Format->name);
 
     /* loop over whole/sub tex copy */
     for (sub = 0; sub < 2; sub++) {
@@ -246,27 +209,29 @@ void PerfDraw()
         /* loop over texture sizes */
         for (TexSize = MinSize; TexSize <= MaxSize; TexSize *= 4) {
 
-            if (TexSize <= maxTexSize) {
-                GLint bytesPerImage = 4 * TexSize * TexSize;
+            if (TexSize <= maxTexSize && CreateTarget()) {
+                double bytesPerImage = (double)Format->bytesPerPixel * TexSize * TexSize;
 
                 if (sub == 0)
                     rate = PerfMeasureRate(CopyTexImage, eglx_PollEvents );
                 else {
                     /* setup empty dest texture */
-                    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA,
+                    glBindTexture(GL_TEXTURE_2D, Tex);
+                    glTexImage2D(GL_TEXTURE_2D, 0, Format->internalFormat,
                                  TexSize, TexSize, 0,
-                                 GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+                                 Format->format, Format->type, NULL);
                     rate = PerfMeasureRate(CopyTexSubImage, eglx_PollEvents );
                 }
 
                 mbPerSec = rate * bytesPerImage / (1024.0 * 1024.0);
+                RenderTarget_Destroy( &Target );
             }
             else {
                 rate = 0.0;
                 mbPerSec = 0.0;
             }
 
-            printf("  glCopyTex%sImage(%d x %d)%s: %.1f copies/sec, %.1f Mpixels/sec\n",
+            printf("  glCopyTex%sImage(%d x %d)%s: %.1f copies/sec, %.1f MB/sec\n",
                    (sub ? "Sub" : ""), TexSize, TexSize,
                    (DrawPoint) ? " + Draw" : "",
                    rate, mbPerSec);
@@ -282,34 +247,36 @@ void PerfDraw2( int sub, int TexSize_ )
     GLint maxTexSize;
 
     glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTexSize);
-    printf("GL_MAX_TEXTURE_SIZE = %d\n", maxTexSize);
+    printf("GL_MAX_TEXTURE_SIZE = %d, RenderTarget_MaxSize = %d, %s\n", maxTexSize, RenderTarget_MaxSize(), Format->name);
 
     {
         TexSize = TexSize_;
 
         {
 
-            if (TexSize <= maxTexSize) {
-                GLint bytesPerImage = 4 * TexSize * TexSize;
+            if (TexSize <= maxTexSize && CreateTarget()) {
+                double bytesPerImage = (double)Format->bytesPerPixel * TexSize * TexSize;
 
                 if (sub == 0)
                     rate = PerfMeasureRate(CopyTexImage, eglx_PollEvents );
                 else {
                     /* setup empty dest texture */
-                    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA,
+                    glBindTexture(GL_TEXTURE_2D, Tex);
+                    glTexImage2D(GL_TEXTURE_2D, 0, Format->internalFormat,
                                  TexSize, TexSize, 0,
-                                 GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+                                 Format->format, Format->type, NULL);
                     rate = PerfMeasureRate(CopyTexSubImage, eglx_PollEvents );
                 }
 
                 mbPerSec = rate * bytesPerImage / (1024.0 * 1024.0);
+                RenderTarget_Destroy( &Target );
             }
             else {
                 rate = 0.0;
                 mbPerSec = 0.0;
             }
 
-            printf("  glCopyTex%sImage(%d x %d)%s: %.1f copies/sec, %.1f Mpixels/sec\n",
+            printf("  glCopyTex%sImage(%d x %d)%s: %.1f copies/sec, %.1f MB/sec\n",
                    (sub ? "Sub" : ""), TexSize, TexSize,
                    (DrawPoint) ? " + Draw" : "",
                    rate, mbPerSec);
@@ -322,21 +289,30 @@ void PerfDraw2( int sub, int TexSize_ )
 
 int main( int argc, const char* argv[] )
 {
-    api_t api = apiInitial( API_Current, argc, argv );
-    printf("%s: %s\n", argv[0], apiName(api));
+    Api = apiInitial( API_Any, argc, argv );
+    printf("%s: %s\n", argv[0], apiName(Api));
 
     int __testcase = integerFromArgs( "--testcase", argc, argv, NULL );
     int __mode = integerFromArgs( "--mode", argc, argv, NULL );
     int __draw = integerFromArgs("--draw", argc, argv, NULL );
+    int __format = integerFromArgs("--format", argc, argv, NULL );
+    int __maxsize = integerFromArgs("--maxsize", argc, argv, NULL );
 
     // initialize and configure
     // ------------------------------
-    eglx_CreateWindow( api, WinWidth, WinHeight );
+    eglx_CreateWindow( Api, WinWidth, WinHeight );
 
     // init
     // -----------
     PerfInit();
 
+    if( __format < 0 || __format >= (int)(sizeof(Formats)/sizeof(Formats[0])) )
+        __format = 0;
+    Format = RenderTarget_GetFormat( Formats[__format] );
+    MaxSize = RenderTarget_MaxSize();
+    if( __maxsize > 0 && __maxsize < MaxSize )
+        MaxSize = __maxsize;
+
     // render loop
     // -----------
     while (!eglx_ShouldClose())
@@ -0,0 +1,257 @@
+/**
+ * Measure depth/stencil test throughput, and how much overdraw early-Z saves:
+ * every frame draws Layers overlapping fullscreen quads with a costly fragment shader (16 iterations).
+ *   --mode 0: no depth test, every layer is shaded
+ *   --mode 1: depth test, back to front, every layer passes
+ *   --mode 2: depth test, front to back, early-Z rejects the hidden layers
+ *   --mode 3: depth prepass, then shading with GL_LEQUAL, back to front
+ *   --mode 4: depth test, front to back, half of the fragments discarded in the shader (alpha test)
+ *   --mode 5: no depth test, stencil test passing half of the target
+ *   --layers N: number of layers, default 8
+ * Effective pixels/second counts all the layers, shaded or rejected.
+ * One build for gl and gles: --api gl33 or gles32
+ */
+#include <stdio.h>
+#include "glad.h"
+#include "glUtils.h"
+#include "eglUtils.h"
+#include "myUtils.h"
+
+
+// settings
+static const int WinWidth = 200;
+static const int WinHeight = 200;
+
+static const GLsizei TargetSize = 1024;
+
+static api_t Api;
+static GLuint VAO;
+static GLuint VBO;
+static GLuint program;
+static GLuint programPrepass;
+static GLint depthStartLoc, depthStepLoc, alphaTestLoc;
+static GLint prepassDepthStartLoc, prepassDepthStepLoc;
+
+static RenderTarget Target;
+static int Mode;
+static GLsizei Layers = 8;
+
+static const char *modeNames[] = {
+    "no depth test",
+    "depth test, back to front",
+    "depth test, front to back",
+    "depth prepass + GL_LEQUAL",
+    "depth test, front to back, discard",
+    "stencil test, half target",
+};
+
+struct vertex
+{
+    GLfloat x, y;
+};
+
+static const struct vertex vertices[4] = {
+    { -1.0, -1.0 },
+    {  1.0, -1.0 },
+    {  1.0,  1.0 },
+    { -1.0,  1.0 }
+};
+
+// layer i is at depth DepthStart + i * DepthStep, in instance order; #version is glslVersion( Api )
+const char *vertexShaderBody =
+    "uniform float DepthStart;\n"
+    "uniform float DepthStep;\n"
+    "layout (location = 0) in vec2 vPos;\n"
+    "out vec2 v_texCoord;\n"
+    "invariant gl_Position;\n"
+    "void main()\n"
+    "{\n"
+    "   gl_Position = vec4( vPos.x, vPos.y, DepthStart + float(gl_InstanceID) * DepthStep, 1.0 );\n"
+    "   v_texCoord = vPos * 0.5 + 0.5;\n"
+    "}\n\0";
+
+const char *fragmentShaderBody =
+    "#ifdef GL_ES\n"
+    "precision highp float;\n"
+    "#endif\n"
+    "uniform float AlphaTest;\n"
+    "in vec2 v_texCoord;\n"
+    "layout (location = 0) out vec4 outColor;\n"
+    "void main()\n"
+    "{\n"
+    "   vec4 c = vec4( v_texCoord, 0.5, 1.0 );\n"
+    "   for( int i = 0; i < 16; i++ )\n"
+    "       c = fract( c * 1.618 + vec4(0.1, 0.2, 0.3, 0.4) );\n"
+    "   float alpha = fract( gl_FragCoord.x * 0.125 );\n"
+    "   if( alpha < AlphaTest )\n"
+    "       discard;\n"
+    "   outColor = c;\n"
+    "}\n\0";
+
+const char *fragmentShaderBody_prepass =
+    "in vec2 v_texCoord;\n"
+    "layout (location = 0) out vec4 outColor;\n"
+    "void main()\n"
+    "{\n"
+    "   outColor = vec4( 0.0 );\n"
+    "}\n\0";
+
+static void PerfInit()
+{
+    // build and compile our shader program
+    // ------------------------------------
+    program = CreateProgramFromBody( Api, vertexShaderBody, fragmentShaderBody );
+    depthStartLoc = glGetUniformLocation( program, "DepthStart" );
+    depthStepLoc = glGetUniformLocation( program, "DepthStep" );
+    alphaTestLoc = glGetUniformLocation( program, "AlphaTest" );
+
+    programPrepass = CreateProgramFromBody( Api, vertexShaderBody, fragmentShaderBody_prepass );
+    prepassDepthStartLoc = glGetUniformLocation( programPrepass, "DepthStart" );
+    prepassDepthStepLoc = glGetUniformLocation( programPrepass, "DepthStep" );
+
+    // set up vertex data (and buffer(s)) and configure vertex attributes
+    // ------------------------------------------------------------------
+    glGenVertexArrays(1, &VAO);
+    glBindVertexArray(VAO);
+
+    glGenBuffers(1, &VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+
+    glVertexAttribPointer( 0, 2, GL_FLOAT, GL_FALSE, sizeof(struct vertex), (void*) 0 );
+    glEnableVertexAttribArray(0);
+
+    // offscreen target, independent of the window size
+    // ------------------------------------------------------------------
+    if( !RenderTarget_Create( &Target, TargetSize, TargetSize, GL_RGBA8, GL_DEPTH24_STENCIL8, 0 ) )
+        exit(EXIT_FAILURE);
+}
+
+/* layers from z = -0.9 (front) to z = 0.9 (back), or the other way */
+static void DrawLayers( GLuint prog, GLint startLoc, GLint stepLoc, int frontToBack )
+{
+    const float step = 1.8f / (Layers > 1 ? Layers - 1 : 1);
+
+    glUseProgram( prog );
+    glUniform1f( startLoc, frontToBack ? -0.9f : 0.9f );
+    glUniform1f( stepLoc, frontToBack ? step : -step );
+    glDrawArraysInstanced( GL_TRIANGLE_FAN, 0, 4, Layers );
+}
+
+static void DrawFrames(unsigned count)
+{
+    for (unsigned i = 0; i < count; i++) {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+
+        if (Mode == 5) {
+            // stencil = 1 in the left half
+            glEnable(GL_SCISSOR_TEST);
+            glScissor(0, 0, TargetSize / 2, TargetSize);
+            glClearStencil(1);
+            glClear(GL_STENCIL_BUFFER_BIT);
+            glClearStencil(0);
+            glDisable(GL_SCISSOR_TEST);
+        }
+
+        if (Mode == 3) {
+            glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+            glDepthFunc(GL_LESS);
+            DrawLayers( programPrepass, prepassDepthStartLoc, prepassDepthStepLoc, 0 );
+            glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+            glDepthFunc(GL_LEQUAL);
+            glDepthMask(GL_FALSE);
+            DrawLayers( program, depthStartLoc, depthStepLoc, 0 );
+            glDepthMask(GL_TRUE);
+        }
+        else {
+            DrawLayers( program, depthStartLoc, depthStepLoc, Mode == 2 || Mode == 4 );
+        }
+
+        if (i % 16 == 0)
+            glFlush();
+    }
+    glFinish();
+}
+
+static void SetupMode( int mode )
+{
+    Mode = mode;
+
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_STENCIL_TEST);
+    glDepthFunc(GL_LESS);
+
+    glUseProgram( program );
+    glUniform1f( alphaTestLoc, mode == 4 ? 0.5f : 0.0f );
+
+    if (mode >= 1 && mode <= 4)
+        glEnable(GL_DEPTH_TEST);
+    if (mode == 5) {
+        glEnable(GL_STENCIL_TEST);
+        glStencilFunc(GL_EQUAL, 1, 0xFF);
+        glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+    }
+}
+
+static void PerfDraw( int mode )
+{
+    const double pixelsPerFrame = (double)TargetSize * TargetSize * Layers;
+    double baseline = 0.0;
+
+    printf("%d x %d, %d layers\n", TargetSize, TargetSize, Layers);
+    for( int m = 0; m < (int)(sizeof(modeNames)/sizeof(modeNames[0])); m++ ){
+        if( mode != -1 && mode != m && m != 0 )
+            continue;
+
+        SetupMode( m );
+        const double rate = PerfMeasureRate(DrawFrames, eglx_PollEvents ) * pixelsPerFrame;
+        if( m == 0 )
+            baseline = rate;
+        if( mode != -1 && mode != m )
+            continue;
+
+        printf("   %-36s: %s effective pixels/second, x%.2f of no depth test\n",
+               modeNames[m], PerfHumanFloat(rate), rate / baseline);
+    }
+
+    glErrorCheck();
+    exit(0);
+}
+
+int main( int argc, const char* argv[] )
+{
+    Api = apiInitial( API_AnyShader, argc, argv );
+    printf("%s: %s\n", argv[0], apiName(Api));
+
+    int __mode = integerFromArgs("--mode", argc, argv, NULL );
+    int __layers = integerFromArgs("--layers", argc, argv, NULL );
+    if( __layers > 0 )
+        Layers = __layers;
+
+    // initialize and configure
+    // ------------------------------
+    eglx_CreateWindow( Api, WinWidth, WinHeight );
+
+    // init
+    // -----------
+    PerfInit();
+
+    // render loop
+    // -----------
+    while (!eglx_ShouldClose())
+    {
+        // render
+        // ------
+        PerfDraw( __mode );
+
+        // swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
+        // -------------------------------------------------------------------------------
+        eglx_SwapBuffers();
+        eglx_PollEvents();
+    }
+
+    // terminate, clearing all previously allocated resources.
+    // ------------------------------------------------------------------
+    eglx_Terminate();
+    return 0;
+}
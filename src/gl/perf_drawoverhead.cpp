@@ -1,5 +1,6 @@
 /**
  * Measure drawing overhead
+ * One build for all apis: --api gl30 (glLegacy), gl33 or gles32
  */
 #include <stdio.h>
 #include "glad.h"
@@ -13,6 +14,7 @@ static const int WinWidth = 200;
 static const int WinHeight = 200;
 
 
+static api_t Api;
 static GLuint VAO;
 static GLuint VBO;
 static GLuint program;
@@ -29,28 +31,18 @@ static const struct vertex vertices[] = {
 };
 
 
-const char *vertexShaderSource =
-#if IS_GlEs
-    "#version 320 es\n"
-#else
-    "#version 330\n"
-#endif
+// #version is glslVersion( Api )
+const char *vertexShaderBody =
     "layout (location = 0) in vec2 vPos;\n"
     "void main()\n"
     "{\n"
     "   gl_Position = vec4( vPos.x, vPos.y, 0.0f, 1.0f );\n"
-#if IS_GlEs
+    "#ifdef GL_ES\n"
     "   gl_PointSize = 1.0;\n" // make IMG gpu happy
-#endif
+    "#endif\n"
     "}\n\0";
 
-const char *fragmentShaderSource =
-#if IS_GlEs
-    "#version 320 es\n"
-    "precision mediump float;\n"
-#else
-    "#version 330\n"
-#endif
+const char *fragmentShaderBody =
     "layout (location = 0) out vec4 outColor;\n"
     "void main()\n"
     "{\n"
@@ -61,34 +53,34 @@ static void PerfInit()
 {
     // build and compile our shader program
     // ------------------------------------
-#if !IS_GlLegacy
-    program = CreateProgramFromSource( vertexShaderSource, fragmentShaderSource );
-    glUseProgram(program);
-#endif
+    if( Api.api != API_GLLegacy ){
+        program = CreateProgramFromBody( Api, vertexShaderBody, fragmentShaderBody );
+        glUseProgram(program);
+    }
 
     // set up vertex data (and buffer(s)) and configure vertex attributes
     // ------------------------------------------------------------------
-#if IS_GlLegacy
-    glGenBuffers(1, &VBO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER,sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-    glVertexPointer(2, GL_FLOAT, sizeof(struct vertex), (void *)0);
-    glEnableClientState(GL_VERTEX_ARRAY);
-#else
-    glGenVertexArrays(1, &VAO);
-    glBindVertexArray(VAO);
-
-    glGenBuffers(1, &VBO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-    const GLint vPos_location = glGetAttribLocation(program, "vPos");
-    printf("Attrib location: vPos=%d\n", vPos_location);
-    glVertexAttribPointer(vPos_location, 2, GL_FLOAT, GL_FALSE,
-                          sizeof(struct vertex), (void*) 0);
-    glEnableVertexAttribArray(vPos_location);
-#endif
+    if( Api.api == API_GLLegacy ){
+        glGenBuffers(1, &VBO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER,sizeof(vertices), vertices, GL_STATIC_DRAW);
+
+        glVertexPointer(2, GL_FLOAT, sizeof(struct vertex), (void *)0);
+        glEnableClientState(GL_VERTEX_ARRAY);
+    }else{
+        glGenVertexArrays(1, &VAO);
+        glBindVertexArray(VAO);
+
+        glGenBuffers(1, &VBO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+
+        const GLint vPos_location = glGetAttribLocation(program, "vPos");
+        printf("Attrib location: vPos=%d\n", vPos_location);
+        glVertexAttribPointer(vPos_location, 2, GL_FLOAT, GL_FALSE,
+                              sizeof(struct vertex), (void*) 0);
+        glEnableVertexAttribArray(vPos_location);
+    }
 
     // misc GL state
     // ------------------------------------------------------------------
@@ -134,9 +126,43 @@ static void DrawStateChange(unsigned count)
     glFinish();
 }
 
+/* Same as DrawNopStateChange(), but filtered by the GL state cache */
+static void DrawNopStateChangeFiltered(unsigned count)
+{
+    unsigned i;
+    for (i = 0; i < count; i++) {
+        StateCache_Disable(GL_DEPTH_TEST);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+    glFinish();
+}
+
+
+/* Same as DrawStateChange(), but filtered by the GL state cache */
+static void DrawStateChangeFiltered(unsigned count)
+{
+    unsigned i;
+    for (i = 0; i < count; i++) {
+        if (i & 1){
+            StateCache_Enable(GL_DEPTH_TEST);
+        }else{
+            StateCache_Disable(GL_DEPTH_TEST);
+        }
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+    glFinish();
+}
+
+static void PrintStateCacheStats()
+{
+    glStateCacheStats_t stats = StateCache_GetStats();
+    printf("      state cache: %s GL calls issued, %s elided\n",
+           PerfHumanFloat(stats.issued), PerfHumanFloat(stats.elided));
+}
+
 static void PerfDraw(int mode)
 {
-    double rate0, rate1, rate2, overhead;
+    double rate0, rate1, rate2, rate3, rate4, overhead;
 
     if( mode == -1 || mode == 0 ) {
         rate0 = PerfMeasureRate(DrawNoStateChange, eglx_PollEvents );
@@ -158,20 +184,40 @@ static void PerfDraw(int mode)
         eglx_SwapBuffers();
     }
 
+    if( mode == -1 || mode == 3 ) {
+        StateCache_Invalidate();
+        StateCache_ResetStats();
+        rate3 = PerfMeasureRate(DrawNopStateChangeFiltered, eglx_PollEvents );
+        overhead = 1000.0 * (1.0 / rate3 - 1.0 / rate0);
+        printf("   Draw w/ nop state change, filtered: %s draws/sec (overhead: %f ms/draw)\n", PerfHumanFloat(rate3), overhead);
+        PrintStateCacheStats();
+        eglx_SwapBuffers();
+    }
+
+    if( mode == -1 || mode == 4 ) {
+        StateCache_Invalidate();
+        StateCache_ResetStats();
+        rate4 = PerfMeasureRate(DrawStateChangeFiltered, eglx_PollEvents );
+        overhead = 1000.0 * (1.0 / rate4 - 1.0 / rate0);
+        printf("   Draw w/ state change, filtered: %s draws/sec (overhead: %f ms/draw)\n", PerfHumanFloat(rate4), overhead);
+        PrintStateCacheStats();
+        eglx_SwapBuffers();
+    }
+
     glErrorCheck();
     exit(0);
 }
 
 int main( int argc, const char* argv[] )
 {
-    api_t api = apiInitial( API_Current, argc, argv );
-    printf("%s: %s\n", argv[0], apiName(api));
+    Api = apiInitial( API_Current, argc, argv );
+    printf("%s: %s\n", argv[0], apiName(Api));
 
     int __mode = integerFromArgs("--mode", argc, argv, NULL );
 
     // initialize and configure
     // ------------------------------
-    eglx_CreateWindow( api, WinWidth, WinHeight );
+    eglx_CreateWindow( Api, WinWidth, WinHeight );
 
     // init
     // -----------
@@ -2,6 +2,7 @@
  * Measure rate of binding/switching between FBO targets.
  * Create two framebuffer objects for rendering to two textures.
  * Ping pong between texturing from one and drawing into the other.
+ * One build for all apis: --api gl30 (glLegacy), gl33 or gles32
  */
 #include <stdio.h>
 #include <stddef.h>
@@ -15,6 +16,7 @@
 static int WinWidth = 200;
 static int WinHeight = 200;
 
+static api_t Api;
 static GLuint VAO, VBO;
 static GLuint FBO[2], Tex[2];
 static const GLsizei TexSize = 512;
@@ -33,12 +35,7 @@ static const struct vertex vertices[1] = {
 
 #define VOFFSET(F) ((void *) offsetof(struct vertex, F))
 
-const char *vertexShaderSource =
-#if IS_GlEs
-    "#version 320 es\n"
-#else
-    "#version 330\n"
- #endif
+const char *vertexShaderBody =
     "layout (location = 0) in vec2 vPos;\n"
     "layout (location = 1) in vec2 vTexCoord;\n"
     "out vec2 v_texCoord;\n"
@@ -46,18 +43,12 @@ const char *vertexShaderSource =
     "{\n"
     "   gl_Position = vec4( vPos.x, vPos.y, 0.0f, 1.0f );\n"
     "   v_texCoord = vTexCoord;\n"
-    #if IS_GlEs
+    "#ifdef GL_ES\n"
     "   gl_PointSize = 1.0;\n" // make IMG gpu happy
-    #endif
+    "#endif\n"
     "}\n\0";
 
-const char *fragmentShaderSource =
-#if IS_GlEs
-    "#version 320 es\n"
-    "precision mediump float;\n"
-#else
-    "#version 330\n"
-#endif
+const char *fragmentShaderBody =
     "in vec2 v_texCoord;\n"
     "layout (location = 0) out vec4 outColor;\n"
     "uniform sampler2D s_texture;\n"
@@ -70,41 +61,41 @@ static void PerfInit()
 {
     // build and compile our shader program
     // ------------------------------------
-#if !IS_GlLegacy
-    program = CreateProgramFromSource( vertexShaderSource, fragmentShaderSource );
-    samplerLoc = glGetUniformLocation( program, "s_texture" );
-#endif
+    if( Api.api != API_GLLegacy ){
+        program = CreateProgramFromBody( Api, vertexShaderBody, fragmentShaderBody );
+        samplerLoc = glGetUniformLocation( program, "s_texture" );
+    }
 
     // set up vertex data (and buffer(s)) and configure vertex attributes
     // ------------------------------------------------------------------
-#if IS_GlLegacy
-    glGenBuffers(1, &VBO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices),vertices, GL_STATIC_DRAW);
-
-    glVertexPointer(2, GL_FLOAT, sizeof(struct vertex), VOFFSET(x));
-    glTexCoordPointer(2, GL_FLOAT, sizeof(struct vertex), VOFFSET(s));
-    glEnableClientState(GL_VERTEX_ARRAY);
-    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-#else
-    glGenVertexArrays(1, &VAO);
-    glBindVertexArray(VAO);
-
-    glGenBuffers(1, &VBO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-    const GLint vPos_location = glGetAttribLocation(program, "vPos");
-    const GLint vTexCoord_location = glGetAttribLocation(program, "vTexCoord");
-    printf("Attrib location: vPos=%d\n", vPos_location);
-    printf("Attrib location: vTexCoord=%d\n", vTexCoord_location);
-    glVertexAttribPointer(vPos_location, 2, GL_FLOAT, GL_FALSE,
-                          sizeof(struct vertex), (void*)VOFFSET(x));
-    glVertexAttribPointer(vTexCoord_location, 2, GL_FLOAT, GL_FALSE,
-                          sizeof(struct vertex), (void *)VOFFSET(s) );
-    glEnableVertexAttribArray(vPos_location);
-    glEnableVertexAttribArray(vTexCoord_location);
-#endif
+    if( Api.api == API_GLLegacy ){
+        glGenBuffers(1, &VBO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices),vertices, GL_STATIC_DRAW);
+
+        glVertexPointer(2, GL_FLOAT, sizeof(struct vertex), VOFFSET(x));
+        glTexCoordPointer(2, GL_FLOAT, sizeof(struct vertex), VOFFSET(s));
+        glEnableClientState(GL_VERTEX_ARRAY);
+        glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    }else{
+        glGenVertexArrays(1, &VAO);
+        glBindVertexArray(VAO);
+
+        glGenBuffers(1, &VBO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+
+        const GLint vPos_location = glGetAttribLocation(program, "vPos");
+        const GLint vTexCoord_location = glGetAttribLocation(program, "vTexCoord");
+        printf("Attrib location: vPos=%d\n", vPos_location);
+        printf("Attrib location: vTexCoord=%d\n", vTexCoord_location);
+        glVertexAttribPointer(vPos_location, 2, GL_FLOAT, GL_FALSE,
+                              sizeof(struct vertex), (void*)VOFFSET(x));
+        glVertexAttribPointer(vTexCoord_location, 2, GL_FLOAT, GL_FALSE,
+                              sizeof(struct vertex), (void *)VOFFSET(s) );
+        glEnableVertexAttribArray(vPos_location);
+        glEnableVertexAttribArray(vTexCoord_location);
+    }
 
     // setup fbo
     // ------------------------------------
@@ -133,13 +124,11 @@ static void PerfInit()
         glClear(GL_COLOR_BUFFER_BIT);
     }
 
-#if IS_GlLegacy
-    glEnable(GL_TEXTURE_2D);
-#else
-    // do nothing
-#endif
+    if( Api.api == API_GLLegacy )
+        glEnable(GL_TEXTURE_2D);
 }
 
+template<int API>
 static void FBOBind(unsigned count)
 {
     unsigned i;
@@ -148,15 +137,15 @@ static void FBOBind(unsigned count)
         const GLuint src = 1 - dst;
 
         /* bind src texture */
-#if IS_GlLegacy
-        glBindTexture(GL_TEXTURE_2D, Tex[src]);
-#else
-        glActiveTexture( GL_TEXTURE0 + src );
-        glBindTexture( GL_TEXTURE_2D, Tex[src] );
-
-        glUseProgram(program);
-        glUniform1i( samplerLoc, src );
-#endif
+        if constexpr( API == API_GLLegacy ){
+            glBindTexture(GL_TEXTURE_2D, Tex[src]);
+        }else{
+            glActiveTexture( GL_TEXTURE0 + src );
+            glBindTexture( GL_TEXTURE_2D, Tex[src] );
+
+            glUseProgram(program);
+            glUniform1i( samplerLoc, src );
+        }
 
         /* bind dst fbo */
         glBindFramebuffer(GL_FRAMEBUFFER, FBO[dst]);
@@ -172,7 +161,7 @@ static void FBOBind(unsigned count)
 
 void PerfDraw()
 {
-    double rate = PerfMeasureRate(FBOBind, eglx_PollEvents );
+    double rate = PerfMeasureRate(API_Select(FBOBind, Api), eglx_PollEvents );
     printf("  FBO Binding: %1.f binds/sec\n", rate);
 
     glErrorCheck();
@@ -181,14 +170,14 @@ void PerfDraw()
 
 int main( int argc, const char* argv[] )
 {
-    api_t api = apiInitial( API_Current, argc, argv );
-    printf("%s: %s\n", argv[0], apiName(api));
+    Api = apiInitial( API_Any, argc, argv );
+    printf("%s: %s\n", argv[0], apiName(Api));
 
     int __draw = integerFromArgs("--draw", argc, argv, NULL );
 
     // initialize and configure
     // ------------------------------
-    eglx_CreateWindow( api, WinWidth, WinHeight );
+    eglx_CreateWindow( Api, WinWidth, WinHeight );
 
     // init
     // -----------
@@ -1,5 +1,10 @@
 /**
  * Measure fill rates.
+ *   --offscreen: sweep offscreen render targets, RGBA8 / RGB10_A2 / RGBA16F, up to RenderTarget_MaxSize()
+ *     --samples N: multisampled targets
+ *     --depth 1: with a depth24/stencil8 attachment, written by every fill
+ *     --maxsize N: stop the sweep at N x N
+ * One build for gl and gles: --api gl33 or gles32
  */
 #include <stdio.h>
 #include <stddef.h>
@@ -15,6 +20,8 @@ static const int WinWidth = 1000;
 static const int WinHeight = 1000;
 
 
+static api_t Api;
+
 static GLuint VAO;
 static GLuint VBO;
 static GLuint TexObj;
@@ -23,6 +30,9 @@ static GLuint ShaderProg_textured;
 static GLuint ShaderProg1;
 static GLuint ShaderProg2;
 
+static RenderTarget Target;
+static const GLsizei OffscreenMinSize = 256;
+
 struct vertex
 {
     GLfloat x, y, s, t, r, g, b, a;
@@ -41,12 +51,7 @@ static const struct vertex vertices[4] = {
 
 // simple fill, blended fill
 // ------------------------------------------------------------------
-const char *vertexShaderSource_simple =
-#if IS_GlEs
-    "#version 320 es\n"
-#else
-    "#version 330\n"
-#endif
+const char *vertexShaderBody_simple =
     "uniform mat4 MVP;\n"
     "layout (location = 0) in vec2 vPos;\n"
     "layout (location = 1) in vec4 vCol;\n"
@@ -57,13 +62,7 @@ const char *vertexShaderSource_simple =
     "   v_color = vCol;\n"
     "}\n\0";
 
-const char *fragmentShaderSource_simple =
-#if IS_GlEs
-    "#version 320 es\n"
-    "precision mediump float;\n"
-#else
-    "#version 330\n"
-#endif
+const char *fragmentShaderBody_simple =
     "in vec4 v_color;\n"
     "layout (location = 0) out vec4 outColor;\n"
     "void main()\n"
@@ -74,12 +73,7 @@ const char *fragmentShaderSource_simple =
 
 // textured fill
 // ------------------------------------------------------------------
-const char *vertexShaderSource_textured =
-#if IS_GlEs
-    "#version 320 es\n"
-#else
-    "#version 330\n"
-    #endif
+const char *vertexShaderBody_textured =
     "uniform mat4 MVP;\n"
     "layout (location = 0) in vec2 vPos;\n"
     "layout (location = 1) in vec4 vCol;\n"
@@ -93,13 +87,7 @@ const char *vertexShaderSource_textured =
     "   v_color = vCol;\n"
     "}\n\0";
 
-const char *fragmentShaderSource_textured =
-#if IS_GlEs
-    "#version 320 es\n"
-    "precision mediump float;\n"
-#else
-    "#version 330\n"
-    #endif
+const char *fragmentShaderBody_textured =
     "uniform sampler2D Tex;\n"
     "in vec2 v_texCoord;\n"
     "in vec4 v_color;\n"
@@ -113,12 +101,7 @@ const char *fragmentShaderSource_textured =
 
 // shader1 fill, shader2 fill
 // ------------------------------------------------------------------
-const char *vertexShaderSource =
-#if IS_GlEs
-    "#version 320 es\n"
-#else
-    "#version 330\n"
-#endif
+const char *vertexShaderBody =
     "uniform mat4 MVP;\n"
     "layout (location = 0) in vec2 vPos;\n"
     "layout (location = 1) in vec4 vCol;\n"
@@ -133,13 +116,7 @@ const char *vertexShaderSource =
     "}\n\0";
 
 /* simple fragment shader */
-const char *fragmentShaderSource1 =
-#if IS_GlEs
-    "#version 320 es\n"
-    "precision mediump float;\n"
-#else
-    "#version 330\n"
-#endif
+const char *fragmentShaderBody1 =
     "uniform sampler2D Tex;\n"
     "in vec2 v_texCoord;\n"
     "in vec4 v_color;\n"
@@ -155,13 +132,7 @@ const char *fragmentShaderSource1 =
  * A good optimizer should catch some of these no-op operations, but
  * probably not all of them.
  */
-const char *fragmentShaderSource2 =
-#if IS_GlEs
-    "#version 320 es\n"
-    "precision mediump float;\n"
-#else
-    "#version 330\n"
-#endif
+const char *fragmentShaderBody2 =
     "uniform sampler2D Tex;\n"
     "in vec2 v_texCoord;\n"
     "in vec4 v_color;\n"
@@ -210,17 +181,17 @@ static void PerfInit()
 {
     // build and compile our shader program
     // ------------------------------------
-    ShaderProg_simple = CreateProgramFromSource(vertexShaderSource_simple, fragmentShaderSource_simple);
+    ShaderProg_simple = CreateProgramFromBody( Api, vertexShaderBody_simple, fragmentShaderBody_simple);
 
-    ShaderProg_textured = CreateProgramFromSource(vertexShaderSource_textured, fragmentShaderSource_textured);
+    ShaderProg_textured = CreateProgramFromBody( Api, vertexShaderBody_textured, fragmentShaderBody_textured);
     glUseProgram(ShaderProg_textured);
     glUniform1i(glGetUniformLocation(ShaderProg_textured, "Tex"), 0);  /* texture unit 0 */
 
-    ShaderProg1 = CreateProgramFromSource(vertexShaderSource, fragmentShaderSource1);
+    ShaderProg1 = CreateProgramFromBody( Api, vertexShaderBody, fragmentShaderBody1);
     glUseProgram(ShaderProg1);
     glUniform1i(glGetUniformLocation(ShaderProg1, "Tex"), 0);  /* texture unit 0 */
 
-    ShaderProg2 = CreateProgramFromSource(vertexShaderSource, fragmentShaderSource2);
+    ShaderProg2 = CreateProgramFromBody( Api, vertexShaderBody, fragmentShaderBody2);
     glUseProgram(ShaderProg2);
     glUniform1i(glGetUniformLocation(ShaderProg2, "Tex"), 0);  /* texture unit 0 */
 
@@ -300,6 +271,72 @@ static void DrawQuad(unsigned count)
 
 }
 
+/* no swap for offscreen targets, flush to keep command buffers small instead */
+static void DrawQuadOffscreen(unsigned count)
+{
+    unsigned i;
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+
+    for (i = 0; i < count; i++) {
+        glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+
+        if (i % 128 == 0)
+            glFlush();
+    }
+
+    glFinish();
+}
+
+static void PerfDrawOffscreen( GLsizei samples, int depth, GLsizei maxSize )
+{
+    static const GLenum formats[] = { GL_RGBA8, GL_RGB10_A2, GL_RGBA16F };
+
+    GLsizei size = RenderTarget_MaxSize();
+    printf("RenderTarget_MaxSize = %d, samples = %d, depth24/stencil8 = %d\n", size, samples, depth);
+    if( maxSize > 0 && maxSize < size )
+        size = maxSize;
+
+    Ortho();
+    glUseProgram( ShaderProg_simple );
+    if( depth ){
+        glEnable(GL_DEPTH_TEST);
+        glDepthFunc(GL_ALWAYS);
+    }
+
+    for( size_t f = 0; f < sizeof(formats)/sizeof(formats[0]); f++ ){
+        for( GLsizei s = OffscreenMinSize; s <= size; s *= 2 ){
+            if( !RenderTarget_Create( &Target, s, s, formats[f], depth ? GL_DEPTH24_STENCIL8 : GL_NONE, samples ) )
+                break;
+
+            const double pixelsPerDraw = (double)s * s;
+            const double sampleBytes = (samples > 0 ? samples : 1) * pixelsPerDraw;
+            const double colorBytes = sampleBytes * Target.color->bytesPerPixel;
+            const double depthBytes = depth ? sampleBytes * 4 : 0;
+
+            /* simple fill, writes color */
+            const double rate = PerfMeasureRate(DrawQuadOffscreen, eglx_PollEvents );
+
+            /* blended fill, reads and writes color */
+            glEnable(GL_BLEND);
+            const double rateBlend = PerfMeasureRate(DrawQuadOffscreen, eglx_PollEvents );
+            glDisable(GL_BLEND);
+
+            printf("   %s %5d x %-5d: simple fill %s pixels/second, %.2f GB/second, blended fill %s pixels/second, %.2f GB/second\n",
+                   Target.color->name, s, s,
+                   PerfHumanFloat(rate * pixelsPerDraw), rate * (colorBytes + depthBytes) / 1e9,
+                   PerfHumanFloat(rateBlend * pixelsPerDraw), rateBlend * (2 * colorBytes + depthBytes) / 1e9);
+
+            RenderTarget_Destroy( &Target );
+            glErrorCheck();
+        }
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, WinWidth, WinHeight);
+    glErrorCheck();
+    exit(0);
+}
+
 static void PerfDraw()
 {
     double rate;
@@ -356,12 +393,17 @@ static void PerfDraw()
 
 int main( int argc, const char* argv[] )
 {
-    api_t api = apiInitial( API_Current, argc, argv );
-    printf("%s: %s\n", argv[0], apiName(api));
+    Api = apiInitial( API_AnyShader, argc, argv );
+    printf("%s: %s\n", argv[0], apiName(Api));
+
+    const int __offscreen = flagFromArgs("--offscreen", argc, argv );
+    int __samples = integerFromArgs("--samples", argc, argv, NULL );
+    int __depth = integerFromArgs("--depth", argc, argv, NULL );
+    int __maxsize = integerFromArgs("--maxsize", argc, argv, NULL );
 
     // initialize and configure
     // ------------------------------
-    eglx_CreateWindow( api, WinWidth, WinHeight );
+    eglx_CreateWindow( Api, WinWidth, WinHeight );
 
     // init
     // -----------
@@ -373,6 +415,8 @@ int main( int argc, const char* argv[] )
     {
         // render
         // ------
+        if( __offscreen )
+            PerfDrawOffscreen( __samples > 0 ? __samples : 0, __depth > 0, __maxsize );
         PerfDraw();
 
         // swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
@@ -1,5 +1,6 @@
 /**
  * Measure glGenerateMipmap() speed.
+ * One build for all apis: --api gl30 (glLegacy), gl33 or gles32
  */
 #include <stdio.h>
 #include <string.h>
@@ -15,6 +16,7 @@ static const int WinWidth = 200;
 static const int WinHeight = 200;
 
 
+static api_t Api;
 static GLboolean DrawPoint = GL_TRUE;
 static GLuint vertex_array;
 static GLuint vertex_buffer;
@@ -35,12 +37,7 @@ static const struct vertex vertices[1] = {
 #define VOFFSET(F) ((void *) offsetof(struct vertex, F))
 
 
-const char *vertexShaderSource =
-#if IS_GlEs
-    "#version 320 es\n"
-#else
-    "#version 330\n"
-#endif
+const char *vertexShaderBody =
     "layout (location = 0) in vec2 vPos;\n"
     "layout (location = 1) in vec2 vTexCoord;\n"
     "out vec2 v_texCoord;\n"
@@ -48,18 +45,12 @@ const char *vertexShaderSource =
     "{\n"
     "   gl_Position = vec4( vPos.x, vPos.y, 0.0f, 1.0f );\n"
     "   v_texCoord = vTexCoord;\n"
-#if IS_GlEs
+    "#ifdef GL_ES\n"
     "   gl_PointSize = 1.0;\n" // make IMG gpu happy
-#endif
+    "#endif\n"
     "}\n\0";
 
-const char *fragmentShaderSource =
-#if IS_GlEs
-    "#version 320 es\n"
-    "precision mediump float;\n"
-#else
-    "#version 330\n"
-#endif
+const char *fragmentShaderBody =
     "in vec2 v_texCoord;\n"
     "layout (location = 0) out vec4 outColor;\n"
     "uniform sampler2D s_texture;\n"
@@ -72,41 +63,41 @@ static void PerfInit()
 {
     // build and compile our shader program
     // ------------------------------------
-#if !IS_GlLegacy
-    program = CreateProgramFromSource( vertexShaderSource, fragmentShaderSource );
-    samplerLoc = glGetUniformLocation( program, "s_texture" );
-#endif
+    if( Api.api != API_GLLegacy ){
+        program = CreateProgramFromBody( Api, vertexShaderBody, fragmentShaderBody );
+        samplerLoc = glGetUniformLocation( program, "s_texture" );
+    }
 
     // set up vertex data (and buffer(s)) and configure vertex attributes
     // ------------------------------------------------------------------
-#if IS_GlLegacy
-    glGenBuffers(1, &vertex_buffer);
-    glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-    glVertexPointer(2, GL_FLOAT, sizeof(struct vertex), VOFFSET(x));
-    glTexCoordPointer(2, GL_FLOAT, sizeof(struct vertex), VOFFSET(s));
-    glEnableClientState(GL_VERTEX_ARRAY);
-    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-#else
-    glGenVertexArrays(1, &vertex_array);
-    glBindVertexArray(vertex_array);
-
-    glGenBuffers(1, &vertex_buffer);
-    glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-    const GLint vPos_location = glGetAttribLocation(program, "vPos");
-    const GLint vTexCoord_location = glGetAttribLocation(program, "vTexCoord");
-    printf("Attrib location: vPos=%d\n", vPos_location);
-    printf("Attrib location: vTexCoord=%d\n", vTexCoord_location);
-    glVertexAttribPointer(vPos_location, 2, GL_FLOAT, GL_FALSE,
-                          sizeof(struct vertex), (void*)VOFFSET(x));
-    glVertexAttribPointer(vTexCoord_location, 2, GL_FLOAT, GL_FALSE,
-                          sizeof(struct vertex), (void *)VOFFSET(s) );
-    glEnableVertexAttribArray(vPos_location);
-    glEnableVertexAttribArray(vTexCoord_location);
-#endif
+    if( Api.api == API_GLLegacy ){
+        glGenBuffers(1, &vertex_buffer);
+        glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+
+        glVertexPointer(2, GL_FLOAT, sizeof(struct vertex), VOFFSET(x));
+        glTexCoordPointer(2, GL_FLOAT, sizeof(struct vertex), VOFFSET(s));
+        glEnableClientState(GL_VERTEX_ARRAY);
+        glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    }else{
+        glGenVertexArrays(1, &vertex_array);
+        glBindVertexArray(vertex_array);
+
+        glGenBuffers(1, &vertex_buffer);
+        glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+
+        const GLint vPos_location = glGetAttribLocation(program, "vPos");
+        const GLint vTexCoord_location = glGetAttribLocation(program, "vTexCoord");
+        printf("Attrib location: vPos=%d\n", vPos_location);
+        printf("Attrib location: vTexCoord=%d\n", vTexCoord_location);
+        glVertexAttribPointer(vPos_location, 2, GL_FLOAT, GL_FALSE,
+                              sizeof(struct vertex), (void*)VOFFSET(x));
+        glVertexAttribPointer(vTexCoord_location, 2, GL_FLOAT, GL_FALSE,
+                              sizeof(struct vertex), (void *)VOFFSET(s) );
+        glEnableVertexAttribArray(vPos_location);
+        glEnableVertexAttribArray(vTexCoord_location);
+    }
 
     // set up texture data and configure texture attributes
     // ------------------------------------------------------------------
@@ -115,16 +106,16 @@ static void PerfInit()
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
-#if IS_GlLegacy
-    glEnable(GL_TEXTURE_2D);
-#else
-    glActiveTexture( GL_TEXTURE0 );
-    glBindTexture( GL_TEXTURE_2D, textureId );
+    if( Api.api == API_GLLegacy ){
+        glEnable(GL_TEXTURE_2D);
+    }else{
+        glActiveTexture( GL_TEXTURE0 );
+        glBindTexture( GL_TEXTURE_2D, textureId );
 
-    glUseProgram(program);
-    // set the sampler texture unit to 0
-    glUniform1i( samplerLoc, 0 );
-#endif
+        glUseProgram(program);
+        // set the sampler texture unit to 0
+        glUniform1i( samplerLoc, 0 );
+    }
 }
 
 static void GenMipmap(unsigned count)
@@ -226,8 +217,8 @@ static void PerfDraw2( int BaseLevel_, int MaxLevel_ )
 
 int main( int argc, const char* argv[] )
 {
-    api_t api = apiInitial( API_Current, argc, argv );
-    printf("%s: %s\n", argv[0], apiName(api));
+    Api = apiInitial( API_Any, argc, argv );
+    printf("%s: %s\n", argv[0], apiName(Api));
 
     int __baselevel = integerFromArgs( "--baselevel", argc, argv, NULL );
     int __maxlevel = integerFromArgs( "--maxlevel", argc, argv, NULL );
@@ -235,7 +226,7 @@ int main( int argc, const char* argv[] )
 
     // initialize and configure
     // ------------------------------
-    eglx_CreateWindow( api, WinWidth, WinHeight );
+    eglx_CreateWindow( Api, WinWidth, WinHeight );
 
     // init
     // -----------
@@ -1,23 +1,28 @@
 /**
  * Test states change when using shaders & textures.
+ * One build for all apis: --api gl30 (glLegacy), gl33 or gles32
  */
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb_image_write.h"
 
 #include <stdio.h>
 #include <stddef.h>
+#include <string.h>
 #include "linmath.h"
 #include "glad.h"
 #include "glUtils.h"
 #include "eglUtils.h"
 #include "myUtils.h"
 #include "SGI_rgb.h"
+#include "glCommandBuffer.h"
+#include "texAtlas.h"
 
 // settings
 static const int WinWidth = 500;
 static const int WinHeight = 500;
 
 
+static api_t Api;
 static mat4x4 M;
 static mat4x4 P;
 
@@ -47,6 +52,30 @@ static GLint prog2_UniV2_uLoc;
 static GLint prog2_MVP_uLoc;
 
 static GLuint texObj[4];
+
+/* per-draw states, used by the filtered/same-state variants of Draw() */
+typedef struct DrawState{
+    GLuint program;
+    GLuint tex0, tex1;
+    GLint UniV1_uLoc, UniV2_uLoc, MVP_uLoc;
+    GLint VertCoord_aLoc, TexCoord0_aLoc, TexCoord1_aLoc;
+} DrawState;
+static DrawState drawStates[2];
+
+/*
+ * per-draw states of the packed texture paths: all textures stay bound, and the shader selects
+ * the image with Select[2], layers of the texture arrays, or atlas scale/offsets.
+ */
+typedef struct PackedDrawState{
+    GLuint program;
+    GLint UniV1_uLoc, UniV2_uLoc, MVP_uLoc, Select_uLoc;
+    GLfloat select[2][4];
+} PackedDrawState;
+static GLuint texArray[2];      // unit0: texObj[0], texObj[2]; unit1: texObj[1], texObj[3]
+static GLuint texAtlas;         // texObj[0..3]
+static PackedDrawState arrayStates[2];
+static PackedDrawState atlasStates[2];
+
 static const char* TexFiles[4] = {
     PROJECT_SOURCE_DIR  "data/tile.rgb",
     PROJECT_SOURCE_DIR  "data/tree2.rgba",
@@ -68,8 +97,8 @@ static const Vertex vertices[4] = {
 };
 
 
-#if IS_GlLegacy
-const char *vertexShaderSource =
+// GLSL 1.10 and the fixed-function matrices, for --api glLegacy
+const char *legacyVertexShaderSource =
     "attribute vec2 VertCoord;\n"
     "attribute vec2 TexCoord0;\n"
     "attribute vec2 TexCoord1;\n"
@@ -80,7 +109,7 @@ const char *vertexShaderSource =
     "    gl_TexCoord[1] = vec4( TexCoord1, 0.0, 0.0 );\n"
     "}\n";
 
-const char *fragmentShaderSource1 =
+const char *legacyFragmentShaderSource1 =
     "uniform sampler2D tex1;\n"
     "uniform sampler2D tex2;\n"
     "uniform vec4 UniV1;\n"
@@ -92,7 +121,7 @@ const char *fragmentShaderSource1 =
     "    gl_FragColor = mix(t1, t2, t2.w) + UniV1 + UniV2;\n"
     "}\n";
 
-const char *fragmentShaderSource2 =
+const char *legacyFragmentShaderSource2 =
     "uniform sampler2D tex1;\n"
     "uniform sampler2D tex2;\n"
     "uniform vec4 UniV1;\n"
@@ -103,13 +132,9 @@ const char *fragmentShaderSource2 =
     "    vec4 t2 = texture2D(tex2, gl_TexCoord[1].xy);\n"
     "    gl_FragColor = t1 + t2 + UniV1 + UniV2;\n"
     "}\n";
-#else
-const char *vertexShaderSource =
-#if IS_GlEs
-    "#version 320 es\n"
-#else
-    "#version 330\n"
-#endif
+
+// #version is glslVersion( Api )
+const char *vertexShaderBody =
     "layout (location = 0) in vec2 VertCoord;\n"
     "layout (location = 1) in vec2 TexCoord0;\n"
     "layout (location = 2) in vec2 TexCoord1;\n"
@@ -123,13 +148,7 @@ const char *vertexShaderSource =
     "    v_TexCoord1 = TexCoord1;\n"
     "}\n";
 
-const char *fragmentShaderSource1 =
-#if IS_GlEs
-    "#version 320 es\n"
-    "precision mediump float;\n"
-#else
-    "#version 330\n"
-#endif
+const char *fragmentShaderBody1 =
     "in vec2 v_TexCoord0\n;"
     "in vec2 v_TexCoord1\n;"
     "uniform sampler2D tex1;\n"
@@ -144,13 +163,7 @@ const char *fragmentShaderSource1 =
     "    FragColor = mix(t1, t2, t2.w) + UniV1 + UniV2;\n"
     "}\n";
 
-const char *fragmentShaderSource2 =
-#if IS_GlEs
-    "#version 320 es\n"
-    "precision mediump float;\n"
-#else
-    "#version 330\n"
-#endif
+const char *fragmentShaderBody2 =
     "in vec2 v_TexCoord0\n;"
     "in vec2 v_TexCoord1\n;"
     "uniform sampler2D tex1;\n"
@@ -164,15 +177,80 @@ const char *fragmentShaderSource2 =
     "    vec4 t2 = texture( tex2, v_TexCoord1 );\n"
     "    FragColor = t1 + t2 + UniV1 + UniV2;\n"
     "}\n";
-#endif
 
-static void DrawPolygonArray( GLint VertCoord_attr, GLint TexCoord0_attr, GLint TexCoord1_attr)
-{
-#if IS_GlLegacy
-    static int init = 0;
-    if( init == 0 ) {
-        init = 1;
+/* texture array path: tex1/tex2 are arrays, Select[i].x is the layer */
+const char *arrayFragmentShaderBody1 =
+    "#ifdef GL_ES\n"
+    "precision mediump sampler2DArray;\n"
+    "#endif\n"
+    "in vec2 v_TexCoord0\n;"
+    "in vec2 v_TexCoord1\n;"
+    "uniform sampler2DArray tex1;\n"
+    "uniform sampler2DArray tex2;\n"
+    "uniform vec4 Select[2];\n"
+    "uniform vec4 UniV1;\n"
+    "uniform vec4 UniV2;\n"
+    "layout (location = 0) out vec4 FragColor;\n"
+    "void main()\n"
+    "{\n"
+    "    vec4 t1 = texture( tex1, vec3(v_TexCoord0, Select[0].x) );\n"
+    "    vec4 t2 = texture( tex2, vec3(v_TexCoord1, Select[1].x) );\n"
+    "    FragColor = mix(t1, t2, t2.w) + UniV1 + UniV2;\n"
+    "}\n";
+
+const char *arrayFragmentShaderBody2 =
+    "#ifdef GL_ES\n"
+    "precision mediump sampler2DArray;\n"
+    "#endif\n"
+    "in vec2 v_TexCoord0\n;"
+    "in vec2 v_TexCoord1\n;"
+    "uniform sampler2DArray tex1;\n"
+    "uniform sampler2DArray tex2;\n"
+    "uniform vec4 Select[2];\n"
+    "uniform vec4 UniV1;\n"
+    "uniform vec4 UniV2;\n"
+    "layout (location = 0) out vec4 FragColor;\n"
+    "void main()\n"
+    "{\n"
+    "    vec4 t1 = texture( tex1, vec3(v_TexCoord0, Select[0].x) );\n"
+    "    vec4 t2 = texture( tex2, vec3(v_TexCoord1, Select[1].x) );\n"
+    "    FragColor = t1 + t2 + UniV1 + UniV2;\n"
+    "}\n";
 
+/* atlas path: Select[i] is the scale/offset of the image, GL_REPEAT is done by fract() */
+const char *atlasFragmentShaderBody1 =
+    "in vec2 v_TexCoord0\n;"
+    "in vec2 v_TexCoord1\n;"
+    "uniform sampler2D atlas;\n"
+    "uniform vec4 Select[2];\n"
+    "uniform vec4 UniV1;\n"
+    "uniform vec4 UniV2;\n"
+    "layout (location = 0) out vec4 FragColor;\n"
+    "void main()\n"
+    "{\n"
+    "    vec4 t1 = texture( atlas, fract(v_TexCoord0) * Select[0].xy + Select[0].zw );\n"
+    "    vec4 t2 = texture( atlas, fract(v_TexCoord1) * Select[1].xy + Select[1].zw );\n"
+    "    FragColor = mix(t1, t2, t2.w) + UniV1 + UniV2;\n"
+    "}\n";
+
+const char *atlasFragmentShaderBody2 =
+    "in vec2 v_TexCoord0\n;"
+    "in vec2 v_TexCoord1\n;"
+    "uniform sampler2D atlas;\n"
+    "uniform vec4 Select[2];\n"
+    "uniform vec4 UniV1;\n"
+    "uniform vec4 UniV2;\n"
+    "layout (location = 0) out vec4 FragColor;\n"
+    "void main()\n"
+    "{\n"
+    "    vec4 t1 = texture( atlas, fract(v_TexCoord0) * Select[0].xy + Select[0].zw );\n"
+    "    vec4 t2 = texture( atlas, fract(v_TexCoord1) * Select[1].xy + Select[1].zw );\n"
+    "    FragColor = t1 + t2 + UniV1 + UniV2;\n"
+    "}\n";
+
+static void InitVertexArrays( GLint VertCoord_attr, GLint TexCoord0_attr, GLint TexCoord1_attr)
+{
+    if( Api.api == API_GLLegacy ){
         glVertexAttribPointer(VertCoord_attr, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), &vertices[0].VertCoords);
         glEnableVertexAttribArray(VertCoord_attr);
 
@@ -181,12 +259,7 @@ static void DrawPolygonArray( GLint VertCoord_attr, GLint TexCoord0_attr, GLint
 
         glVertexAttribPointer(TexCoord1_attr, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), &vertices[0].Tex1Coords);
         glEnableVertexAttribArray(TexCoord1_attr);
-    }
-#else
-    static int init = 0;
-    if( init == 0 ){
-        init = 1;
-
+    }else{
         glGenVertexArrays(1, &VAO);
         glBindVertexArray(VAO);
 
@@ -203,11 +276,14 @@ static void DrawPolygonArray( GLint VertCoord_attr, GLint TexCoord0_attr, GLint
         glVertexAttribPointer(TexCoord1_attr, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, Tex1Coords));
         glEnableVertexAttribArray(TexCoord1_attr);
     }
-#endif
+}
 
+static void DrawPolygonArray( GLint VertCoord_attr, GLint TexCoord0_attr, GLint TexCoord1_attr)
+{
     glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
 }
 
+template<int API>
 static void Draw(unsigned count)
 {
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -215,23 +291,23 @@ static void Draw(unsigned count)
     for (int i = 0; i < count; i++) {
         Yrot = 0.05 * i;
 
-#if IS_GlLegacy
-        glPushMatrix(); /* modelview matrix */
-        glTranslatef(0.0, 0.0, -EyeDist);
-        glRotatef(Zrot, 0, 0, 1);
-        glRotatef(Yrot, 0, 1, 0);
-        glRotatef(Xrot, 1, 0, 0);
-#else
-        mat4x4 m;
-        mat4x4_dup( m, M );
-        mat4x4_translate_in_place( m, 0.0, 0.0, -EyeDist );
-        mat4x4_rotate( m, m, 0, 0, 1, Zrot );
-        mat4x4_rotate( m, m, 0, 1, 0, Yrot );
-        mat4x4_rotate( m, m, 1, 0, 0, Xrot );
-
         mat4x4 mvp;
-        mat4x4_mul( mvp, P, m );
-#endif
+        if constexpr( API == API_GLLegacy ){
+            glPushMatrix(); /* modelview matrix */
+            glTranslatef(0.0, 0.0, -EyeDist);
+            glRotatef(Zrot, 0, 0, 1);
+            glRotatef(Yrot, 0, 1, 0);
+            glRotatef(Xrot, 1, 0, 0);
+        }else{
+            mat4x4 m;
+            mat4x4_dup( m, M );
+            mat4x4_translate_in_place( m, 0.0, 0.0, -EyeDist );
+            mat4x4_rotate( m, m, 0, 0, 1, Zrot );
+            mat4x4_rotate( m, m, 0, 1, 0, Yrot );
+            mat4x4_rotate( m, m, 1, 0, 0, Xrot );
+
+            mat4x4_mul( mvp, P, m );
+        }
 
         glUseProgram(program1);
         glActiveTexture(GL_TEXTURE0 + 0);
@@ -240,9 +316,8 @@ static void Draw(unsigned count)
         glBindTexture(GL_TEXTURE_2D, texObj[1]);
         glUniform4f( prog1_UniV1_uLoc, Xrot, Yrot, Zrot, 1.000000);
         glUniform4f( prog1_UniV2_uLoc, Xrot, Yrot, Zrot, 1.000000);
-#if !IS_GlLegacy
-        glUniformMatrix4fv( prog1_MVP_uLoc, 1, GL_FALSE, (const GLfloat*)&mvp );
-#endif
+        if constexpr( API != API_GLLegacy )
+            glUniformMatrix4fv( prog1_MVP_uLoc, 1, GL_FALSE, (const GLfloat*)&mvp );
         DrawPolygonArray(prog1_VertCoord_aLoc, prog1_TexCoord0_aLoc, prog1_TexCoord1_aLoc);
 
         glUseProgram(program2);
@@ -252,26 +327,414 @@ static void Draw(unsigned count)
         glBindTexture(GL_TEXTURE_2D, texObj[3]);
         glUniform4f( prog2_UniV1_uLoc, Xrot, Yrot, Zrot, 1.000000);
         glUniform4f( prog2_UniV2_uLoc, Xrot, Yrot, Zrot, 1.000000);
-#if !IS_GlLegacy
-        glUniformMatrix4fv( prog2_MVP_uLoc, 1, GL_FALSE, (const GLfloat*)&mvp );
-#endif
+        if constexpr( API != API_GLLegacy )
+            glUniformMatrix4fv( prog2_MVP_uLoc, 1, GL_FALSE, (const GLfloat*)&mvp );
         DrawPolygonArray(prog2_VertCoord_aLoc, prog2_TexCoord0_aLoc, prog2_TexCoord1_aLoc);
 
-#if IS_GlLegacy
-        glPopMatrix();
-#endif
+        if constexpr( API == API_GLLegacy )
+            glPopMatrix();
     }
 
     eglx_SwapBuffers();
 }
 
-static void PerfDraw()
+template<int API>
+static void ApplyState( const DrawState *state, const GLfloat *univ, const GLfloat *mvp )
+{
+    glUseProgram(state->program);
+    glActiveTexture(GL_TEXTURE0 + 0);
+    glBindTexture(GL_TEXTURE_2D, state->tex0);
+    glActiveTexture(GL_TEXTURE0 + 1);
+    glBindTexture(GL_TEXTURE_2D, state->tex1);
+    glUniform4fv( state->UniV1_uLoc, 1, univ );
+    glUniform4fv( state->UniV2_uLoc, 1, univ );
+    if constexpr( API != API_GLLegacy )
+        glUniformMatrix4fv( state->MVP_uLoc, 1, GL_FALSE, mvp );
+}
+
+template<int API>
+static void ApplyStateFiltered( const DrawState *state, const GLfloat *univ, const GLfloat *mvp )
+{
+    StateCache_UseProgram(state->program);
+    StateCache_BindTexture(0, GL_TEXTURE_2D, state->tex0);
+    StateCache_BindTexture(1, GL_TEXTURE_2D, state->tex1);
+    StateCache_Uniform4fv( state->UniV1_uLoc, 1, univ );
+    StateCache_Uniform4fv( state->UniV2_uLoc, 1, univ );
+    if constexpr( API != API_GLLegacy )
+        StateCache_UniformMatrix4fv( state->MVP_uLoc, 1, GL_FALSE, mvp );
+}
+
+/**
+ * Same scene as Draw(), but the states go through ApplyState()/ApplyStateFiltered().
+ *   sameState = 0: alternate program1/program2 and their textures, like Draw()
+ *   sameState = 1: both draws of an iteration use program1 and the same uniforms,
+ *                  so half of the state changes are redundant
+ */
+template<int API>
+static void DrawStates(unsigned count, int sameState, int filtered)
+{
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    for (unsigned i = 0; i < count; i++) {
+        Yrot = 0.05 * i;
+        const GLfloat univ[4] = { Xrot, sameState ? 0.0f : Yrot, Zrot, 1.000000 };
+
+        mat4x4 mvp_;
+        const GLfloat *mvp = NULL;
+        if constexpr( API == API_GLLegacy ){
+            glPushMatrix(); /* modelview matrix */
+            glTranslatef(0.0, 0.0, -EyeDist);
+            glRotatef(Zrot, 0, 0, 1);
+            glRotatef(Yrot, 0, 1, 0);
+            glRotatef(Xrot, 1, 0, 0);
+        }else{
+            mat4x4 m;
+            mat4x4_dup( m, M );
+            mat4x4_translate_in_place( m, 0.0, 0.0, -EyeDist );
+            mat4x4_rotate( m, m, 0, 0, 1, Zrot );
+            mat4x4_rotate( m, m, 0, 1, 0, Yrot );
+            mat4x4_rotate( m, m, 1, 0, 0, Xrot );
+
+            mat4x4_mul( mvp_, P, m );
+            mvp = (const GLfloat*)&mvp_;
+        }
+
+        for (int k = 0; k < 2; k++) {
+            const DrawState *state = &drawStates[sameState ? 0 : k];
+            if (filtered)
+                ApplyStateFiltered<API>(state, univ, mvp);
+            else
+                ApplyState<API>(state, univ, mvp);
+            DrawPolygonArray(state->VertCoord_aLoc, state->TexCoord0_aLoc, state->TexCoord1_aLoc);
+        }
+
+        if constexpr( API == API_GLLegacy )
+            glPopMatrix();
+    }
+
+    eglx_SwapBuffers();
+}
+
+template<int API>
+static void DrawFiltered(unsigned count)
+{
+    DrawStates<API>(count, 0, 1);
+}
+
+template<int API>
+static void DrawSameState(unsigned count)
+{
+    DrawStates<API>(count, 1, 0);
+}
+
+template<int API>
+static void DrawSameStateFiltered(unsigned count)
+{
+    DrawStates<API>(count, 1, 1);
+}
+
+/**
+ * Same scene as Draw(), but the draws are recorded into a command buffer, and replayed
+ * in batches of about one frame, optionally sorted by state.
+ */
+static CmdBuffer cmdBuffer;
+static const int CmdBufferBatch = 1024;
+
+static void FlushCommands(int sorted)
+{
+    if (sorted)
+        CmdBuffer_Sort(&cmdBuffer);
+    CmdBuffer_Submit(&cmdBuffer);
+}
+
+static void DrawDeferred(unsigned count, int sorted)
 {
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+    for (unsigned i = 0; i < count; i++) {
+        Yrot = 0.05 * i;
+        const GLfloat univ[4] = { Xrot, Yrot, Zrot, 1.000000 };
+
+        mat4x4 m;
+        mat4x4_dup( m, M );
+        mat4x4_translate_in_place( m, 0.0, 0.0, -EyeDist );
+        mat4x4_rotate( m, m, 0, 0, 1, Zrot );
+        mat4x4_rotate( m, m, 0, 1, 0, Yrot );
+        mat4x4_rotate( m, m, 1, 0, 0, Xrot );
+
+        mat4x4 mvp;
+        mat4x4_mul( mvp, P, m );
+
+        for (int k = 0; k < 2; k++) {
+            const DrawState *state = &drawStates[k];
+            DrawCmd *cmd = CmdBuffer_Add(&cmdBuffer);
+            cmd->program = state->program;
+            cmd->vertexArray = VAO;
+            cmd->textures[0] = state->tex0;
+            cmd->textures[1] = state->tex1;
+            cmd->material = k;
+            cmd->depth = 0.5;
+            CmdBuffer_AddUniform4fv(cmd, state->UniV1_uLoc, univ);
+            CmdBuffer_AddUniform4fv(cmd, state->UniV2_uLoc, univ);
+            CmdBuffer_AddUniformMatrix4fv(cmd, state->MVP_uLoc, (const GLfloat*)&mvp);
+            cmd->mode = GL_TRIANGLE_FAN;
+            cmd->first = 0;
+            cmd->count = 4;
+        }
+
+        if (cmdBuffer.count >= CmdBufferBatch)
+            FlushCommands(sorted);
+    }
+    FlushCommands(sorted);
+
+    eglx_SwapBuffers();
+}
+
+static void DrawDeferredRecordOrder(unsigned count)
+{
+    DrawDeferred(count, 0);
+}
+
+static void DrawDeferredSorted(unsigned count)
+{
+    DrawDeferred(count, 1);
+}
+
+/**
+ * Same quad cut into TileRows x TileRows tiles of GL_TRIANGLES, the top half drawn with the
+ * first state and the bottom half with the second. The tiles of a state are contiguous in the
+ * vertex buffer but recorded interleaved: sorting brings them together, and the command buffer
+ * merges them into one draw per state.
+ */
+#define TileRows        4
+#define TileVertices    6
+static GLuint tilesVAO;
+static GLuint tilesVBO;
+
+static void InitTiles(GLint VertCoord_attr, GLint TexCoord0_attr, GLint TexCoord1_attr)
+{
+    Vertex tiles[TileRows * TileRows * TileVertices];
+    const int corners[TileVertices][2] = { {0,0}, {1,0}, {1,1}, {0,0}, {1,1}, {0,1} };
+
+    for (int t = 0; t < TileRows * TileRows; t++) {
+        const int col = t % TileRows, row = t / TileRows;
+        for (int v = 0; v < TileVertices; v++) {
+            const float u = (float)(col + corners[v][0]) / TileRows;
+            const float w = (float)(row + corners[v][1]) / TileRows;
+            Vertex *vert = &tiles[t * TileVertices + v];
+            vert->VertCoords[0] = -3.0 + 6.0 * u;
+            vert->VertCoords[1] = -3.0 + 6.0 * w;
+            vert->Tex0Coords[0] = 2.0 * u;
+            vert->Tex0Coords[1] = 2.0 * w;
+            vert->Tex1Coords[0] = u;
+            vert->Tex1Coords[1] = w;
+        }
+    }
+
+    glGenVertexArrays(1, &tilesVAO);
+    glBindVertexArray(tilesVAO);
+
+    glGenBuffers(1, &tilesVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, tilesVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(tiles), tiles, GL_STATIC_DRAW);
+
+    glVertexAttribPointer(VertCoord_attr, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, VertCoords));
+    glEnableVertexAttribArray(VertCoord_attr);
+    glVertexAttribPointer(TexCoord0_attr, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, Tex0Coords));
+    glEnableVertexAttribArray(TexCoord0_attr);
+    glVertexAttribPointer(TexCoord1_attr, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, Tex1Coords));
+    glEnableVertexAttribArray(TexCoord1_attr);
+
+    glBindVertexArray(VAO);
+}
+
+static void DrawDeferredTiles(unsigned count)
+{
+    const int tilesPerState = TileRows * TileRows / 2;
+
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    for (unsigned i = 0; i < count; i++) {
+        Yrot = 0.05 * i;
+        const GLfloat univ[4] = { Xrot, Yrot, Zrot, 1.000000 };
+
+        mat4x4 m;
+        mat4x4_dup( m, M );
+        mat4x4_translate_in_place( m, 0.0, 0.0, -EyeDist );
+        mat4x4_rotate( m, m, 0, 0, 1, Zrot );
+        mat4x4_rotate( m, m, 0, 1, 0, Yrot );
+        mat4x4_rotate( m, m, 1, 0, 0, Xrot );
+
+        mat4x4 mvp;
+        mat4x4_mul( mvp, P, m );
+
+        for (int t = 0; t < tilesPerState; t++) {
+            for (int k = 0; k < 2; k++) {
+                const DrawState *state = &drawStates[k];
+                DrawCmd *cmd = CmdBuffer_Add(&cmdBuffer);
+                cmd->program = state->program;
+                cmd->vertexArray = tilesVAO;
+                cmd->textures[0] = state->tex0;
+                cmd->textures[1] = state->tex1;
+                cmd->material = k;
+                cmd->depth = 0.5;
+                CmdBuffer_AddUniform4fv(cmd, state->UniV1_uLoc, univ);
+                CmdBuffer_AddUniform4fv(cmd, state->UniV2_uLoc, univ);
+                CmdBuffer_AddUniformMatrix4fv(cmd, state->MVP_uLoc, (const GLfloat*)&mvp);
+                cmd->mode = GL_TRIANGLES;
+                cmd->first = (k * tilesPerState + t) * TileVertices;
+                cmd->count = TileVertices;
+            }
+        }
+
+        if (cmdBuffer.count >= CmdBufferBatch)
+            FlushCommands(1);
+    }
+    FlushCommands(1);
+
+    eglx_SwapBuffers();
+}
+
+/**
+ * Same scene as Draw(), but the textures stay bound: texture arrays or an atlas,
+ * and the images are selected by a per-draw uniform.
+ */
+static void DrawPacked(unsigned count, const PackedDrawState *states)
+{
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    for (unsigned i = 0; i < count; i++) {
+        Yrot = 0.05 * i;
+
+        mat4x4 m;
+        mat4x4_dup( m, M );
+        mat4x4_translate_in_place( m, 0.0, 0.0, -EyeDist );
+        mat4x4_rotate( m, m, 0, 0, 1, Zrot );
+        mat4x4_rotate( m, m, 0, 1, 0, Yrot );
+        mat4x4_rotate( m, m, 1, 0, 0, Xrot );
+
+        mat4x4 mvp;
+        mat4x4_mul( mvp, P, m );
+
+        for (int k = 0; k < 2; k++) {
+            const PackedDrawState *state = &states[k];
+            glUseProgram(state->program);
+            glUniform4fv( state->Select_uLoc, 2, (const GLfloat*)state->select );
+            glUniform4f( state->UniV1_uLoc, Xrot, Yrot, Zrot, 1.000000);
+            glUniform4f( state->UniV2_uLoc, Xrot, Yrot, Zrot, 1.000000);
+            glUniformMatrix4fv( state->MVP_uLoc, 1, GL_FALSE, (const GLfloat*)&mvp );
+            DrawPolygonArray(prog1_VertCoord_aLoc, prog1_TexCoord0_aLoc, prog1_TexCoord1_aLoc);
+        }
+    }
+
+    eglx_SwapBuffers();
+}
+
+static void DrawTextureArray(unsigned count)
+{
+    glActiveTexture(GL_TEXTURE0 + 0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texArray[0]);
+    glActiveTexture(GL_TEXTURE0 + 1);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texArray[1]);
+    DrawPacked(count, arrayStates);
+}
+
+static void DrawTextureAtlas(unsigned count)
+{
+    glActiveTexture(GL_TEXTURE0 + 0);
+    glBindTexture(GL_TEXTURE_2D, texAtlas);
+    DrawPacked(count, atlasStates);
+}
+
+static void PrintCmdBufferStats(double rate, int drawsPerIteration)
+{
+    const CmdBufferStats *stats = &cmdBuffer.stats;
+    printf("    %s draws/sec, %s draws recorded, %s submitted, %.3f state changes/draw\n",
+           PerfHumanFloat(rate * drawsPerIteration),
+           PerfHumanFloat(stats->recorded), PerfHumanFloat(stats->submitted),
+           (double)stats->stateChanges / stats->submitted);
+}
+
+static void PrintStateCacheStats()
+{
+    glStateCacheStats_t stats = StateCache_GetStats();
+    printf("    state cache: %s GL calls issued, %s elided\n",
+           PerfHumanFloat(stats.issued), PerfHumanFloat(stats.elided));
+}
+
+static void PerfDraw(int mode)
+{
+    double rate, rate0 = 0;
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
     printf("GLSL texture/program change rate\n");
-    double rate = PerfMeasureRate(Draw, eglx_PollEvents );
-    printf("  Immediate mode: %s change/sec\n", PerfHumanFloat(rate));
+    if( mode == -1 || mode == 0 ) {
+        rate = rate0 = PerfMeasureRate(API_Select(Draw, Api), eglx_PollEvents );
+        printf("  Immediate mode: %s change/sec\n", PerfHumanFloat(rate));
+    }
+
+    if( mode == -1 || mode == 1 ) {
+        StateCache_Invalidate();
+        StateCache_ResetStats();
+        rate = PerfMeasureRate(API_Select(DrawFiltered, Api), eglx_PollEvents );
+        printf("  Immediate mode, filtered: %s change/sec\n", PerfHumanFloat(rate));
+        PrintStateCacheStats();
+    }
+
+    if( mode == -1 || mode == 2 ) {
+        rate = PerfMeasureRate(API_Select(DrawSameState, Api), eglx_PollEvents );
+        printf("  Same state: %s change/sec\n", PerfHumanFloat(rate));
+    }
+
+    if( mode == -1 || mode == 3 ) {
+        StateCache_Invalidate();
+        StateCache_ResetStats();
+        rate = PerfMeasureRate(API_Select(DrawSameStateFiltered, Api), eglx_PollEvents );
+        printf("  Same state, filtered: %s change/sec\n", PerfHumanFloat(rate));
+        PrintStateCacheStats();
+    }
+
+    if( Api.api != API_GLLegacy ){
+        if( mode == -1 || mode == 4 ) {
+            StateCache_Invalidate();
+            CmdBuffer_ResetStats(&cmdBuffer);
+            rate = PerfMeasureRate(DrawDeferredRecordOrder, eglx_PollEvents );
+            printf("  Deferred, record order: %s change/sec\n", PerfHumanFloat(rate));
+            PrintCmdBufferStats(rate, 2);
+        }
+
+        if( mode == -1 || mode == 5 ) {
+            StateCache_Invalidate();
+            CmdBuffer_ResetStats(&cmdBuffer);
+            rate = PerfMeasureRate(DrawDeferredSorted, eglx_PollEvents );
+            printf("  Deferred, sorted: %s change/sec\n", PerfHumanFloat(rate));
+            PrintCmdBufferStats(rate, 2);
+        }
+
+        if( mode == -1 || mode == 6 ) {
+            rate = PerfMeasureRate(DrawTextureArray, eglx_PollEvents );
+            printf("  Texture array: %s change/sec", PerfHumanFloat(rate));
+            if( rate0 > 0 )
+                printf(", x%.2f of bind per draw", rate / rate0);
+            printf("\n");
+        }
+
+        if( mode == -1 || mode == 7 ) {
+            rate = PerfMeasureRate(DrawTextureAtlas, eglx_PollEvents );
+            printf("  Texture atlas: %s change/sec", PerfHumanFloat(rate));
+            if( rate0 > 0 )
+                printf(", x%.2f of bind per draw", rate / rate0);
+            printf("\n");
+        }
+
+        if( mode == -1 || mode == 8 ) {
+            StateCache_Invalidate();
+            CmdBuffer_ResetStats(&cmdBuffer);
+            rate = PerfMeasureRate(DrawDeferredTiles, eglx_PollEvents );
+            printf("  Deferred tiles, sorted and merged: %s change/sec\n", PerfHumanFloat(rate));
+            PrintCmdBufferStats(rate, TileRows * TileRows);
+        }
+    }
 
     glErrorCheck();
     exit(0);
@@ -309,12 +772,12 @@ static void InitTextures()
 
         glActiveTexture(GL_TEXTURE0 + i);
         glBindTexture(GL_TEXTURE_2D, texObj[i]);
-#if IS_GlLegacy
-        gluBuild2DMipmaps(GL_TEXTURE_2D, 4, imgWidth, imgHeight, imgFormat, GL_UNSIGNED_BYTE, image);
-#else
-        glTexImage2D( GL_TEXTURE_2D, 0, imgFormat, imgWidth, imgHeight, 0, imgFormat, GL_UNSIGNED_BYTE, image );
-        glGenerateMipmap( GL_TEXTURE_2D );
-#endif
+        if( Api.api == API_GLLegacy ){
+            gluBuild2DMipmaps(GL_TEXTURE_2D, 4, imgWidth, imgHeight, imgFormat, GL_UNSIGNED_BYTE, image);
+        }else{
+            glTexImage2D( GL_TEXTURE_2D, 0, imgFormat, imgWidth, imgHeight, 0, imgFormat, GL_UNSIGNED_BYTE, image );
+            glGenerateMipmap( GL_TEXTURE_2D );
+        }
         free(image);
 
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -325,13 +788,144 @@ static void InitTextures()
     }
 }
 
+static void InitTextureArrays(GLubyte **images, const GLint *widths, const GLint *heights, const GLenum *formats)
+{
+    glGenTextures(2, texArray);
+
+    for (int unit = 0; unit < 2; unit++) {
+        // layer 0: texObj[unit], layer 1: texObj[unit + 2], they have the same size and format
+        const int a = unit, b = unit + 2;
+        if (widths[a] != widths[b] || heights[a] != heights[b] || formats[a] != formats[b]) {
+            printf("%s: %s and %s can't be packed in one texture array\n", __func__, TexFiles[a], TexFiles[b]);
+            exit(EXIT_FAILURE);
+        }
+
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, texArray[unit]);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, formats[a], widths[a], heights[a], 2, 0, formats[a], GL_UNSIGNED_BYTE, NULL);
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, widths[a], heights[a], 1, formats[a], GL_UNSIGNED_BYTE, images[a]);
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, 1, widths[b], heights[b], 1, formats[b], GL_UNSIGNED_BYTE, images[b]);
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    }
+}
+
+static void InitTextureAtlas(GLubyte **images, const GLint *widths, const GLint *heights, const GLenum *formats, GLfloat scaleOffsets[4][4])
+{
+    const int padding = 4;
+    TexAtlas atlas;
+    AtlasRect rects[4];
+
+    // grow until all images fit
+    int width = 256, height = 256;
+    for (;;) {
+        TexAtlas_Init(&atlas, width, height, padding);
+        if (TexAtlas_InsertAll(&atlas, 4, widths, heights, rects))
+            break;
+        TexAtlas_Free(&atlas);
+        if (width <= height)
+            width *= 2;
+        else
+            height *= 2;
+    }
+    printf("texture atlas: width = %d, height = %d, padding = %d\n", width, height, padding);
+
+    uint8_t *pixels = (uint8_t*) calloc(width * height, 4);
+    for (int i = 0; i < 4; i++)
+        TexAtlas_Blit(&atlas, pixels, &rects[i], images[i], formats[i] == GL_RGB ? 3 : 4, 1);
+
+    glGenTextures(1, &texAtlas);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, texAtlas);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, TexAtlas_MaxMipLevel(&atlas));
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    for (int i = 0; i < 4; i++) {
+        TexAtlas_ScaleOffset(&atlas, &rects[i], scaleOffsets[i]);
+        printf("  %s: x = %d, y = %d\n", TexFiles[i], rects[i].x, rects[i].y);
+    }
+
+    free(pixels);
+    TexAtlas_Free(&atlas);
+}
+
+static PackedDrawState InitPackedProgram(const char *fragShaderBody, const char *samplerName1, const char *samplerName2)
+{
+    PackedDrawState state;
+    state.program = CreateProgramFromBody( Api, vertexShaderBody, fragShaderBody );
+    glUseProgram(state.program);
+
+    glUniform1i( glGetUniformLocation(state.program, samplerName1), 0 );
+    if (samplerName2)
+        glUniform1i( glGetUniformLocation(state.program, samplerName2), 1 );
+    state.UniV1_uLoc = glGetUniformLocation(state.program, "UniV1");
+    state.UniV2_uLoc = glGetUniformLocation(state.program, "UniV2");
+    state.MVP_uLoc = glGetUniformLocation(state.program, "MVP");
+    state.Select_uLoc = glGetUniformLocation(state.program, "Select");
+    return state;
+}
+
+static void InitPackedTextures()
+{
+    GLubyte *images[4];
+    GLint widths[4], heights[4];
+    GLenum formats[4];
+
+    for (int i = 0; i < 4; i++) {
+        images[i] = SGI_LoadRGBImage(TexFiles[i], &widths[i], &heights[i], &formats[i]);
+        if (!images[i]) {
+            printf("Couldn't read %s\n", TexFiles[i]);
+            exit(0);
+        }
+    }
+
+    // texture arrays
+    InitTextureArrays(images, widths, heights, formats);
+    arrayStates[0] = InitPackedProgram(arrayFragmentShaderBody1, "tex1", "tex2");
+    arrayStates[1] = InitPackedProgram(arrayFragmentShaderBody2, "tex1", "tex2");
+    for (int k = 0; k < 2; k++) {
+        arrayStates[k].select[0][0] = k;
+        arrayStates[k].select[1][0] = k;
+    }
+
+    // atlas
+    GLfloat scaleOffsets[4][4];
+    InitTextureAtlas(images, widths, heights, formats, scaleOffsets);
+    atlasStates[0] = InitPackedProgram(atlasFragmentShaderBody1, "atlas", NULL);
+    atlasStates[1] = InitPackedProgram(atlasFragmentShaderBody2, "atlas", NULL);
+    for (int k = 0; k < 2; k++) {
+        // like texObj[2k], texObj[2k+1] of Draw()
+        memcpy(atlasStates[k].select[0], scaleOffsets[2 * k], sizeof(scaleOffsets[0]));
+        memcpy(atlasStates[k].select[1], scaleOffsets[2 * k + 1], sizeof(scaleOffsets[0]));
+    }
+
+    for (int i = 0; i < 4; i++)
+        free(images[i]);
+}
+
+static GLuint CreateStateProgram(const char *legacyFragShaderSource, const char *fragShaderBody)
+{
+    if( Api.api == API_GLLegacy )
+        return CreateProgramFromSource( legacyVertexShaderSource, legacyFragShaderSource );
+    return CreateProgramFromBody( Api, vertexShaderBody, fragShaderBody );
+}
+
 static void InitPrograms()
 {
     const float UniV1[4] = {0.8, 0.2, 0.2, 0};
     const float UniV2[4] = {0.6, 0.6, 0.6, 0};
 
     {
-        program1 = CreateProgramFromSource(vertexShaderSource, fragmentShaderSource1);
+        program1 = CreateStateProgram(legacyFragmentShaderSource1, fragmentShaderBody1);
         glUseProgram( program1 );
 
         prog1_tex1_uLoc = glGetUniformLocation(program1, "tex1");
@@ -357,9 +951,13 @@ static void InitPrograms()
         printf("prog1_UniV2_uLoc = %d\n", prog1_UniV2_uLoc);
         printf("prog1_MVP_uLoc = %d\n", prog1_MVP_uLoc);
         printf("\n");
+
+        drawStates[0] = { program1, texObj[0], texObj[1],
+                          prog1_UniV1_uLoc, prog1_UniV2_uLoc, prog1_MVP_uLoc,
+                          prog1_VertCoord_aLoc, prog1_TexCoord0_aLoc, prog1_TexCoord1_aLoc };
     }
     {
-        program2 = CreateProgramFromSource(vertexShaderSource, fragmentShaderSource2);
+        program2 = CreateStateProgram(legacyFragmentShaderSource2, fragmentShaderBody2);
         glUseProgram( program2 );
 
         prog2_tex1_uLoc = glGetUniformLocation(program2, "tex1");
@@ -385,6 +983,10 @@ static void InitPrograms()
         printf("prog2_UniV2_uLoc = %d\n", prog2_UniV2_uLoc);
         printf("prog2_MVP_uLoc = %d\n", prog2_MVP_uLoc);
         printf("\n");
+
+        drawStates[1] = { program2, texObj[2], texObj[3],
+                          prog2_UniV1_uLoc, prog2_UniV2_uLoc, prog2_MVP_uLoc,
+                          prog2_VertCoord_aLoc, prog2_TexCoord0_aLoc, prog2_TexCoord1_aLoc };
     }
 }
 
@@ -392,43 +994,50 @@ static void PerfInit()
 {
     InitTextures();
     InitPrograms();
+    InitVertexArrays(prog1_VertCoord_aLoc, prog1_TexCoord0_aLoc, prog1_TexCoord1_aLoc);
+    if( Api.api != API_GLLegacy ){
+        CmdBuffer_Init(&cmdBuffer, CmdBufferBatch * 2);
+        InitTiles(prog1_VertCoord_aLoc, prog1_TexCoord0_aLoc, prog1_TexCoord1_aLoc);
+        InitPackedTextures();
+    }
 
     glEnable(GL_DEPTH_TEST);
     glClearColor(.6, .6, .9, 0);
-#if IS_GlLegacy
-    glColor3f(1.0, 1.0, 1.0);
-#endif
+    if( Api.api == API_GLLegacy )
+        glColor3f(1.0, 1.0, 1.0);
 
 }
 
 static void Reshape()
 {
-#if IS_GlLegacy
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-    glFrustum(-1.0, 1.0, -1.0, 1.0, 5.0, 25.0);
-
-    glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();
-    glTranslatef(0.0, 0.0, -15.0);
-#else
-    mat4x4_identity( P );
-    mat4x4_frustum( P, -1.0, 1.0, -1.0, 1.0, 5.0, 25.0 );
-
-    mat4x4_identity( M );
-    mat4x4_translate( M, 0.0, 0.0, -15.0 );
-#endif
+    if( Api.api == API_GLLegacy ){
+        glMatrixMode(GL_PROJECTION);
+        glLoadIdentity();
+        glFrustum(-1.0, 1.0, -1.0, 1.0, 5.0, 25.0);
+
+        glMatrixMode(GL_MODELVIEW);
+        glLoadIdentity();
+        glTranslatef(0.0, 0.0, -15.0);
+    }else{
+        mat4x4_identity( P );
+        mat4x4_frustum( P, -1.0, 1.0, -1.0, 1.0, 5.0, 25.0 );
+
+        mat4x4_identity( M );
+        mat4x4_translate( M, 0.0, 0.0, -15.0 );
+    }
 }
 
 
 int main( int argc, const char* argv[] )
 {
-    api_t api = apiInitial( API_Current, argc, argv );
-    printf("%s: %s\n", argv[0], apiName(api));
+    Api = apiInitial( API_Any, argc, argv );
+    printf("%s: %s\n", argv[0], apiName(Api));
+
+    int __mode = integerFromArgs("--mode", argc, argv, NULL );
 
     // initialize and configure
     // ------------------------------
-    eglx_CreateWindow( api, WinWidth, WinHeight );
+    eglx_CreateWindow( Api, WinWidth, WinHeight );
 
     // init
     // -----------
@@ -441,7 +1050,7 @@ int main( int argc, const char* argv[] )
     {
         // render
         // ------
-        PerfDraw();
+        PerfDraw( __mode );
 
         // swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
         // -------------------------------------------------------------------------------
@@ -0,0 +1,216 @@
+/**
+ * Measure framebuffer load/store, which matters most on tiled GPUs: every frame renders a pass into
+ * an offscreen RGBA8 + depth24/stencil8 target, then switches to the window framebuffer.
+ *   --mode 0: load color/depth/stencil, store all
+ *   --mode 1: clear at start, store all
+ *   --mode 2: glInvalidateFramebuffer(all) at start, store all
+ *   --mode 3: clear at start, glInvalidateFramebuffer(depth/stencil) at end
+ *   --mode 4: clear at start, glInvalidateSubFramebuffer(depth/stencil, whole target) at end
+ *   --maxsize N: stop the sweep at N x N
+ * Memory traffic per frame comes from GpuCounters_XXX(), if the driver exposes bandwidth counters.
+ * One build for gl and gles: --api gl33 or gles32
+ */
+#include <stdio.h>
+#include "glad.h"
+#include "glUtils.h"
+#include "eglUtils.h"
+#include "myUtils.h"
+
+
+// settings
+static const int WinWidth = 200;
+static const int WinHeight = 200;
+
+static const GLsizei MinSize = 256;
+static const GLsizei MaxSize = 4096;
+static const unsigned PassFills = 4;        // fullscreen quads per pass
+static const unsigned CounterFrames = 16;   // frames measured by the GPU counters
+
+static api_t Api;
+static GLuint VAO;
+static GLuint VBO;
+static GLuint program;
+
+static RenderTarget Target;
+static int Mode;
+
+static const GLenum attachmentsAll[3] = { GL_COLOR_ATTACHMENT0, GL_DEPTH_ATTACHMENT, GL_STENCIL_ATTACHMENT };
+static const GLenum attachmentsDepthStencil[2] = { GL_DEPTH_ATTACHMENT, GL_STENCIL_ATTACHMENT };
+
+static const char *modeNames[] = {
+    "load, store all",
+    "clear, store all",
+    "invalidate all, store all",
+    "clear, invalidate depth/stencil",
+    "clear, invalidate sub depth/stencil",
+};
+
+struct vertex
+{
+    GLfloat x, y;
+};
+
+static const struct vertex vertices[4] = {
+    { -1.0, -1.0 },
+    {  1.0, -1.0 },
+    {  1.0,  1.0 },
+    { -1.0,  1.0 }
+};
+
+const char *vertexShaderBody =
+    "layout (location = 0) in vec2 vPos;\n"
+    "void main()\n"
+    "{\n"
+    "   gl_Position = vec4( vPos.x, vPos.y, 0.5, 1.0 );\n"
+    "}\n\0";
+
+const char *fragmentShaderBody =
+    "layout (location = 0) out vec4 outColor;\n"
+    "void main()\n"
+    "{\n"
+    "   outColor = vec4( 0.5, 0.5, 0.5, 0.5 );\n"
+    "}\n\0";
+
+static void PerfInit()
+{
+    // build and compile our shader program
+    // ------------------------------------
+    program = CreateProgramFromBody( Api, vertexShaderBody, fragmentShaderBody );
+    glUseProgram(program);
+
+    // set up vertex data (and buffer(s)) and configure vertex attributes
+    // ------------------------------------------------------------------
+    glGenVertexArrays(1, &VAO);
+    glBindVertexArray(VAO);
+
+    glGenBuffers(1, &VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+
+    glVertexAttribPointer( 0, 2, GL_FLOAT, GL_FALSE, sizeof(struct vertex), (void*) 0 );
+    glEnableVertexAttribArray(0);
+
+    // every fill writes depth and stencil, so that they are worth storing
+    // ------------------------------------------------------------------
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_ALWAYS);
+    glEnable(GL_STENCIL_TEST);
+    glStencilFunc(GL_ALWAYS, 1, 0xFF);
+    glStencilOp(GL_KEEP, GL_KEEP, GL_INCR);
+}
+
+static void RenderPass()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, Target.fbo);
+    glViewport(0, 0, Target.width, Target.height);
+
+    // start of the pass
+    if (Mode == 1 || Mode == 3 || Mode == 4)
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+    else if (Mode == 2)
+        glInvalidateFramebuffer(GL_FRAMEBUFFER, 3, attachmentsAll);
+
+    for (unsigned i = 0; i < PassFills; i++)
+        glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+
+    // end of the pass
+    if (Mode == 3)
+        glInvalidateFramebuffer(GL_FRAMEBUFFER, 2, attachmentsDepthStencil);
+    else if (Mode == 4)
+        glInvalidateSubFramebuffer(GL_FRAMEBUFFER, 2, attachmentsDepthStencil, 0, 0, Target.width, Target.height);
+
+    // the next pass, in another framebuffer, makes a tiler write the target back
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, WinWidth, WinHeight);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glFlush();
+}
+
+static void Frames(unsigned count)
+{
+    for (unsigned i = 0; i < count; i++)
+        RenderPass();
+    glFinish();
+}
+
+static void PerfDraw( int mode, GLsizei maxSize )
+{
+    const int hasInvalidate = glVersionAtLeast( 4, 3, 3, 0 ) || GLAD_GL_ARB_invalidate_subdata;
+    const int hasCounters = GpuCounters_Init();
+
+    GLsizei size = RenderTarget_MaxSize();
+    if( size > MaxSize )
+        size = MaxSize;
+    if( maxSize > 0 && maxSize < size )
+        size = maxSize;
+
+    for( int m = 0; m < (int)(sizeof(modeNames)/sizeof(modeNames[0])); m++ ){
+        if( mode != -1 && mode != m )
+            continue;
+        if( m >= 2 && !hasInvalidate ){
+            printf("%s: glInvalidateFramebuffer not supported\n", modeNames[m]);
+            continue;
+        }
+
+        printf("%s, %u fills/pass:\n", modeNames[m], PassFills);
+        Mode = m;
+        for( GLsizei s = MinSize; s <= size; s *= 2 ){
+            if( !RenderTarget_Create( &Target, s, s, GL_RGBA8, GL_DEPTH24_STENCIL8, 0 ) )
+                break;
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+
+            const double rate = PerfMeasureRate(Frames, eglx_PollEvents );
+            printf("   %5d x %-5d: %.1f frames/second", s, s, rate);
+
+            if( hasCounters ){
+                GpuCounters_Begin();
+                Frames(CounterFrames);
+                const double bytesPerFrame = GpuCounters_End() / CounterFrames;
+                printf(", %.2f MB/frame, %.2f GB/second", bytesPerFrame / (1024.0 * 1024.0), bytesPerFrame * rate / 1e9);
+            }
+            printf("\n");
+
+            RenderTarget_Destroy( &Target );
+            glErrorCheck();
+        }
+    }
+
+    glErrorCheck();
+    exit(0);
+}
+
+int main( int argc, const char* argv[] )
+{
+    Api = apiInitial( API_AnyShader, argc, argv );
+    printf("%s: %s\n", argv[0], apiName(Api));
+
+    int __mode = integerFromArgs("--mode", argc, argv, NULL );
+    int __maxsize = integerFromArgs("--maxsize", argc, argv, NULL );
+
+    // initialize and configure
+    // ------------------------------
+    eglx_CreateWindow( Api, WinWidth, WinHeight );
+
+    // init
+    // -----------
+    PerfInit();
+
+    // render loop
+    // -----------
+    while (!eglx_ShouldClose())
+    {
+        // render
+        // ------
+        PerfDraw( __mode, __maxsize );
+
+        // swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
+        // -------------------------------------------------------------------------------
+        eglx_SwapBuffers();
+        eglx_PollEvents();
+    }
+
+    // terminate, clearing all previously allocated resources.
+    // ------------------------------------------------------------------
+    eglx_Terminate();
+    return 0;
+}
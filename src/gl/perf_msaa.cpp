@@ -0,0 +1,309 @@
+/**
+ * Measure the cost of MSAA: perf_fill_gl simple/blended fill into 1x, 2x, 4x, 8x render targets,
+ * and the resolve to a single sampled target:
+ *   --mode 0: fill rate
+ *   --mode 1: glBlitFramebuffer() resolve, cost per megapixel
+ *   --mode 2: frame = clear + fills + resolve, explicit glBlitFramebuffer() resolve,
+ *             and GL_EXT_multisampled_render_to_texture implicit resolve on GLES
+ *   --samples N: only this sample count
+ * One build for gl and gles: --api gl33 or gles32
+ */
+#include <stdio.h>
+#include "glad.h"
+#include "glUtils.h"
+#include "eglUtils.h"
+#include "myUtils.h"
+#include <EGL/egl.h>
+
+
+// settings
+static const int WinWidth = 200;
+static const int WinHeight = 200;
+
+static const GLsizei TargetWidth = 1920;
+static const GLsizei TargetHeight = 1080;
+static const unsigned FrameFills = 4;       // fullscreen quads per frame, mode 2
+
+static api_t Api;
+static GLuint VAO;
+static GLuint VBO;
+static GLuint program;
+
+static RenderTarget MsaaTarget;
+static RenderTarget ResolveTarget;
+
+// GL_EXT_multisampled_render_to_texture target, the resolve happens when the tile memory is written back
+static GLuint MsrttFBO, MsrttTex, MsrttDepth;
+
+// GLES only extension, not in the glad_gl table
+typedef void (GLAD_API_PTR *PFNGLRENDERBUFFERSTORAGEMULTISAMPLEEXTPROC_)(GLenum target, GLsizei samples, GLenum internalformat, GLsizei width, GLsizei height);
+typedef void (GLAD_API_PTR *PFNGLFRAMEBUFFERTEXTURE2DMULTISAMPLEEXTPROC_)(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level, GLsizei samples);
+static PFNGLRENDERBUFFERSTORAGEMULTISAMPLEEXTPROC_ _glRenderbufferStorageMultisampleEXT = NULL;
+static PFNGLFRAMEBUFFERTEXTURE2DMULTISAMPLEEXTPROC_ _glFramebufferTexture2DMultisampleEXT = NULL;
+
+struct vertex
+{
+    GLfloat x, y, r, g, b, a;
+};
+
+static const struct vertex vertices[4] = {
+    /*  x     y     r    g    b    a  */
+    { -1.0, -1.0,  1.0, 0.0, 0.0, 0.5 },
+    {  1.0, -1.0,  0.0, 1.0, 0.0, 0.5 },
+    {  1.0,  1.0,  0.0, 0.0, 1.0, 0.5 },
+    { -1.0,  1.0,  1.0, 1.0, 1.0, 0.5 }
+};
+
+const char *vertexShaderBody =
+    "layout (location = 0) in vec2 vPos;\n"
+    "layout (location = 1) in vec4 vCol;\n"
+    "out vec4 v_color;\n"
+    "void main()\n"
+    "{\n"
+    "   gl_Position = vec4( vPos.x, vPos.y, 0.0, 1.0 );\n"
+    "   v_color = vCol;\n"
+    "}\n\0";
+
+const char *fragmentShaderBody =
+    "in vec4 v_color;\n"
+    "layout (location = 0) out vec4 outColor;\n"
+    "void main()\n"
+    "{\n"
+    "   outColor = v_color;\n"
+    "}\n\0";
+
+static void PerfInit()
+{
+    // build and compile our shader program
+    // ------------------------------------
+    program = CreateProgramFromBody( Api, vertexShaderBody, fragmentShaderBody );
+    glUseProgram(program);
+
+    // set up vertex data (and buffer(s)) and configure vertex attributes
+    // ------------------------------------------------------------------
+    glGenVertexArrays(1, &VAO);
+    glBindVertexArray(VAO);
+
+    glGenBuffers(1, &VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+
+    glVertexAttribPointer( 0, 2, GL_FLOAT, GL_FALSE, sizeof(struct vertex), (void*) 0 ); //vPos
+    glVertexAttribPointer( 1, 4, GL_FLOAT, GL_FALSE, sizeof(struct vertex), (void*) (2 * sizeof(GLfloat)) ); //vCol
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+
+    // resolve destination
+    // ------------------------------------------------------------------
+    if( !RenderTarget_Create( &ResolveTarget, TargetWidth, TargetHeight, GL_RGBA8, GL_NONE, 0 ) )
+        exit(EXIT_FAILURE);
+}
+
+static int MsrttInit()
+{
+    if( Api.api != API_GLES || !glHasExtension( "GL_EXT_multisampled_render_to_texture" ) )
+        return 0;
+
+    _glRenderbufferStorageMultisampleEXT = (PFNGLRENDERBUFFERSTORAGEMULTISAMPLEEXTPROC_) eglGetProcAddress( "glRenderbufferStorageMultisampleEXT" );
+    _glFramebufferTexture2DMultisampleEXT = (PFNGLFRAMEBUFFERTEXTURE2DMULTISAMPLEEXTPROC_) eglGetProcAddress( "glFramebufferTexture2DMultisampleEXT" );
+    return _glRenderbufferStorageMultisampleEXT && _glFramebufferTexture2DMultisampleEXT;
+}
+
+static int CreateMsrttTarget( GLsizei samples )
+{
+    glGenTextures( 1, &MsrttTex );
+    glBindTexture( GL_TEXTURE_2D, MsrttTex );
+    glTexStorage2D( GL_TEXTURE_2D, 1, GL_RGBA8, TargetWidth, TargetHeight );
+
+    glGenRenderbuffers( 1, &MsrttDepth );
+    glBindRenderbuffer( GL_RENDERBUFFER, MsrttDepth );
+    _glRenderbufferStorageMultisampleEXT( GL_RENDERBUFFER, samples, GL_DEPTH24_STENCIL8, TargetWidth, TargetHeight );
+
+    glGenFramebuffers( 1, &MsrttFBO );
+    glBindFramebuffer( GL_FRAMEBUFFER, MsrttFBO );
+    _glFramebufferTexture2DMultisampleEXT( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, MsrttTex, 0, samples );
+    glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, MsrttDepth );
+
+    const GLenum stat = glCheckFramebufferStatus( GL_FRAMEBUFFER );
+    if( stat != GL_FRAMEBUFFER_COMPLETE ){
+        printf("%s: %d samples: %s\n", __func__, samples, framebufferStatusName(stat));
+        return 0;
+    }
+    glViewport( 0, 0, TargetWidth, TargetHeight );
+    return 1;
+}
+
+static void DestroyMsrttTarget()
+{
+    glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+    glDeleteFramebuffers( 1, &MsrttFBO );
+    glDeleteTextures( 1, &MsrttTex );
+    glDeleteRenderbuffers( 1, &MsrttDepth );
+    MsrttFBO = MsrttTex = MsrttDepth = 0;
+}
+
+/* same as DrawQuadOffscreen() of perf_fill_gl */
+static void DrawQuad(unsigned count)
+{
+    unsigned i;
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+
+    for (i = 0; i < count; i++) {
+        glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+
+        if (i % 128 == 0)
+            glFlush();
+    }
+
+    glFinish();
+}
+
+static void Resolve(unsigned count)
+{
+    glBindFramebuffer( GL_READ_FRAMEBUFFER, MsaaTarget.fbo );
+    glBindFramebuffer( GL_DRAW_FRAMEBUFFER, ResolveTarget.fbo );
+
+    for (unsigned i = 0; i < count; i++)
+        glBlitFramebuffer( 0, 0, TargetWidth, TargetHeight, 0, 0, TargetWidth, TargetHeight, GL_COLOR_BUFFER_BIT, GL_NEAREST );
+
+    glFinish();
+    glBindFramebuffer( GL_FRAMEBUFFER, MsaaTarget.fbo );
+}
+
+/* a frame rendered into MsaaTarget, resolved with glBlitFramebuffer() */
+static void FrameExplicitResolve(unsigned count)
+{
+    for (unsigned i = 0; i < count; i++) {
+        glBindFramebuffer( GL_FRAMEBUFFER, MsaaTarget.fbo );
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+        for (unsigned j = 0; j < FrameFills; j++)
+            glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+
+        if (MsaaTarget.samples > 0) {
+            glBindFramebuffer( GL_DRAW_FRAMEBUFFER, ResolveTarget.fbo );
+            glBlitFramebuffer( 0, 0, TargetWidth, TargetHeight, 0, 0, TargetWidth, TargetHeight, GL_COLOR_BUFFER_BIT, GL_NEAREST );
+        }
+        glFlush();
+    }
+    glFinish();
+}
+
+/* a frame rendered into MsrttFBO, resolved implicitly, the multisampled data is never written to memory */
+static void FrameImplicitResolve(unsigned count)
+{
+    static const GLenum discards[] = { GL_DEPTH_STENCIL_ATTACHMENT };
+
+    glBindFramebuffer( GL_FRAMEBUFFER, MsrttFBO );
+    for (unsigned i = 0; i < count; i++) {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+        for (unsigned j = 0; j < FrameFills; j++)
+            glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+        glInvalidateFramebuffer( GL_FRAMEBUFFER, 1, discards );
+        glFlush();
+    }
+    glFinish();
+}
+
+static void PerfDraw( int mode, int samplesOnly )
+{
+    static const GLsizei sampleCounts[] = { 0, 2, 4, 8 };
+    const double mpixels = (double)TargetWidth * TargetHeight / 1e6;
+
+    GLint maxSamples;
+    glGetIntegerv( GL_MAX_SAMPLES, &maxSamples );
+    printf("GL_MAX_SAMPLES = %d, target %d x %d RGBA8 + depth24/stencil8\n", maxSamples, TargetWidth, TargetHeight);
+
+    const int hasMsrtt = MsrttInit();
+    if( Api.api == API_GLES )
+        printf("GL_EXT_multisampled_render_to_texture = %d\n", hasMsrtt);
+
+    for( size_t s = 0; s < sizeof(sampleCounts)/sizeof(sampleCounts[0]); s++ ){
+        const GLsizei samples = sampleCounts[s];
+        if( samplesOnly != -1 && samplesOnly != samples )
+            continue;
+        if( samples > maxSamples ){
+            printf("%dx: not supported\n", samples);
+            continue;
+        }
+        if( !RenderTarget_Create( &MsaaTarget, TargetWidth, TargetHeight, GL_RGBA8, GL_DEPTH24_STENCIL8, samples ) )
+            continue;
+        printf("%dx:\n", samples > 0 ? samples : 1);
+
+        if( mode == -1 || mode == 0 ){
+            double rate = PerfMeasureRate(DrawQuad, eglx_PollEvents ) * mpixels * 1e6;
+            printf("   Simple fill: %s pixels/second\n", PerfHumanFloat(rate));
+
+            glEnable(GL_BLEND);
+            rate = PerfMeasureRate(DrawQuad, eglx_PollEvents ) * mpixels * 1e6;
+            glDisable(GL_BLEND);
+            printf("   Blended fill: %s pixels/second\n", PerfHumanFloat(rate));
+        }
+
+        if( (mode == -1 || mode == 1) && samples > 0 ){
+            glClear(GL_COLOR_BUFFER_BIT);
+            glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+            const double rate = PerfMeasureRate(Resolve, eglx_PollEvents );
+            printf("   glBlitFramebuffer resolve: %.1f resolves/second, %.3f ms/megapixel\n",
+                   rate, 1e3 / (rate * mpixels));
+        }
+
+        if( mode == -1 || mode == 2 ){
+            const double rate = PerfMeasureRate(FrameExplicitResolve, eglx_PollEvents );
+            printf("   Frame, clear + %u fills%s: %.1f frames/second, %.3f ms/megapixel\n",
+                   FrameFills, samples > 0 ? " + glBlitFramebuffer resolve" : "", rate, 1e3 / (rate * mpixels));
+        }
+
+        RenderTarget_Destroy( &MsaaTarget );
+
+        if( (mode == -1 || mode == 2) && samples > 0 && hasMsrtt ){
+            if( CreateMsrttTarget( samples ) ){
+                const double rate = PerfMeasureRate(FrameImplicitResolve, eglx_PollEvents );
+                printf("   Frame, clear + %u fills + multisampled_render_to_texture resolve: %.1f frames/second, %.3f ms/megapixel\n",
+                       FrameFills, rate, 1e3 / (rate * mpixels));
+            }
+            DestroyMsrttTarget();
+        }
+        glErrorCheck();
+    }
+
+    glErrorCheck();
+    exit(0);
+}
+
+int main( int argc, const char* argv[] )
+{
+    Api = apiInitial( API_AnyShader, argc, argv );
+    printf("%s: %s\n", argv[0], apiName(Api));
+
+    int __mode = integerFromArgs("--mode", argc, argv, NULL );
+    int __samples = integerFromArgs("--samples", argc, argv, NULL );
+    if( __samples == 1 )
+        __samples = 0;
+
+    // initialize and configure
+    // ------------------------------
+    eglx_CreateWindow( Api, WinWidth, WinHeight );
+
+    // init
+    // -----------
+    PerfInit();
+
+    // render loop
+    // -----------
+    while (!eglx_ShouldClose())
+    {
+        // render
+        // ------
+        PerfDraw( __mode, __samples );
+
+        // swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
+        // -------------------------------------------------------------------------------
+        eglx_SwapBuffers();
+        eglx_PollEvents();
+    }
+
+    // terminate, clearing all previously allocated resources.
+    // ------------------------------------------------------------------
+    eglx_Terminate();
+    return 0;
+}
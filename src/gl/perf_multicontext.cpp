@@ -0,0 +1,259 @@
+/**
+ * Measure how driver throughput scales with 1 ~ N threads, each one owning a context
+ * rendering to its own pbuffer:
+ *   --mode 0: perf_drawoverhead workload, draw only
+ *   --mode 1: perf_vbo workload, glBufferSubData() + draw
+ *   --share 0: every context has its own share group
+ *   --share 1: all contexts share objects with the window context
+ *   --threads N: max threads, default 4
+ * One build for gl and gles: --api gl33 or gles32
+ */
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include "glad.h"
+#include "glUtils.h"
+#include "eglUtils.h"
+#include "myUtils.h"
+
+
+// settings
+static const int WinWidth = 200;
+static const int WinHeight = 200;
+
+#define MaxThreads  64
+static const double Duration = 2.0;     // seconds per measure
+static const GLsizei VBOSubSize = 16 * 1024;
+
+typedef struct ThreadData{
+    int index;
+    int mode;
+    eglContext_t *ctx;
+    GLuint program, VAO, VBO;           // created by the thread, in its context
+    double rate;                        // iterations/second
+} ThreadData;
+
+static api_t Api;
+static pthread_barrier_t startBarrier;
+
+struct vertex
+{
+    GLfloat x, y;
+};
+
+static const struct vertex vertices[] = {
+    { -0.5, -0.5 },
+    {  0.5, -0.5 },
+    {  0.0,  0.5 },
+};
+
+const char *vertexShaderBody =
+    "layout (location = 0) in vec2 vPos;\n"
+    "void main()\n"
+    "{\n"
+    "   gl_Position = vec4( vPos.x, vPos.y, 0.0f, 1.0f );\n"
+    "#ifdef GL_ES\n"
+    "   gl_PointSize = 1.0;\n" // make IMG gpu happy
+    "#endif\n"
+    "}\n\0";
+
+const char *fragmentShaderBody =
+    "layout (location = 0) out vec4 outColor;\n"
+    "void main()\n"
+    "{\n"
+    "   outColor = vec4( 1.0f, 1.0f, 1.0f, 1.0f );\n"
+    "}\n\0";
+
+/* per thread objects, created in the thread's own context, in both share modes */
+static void ThreadInit( ThreadData *data, GLubyte *subData )
+{
+    data->program = CreateProgramFromBody( Api, vertexShaderBody, fragmentShaderBody );
+    glUseProgram( data->program );
+
+    glGenVertexArrays( 1, &data->VAO );
+    glBindVertexArray( data->VAO );
+
+    glGenBuffers( 1, &data->VBO );
+    glBindBuffer( GL_ARRAY_BUFFER, data->VBO );
+    glBufferData( GL_ARRAY_BUFFER, VBOSubSize, NULL, GL_STREAM_DRAW );
+    for( GLsizei i = 0; i < VBOSubSize / (GLsizei)sizeof(vertices); i++ )
+        memcpy( subData + i * sizeof(vertices), vertices, sizeof(vertices) );
+    glBufferSubData( GL_ARRAY_BUFFER, 0, VBOSubSize, subData );
+
+    glVertexAttribPointer( 0, 2, GL_FLOAT, GL_FALSE, sizeof(struct vertex), (void*) 0 );
+    glEnableVertexAttribArray( 0 );
+    glViewport( 0, 0, WinWidth, WinHeight );
+}
+
+/* shared objects would stay in the window context's share group until exit */
+static void ThreadCleanup( ThreadData *data )
+{
+    glDeleteVertexArrays( 1, &data->VAO );
+    glDeleteBuffers( 1, &data->VBO );
+    glDeleteProgram( data->program );
+}
+
+/* same as DrawNoStateChange() of perf_drawoverhead */
+static void DrawNoStateChange( unsigned count, const GLubyte *subData )
+{
+    for (unsigned i = 0; i < count; i++)
+        glDrawArrays( GL_TRIANGLES, 0, 3 );
+    glFinish();
+}
+
+/* same as UploadSubVBO() of perf_vbo */
+static void UploadSubVBO( unsigned count, const GLubyte *subData )
+{
+    for (unsigned i = 0; i < count; i++) {
+        glBufferSubData( GL_ARRAY_BUFFER, 0, VBOSubSize, subData );
+        glDrawArrays( GL_POINTS, 0, 1 );
+    }
+    glFinish();
+}
+
+static void* ThreadMain( void *arg )
+{
+    ThreadData *data = (ThreadData*) arg;
+    void (*workload)( unsigned, const GLubyte* ) = (data->mode == 0) ? DrawNoStateChange : UploadSubVBO;
+    GLubyte *subData = (GLubyte*) malloc( VBOSubSize );
+
+    if( !egl_MakeCurrent( data->ctx ) )
+        exit(EXIT_FAILURE);
+    ThreadInit( data, subData );
+
+    // warm up, and find a batch size of a few milliseconds
+    unsigned subiters = 16;
+    double t0 = PerfGetSecond();
+    do {
+        workload( subiters, subData );
+        subiters *= 2;
+    } while( PerfGetSecond() - t0 < 0.01 * Duration );
+
+    // all threads start together
+    pthread_barrier_wait( &startBarrier );
+
+    unsigned iters = 0;
+    double t1;
+    t0 = PerfGetSecond();
+    do {
+        workload( subiters, subData );
+        iters += subiters;
+        t1 = PerfGetSecond();
+    } while( t1 - t0 < Duration );
+    data->rate = iters / (t1 - t0);
+
+    ThreadCleanup( data );
+    glErrorCheck();
+    egl_MakeCurrent( NULL );
+    free( subData );
+    return NULL;
+}
+
+/* return the aggregate rate */
+static double RunThreads( int mode, int share, int numThreads )
+{
+    ThreadData data[MaxThreads];
+    pthread_t threads[MaxThreads];
+
+    for( int i = 0; i < numThreads; i++ ){
+        data[i].index = i;
+        data[i].mode = mode;
+        data[i].rate = 0.0;
+        data[i].ctx = egl_CreateContextEx( Api, NULL, NULL, WinWidth, WinHeight, share ? egl_GetDefaultContext() : NULL );
+        if( data[i].ctx == NULL ){
+            printf("%s: can't create context %d\n", __func__, i);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    pthread_barrier_init( &startBarrier, NULL, numThreads );
+    for( int i = 0; i < numThreads; i++ )
+        pthread_create( &threads[i], NULL, ThreadMain, &data[i] );
+
+    double total = 0.0;
+    for( int i = 0; i < numThreads; i++ ){
+        pthread_join( threads[i], NULL );
+        total += data[i].rate;
+    }
+    pthread_barrier_destroy( &startBarrier );
+
+    const double unit = (mode == 0) ? 1.0 : VBOSubSize / (1024.0 * 1024.0);
+    printf("   %2d threads: %s %s aggregate, per thread:", numThreads,
+           PerfHumanFloat(total * unit), (mode == 0) ? "draws/sec" : "MB/sec");
+    for( int i = 0; i < numThreads; i++ )
+        printf(" %s", PerfHumanFloat(data[i].rate * unit));
+    printf("\n");
+
+    for( int i = 0; i < numThreads; i++ )
+        egl_DestroyContext( data[i].ctx );
+
+    return total;
+}
+
+static void PerfDraw( int mode, int share, int maxThreads )
+{
+    static const char *workloadNames[] = { "perf_drawoverhead, draw only", "perf_vbo, glBufferSubData(16KB) + draw" };
+
+    for( int m = 0; m < 2; m++ ){
+        if( mode != -1 && mode != m )
+            continue;
+
+        for( int s = 0; s < 2; s++ ){
+            if( share != -1 && share != s )
+                continue;
+
+            printf("%s, %s share groups\n", workloadNames[m], s ? "shared" : "independent");
+            double rate1 = 0.0;
+            for( int n = 1; n <= maxThreads; n++ ){
+                const double rate = RunThreads( m, s, n );
+                if( n == 1 )
+                    rate1 = rate;
+                else
+                    printf("              scaling x%.2f of 1 thread\n", rate / rate1);
+                eglx_PollEvents();
+            }
+            printf("\n");
+        }
+    }
+
+    exit(0);
+}
+
+int main( int argc, const char* argv[] )
+{
+    Api = apiInitial( API_AnyShader, argc, argv );
+    printf("%s: %s\n", argv[0], apiName(Api));
+
+    int __mode = integerFromArgs("--mode", argc, argv, NULL );
+    int __share = integerFromArgs("--share", argc, argv, NULL );
+    int __threads = integerFromArgs("--threads", argc, argv, NULL );
+    if( __threads == -1 )
+        __threads = 4;
+    if( __threads < 1 || __threads > MaxThreads ){
+        printf("--threads must be in [1, %d]\n", MaxThreads);
+        exit(EXIT_FAILURE);
+    }
+
+    // initialize and configure
+    // ------------------------------
+    eglx_CreateWindow( Api, WinWidth, WinHeight );
+
+    // render loop
+    // -----------
+    while (!eglx_ShouldClose())
+    {
+        // render
+        // ------
+        PerfDraw( __mode, __share, __threads );
+
+        // swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
+        // -------------------------------------------------------------------------------
+        eglx_SwapBuffers();
+        eglx_PollEvents();
+    }
+
+    // terminate, clearing all previously allocated resources.
+    // ------------------------------------------------------------------
+    eglx_Terminate();
+    return 0;
+}
@@ -0,0 +1,303 @@
+/**
+ * Measure pixel conversion for readback consumers, on the GPU vs on the CPU:
+ *   GPU: a shader converts and packs the bytes into an RGBA8 target, which is read back as is
+ *   CPU: the RGBA8 image is read back, then converted by PixelConvert_XXX(), in row bands on --threads N threads
+ *   --mode 0: BGRA
+ *   --mode 1: RGB24
+ *   --mode 2: premultiplied RGBA
+ *   --mode 3: RGB565
+ *   --mode 4: NV12
+ *   --flip 0: keep GL's bottom-up rows, default is top-down
+ * Both outputs are compared, max diff is the largest byte difference.
+ * One build for gl and gles: --api gl33 or gles32
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "glad.h"
+#include "glUtils.h"
+#include "eglUtils.h"
+#include "myUtils.h"
+#include "pixelConvert.h"
+
+
+// settings
+static const int WinWidth = 200;
+static const int WinHeight = 200;
+
+static const GLsizei Width = 1920;
+static const GLsizei Height = 1080;
+
+static api_t Api;
+static GLuint VAO;
+static GLuint program;
+static GLint modeLoc, flipLoc, srcSizeLoc;
+
+static RenderTarget Src;
+static RenderTarget Packed;
+static int Mode;
+static int Flip = 1;
+static GLubyte *Readback;
+static GLubyte *CpuOut;
+static GLubyte *GpuOut;
+
+enum {
+    CONV_BGRA,
+    CONV_RGB,
+    CONV_PREMULTIPLY,
+    CONV_565,
+    CONV_NV12,
+    CONV_COUNT
+};
+
+// packed target size, in RGBA8 texels, for Width x Height pixels
+static const struct {
+    const char *name;
+    GLsizei width, height;
+} Conversions[CONV_COUNT] = {
+    { "BGRA",          Width,         Height },
+    { "RGB24",         Width * 3 / 4, Height },
+    { "premultiplied", Width,         Height },
+    { "RGB565",        Width / 2,     Height },
+    { "NV12",          Width / 4,     Height * 3 / 2 },
+};
+
+const char *vertexShaderBody =
+    "void main()\n"
+    "{\n"
+    "   vec2 pos = vec2( float((gl_VertexID << 1) & 2), float(gl_VertexID & 2) );\n"
+    "   gl_Position = vec4( pos * 2.0 - 1.0, 0.0, 1.0 );\n"
+    "}\n\0";
+
+// every output texel is 4 bytes of the converted image, same math as pixelConvert.cpp
+const char *fragmentShaderBody =
+    "#ifdef GL_ES\n"
+    "precision highp float;\n"
+    "precision highp int;\n"
+    "#endif\n"
+    "uniform highp sampler2D Src;\n"
+    "uniform int Mode;\n"
+    "uniform int Flip;\n"
+    "uniform ivec2 SrcSize;\n"
+    "layout (location = 0) out vec4 outColor;\n"
+    "uvec4 fetch( int x, int y )\n"
+    "{\n"
+    "   x = min( x, SrcSize.x - 1 );\n"
+    "   y = min( y, SrcSize.y - 1 );\n"
+    "   if( Flip != 0 )\n"
+    "       y = SrcSize.y - 1 - y;\n"
+    "   return uvec4( texelFetch( Src, ivec2(x, y), 0 ) * 255.0 + 0.5 );\n"
+    "}\n"
+    "uint byteAt( int k, int row )\n"
+    "{\n"
+    "   if( Mode == 0 ){\n"
+    "       uvec4 p = fetch( k / 4, row ).bgra;\n"
+    "       return p[k % 4];\n"
+    "   }\n"
+    "   if( Mode == 1 ){\n"
+    "       uvec4 p = fetch( k / 3, row );\n"
+    "       return p[k % 3];\n"
+    "   }\n"
+    "   if( Mode == 2 ){\n"
+    "       uvec4 p = fetch( k / 4, row );\n"
+    "       if( k % 4 == 3 )\n"
+    "           return p.a;\n"
+    "       uint t = p[k % 4] * p.a + 128u;\n"
+    "       return (t + (t >> 8)) >> 8;\n"
+    "   }\n"
+    "   if( Mode == 3 ){\n"
+    "       uvec4 p = fetch( k / 2, row );\n"
+    "       uvec3 c = (p.rgb * uvec3( 31u, 63u, 31u ) + 127u) / 255u;\n"
+    "       uint v = (c.r << 11) | (c.g << 5) | c.b;\n"
+    "       return (k % 2 == 0) ? (v & 255u) : (v >> 8);\n"
+    "   }\n"
+    "   if( row < SrcSize.y ){\n"
+    "       uvec4 p = fetch( k, row );\n"
+    "       return ((66u * p.r + 129u * p.g + 25u * p.b + 128u) >> 8) + 16u;\n"
+    "   }\n"
+    "   int x = (k / 2) * 2;\n"
+    "   int y = (row - SrcSize.y) * 2;\n"
+    "   uvec4 s = fetch( x, y ) + fetch( x + 1, y ) + fetch( x, y + 1 ) + fetch( x + 1, y + 1 );\n"
+    "   ivec3 c = ivec3( (s.rgb + 2u) >> 2 );\n"
+    "   if( k % 2 == 0 )\n"
+    "       return uint( ((-38 * c.r - 74 * c.g + 112 * c.b + 128) >> 8) + 128 );\n"
+    "   return uint( ((112 * c.r - 94 * c.g - 18 * c.b + 128) >> 8) + 128 );\n"
+    "}\n"
+    "void main()\n"
+    "{\n"
+    "   ivec2 o = ivec2( gl_FragCoord.xy );\n"
+    "   int k = o.x * 4;\n"
+    "   outColor = vec4( byteAt( k, o.y ), byteAt( k + 1, o.y ), byteAt( k + 2, o.y ), byteAt( k + 3, o.y ) ) / 255.0;\n"
+    "}\n\0";
+
+static void PerfInit()
+{
+    // build and compile our shader program
+    // ------------------------------------
+    program = CreateProgramFromBody( Api, vertexShaderBody, fragmentShaderBody );
+    glUseProgram(program);
+    glUniform1i( glGetUniformLocation( program, "Src" ), 0 );
+    modeLoc = glGetUniformLocation( program, "Mode" );
+    flipLoc = glGetUniformLocation( program, "Flip" );
+    srcSizeLoc = glGetUniformLocation( program, "SrcSize" );
+    glUniform2i( srcSizeLoc, Width, Height );
+
+    // the fullscreen triangle comes from gl_VertexID
+    // ------------------------------------------------------------------
+    glGenVertexArrays(1, &VAO);
+    glBindVertexArray(VAO);
+
+    // source image: checkerboard, alpha ramp so that premultiply does something
+    // ------------------------------------------------------------------
+    if( !RenderTarget_Create( &Src, Width, Height, GL_RGBA8, GL_NONE, 0 ) )
+        exit(EXIT_FAILURE);
+    uint8_t *image = GenerateCheckboard_RGBA( Width, Height, 8 );
+    for( GLsizei y = 0; y < Height; y++ )
+        for( GLsizei x = 0; x < Width; x++ )
+            image[(y * Width + x) * 4 + 3] = (uint8_t)(x + y);
+    glActiveTexture( GL_TEXTURE0 );
+    glBindTexture( GL_TEXTURE_2D, Src.colorTexture );
+    glTexSubImage2D( GL_TEXTURE_2D, 0, 0, 0, Width, Height, GL_RGBA, GL_UNSIGNED_BYTE, image );
+    free( image );
+
+    Readback = (GLubyte*) malloc( Width * Height * 4 );
+    CpuOut = (GLubyte*) malloc( Width * Height * 4 );
+    GpuOut = (GLubyte*) malloc( Width * Height * 4 );
+}
+
+static void CpuConvertOnly(unsigned count)
+{
+    for (unsigned i = 0; i < count; i++) {
+        switch (Mode) {
+            case CONV_BGRA:
+                PixelConvert_RGBAtoBGRA( Readback, Width * 4, CpuOut, Width * 4, Width, Height, Flip );
+                break;
+            case CONV_RGB:
+                PixelConvert_RGBAtoRGB( Readback, Width * 4, CpuOut, Width * 3, Width, Height, Flip );
+                break;
+            case CONV_PREMULTIPLY:
+                PixelConvert_Premultiply( Readback, Width * 4, CpuOut, Width * 4, Width, Height, Flip );
+                break;
+            case CONV_565:
+                PixelConvert_RGBAto565( Readback, Width * 4, CpuOut, Width * 2, Width, Height, Flip );
+                break;
+            case CONV_NV12:
+                PixelConvert_RGBAtoNV12( Readback, Width * 4, CpuOut, Width, CpuOut + Width * Height, Width, Width, Height, Flip );
+                break;
+        }
+    }
+}
+
+static void ReadbackConvert(unsigned count)
+{
+    glBindFramebuffer( GL_FRAMEBUFFER, Src.fbo );
+    for (unsigned i = 0; i < count; i++) {
+        glReadPixels( 0, 0, Width, Height, GL_RGBA, GL_UNSIGNED_BYTE, Readback );
+        CpuConvertOnly( 1 );
+    }
+    glFinish();
+}
+
+static void ReadbackOnly(unsigned count)
+{
+    glBindFramebuffer( GL_FRAMEBUFFER, Src.fbo );
+    for (unsigned i = 0; i < count; i++)
+        glReadPixels( 0, 0, Width, Height, GL_RGBA, GL_UNSIGNED_BYTE, Readback );
+    glFinish();
+}
+
+static void GpuConvert(unsigned count)
+{
+    glBindFramebuffer( GL_FRAMEBUFFER, Packed.fbo );
+    glViewport( 0, 0, Packed.width, Packed.height );
+    for (unsigned i = 0; i < count; i++) {
+        glDrawArrays( GL_TRIANGLES, 0, 3 );
+        glReadPixels( 0, 0, Packed.width, Packed.height, GL_RGBA, GL_UNSIGNED_BYTE, GpuOut );
+    }
+    glFinish();
+}
+
+static void PerfDraw( int mode )
+{
+    printf("%d x %d, flip %d, CPU: %s, %d threads\n", Width, Height, Flip, PixelConvert_SimdName(), PixelConvert_GetThreads());
+
+    const double readbackRate = PerfMeasureRate(ReadbackOnly, eglx_PollEvents );
+    printf("   RGBA readback alone: %.2f ms/frame\n", 1000.0 / readbackRate);
+
+    for( int m = 0; m < CONV_COUNT; m++ ){
+        if( mode != -1 && mode != m )
+            continue;
+
+        Mode = m;
+        glUseProgram( program );
+        glUniform1i( modeLoc, m );
+        glUniform1i( flipLoc, Flip );
+        if( !RenderTarget_Create( &Packed, Conversions[m].width, Conversions[m].height, GL_RGBA8, GL_NONE, 0 ) )
+            exit(EXIT_FAILURE);
+        glBindTexture( GL_TEXTURE_2D, Src.colorTexture );
+
+        const double gpuRate = PerfMeasureRate(GpuConvert, eglx_PollEvents );
+        const double cpuRate = PerfMeasureRate(ReadbackConvert, eglx_PollEvents );
+        const double convertRate = PerfMeasureRate(CpuConvertOnly, eglx_PollEvents );
+
+        // the last runs left both outputs of the same image
+        const size_t bytes = (size_t)Packed.width * Packed.height * 4;
+        int maxDiff = 0;
+        for( size_t i = 0; i < bytes; i++ ){
+            const int d = abs( (int)CpuOut[i] - (int)GpuOut[i] );
+            if( d > maxDiff )
+                maxDiff = d;
+        }
+
+        printf("   %-14s: GPU shader + readback %.2f ms/frame, readback + CPU %.2f ms/frame (convert %.2f ms, %.2f GB/sec), max diff %d\n",
+               Conversions[m].name, 1000.0 / gpuRate, 1000.0 / cpuRate,
+               1000.0 / convertRate, convertRate * Width * Height * 4 / 1e9, maxDiff);
+
+        RenderTarget_Destroy( &Packed );
+        glErrorCheck();
+    }
+
+    glErrorCheck();
+    exit(0);
+}
+
+int main( int argc, const char* argv[] )
+{
+    Api = apiInitial( API_AnyShader, argc, argv );
+    printf("%s: %s\n", argv[0], apiName(Api));
+
+    int __mode = integerFromArgs("--mode", argc, argv, NULL );
+    int __threads = integerFromArgs("--threads", argc, argv, NULL );
+    int __flip = integerFromArgs("--flip", argc, argv, NULL );
+    if( __threads > 0 )
+        PixelConvert_SetThreads( __threads );
+    if( __flip != -1 )
+        Flip = __flip;
+
+    // initialize and configure
+    // ------------------------------
+    eglx_CreateWindow( Api, WinWidth, WinHeight );
+
+    // init
+    // -----------
+    PerfInit();
+
+    // render loop
+    // -----------
+    while (!eglx_ShouldClose())
+    {
+        // render
+        // ------
+        PerfDraw( __mode );
+
+        // swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
+        // -------------------------------------------------------------------------------
+        eglx_SwapBuffers();
+        eglx_PollEvents();
+    }
+
+    // terminate, clearing all previously allocated resources.
+    // ------------------------------------------------------------------
+    eglx_Terminate();
+    return 0;
+}
@@ -1,5 +1,12 @@
 /**
  * Measure glReadPixels speed.
+ *   --offscreen: read whole offscreen render targets, RGBA8 / RGB10_A2 / RGBA16F, up to RenderTarget_MaxSize()
+ *     --maxsize N: stop the sweep at N x N
+ *     --pbo 1: read into a PBO
+ *   --matrix: read the window with every format/type pair, invalid pairs skipped, and mark the pairs read
+ *     without a driver-side conversion: GL_IMPLEMENTATION_COLOR_READ_FORMAT/TYPE, and the ones as fast as
+ *     the fastest pair of the same buffer (within MatrixFastRatio)
+ * One build for all apis: --api gl30 (glLegacy), gl33 or gles32
  */
 #include <stdio.h>
 #include "glad.h"
@@ -13,6 +20,7 @@ static const int WinWidth = 1000;
 static const int WinHeight = 1000;
 
 
+static api_t Api;
 static GLuint VAO;
 static GLuint VBO;
 static GLuint program;
@@ -24,30 +32,25 @@ static GLvoid *ReadBuffer;
 static GLuint PBO;
 static int use_PBO = 0;
 
+// surface read from: the window, or an offscreen render target
+static GLint SurfaceWidth = WinWidth;
+static GLint SurfaceHeight = WinHeight;
+static RenderTarget Target;
+static const GLsizei OffscreenMinSize = 256;
+
 static const GLfloat vertices[2] = { 0.0, 0.0 };
 
-const char *vertexShaderSource =
-#if IS_GlEs
-    "#version 320 es\n"
-#else
-    "#version 330\n"
-#endif
+const char *vertexShaderBody =
     "layout (location = 0) in vec2 vPos;\n"
     "void main()\n"
     "{\n"
     "   gl_Position = vec4( vPos.x, vPos.y, 0.0f, 1.0f );\n"
-#if IS_GlEs
+    "#ifdef GL_ES\n"
     "   gl_PointSize = 1.0;\n" // make IMG gpu happy
-#endif
+    "#endif\n"
     "}\n\0";
 
-const char *fragmentShaderSource =
-#if IS_GlEs
-    "#version 320 es\n"
-    "precision mediump float;\n"
-#else
-    "#version 330\n"
-#endif
+const char *fragmentShaderBody =
     "layout (location = 0) out vec4 outColor;\n"
     "void main()\n"
     "{\n"
@@ -58,33 +61,33 @@ static void PerfInit()
 {
     // build and compile our shader program
     // ------------------------------------
-#if !IS_GlLegacy
-    program = CreateProgramFromSource( vertexShaderSource, fragmentShaderSource );
-    glUseProgram(program);
-#endif
+    if( Api.api != API_GLLegacy ){
+        program = CreateProgramFromBody( Api, vertexShaderBody, fragmentShaderBody );
+        glUseProgram(program);
+    }
 
     // set up vertex data (and buffer(s)) and configure vertex attributes
     // ------------------------------------------------------------------
-#if IS_GlLegacy
-    glGenBuffers(1, &VBO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-    glVertexPointer(2, GL_FLOAT, sizeof(vertices), (void *) 0);
-    glEnableClientState(GL_VERTEX_ARRAY);
-#else
-    glGenVertexArrays(1, &VAO);
-    glBindVertexArray(VAO);
-
-    glGenBuffers(1, &VBO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-    const GLint vPos_location = glGetAttribLocation(program, "vPos");
-    printf("Attrib location: vPos=%d\n", vPos_location);
-    glVertexAttribPointer(vPos_location, 2, GL_FLOAT, GL_FALSE, sizeof(vertices), (void*) 0);
-    glEnableVertexAttribArray(vPos_location);
-#endif
+    if( Api.api == API_GLLegacy ){
+        glGenBuffers(1, &VBO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+
+        glVertexPointer(2, GL_FLOAT, sizeof(vertices), (void *) 0);
+        glEnableClientState(GL_VERTEX_ARRAY);
+    }else{
+        glGenVertexArrays(1, &VAO);
+        glBindVertexArray(VAO);
+
+        glGenBuffers(1, &VBO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+
+        const GLint vPos_location = glGetAttribLocation(program, "vPos");
+        printf("Attrib location: vPos=%d\n", vPos_location);
+        glVertexAttribPointer(vPos_location, 2, GL_FLOAT, GL_FALSE, sizeof(vertices), (void*) 0);
+        glEnableVertexAttribArray(vPos_location);
+    }
 
     // misc GL state
     // ------------------------------------------------------------------
@@ -115,8 +118,8 @@ static void ReadPixels(unsigned count)
         /* read from random pos */
         GLint x, y;
 
-        x = WinWidth - ReadWidth;
-        y = WinHeight - ReadHeight;
+        x = SurfaceWidth - ReadWidth;
+        y = SurfaceHeight - ReadHeight;
         if (x > 0)
             x = rand() % x;
         if (y > 0)
@@ -222,17 +225,184 @@ static void PerfDraw2( int Sizes_)
     exit(0);
 }
 
+// every format/type pair the APIs define for glReadPixels(), the context decides which ones are valid
+static const struct {
+    GLenum format;
+    GLenum type;
+    GLuint pixel_size;
+} MatrixFormats[] = {
+    { GL_RGBA, GL_UNSIGNED_BYTE,                   4 },
+    { GL_BGRA_EXT, GL_UNSIGNED_BYTE,               4 },
+    { GL_RGB, GL_UNSIGNED_BYTE,                    3 },
+    { GL_RGB, GL_UNSIGNED_SHORT_5_6_5,             2 },
+    { GL_RGBA, GL_UNSIGNED_SHORT_4_4_4_4,          2 },
+    { GL_RGBA, GL_UNSIGNED_SHORT_5_5_5_1,          2 },
+    { GL_RGBA, GL_UNSIGNED_INT_2_10_10_10_REV,     4 },
+    { GL_RGBA, GL_HALF_FLOAT,                      8 },
+    { GL_RGBA, GL_FLOAT,                           16 },
+    { GL_RG, GL_UNSIGNED_BYTE,                     2 },
+    { GL_RED, GL_UNSIGNED_BYTE,                    1 },
+    { GL_RGBA_INTEGER, GL_UNSIGNED_INT,            16 },
+    { GL_LUMINANCE, GL_UNSIGNED_BYTE,              1 },
+    // GL only, the 1x1 probe read skips them on GLES
+    { GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV,        4 },
+    { GL_RGBA, GL_UNSIGNED_INT_8_8_8_8,            4 },
+    { GL_BGR, GL_UNSIGNED_BYTE,                    3 },
+    { GL_DEPTH_COMPONENT, GL_UNSIGNED_INT,         4 },
+    { GL_DEPTH_COMPONENT, GL_UNSIGNED_SHORT,       2 },
+    { GL_DEPTH_COMPONENT, GL_FLOAT,                4 },
+    { GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8,      4 },
+    { GL_STENCIL_INDEX, GL_UNSIGNED_BYTE,          1 },
+    { 0, 0, 0 }
+};
+
+// within this fraction of the fastest pair of the same buffer, a pair is taken as not converted
+static const double MatrixFastRatio = 0.8;
+
+/* color, depth or stencil pairs are only compared with each other */
+static int MatrixBufferKind( GLenum format )
+{
+    if( format == GL_DEPTH_COMPONENT || format == GL_DEPTH_STENCIL )
+        return 1;
+    if( format == GL_STENCIL_INDEX )
+        return 2;
+    return 0;
+}
+
+static void PerfDrawMatrix()
+{
+    const int count = sizeof(MatrixFormats)/sizeof(MatrixFormats[0]) - 1;
+    double rates[sizeof(MatrixFormats)/sizeof(MatrixFormats[0])];
+    double best[3] = { 0.0, 0.0, 0.0 };
+    GLint implFormat = 0, implType = 0;
+
+    glGetIntegerv( GL_IMPLEMENTATION_COLOR_READ_FORMAT, &implFormat );
+    glGetIntegerv( GL_IMPLEMENTATION_COLOR_READ_TYPE, &implType );
+    printf("GL_IMPLEMENTATION_COLOR_READ_FORMAT/TYPE = %s/%s\n", glFormatName(implFormat), glTypeName(implType));
+
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+    while( glGetError() != GL_NO_ERROR )
+        ;
+
+    SurfaceWidth = ReadWidth = WinWidth;
+    SurfaceHeight = ReadHeight = WinHeight;
+    ReadBuffer = malloc( (size_t)WinWidth * WinHeight * 16 );
+    if( use_PBO ){
+        glBindBuffer( GL_PIXEL_PACK_BUFFER, PBO );
+        glBufferData( GL_PIXEL_PACK_BUFFER, (size_t)WinWidth * WinHeight * 16, NULL, GL_STREAM_READ );
+    }
+
+    for( int i = 0; i < count; i++ ){
+        ReadFormat = MatrixFormats[i].format;
+        ReadType = MatrixFormats[i].type;
+        rates[i] = -1.0;
+
+        // a 1x1 read tells whether the pair is valid for this context and surface
+        glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+        glReadPixels( 0, 0, 1, 1, ReadFormat, ReadType, ReadBuffer );
+        if( glGetError() != GL_NO_ERROR )
+            continue;
+
+        rates[i] = PerfMeasureRate(ReadPixels, eglx_PollEvents ) * WinWidth * WinHeight * MatrixFormats[i].pixel_size;
+        const int kind = MatrixBufferKind( ReadFormat );
+        if( rates[i] > best[kind] )
+            best[kind] = rates[i];
+    }
+
+    printf("glReadPixels(%d x %d), PBO = %d:\n", WinWidth, WinHeight, use_PBO);
+    for( int i = 0; i < count; i++ ){
+        const GLenum format = MatrixFormats[i].format;
+        const GLenum type = MatrixFormats[i].type;
+
+        if( rates[i] < 0.0 ){
+            printf("   %-18s %-32s: invalid, skipped\n", glFormatName(format), glTypeName(type));
+            continue;
+        }
+
+        const int isImpl = (GLint)format == implFormat && (GLint)type == implType;
+        const int isFast = rates[i] >= best[MatrixBufferKind(format)] * MatrixFastRatio;
+        printf("   %-18s %-32s: %8.1f MB/sec%s%s\n", glFormatName(format), glTypeName(type),
+               rates[i] / (1024.0 * 1024.0),
+               isImpl ? ", implementation format" : "",
+               isFast ? ", no conversion" : ", converted");
+    }
+
+    free(ReadBuffer);
+    ReadBuffer = NULL;
+    glErrorCheck();
+    exit(0);
+}
+
+static void PerfDrawOffscreen( GLsizei maxSize )
+{
+    static const GLenum formats[] = { GL_RGBA8, GL_RGB10_A2, GL_RGBA16F };
+
+    GLsizei size = RenderTarget_MaxSize();
+    printf("RenderTarget_MaxSize = %d, PBO = %d\n", size, use_PBO);
+    if( maxSize > 0 && maxSize < size )
+        size = maxSize;
+
+    for( size_t f = 0; f < sizeof(formats)/sizeof(formats[0]); f++ ){
+        for( GLsizei s = OffscreenMinSize; s <= size; s *= 2 ){
+            if( !RenderTarget_Create( &Target, s, s, formats[f], GL_NONE, 0 ) )
+                break;
+            glClear(GL_COLOR_BUFFER_BIT);
+
+            ReadFormat = Target.color->readFormat;
+            ReadType = Target.color->readType;
+            SurfaceWidth = ReadWidth = s;
+            SurfaceHeight = ReadHeight = s;
+
+            const size_t imgSize = (size_t)s * s * Target.color->readBytesPerPixel;
+            if( use_PBO ){
+                glBindBuffer( GL_PIXEL_PACK_BUFFER, PBO );
+                glBufferData( GL_PIXEL_PACK_BUFFER, imgSize, NULL, GL_STREAM_READ );
+                glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+                ReadBuffer = NULL;
+            }
+            else {
+                ReadBuffer = malloc(imgSize);
+            }
+
+            if( glGetError() != GL_NO_ERROR || (!use_PBO && ReadBuffer == NULL) ){
+                printf("   %s %5d x %-5d: out of memory for %s\n", Target.color->name, s, s, PerfHumanFloat(imgSize));
+                RenderTarget_Destroy( &Target );
+                break;
+            }
+
+            double rate = PerfMeasureRate(ReadPixels, eglx_PollEvents );
+            printf("   %s %5d x %-5d, %d bytes/pixel read: %.1f images/sec, %s pixels/sec, %.2f GB/sec\n",
+                   Target.color->name, s, s, Target.color->readBytesPerPixel,
+                   rate, PerfHumanFloat(rate * s * s), rate * imgSize / 1e9);
+
+            free(ReadBuffer);
+            ReadBuffer = NULL;
+            RenderTarget_Destroy( &Target );
+            glErrorCheck();
+        }
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    SurfaceWidth = WinWidth;
+    SurfaceHeight = WinHeight;
+    glErrorCheck();
+    exit(0);
+}
+
 int main( int argc, const char* argv[] )
 {
-    api_t api = apiInitial( API_Current, argc, argv );
-    printf("%s: %s\n", argv[0], apiName(api));
+    Api = apiInitial( API_Any, argc, argv );
+    printf("%s: %s\n", argv[0], apiName(Api));
 
     int __testcase = integerFromArgs( "--testcase", argc, argv, NULL );
     int __pbo = integerFromArgs( "--pbo", argc, argv, NULL );
+    const int __offscreen = flagFromArgs( "--offscreen", argc, argv );
+    int __maxsize = integerFromArgs( "--maxsize", argc, argv, NULL );
+    const int __matrix = flagFromArgs( "--matrix", argc, argv );
 
     // initialize and configure
     // ------------------------------
-    eglx_CreateWindow( api, WinWidth, WinHeight );
+    eglx_CreateWindow( Api, WinWidth, WinHeight );
 
     // init
     // -----------
@@ -242,6 +412,20 @@ int main( int argc, const char* argv[] )
     // -----------
     while (!eglx_ShouldClose())
     {
+        if( __offscreen ){
+            if( __pbo != -1 )
+                use_PBO = __pbo;
+
+            PerfDrawOffscreen( __maxsize );
+        }
+
+        if( __matrix ){
+            if( __pbo != -1 )
+                use_PBO = __pbo;
+
+            PerfDrawMatrix();
+        }
+
         if( __testcase != -1 ){
             if( __pbo != -1 )
                 use_PBO = __pbo;
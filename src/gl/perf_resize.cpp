@@ -0,0 +1,210 @@
+/**
+ * Measure window resize:
+ *   resize latency: eglx_SetWindowSize() to ConfigureNotify
+ *   first frame after resize, which pays the surface reallocation, vs a steady frame of the same size
+ *   --storm N: also resize every frame, N frames, without waiting for the window size
+ * One build for all apis: --api gl30 (glLegacy), gl33 or gles32
+ */
+#include <stdio.h>
+#include "glad.h"
+#include "glUtils.h"
+#include "eglUtils.h"
+#include "myUtils.h"
+
+
+// settings
+static const int WinWidth = 320;
+static const int WinHeight = 240;
+static const int ResizeTimeoutMs = 1000;
+static const int SteadyFrames = 10;
+
+static api_t Api;
+static GLuint VAO;
+static GLuint program;
+static GLuint VBO;
+
+struct vertex
+{
+    GLfloat x, y;
+};
+
+static const struct vertex vertices[3] = {
+    { -0.5, -0.5 },
+    {  0.5, -0.5 },
+    {  0.0,  0.5 },
+};
+
+// many sizes, fit in the default 1280x1024 screen of Xvfb
+static const struct {
+    int w;
+    int h;
+} sizes[] = {
+    { 64, 64 },
+    { 320, 240 },
+    { 1001, 999 },
+    { 128, 128 },
+    { 640, 480 },
+    { 333, 177 },
+    { 1024, 768 },
+    { 256, 256 },
+    { 800, 600 },
+    { 1280, 720 },
+    { 17, 1000 },
+    { 1280, 1024 },
+    { 1000, 17 },
+};
+
+const char *vertexShaderBody =
+    "layout (location = 0) in vec2 vPos;\n"
+    "void main()\n"
+    "{\n"
+    "   gl_Position = vec4( vPos.x, vPos.y, 0.0f, 1.0f );\n"
+    "}\n\0";
+
+const char *fragmentShaderBody =
+    "layout (location = 0) out vec4 outColor;\n"
+    "void main()\n"
+    "{\n"
+    "   outColor = vec4( 1.0f, 1.0f, 1.0f, 1.0f );\n"
+    "}\n\0";
+
+static void PerfInit()
+{
+    // build and compile our shader program
+    // ------------------------------------
+    if( Api.api != API_GLLegacy ){
+        program = CreateProgramFromBody( Api, vertexShaderBody, fragmentShaderBody );
+        glUseProgram(program);
+    }
+
+    // set up vertex data (and buffer(s)) and configure vertex attributes
+    // ------------------------------------------------------------------
+    if( Api.api == API_GLLegacy ){
+        glGenBuffers(1, &VBO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+
+        glVertexPointer(2, GL_FLOAT, sizeof(struct vertex), (void *) 0);
+        glEnableClientState(GL_VERTEX_ARRAY);
+    }else{
+        glGenVertexArrays(1, &VAO);
+        glBindVertexArray(VAO);
+
+        glGenBuffers(1, &VBO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+
+        const GLint vPos_location = glGetAttribLocation(program, "vPos");
+        glVertexAttribPointer(vPos_location, 2, GL_FLOAT, GL_FALSE, sizeof(struct vertex), (void*) 0);
+        glEnableVertexAttribArray(vPos_location);
+    }
+}
+
+/* one frame, finished, return its time in microseconds */
+static uint64_t DrawFrame( int width, int height )
+{
+    const uint64_t t0 = PerfGetMicrosecond();
+    glViewport(0, 0, width, height);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    eglx_SwapBuffers();
+    glFinish();
+    return PerfGetMicrosecond() - t0;
+}
+
+static void PerfResize()
+{
+    const int numSizes = sizeof(sizes)/sizeof(sizes[0]);
+    double sumResize = 0, sumFirst = 0, sumRealloc = 0;
+    int measured = 0;
+
+    printf("Resize, timeout %d ms\n", ResizeTimeoutMs);
+    for( int i = 0; i < numSizes; i++ ){
+        // resize, and wait for the ConfigureNotify
+        const uint64_t t0 = PerfGetMicrosecond();
+        eglx_SetWindowSize( sizes[i].w, sizes[i].h );
+        const int ok = eglx_WaitWindowSize( sizes[i].w, sizes[i].h, ResizeTimeoutMs );
+        const uint64_t resizeUs = PerfGetMicrosecond() - t0;
+        if( !ok ){
+            printf("   %4dx%-4d: resize timeout\n", sizes[i].w, sizes[i].h);
+            continue;
+        }
+
+        // the first frame reallocates the surface, the next ones are steady
+        const uint64_t firstUs = DrawFrame( sizes[i].w, sizes[i].h );
+        uint64_t steadyUs = 0;
+        for( int f = 0; f < SteadyFrames; f++ )
+            steadyUs += DrawFrame( sizes[i].w, sizes[i].h );
+        steadyUs /= SteadyFrames;
+
+        const double reallocUs = (double)firstUs - (double)steadyUs;
+        printf("   %4dx%-4d: resize %.3f ms, first frame %.3f ms, steady frame %.3f ms, reallocation %.3f ms\n",
+               sizes[i].w, sizes[i].h, resizeUs * 1e-3, firstUs * 1e-3, steadyUs * 1e-3, reallocUs * 1e-3);
+
+        sumResize += resizeUs;
+        sumFirst += firstUs;
+        sumRealloc += reallocUs;
+        measured++;
+        eglx_PollEvents();
+    }
+
+    if( measured > 0 )
+        printf("   mean: resize %.3f ms, first frame %.3f ms, reallocation %.3f ms\n",
+               sumResize * 1e-3 / measured, sumFirst * 1e-3 / measured, sumRealloc * 1e-3 / measured);
+}
+
+/* resize every frame, without waiting: how the driver copes with a storm of ConfigureNotify */
+static void PerfResizeStorm( int frames )
+{
+    const int numSizes = sizeof(sizes)/sizeof(sizes[0]);
+    uint64_t maxUs = 0;
+
+    const uint64_t t0 = PerfGetMicrosecond();
+    for( int i = 0; i < frames; i++ ){
+        const int k = i % numSizes;
+        eglx_SetWindowSize( sizes[k].w, sizes[k].h );
+        eglx_PollEvents();
+        const uint64_t us = DrawFrame( sizes[k].w, sizes[k].h );
+        if( us > maxUs )
+            maxUs = us;
+    }
+    const double seconds = (PerfGetMicrosecond() - t0) * 1e-6;
+
+    printf("Resize storm, %d frames: %s frames/second, max frame %.3f ms\n",
+           frames, PerfHumanFloat(frames / seconds), maxUs * 1e-3);
+}
+
+int main( int argc, const char* argv[] )
+{
+    Api = apiInitial( API_Any, argc, argv );
+    printf("%s: %s\n", argv[0], apiName(Api));
+
+    int __storm = integerFromArgs("--storm", argc, argv, NULL );
+
+    // initialize and configure
+    // ------------------------------
+    eglx_CreateWindow( Api, WinWidth, WinHeight );
+
+    // init
+    // -----------
+    PerfInit();
+
+    // render loop
+    // -----------
+    while (!eglx_ShouldClose())
+    {
+        // render
+        // ------
+        PerfResize();
+        if( __storm > 0 )
+            PerfResizeStorm( __storm );
+
+        glErrorCheck();
+        exit( 0 );
+    }
+
+    // terminate, clearing all previously allocated resources.
+    // ------------------------------------------------------------------
+    eglx_Terminate();
+    return 0;
+}
@@ -0,0 +1,297 @@
+/**
+ * Measure the CPU reference rasterizer (softRaster.h) as a baseline, against the GL driver on the same frame:
+ *   Width x Height RGBA8, a fixed pseudo-random set of primitives in one draw, cleared every frame
+ *   --mode 0: gouraud triangles
+ *   --mode 1: textured triangles, nearest
+ *   --mode 2: textured triangles, linear
+ *   --mode 3: blended triangles
+ *   --mode 4: points
+ *   --threads N: threads of the soft rasterizer, default one per CPU; 1 thread is measured too
+ * The last GL and soft frames are compared, see Golden_Compare().
+ * One build for gl and gles: --api gl33 or gles32
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <unistd.h>
+#include "glad.h"
+#include "glUtils.h"
+#include "eglUtils.h"
+#include "myUtils.h"
+#include "softRaster.h"
+
+
+// settings
+static const int WinWidth = 200;
+static const int WinHeight = 200;
+
+static const int Width = 1024;
+static const int Height = 1024;
+static const int NumTriangles = 2000;
+static const int NumPoints = 20000;
+static const float PointSize = 4.0f;
+static const int TexSize = 256;
+
+static api_t Api;
+static GLuint VAO;
+static GLuint VBO;
+static GLuint TexObj;
+static GLuint program;
+static GLint texturedLoc, pointSizeLoc;
+
+static RenderTarget Target;
+static SoftRaster *Soft;
+static int Threads;
+static uint8_t *TexImage;
+static GLubyte *GlOut;
+
+static SoftRasterVertex *Vertices;
+static int NumVertices;
+static double Fragments;    // covered pixels per frame, overdraw included
+
+enum {
+    MODE_GOURAUD,
+    MODE_NEAREST,
+    MODE_LINEAR,
+    MODE_BLEND,
+    MODE_POINTS,
+    MODE_COUNT
+};
+
+static const char *ModeNames[MODE_COUNT] = {
+    "gouraud", "nearest", "linear", "blend", "points"
+};
+static int Mode;
+
+const char *vertexShaderBody =
+    "uniform float PointSize;\n"
+    "layout (location = 0) in vec4 vPos;\n"
+    "layout (location = 1) in vec4 vCol;\n"
+    "layout (location = 2) in vec2 vTexCoord;\n"
+    "out vec4 v_color;\n"
+    "out vec2 v_texCoord;\n"
+    "void main()\n"
+    "{\n"
+    "   gl_Position = vPos;\n"
+    "   gl_PointSize = PointSize;\n"
+    "   v_color = vCol;\n"
+    "   v_texCoord = vTexCoord;\n"
+    "}\n\0";
+
+// GL_MODULATE, as the soft rasterizer
+const char *fragmentShaderBody =
+    "uniform sampler2D s_texture;\n"
+    "uniform int Textured;\n"
+    "in vec4 v_color;\n"
+    "in vec2 v_texCoord;\n"
+    "layout (location = 0) out vec4 outColor;\n"
+    "void main()\n"
+    "{\n"
+    "   outColor = (Textured != 0) ? texture( s_texture, v_texCoord ) * v_color : v_color;\n"
+    "}\n\0";
+
+/* same sequence on every platform, unlike rand() */
+static uint32_t Seed;
+static float Random( float lo, float hi )
+{
+    Seed = Seed * 1664525u + 1013904223u;
+    return lo + (hi - lo) * (float)(Seed >> 8) / (float)(1 << 24);
+}
+
+/* triangles of about 64x64 pixels all over the target, or points */
+static void GenerateVertices( int mode )
+{
+    Seed = 1;
+    NumVertices = (mode == MODE_POINTS) ? NumPoints : NumTriangles * 3;
+    Vertices = (SoftRasterVertex*) realloc( Vertices, sizeof(SoftRasterVertex) * NumVertices );
+    Fragments = 0.0;
+
+    const float size = 128.0f / Width;
+    for( int i=0; i < NumVertices; i++ ){
+        SoftRasterVertex *v = &Vertices[i];
+        if( mode == MODE_POINTS || i % 3 == 0 ){
+            v->pos[0] = Random( -1.0f, 1.0f );
+            v->pos[1] = Random( -1.0f, 1.0f );
+        }else{
+            v->pos[0] = Vertices[i - i % 3].pos[0] + Random( -size, size );
+            v->pos[1] = Vertices[i - i % 3].pos[1] + Random( -size, size );
+        }
+        v->pos[2] = 0.0f;
+        v->pos[3] = 1.0f;
+        for( int c=0; c < 4; c++ )
+            v->color[c] = Random( 0.0f, 1.0f );
+        if( mode != MODE_BLEND )
+            v->color[3] = 1.0f;
+        // the texture twice over the target, magnified
+        v->texCoord[0] = v->pos[0] + 1.0f;
+        v->texCoord[1] = v->pos[1] + 1.0f;
+    }
+
+    if( mode == MODE_POINTS ){
+        Fragments = (double)NumPoints * PointSize * PointSize;
+        return;
+    }
+    for( int i=0; i < NumVertices; i += 3 ){
+        const float *a = Vertices[i].pos, *b = Vertices[i + 1].pos, *c = Vertices[i + 2].pos;
+        const float area = ((b[0] - a[0]) * (c[1] - a[1]) - (c[0] - a[0]) * (b[1] - a[1])) * 0.5f;
+        Fragments += ((area < 0.0f) ? -area : area) * Width * Height / 4.0;
+    }
+}
+
+static void PerfInit()
+{
+    // build and compile our shader program
+    // ------------------------------------
+    program = CreateProgramFromBody( Api, vertexShaderBody, fragmentShaderBody );
+    glUseProgram(program);
+    glUniform1i( glGetUniformLocation( program, "s_texture" ), 0 );
+    texturedLoc = glGetUniformLocation( program, "Textured" );
+    pointSizeLoc = glGetUniformLocation( program, "PointSize" );
+    glUniform1f( pointSizeLoc, PointSize );
+    if( Api.api != API_GLES )
+        glEnable( GL_PROGRAM_POINT_SIZE );
+
+    // vertices in the SoftRasterVertex layout, so both draw the same array
+    // ------------------------------------------------------------------
+    glGenVertexArrays(1, &VAO);
+    glBindVertexArray(VAO);
+    glGenBuffers(1, &VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glVertexAttribPointer( 0, 4, GL_FLOAT, GL_FALSE, sizeof(SoftRasterVertex), (void*) offsetof(SoftRasterVertex, pos) );
+    glVertexAttribPointer( 1, 4, GL_FLOAT, GL_FALSE, sizeof(SoftRasterVertex), (void*) offsetof(SoftRasterVertex, color) );
+    glVertexAttribPointer( 2, 2, GL_FLOAT, GL_FALSE, sizeof(SoftRasterVertex), (void*) offsetof(SoftRasterVertex, texCoord) );
+    glEnableVertexAttribArray( 0 );
+    glEnableVertexAttribArray( 1 );
+    glEnableVertexAttribArray( 2 );
+
+    // texture, GL_REPEAT
+    // ------------------------------------------------------------------
+    TexImage = GenerateCheckboard_RGBA( TexSize, TexSize, 8 );
+    glGenTextures( 1, &TexObj );
+    glActiveTexture( GL_TEXTURE0 );
+    glBindTexture( GL_TEXTURE_2D, TexObj );
+    glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA, TexSize, TexSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, TexImage );
+
+    if( !RenderTarget_Create( &Target, Width, Height, GL_RGBA8, GL_NONE, 0 ) )
+        exit(EXIT_FAILURE);
+    Soft = SoftRaster_Create( Width, Height );
+    if( Soft == NULL )
+        exit(EXIT_FAILURE);
+    GlOut = (GLubyte*) malloc( Width * Height * 4 );
+}
+
+static void GlFrame(unsigned count)
+{
+    RenderTarget_Bind( &Target );
+    for (unsigned i = 0; i < count; i++) {
+        glClear( GL_COLOR_BUFFER_BIT );
+        glDrawArrays( (Mode == MODE_POINTS) ? GL_POINTS : GL_TRIANGLES, 0, NumVertices );
+    }
+    glFinish();
+}
+
+static void SoftFrame(unsigned count)
+{
+    const SoftRasterTexture texture = { TexImage, TexSize, TexSize, Mode == MODE_LINEAR, 1 };
+    for (unsigned i = 0; i < count; i++) {
+        SoftRaster_Clear( Soft, 0.2f, 0.3f, 0.4f, 1.0f );
+        SoftRaster_SetTexture( Soft, (Mode == MODE_NEAREST || Mode == MODE_LINEAR) ? &texture : NULL );
+        SoftRaster_SetBlend( Soft, Mode == MODE_BLEND );
+        SoftRaster_SetPointSize( Soft, PointSize );
+        SoftRaster_Draw( Soft, (Mode == MODE_POINTS) ? SR_POINTS : SR_TRIANGLES, Vertices, NumVertices );
+        SoftRaster_Finish( Soft );
+    }
+}
+
+static void PerfDraw( int mode )
+{
+    printf("%d x %d, %d triangles of ~64x64 / %d points of %.0fx%.0f, soft rasterizer: %d threads\n",
+           Width, Height, NumTriangles, NumPoints, PointSize, PointSize, Threads);
+
+    for( int m = 0; m < MODE_COUNT; m++ ){
+        if( mode != -1 && mode != m )
+            continue;
+
+        Mode = m;
+        GenerateVertices( m );
+        glBindBuffer( GL_ARRAY_BUFFER, VBO );
+        glBufferData( GL_ARRAY_BUFFER, sizeof(SoftRasterVertex) * NumVertices, Vertices, GL_STATIC_DRAW );
+        glUseProgram( program );
+        glUniform1i( texturedLoc, m == MODE_NEAREST || m == MODE_LINEAR );
+        glBindTexture( GL_TEXTURE_2D, TexObj );
+        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, (m == MODE_LINEAR) ? GL_LINEAR : GL_NEAREST );
+        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, (m == MODE_LINEAR) ? GL_LINEAR : GL_NEAREST );
+        if( m == MODE_BLEND ){
+            glEnable( GL_BLEND );
+            glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
+        }
+        glClearColor( 0.2f, 0.3f, 0.4f, 1.0f );
+
+        const double glRate = PerfMeasureRate(GlFrame, eglx_PollEvents );
+        SoftRaster_SetThreads( Soft, 1 );
+        const double softRate1 = PerfMeasureRate(SoftFrame, eglx_PollEvents );
+        SoftRaster_SetThreads( Soft, Threads );
+        const double softRate = PerfMeasureRate(SoftFrame, eglx_PollEvents );
+
+        // the last frames of both
+        GlFrame( 1 );
+        glReadPixels( 0, 0, Width, Height, GL_RGBA, GL_UNSIGNED_BYTE, GlOut );
+        glDisable( GL_BLEND );
+        SoftFrame( 1 );
+        const uint8_t *softOut = SoftRaster_Finish( Soft );     // nothing pending, the last frame
+        const GoldenTolerance tolerance = Golden_DefaultTolerance();
+        GoldenResult result;
+        const int pass = Golden_Compare( GlOut, softOut, Width, Height, &tolerance, &result );
+
+        printf("   %-8s: GL %.2f ms/frame (%s frags/sec), soft 1 thread %.2f ms/frame (%s frags/sec), %d threads %.2f ms/frame (%s frags/sec)\n",
+               ModeNames[m], 1000.0 / glRate, PerfHumanFloat( glRate * Fragments ),
+               1000.0 / softRate1, PerfHumanFloat( softRate1 * Fragments ),
+               Threads, 1000.0 / softRate, PerfHumanFloat( softRate * Fragments ));
+        printf("   %-8s  vs GL: %s, max %u, %llu px over %d, SSIM %.4f\n", "", pass ? "ok" : "DIFF !!!",
+               result.compare.maxError, (unsigned long long)result.badPixels, tolerance.maxChannelDelta, result.ssim);
+        glErrorCheck();
+    }
+
+    glErrorCheck();
+    exit(0);
+}
+
+int main( int argc, const char* argv[] )
+{
+    Api = apiInitial( API_AnyShader, argc, argv );
+    printf("%s: %s\n", argv[0], apiName(Api));
+
+    int __mode = integerFromArgs("--mode", argc, argv, NULL );
+    int __threads = integerFromArgs("--threads", argc, argv, NULL );
+    Threads = (__threads > 0) ? __threads : (int)sysconf( _SC_NPROCESSORS_ONLN );
+    if( Threads > SoftRaster_MaxThreads )
+        Threads = SoftRaster_MaxThreads;    // what SoftRaster_SetThreads() keeps, so the printed count is the one used
+
+    // initialize and configure
+    // ------------------------------
+    eglx_CreateWindow( Api, WinWidth, WinHeight );
+
+    // init
+    // -----------
+    PerfInit();
+
+    // render loop
+    // -----------
+    while (!eglx_ShouldClose())
+    {
+        // render
+        // ------
+        PerfDraw( __mode );
+
+        // swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
+        // -------------------------------------------------------------------------------
+        eglx_SwapBuffers();
+        eglx_PollEvents();
+    }
+
+    // terminate, clearing all previously allocated resources.
+    // ------------------------------------------------------------------
+    eglx_Terminate();
+    return 0;
+}
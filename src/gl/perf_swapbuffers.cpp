@@ -1,7 +1,11 @@
 /**
  * Measure SwapBuffers.
+ * One build for all apis: --api gl30 (glLegacy), gl33 or gles32
  */
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
 #include <sched.h>
 #include "glad.h"
 #include "glUtils.h"
@@ -14,6 +18,7 @@ static int WinWidth = 100;
 static int WinHeight = 100;
 
 
+static api_t Api;
 static GLuint VAO;
 static GLuint VBO;
 static GLuint program;
@@ -30,28 +35,17 @@ static const struct vertex vertices[4] = {
     { -0.5,  0.5 }
 };
 
-const char *vertexShaderSource =
-#if IS_GlEs
-    "#version 320 es\n"
-#else
-    "#version 330\n"
-#endif
+const char *vertexShaderBody =
     "layout (location = 0) in vec2 vPos;\n"
     "void main()\n"
     "{\n"
     "   gl_Position = vec4( vPos.x, vPos.y, 0.0f, 1.0f );\n"
-#if IS_GlEs
+    "#ifdef GL_ES\n"
     "   gl_PointSize = 1.0;\n" // make IMG gpu happy
-#endif
+    "#endif\n"
     "}\n\0";
 
-const char *fragmentShaderSource =
-#if IS_GlEs
-    "#version 320 es\n"
-    "precision mediump float;\n"
-#else
-    "#version 330\n"
-#endif
+const char *fragmentShaderBody =
     "layout (location = 0) out vec4 outColor;\n"
     "void main()\n"
     "{\n"
@@ -62,33 +56,33 @@ static void PerfInit()
 {
     // build and compile our shader program
     // ------------------------------------
-#if !IS_GlLegacy
-    program = CreateProgramFromSource( vertexShaderSource, fragmentShaderSource );
-    glUseProgram(program);
-#endif
+    if( Api.api != API_GLLegacy ){
+        program = CreateProgramFromBody( Api, vertexShaderBody, fragmentShaderBody );
+        glUseProgram(program);
+    }
 
     // set up vertex data (and buffer(s)) and configure vertex attributes
     // ------------------------------------------------------------------
-#if IS_GlLegacy
-    glGenBuffers(1, &VBO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-    glVertexPointer(2, GL_FLOAT, sizeof(struct vertex), (void *) 0);
-    glEnableClientState(GL_VERTEX_ARRAY);
-#else
-    glGenVertexArrays(1, &VAO);
-    glBindVertexArray(VAO);
-
-    glGenBuffers(1, &VBO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-    const GLint vPos_location = glGetAttribLocation(program, "vPos");
-    printf("Attrib location: vPos=%d\n", vPos_location);
-    glVertexAttribPointer(vPos_location, 2, GL_FLOAT, GL_FALSE, sizeof(struct vertex), (void*) 0);
-    glEnableVertexAttribArray(vPos_location);
-#endif
+    if( Api.api == API_GLLegacy ){
+        glGenBuffers(1, &VBO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+
+        glVertexPointer(2, GL_FLOAT, sizeof(struct vertex), (void *) 0);
+        glEnableClientState(GL_VERTEX_ARRAY);
+    }else{
+        glGenVertexArrays(1, &VAO);
+        glBindVertexArray(VAO);
+
+        glGenBuffers(1, &VBO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+
+        const GLint vPos_location = glGetAttribLocation(program, "vPos");
+        printf("Attrib location: vPos=%d\n", vPos_location);
+        glVertexAttribPointer(vPos_location, 2, GL_FLOAT, GL_FALSE, sizeof(struct vertex), (void*) 0);
+        glEnableVertexAttribArray(vPos_location);
+    }
 
     // misc GL state
     // ------------------------------------------------------------------
@@ -160,21 +154,272 @@ static void PerfDraw()
            PerfHumanFloat(rate0 * w * h) );
 }
 
+/*
+ * Frame pacing: swap interval 0, 1 or adaptive, timestamp every frame, and report the frame time
+ * distribution, dropped frames and input-to-present latency.
+ * Present times come from EGL_ANDROID_get_frame_timestamps when available, else the CPU time when
+ * eglSwapBuffers() returns is used, so the latency is input-to-swap.
+ * EGL has no adaptive vsync, so "adaptive" is emulated: vsync, but the frame after a late frame
+ * is swapped with interval 0.
+ */
+#define SwapInterval_Adaptive  (-1)
+
+static int CompareDouble( const void *a, const void *b )
+{
+    const double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static void PrintDistribution( const char *name, double *values, int n )
+{
+    if( n <= 0 ){
+        printf("   %s: no samples\n", name);
+        return;
+    }
+
+    double sum = 0.0;
+    for( int i = 0; i < n; i++ )
+        sum += values[i];
+    qsort( values, n, sizeof(double), CompareDouble );
+
+    printf("   %s (ms): mean %.3f, min %.3f, p50 %.3f, p90 %.3f, p99 %.3f, max %.3f\n", name,
+           sum / n, values[0], values[n / 2], values[(int)(n * 0.9)], values[(int)(n * 0.99)], values[n - 1]);
+}
+
+static void PerfFramePacing( int interval, int frames, double refreshHz )
+{
+    const double periodMs = 1000.0 / refreshHz;
+    const int timestamps = egl_EnableFrameTimestamps();
+
+    uint64_t *frameIds = (uint64_t*) calloc( frames, sizeof(uint64_t) );
+    uint64_t *inputUs = (uint64_t*) calloc( frames, sizeof(uint64_t) );
+    uint64_t *swapUs = (uint64_t*) calloc( frames, sizeof(uint64_t) );
+    double *presentMs = (double*) calloc( frames, sizeof(double) );
+    double *frameTimes = (double*) calloc( frames, sizeof(double) );
+    double *latencies = (double*) calloc( frames, sizeof(double) );
+
+    printf("Frame pacing, swap interval %s, %d frames, refresh %.1f Hz, present time from %s\n",
+           interval == SwapInterval_Adaptive ? "adaptive" : (interval ? "1" : "0"),
+           frames, refreshHz, timestamps ? "EGL_ANDROID_get_frame_timestamps" : "CPU");
+
+    egl_SwapInterval( interval == SwapInterval_Adaptive ? 1 : interval );
+
+    for( int i = 0; i < frames; i++ ){
+        inputUs[i] = PerfGetMicrosecond();  // input sampled at the start of the frame
+        eglx_PollEvents();
+
+        glClear(GL_COLOR_BUFFER_BIT);
+        glDrawArrays(GL_POINTS, 0, 4);
+
+        if( timestamps && !egl_GetNextFrameId( &frameIds[i] ) )
+            frameIds[i] = 0;
+        eglx_SwapBuffers();
+        swapUs[i] = PerfGetMicrosecond();
+
+        if( interval == SwapInterval_Adaptive && i > 0 ){
+            const int late = (swapUs[i] - swapUs[i - 1]) * 0.001 > 1.5 * periodMs;
+            egl_SwapInterval( late ? 0 : 1 );
+        }
+    }
+    glFinish();
+
+    // collect present times, they may still be pending for the last frames
+    int cpuFallbacks = 0;
+    for( int i = 0; i < frames; i++ ){
+        int64_t presentNs;
+        int ok = 0;
+        for( int retry = 0; timestamps && frameIds[i] && !ok && retry < 100; retry++ ){
+            ok = egl_GetFramePresentTime( frameIds[i], &presentNs );
+            if( !ok )
+                sched_yield();
+        }
+
+        if( ok ){
+            presentMs[i] = presentNs * 1e-6;
+        }else{
+            presentMs[i] = swapUs[i] * 1e-3;
+            cpuFallbacks++;
+        }
+    }
+
+    int numFrameTimes = 0, dropped = 0;
+    const double expectedMs = periodMs * (interval > 1 ? interval : 1);
+    for( int i = 1; i < frames; i++ ){
+        const double t = presentMs[i] - presentMs[i - 1];
+        frameTimes[numFrameTimes++] = t;
+        if( t > 1.5 * expectedMs )
+            dropped += (int)(t / expectedMs + 0.5) - 1;
+    }
+    for( int i = 0; i < frames; i++ )
+        latencies[i] = presentMs[i] - inputUs[i] * 1e-3;
+
+    PrintDistribution( "frame time", frameTimes, numFrameTimes );
+    PrintDistribution( timestamps ? "input-to-present latency" : "input-to-swap latency", latencies, frames );
+    printf("   dropped frames: %d (> 1.5 x %.3f ms)\n", dropped, expectedMs);
+    if( timestamps && cpuFallbacks )
+        printf("   %d frames without present time, CPU time used\n", cpuFallbacks);
+
+    egl_SwapInterval( 1 );
+    free( frameIds );
+    free( inputUs );
+    free( swapUs );
+    free( presentMs );
+    free( frameTimes );
+    free( latencies );
+}
+
+/*
+ * Damage: every frame changes a square of DamagePercent of the window, at a moving position.
+ *   full:   repaint and present the whole window
+ *   damage: repaint only what the back buffer misses (buffer age), present the old and the new square as damage
+ */
+static int DamagePercent;
+static DamageTracker damageTracker;
+static uint64_t damageFrames;
+static uint64_t pixelsTouched;
+
+// the square drawn by frame
+static eglRect_t DamageSquare( int w, int h, uint64_t frame )
+{
+    const int size = (int)sqrt( w * h * DamagePercent / 100.0 );
+    const int dw = size < w ? size : w;
+    const int dh = size < h ? size : h;
+    const int x = (w > dw) ? (int)((frame * 37) % (w - dw)) : 0;
+    const int y = (h > dh) ? (int)((frame * 23) % (h - dh)) : 0;
+    return { x, y, dw, dh };
+}
+
+static void SwapFullRepaint(unsigned count)
+{
+    int w, h;
+    eglx_GetWindowSize( &w, &h );
+
+    for (unsigned i = 0; i < count; i++) {
+        const eglRect_t damage = DamageSquare( w, h, damageFrames );
+        glClearColor( 0.0, 0.0, 0.0, 0.0 );
+        glClear( GL_COLOR_BUFFER_BIT );
+
+        glEnable( GL_SCISSOR_TEST );
+        glScissor( damage.x, damage.y, damage.width, damage.height );
+        glClearColor( (damageFrames & 1) ? 1.0 : 0.5, 0.5, 0.5, 1.0 );
+        glClear( GL_COLOR_BUFFER_BIT );
+        glDisable( GL_SCISSOR_TEST );
+
+        eglx_SwapBuffers();
+        pixelsTouched += (uint64_t)w * h;
+        damageFrames++;
+    }
+}
+
+static void SwapDamageRepaint(unsigned count)
+{
+    int w, h;
+    eglx_GetWindowSize( &w, &h );
+
+    for (unsigned i = 0; i < count; i++) {
+        // what changed on screen: the square moved away from its last position, and is drawn at the new one
+        const eglRect_t square = DamageSquare( w, h, damageFrames );
+        eglRect_t rects[2] = { square };
+        int numRects = 1;
+        if( damageFrames > 0 )
+            rects[numRects++] = DamageSquare( w, h, damageFrames - 1 );
+        const eglRect_t damage = (numRects == 2) ? egl_RectUnion( rects[0], rects[1] ) : square;
+        const int age = egl_QueryBufferAge();
+        const eglRect_t region = DamageTracker_RepaintRegion( &damageTracker, age, damage );
+        egl_SetDamageRegion( &region, 1 );
+
+        // repaint the region: background, then the square on top of it
+        glEnable( GL_SCISSOR_TEST );
+        glScissor( region.x, region.y, region.width, region.height );
+        glClearColor( 0.0, 0.0, 0.0, 0.0 );
+        glClear( GL_COLOR_BUFFER_BIT );
+        glScissor( square.x, square.y, square.width, square.height );
+        glClearColor( (damageFrames & 1) ? 1.0 : 0.5, 0.5, 0.5, 1.0 );
+        glClear( GL_COLOR_BUFFER_BIT );
+        glDisable( GL_SCISSOR_TEST );
+
+        egl_SwapBuffersWithDamage( rects, numRects );
+        DamageTracker_EndFrame( &damageTracker, damage );
+        pixelsTouched += (uint64_t)region.width * region.height;
+        damageFrames++;
+    }
+}
+
+static void PerfDamage()
+{
+    static const int percents[] = { 1, 10, 50 };
+
+    int w, h;
+    eglx_GetWindowSize( &w, &h );
+    const int support = egl_DamageSupport();
+    printf("Damage, window %dx%d, swap_buffers_with_damage: %s, buffer_age: %s, partial_update: %s\n", w, h,
+           (support & EGL_Damage_SwapWithDamage) ? "yes" : "no",
+           (support & EGL_Damage_BufferAge) ? "yes" : "no",
+           (support & EGL_Damage_PartialUpdate) ? "yes" : "no");
+
+    for( int i = 0; i < (int)(sizeof(percents)/sizeof(percents[0])); i++ ){
+        DamagePercent = percents[i];
+
+        for( int damaged = 0; damaged < 2; damaged++ ){
+            DamageTracker_Init( &damageTracker, w, h );
+            damageFrames = 0;
+            pixelsTouched = 0;
+
+            const double rate = PerfMeasureRate( damaged ? SwapDamageRepaint : SwapFullRepaint, eglx_PollEvents );
+            const double pixelsPerFrame = (double)pixelsTouched / damageFrames;
+            printf("   %2d%% damage, %-6s: %s swaps/second, %s pixels touched/frame (%.1f%%)\n",
+                   DamagePercent, damaged ? "damage" : "full",
+                   PerfHumanFloat(rate), PerfHumanFloat(pixelsPerFrame), 100.0 * pixelsPerFrame / (w * h));
+        }
+    }
+    glClearColor( 0.0, 0.0, 0.0, 0.0 );
+}
+
 int main( int argc, const char* argv[] )
 {
-    api_t api = apiInitial( API_Current, argc, argv );
-    printf("%s: %s\n", argv[0], apiName(api));
+    Api = apiInitial( API_Any, argc, argv );
+    printf("%s: %s\n", argv[0], apiName(Api));
 
     // initialize and configure
     // ------------------------------
     WinWidth = sizes[0].w;
     WinHeight = sizes[0].h;
-    eglx_CreateWindow( api, WinWidth, WinHeight );
+    eglx_CreateWindow( Api, WinWidth, WinHeight );
 
     // init
     // -----------
     PerfInit();
 
+    // frame pacing mode
+    // -----------
+    if( flagFromArgs( "--pacing", argc, argv ) ){
+        const char *interval = stringFromArgs( "--interval", argc, argv );
+        int frames = integerFromArgs( "--frames", argc, argv, NULL );
+        int refresh = integerFromArgs( "--refresh", argc, argv, NULL );
+        if( frames <= 1 )
+            frames = 600;
+        if( refresh <= 0 )
+            refresh = 60;
+
+        if( interval == NULL || strcmp( interval, "0" ) == 0 )
+            PerfFramePacing( 0, frames, refresh );
+        if( interval == NULL || strcmp( interval, "1" ) == 0 )
+            PerfFramePacing( 1, frames, refresh );
+        if( interval == NULL || strcmp( interval, "adaptive" ) == 0 )
+            PerfFramePacing( SwapInterval_Adaptive, frames, refresh );
+
+        glErrorCheck();
+        exit( 0 );
+    }
+
+    // damage mode
+    // -----------
+    if( flagFromArgs( "--damage", argc, argv ) ){
+        PerfDamage();
+        glErrorCheck();
+        exit( 0 );
+    }
+
     // render loop
     // -----------
     while (!eglx_ShouldClose())
@@ -185,16 +430,8 @@ int main( int argc, const char* argv[] )
             eglx_SetWindowSize( sizes[i].w, sizes[i].h );
 
             //wait window size change take effect
-            int n = 0;
-            int w, h;
-            while(1){
-                sched_yield();
-
-                n++;
-                eglx_GetWindowSize(  &w, &h );
-                if( (w == sizes[i].w && h == sizes[i].h) || (n >= 10000) )
-                    break;
-            }
+            if( !eglx_WaitWindowSize( sizes[i].w, sizes[i].h, 1000 ) )
+                printf("resize to %dx%d timeout\n", sizes[i].w, sizes[i].h);
 
             // render
             // ------
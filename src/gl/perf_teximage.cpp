@@ -1,5 +1,16 @@
 /**
  * Measure glTex[Sub]Image2D() and glGetTexImage() rate
+ *   --mode 0 ~ 3: mutable glTexImage2D() storage
+ *   --mode 4: create texture, glTexStorage2D() + glTexSubImage2D()
+ *   --mode 5: glTexSubImage2D() into immutable glTexStorage2D() storage
+ *   --mode 6: same, sourced from a single PBO
+ *   --mode 7: same, sourced from a ring of PBOs, fenced
+ *   --mode 8: glTexSubImage2D() of every mipmap level of immutable storage
+ *   --matrix: glTexSubImage2D() of every internal format/format/type pair, invalid pairs skipped, and mark
+ *     the pairs uploaded without a driver-side conversion: the ones as fast as the fastest pair
+ * Every upload mode also reports the stall seen by the next draw, that is how much longer a draw
+ * using the texture takes to complete right after the upload than on an idle GPU.
+ * One build for all apis: --api gl30 (glLegacy), gl33 or gles32
  */
 #include <stdio.h>
 #include <string.h>
@@ -14,6 +25,7 @@ static const int WinWidth = 100;
 static const int WinHeight = 100;
 
 
+static api_t Api;
 static GLuint VAO;
 static GLuint VBO;
 static GLuint program;
@@ -21,6 +33,17 @@ static GLuint TexObj = 0;
 static GLubyte *TexImage = NULL;
 static GLsizei TexSize;
 static GLenum TexIntFormat, TexSrcFormat, TexSrcType;
+static GLenum TexStorageFormat;
+static GLsizei TexLevels;
+static GLint UploadMode;
+static GLint BytesPerImage;
+static int HasTexStorage;
+
+#define PBORingSize 4
+static GLuint PBOs[PBORingSize];
+static GLsync PBOFences[PBORingSize];
+static unsigned PBOSlot;
+static const int StallIterations = 16;
 
 static GLboolean DrawPoint = GL_TRUE;
 static const GLboolean TexSubImage4 = GL_FALSE;
@@ -36,12 +59,7 @@ static const struct vertex vertices[1] = {
 
 #define VOFFSET(F) ((void *) offsetof(struct vertex, F))
 
-const char *vertexShaderSource =
-#if IS_GlEs
-    "#version 320 es\n"
-#else
-    "#version 330\n"
-#endif
+const char *vertexShaderBody =
     "layout (location = 0) in vec2 vPos;\n"
     "layout (location = 1) in vec2 vTexCoord;\n"
     "out vec2 v_texCoord;\n"
@@ -49,18 +67,12 @@ const char *vertexShaderSource =
     "{\n"
     "   gl_Position = vec4( vPos.x, vPos.y, 0.0f, 1.0f );\n"
     "   v_texCoord = vTexCoord;\n"
-#if IS_GlEs
+    "#ifdef GL_ES\n"
     "   gl_PointSize = 1.0;\n" // make IMG gpu happy
-#endif
+    "#endif\n"
     "}\n\0";
 
-const char *fragmentShaderSource =
-#if IS_GlEs
-    "#version 320 es\n"
-    "precision mediump float;\n"
-#else
-    "#version 330\n"
-#endif
+const char *fragmentShaderBody =
     "in vec2 v_texCoord;\n"
     "layout (location = 0) out vec4 outColor;\n"
     "uniform sampler2D s_texture;\n"
@@ -73,41 +85,41 @@ static void PerfInit()
 {
     // build and compile our shader program
     // ------------------------------------
-#if !IS_GlLegacy
-    program = CreateProgramFromSource( vertexShaderSource, fragmentShaderSource );
-    glUseProgram(program);
-#endif
+    if( Api.api != API_GLLegacy ){
+        program = CreateProgramFromBody( Api, vertexShaderBody, fragmentShaderBody );
+        glUseProgram(program);
+    }
 
     // set up vertex data (and buffer(s)) and configure vertex attributes
     // ------------------------------------------------------------------
-#if IS_GlLegacy
-    glGenBuffers(1, &VBO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-    glVertexPointer(2, GL_FLOAT, sizeof(struct vertex), VOFFSET(x));
-    glTexCoordPointer(2, GL_FLOAT, sizeof(struct vertex), VOFFSET(s));
-    glEnableClientState(GL_VERTEX_ARRAY);
-    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-#else
-    glGenVertexArrays(1, &VAO);
-    glBindVertexArray(VAO);
-
-    glGenBuffers(1, &VBO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-    const GLint vPos_location = glGetAttribLocation(program, "vPos");
-    const GLint vTexCoord_location = glGetAttribLocation(program, "vTexCoord");
-    printf("Attrib location: vPos=%d\n", vPos_location);
-    printf("Attrib location: vTexCoord=%d\n", vTexCoord_location);
-    glVertexAttribPointer(vPos_location, 3, GL_FLOAT, GL_FALSE,
-                          sizeof(struct vertex), VOFFSET(x));
-    glVertexAttribPointer(vTexCoord_location, 2, GL_FLOAT, GL_FALSE,
-                          sizeof(struct vertex), VOFFSET(s));
-    glEnableVertexAttribArray(vPos_location);
-    glEnableVertexAttribArray(vTexCoord_location);
-#endif
+    if( Api.api == API_GLLegacy ){
+        glGenBuffers(1, &VBO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+
+        glVertexPointer(2, GL_FLOAT, sizeof(struct vertex), VOFFSET(x));
+        glTexCoordPointer(2, GL_FLOAT, sizeof(struct vertex), VOFFSET(s));
+        glEnableClientState(GL_VERTEX_ARRAY);
+        glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    }else{
+        glGenVertexArrays(1, &VAO);
+        glBindVertexArray(VAO);
+
+        glGenBuffers(1, &VBO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+
+        const GLint vPos_location = glGetAttribLocation(program, "vPos");
+        const GLint vTexCoord_location = glGetAttribLocation(program, "vTexCoord");
+        printf("Attrib location: vPos=%d\n", vPos_location);
+        printf("Attrib location: vTexCoord=%d\n", vTexCoord_location);
+        glVertexAttribPointer(vPos_location, 3, GL_FLOAT, GL_FALSE,
+                              sizeof(struct vertex), VOFFSET(x));
+        glVertexAttribPointer(vTexCoord_location, 2, GL_FLOAT, GL_FALSE,
+                              sizeof(struct vertex), VOFFSET(s));
+        glEnableVertexAttribArray(vPos_location);
+        glEnableVertexAttribArray(vTexCoord_location);
+    }
 
     // texture
     // ------------------------------------------------------------------
@@ -115,12 +127,17 @@ static void PerfInit()
     glBindTexture(GL_TEXTURE_2D, TexObj);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-#if IS_GlLegacy
-    glEnable(GL_TEXTURE_2D);
-#else
-    glActiveTexture( GL_TEXTURE0 );
-    glBindTexture( GL_TEXTURE_2D, TexObj );
-#endif
+    if( Api.api == API_GLLegacy ){
+        glEnable(GL_TEXTURE_2D);
+    }else{
+        glActiveTexture( GL_TEXTURE0 );
+        glBindTexture( GL_TEXTURE_2D, TexObj );
+    }
+
+    // immutable storage and PBOs
+    // ------------------------------------------------------------------
+    HasTexStorage = glVersionAtLeast( 4, 2, 3, 0 ) || GLAD_GL_ARB_texture_storage;
+    glGenBuffers(PBORingSize, PBOs);
 }
 
 static void CreateUploadTexImage2D(unsigned count)
@@ -211,7 +228,7 @@ static void UploadTexSubImage2D(unsigned count)
     glFinish();
 }
 
-#if !IS_GlEs
+/* GL only */
 static void GetTexImage2D(unsigned count)
 {
     unsigned i;
@@ -223,13 +240,17 @@ static void GetTexImage2D(unsigned count)
     glFinish();
     free(buf);
 }
-#endif
 
 enum {
     MODE_CREATE_TEXIMAGE,
     MODE_TEXIMAGE,
     MODE_TEXSUBIMAGE,
     MODE_GETTEXIMAGE,
+    MODE_CREATE_TEXSTORAGE,
+    MODE_TEXSTORAGE_SUBIMAGE,
+    MODE_TEXSTORAGE_PBO,
+    MODE_TEXSTORAGE_PBO_RING,
+    MODE_TEXSTORAGE_MIPLEVELS,
     MODE_COUNT
 };
 
@@ -237,29 +258,363 @@ static const char *mode_name[MODE_COUNT] = {
     "Create_TexImage",
     "TexImage",
     "TexSubImage",
-    "GetTexImage"
+    "GetTexImage",
+    "Create_TexStorage",
+    "TexStorage_TexSubImage",
+    "TexStorage_PBO",
+    "TexStorage_PBORing",
+    "TexStorage_MipLevels",
 };
 
+/* replace TexObj, levels = 0: mutable, else immutable storage of that many levels */
+static void NewTexture( GLsizei levels )
+{
+    if (TexObj)
+        glDeleteTextures(1, &TexObj);
+
+    glGenTextures(1, &TexObj);
+    glBindTexture(GL_TEXTURE_2D, TexObj);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    if (levels > 0)
+        glTexStorage2D(GL_TEXTURE_2D, levels, TexStorageFormat, TexSize, TexSize);
+}
+
+static void UploadPBO( unsigned slot, GLbitfield access )
+{
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, PBOs[slot]);
+    void *ptr = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, BytesPerImage, access);
+    memcpy(ptr, TexImage, BytesPerImage);
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+    glTexSubImage2D(GL_TEXTURE_2D, 0,
+                    0, 0, TexSize, TexSize,
+                    TexSrcFormat, TexSrcType, (void*) 0);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+/* the next slot is written without synchronization, once the GPU is done with its previous upload */
+static void UploadPBORing()
+{
+    const unsigned slot = PBOSlot++ % PBORingSize;
+    if (PBOFences[slot]) {
+        glClientWaitSync(PBOFences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        glDeleteSync(PBOFences[slot]);
+    }
+
+    UploadPBO(slot, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    PBOFences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+static void ClearPBOFences()
+{
+    for (int i = 0; i < PBORingSize; i++) {
+        if (PBOFences[i])
+            glDeleteSync(PBOFences[i]);
+        PBOFences[i] = 0;
+    }
+}
+
+/* one upload of UploadMode, without draw nor glFinish() */
+static void UploadOnce()
+{
+    switch (UploadMode) {
+        case MODE_CREATE_TEXIMAGE:
+            NewTexture(0);
+            glTexImage2D(GL_TEXTURE_2D, 0, TexIntFormat,
+                         TexSize, TexSize, 0,
+                         TexSrcFormat, TexSrcType, TexImage);
+            break;
+
+        case MODE_TEXIMAGE:
+            glTexImage2D(GL_TEXTURE_2D, 0, TexIntFormat,
+                         TexSize, TexSize, 0,
+                         TexSrcFormat, TexSrcType, TexImage);
+            break;
+
+        case MODE_CREATE_TEXSTORAGE:
+            NewTexture(1);
+            glTexSubImage2D(GL_TEXTURE_2D, 0,
+                            0, 0, TexSize, TexSize,
+                            TexSrcFormat, TexSrcType, TexImage);
+            break;
+
+        case MODE_TEXSUBIMAGE:
+        case MODE_TEXSTORAGE_SUBIMAGE:
+            glTexSubImage2D(GL_TEXTURE_2D, 0,
+                            0, 0, TexSize, TexSize,
+                            TexSrcFormat, TexSrcType, TexImage);
+            break;
+
+        case MODE_TEXSTORAGE_PBO:
+            UploadPBO(0, GL_MAP_WRITE_BIT);
+            break;
+
+        case MODE_TEXSTORAGE_PBO_RING:
+            UploadPBORing();
+            break;
+
+        case MODE_TEXSTORAGE_MIPLEVELS:
+            /* level 0 data is large enough for every level */
+            for (GLsizei level = 0; level < TexLevels; level++) {
+                const GLsizei size = (TexSize >> level) > 0 ? (TexSize >> level) : 1;
+                glTexSubImage2D(GL_TEXTURE_2D, level,
+                                0, 0, size, size,
+                                TexSrcFormat, TexSrcType, TexImage);
+            }
+            break;
+    }
+}
+
+static void UploadTexStorage(unsigned count)
+{
+    unsigned i;
+    for (i = 0; i < count; i++) {
+        UploadOnce();
+        if (DrawPoint)
+            glDrawArrays(GL_POINTS, 0, 1);
+    }
+    glFinish();
+    ClearPBOFences();
+}
+
+/* microseconds: a draw right after the upload, minus the same draw on an idle GPU */
+static double MeasureNextDrawStall()
+{
+    uint64_t idle = 0, afterUpload = 0;
+
+    for (int i = 0; i < StallIterations; i++) {
+        glFinish();
+        uint64_t t0 = PerfGetMicrosecond();
+        glDrawArrays(GL_POINTS, 0, 1);
+        glFinish();
+        idle += PerfGetMicrosecond() - t0;
+
+        UploadOnce();
+        t0 = PerfGetMicrosecond();
+        glDrawArrays(GL_POINTS, 0, 1);
+        glFinish();
+        afterUpload += PerfGetMicrosecond() - t0;
+    }
+    ClearPBOFences();
+
+    return ((double)afterUpload - (double)idle) / StallIterations;
+}
+
 static const struct {
     GLenum format, type;
     GLenum internal_format;
+    GLenum storage_format;  // sized, for glTexStorage2D()
     const char *name;
     GLuint texel_size;
     GLboolean full_test;
 } SrcFormats[] = {
-    { GL_RGBA, GL_UNSIGNED_BYTE,       GL_RGBA, "RGBA/ubyte", 4,   GL_TRUE },
-//    { GL_RGB, GL_UNSIGNED_BYTE,        GL_RGB, "RGB/ubyte", 3,     GL_FALSE },
-//    { GL_RGB, GL_UNSIGNED_SHORT_5_6_5, GL_RGB, "RGB/565", 2,       GL_FALSE },
+    { GL_RGBA, GL_UNSIGNED_BYTE,       GL_RGBA, GL_RGBA8, "RGBA/ubyte", 4,   GL_TRUE },
+//    { GL_RGB, GL_UNSIGNED_BYTE,        GL_RGB, GL_RGB8, "RGB/ubyte", 3,     GL_FALSE },
+//    { GL_RGB, GL_UNSIGNED_SHORT_5_6_5, GL_RGB, GL_RGB565, "RGB/565", 2,       GL_FALSE },
 //#if !IS_GlEs
-//    { GL_BGRA, GL_UNSIGNED_BYTE,       GL_RGBA, "BGRA/ubyte", 4,   GL_FALSE },
+//    { GL_BGRA, GL_UNSIGNED_BYTE,       GL_RGBA, GL_RGBA8, "BGRA/ubyte", 4,   GL_FALSE },
 //#endif
 //#if !IS_Gl
-//    { GL_LUMINANCE, GL_UNSIGNED_BYTE,  GL_LUMINANCE, "L/ubyte", 1, GL_FALSE },
+//    { GL_LUMINANCE, GL_UNSIGNED_BYTE,  GL_LUMINANCE, GL_LUMINANCE, "L/ubyte", 1, GL_FALSE },
 //#endif
-    { 0, 0, 0, NULL, 0, 0 }
+    { 0, 0, 0, 0, NULL, 0, 0 }
+};
+
+/* return images/sec of mode at TexSize, or -1 if the mode is not available; sets BytesPerImage */
+static double MeasureMode( GLint mode, GLuint texel_size )
+{
+    double rate;
+
+    BytesPerImage = TexSize * TexSize * texel_size;
+    UploadMode = mode;
+
+    if (mode >= MODE_CREATE_TEXSTORAGE && !HasTexStorage)
+        return -1.0;
+
+    switch (mode) {
+        case MODE_TEXIMAGE:
+            NewTexture(0);
+            rate = PerfMeasureRate(UploadTexImage2D, eglx_PollEvents );
+            break;
+
+        case MODE_CREATE_TEXIMAGE:
+            rate = PerfMeasureRate(CreateUploadTexImage2D, eglx_PollEvents );
+            break;
+
+        case MODE_TEXSUBIMAGE:
+            /* create initial, empty texture */
+            NewTexture(0);
+            glTexImage2D(GL_TEXTURE_2D, 0, TexIntFormat,
+                         TexSize, TexSize, 0,
+                         TexSrcFormat, TexSrcType, NULL);
+            rate = PerfMeasureRate(UploadTexSubImage2D, eglx_PollEvents );
+            break;
+
+        case MODE_GETTEXIMAGE:
+            if( Api.api == API_GLES )
+                return -1.0;
+            NewTexture(0);
+            glTexImage2D(GL_TEXTURE_2D, 0, TexIntFormat,
+                         TexSize, TexSize, 0,
+                         TexSrcFormat, TexSrcType, TexImage);
+            rate = PerfMeasureRate(GetTexImage2D, eglx_PollEvents );
+            break;
+
+        case MODE_CREATE_TEXSTORAGE:
+            rate = PerfMeasureRate(UploadTexStorage, eglx_PollEvents );
+            break;
+
+        case MODE_TEXSTORAGE_SUBIMAGE:
+            NewTexture(1);
+            rate = PerfMeasureRate(UploadTexStorage, eglx_PollEvents );
+            break;
+
+        case MODE_TEXSTORAGE_PBO:
+        case MODE_TEXSTORAGE_PBO_RING:
+            NewTexture(1);
+            for (int i = 0; i < PBORingSize; i++) {
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, PBOs[i]);
+                glBufferData(GL_PIXEL_UNPACK_BUFFER, BytesPerImage, NULL, GL_STREAM_DRAW);
+            }
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            rate = PerfMeasureRate(UploadTexStorage, eglx_PollEvents );
+            break;
+
+        case MODE_TEXSTORAGE_MIPLEVELS:
+            TexLevels = 1;
+            while ((TexSize >> TexLevels) > 0)
+                TexLevels++;
+            NewTexture(TexLevels);
+            BytesPerImage = 0;
+            for (GLsizei level = 0; level < TexLevels; level++) {
+                const GLsizei size = (TexSize >> level) > 0 ? (TexSize >> level) : 1;
+                BytesPerImage += size * size * texel_size;
+            }
+            rate = PerfMeasureRate(UploadTexStorage, eglx_PollEvents );
+            break;
+
+        default:
+            exit(1);
+    }
+
+    return rate;
+}
+
+static void PrintMode( GLint mode, const char *formatName, double rate )
+{
+    const double mbPerSec = rate * BytesPerImage / (1024.0 * 1024.0);
+
+    printf("  %s(%s %d x %d)%s: "
+           "%.1f images/sec, %.1f MB/sec",
+           mode_name[mode], formatName, TexSize, TexSize,
+           (DrawPoint) ? " + Draw" : "",
+           rate, mbPerSec);
+    if (rate > 0.0 && mode != MODE_GETTEXIMAGE)
+        printf(", next draw stall %.1f us", MeasureNextDrawStall());
+    printf("\n");
+}
+
+
+
+// internal format/format/type pairs for the upload matrix, the context decides which ones are valid
+static const struct {
+    GLenum internal_format;
+    GLenum format, type;
+    GLuint texel_size;
+} MatrixFormats[] = {
+    { GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE,                        4 },
+    // GLES EXT_texture_format_BGRA8888, then the GL only pairs
+    { GL_BGRA_EXT, GL_BGRA_EXT, GL_UNSIGNED_BYTE,                 4 },
+    { GL_RGBA8, GL_BGRA, GL_UNSIGNED_BYTE,                        4 },
+    { GL_RGBA8, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV,             4 },
+    { GL_RGBA8, GL_RGBA, GL_UNSIGNED_INT_8_8_8_8,                 4 },
+    { GL_RGB8, GL_BGR, GL_UNSIGNED_BYTE,                          3 },
+    { GL_RGB8, GL_RGB, GL_UNSIGNED_BYTE,                          3 },
+    { GL_SRGB8_ALPHA8, GL_RGBA, GL_UNSIGNED_BYTE,                 4 },
+    { GL_RGB565, GL_RGB, GL_UNSIGNED_SHORT_5_6_5,                 2 },
+    { GL_RGB565, GL_RGB, GL_UNSIGNED_BYTE,                        3 },
+    { GL_RGBA4, GL_RGBA, GL_UNSIGNED_SHORT_4_4_4_4,               2 },
+    { GL_RGB5_A1, GL_RGBA, GL_UNSIGNED_SHORT_5_5_5_1,             2 },
+    { GL_RGB10_A2, GL_RGBA, GL_UNSIGNED_INT_2_10_10_10_REV,       4 },
+    { GL_R11F_G11F_B10F, GL_RGB, GL_UNSIGNED_INT_10F_11F_11F_REV, 4 },
+    { GL_RGBA16F, GL_RGBA, GL_HALF_FLOAT,                         8 },
+    { GL_RGBA16F, GL_RGBA, GL_FLOAT,                              16 },
+    { GL_RGBA32F, GL_RGBA, GL_FLOAT,                              16 },
+    { GL_RG8, GL_RG, GL_UNSIGNED_BYTE,                            2 },
+    { GL_R8, GL_RED, GL_UNSIGNED_BYTE,                            1 },
+    { GL_LUMINANCE, GL_LUMINANCE, GL_UNSIGNED_BYTE,               1 },
+    { 0, 0, 0, 0 }
 };
 
+static const GLsizei MatrixTexSize = 1024;
+// within this fraction of the fastest pair, a pair is taken as not converted
+static const double MatrixFastRatio = 0.8;
+
+static void PerfDrawMatrix()
+{
+    const int count = sizeof(MatrixFormats)/sizeof(MatrixFormats[0]) - 1;
+    double rates[sizeof(MatrixFormats)/sizeof(MatrixFormats[0])];
+    double best = 0.0;
+    // GLES has no GL_TEXTURE_IMAGE_FORMAT/TYPE query
+    const int hasQuery = !glContextIsEs() && (glVersionAtLeast( 4, 3, 0, 0 ) || GLAD_GL_ARB_internalformat_query2);
+
+    TexSize = MatrixTexSize;
+    TexImage = (GLubyte*) malloc(TexSize * TexSize * 16);
+    memset( TexImage, 0x7f, TexSize * TexSize * 16 );
+    while( glGetError() != GL_NO_ERROR )
+        ;
+
+    for (int i = 0; i < count; i++) {
+        TexIntFormat = MatrixFormats[i].internal_format;
+        TexSrcFormat = MatrixFormats[i].format;
+        TexSrcType = MatrixFormats[i].type;
+        rates[i] = -1.0;
+
+        /* the allocation tells whether the pair is valid for this context */
+        NewTexture(0);
+        glTexImage2D(GL_TEXTURE_2D, 0, TexIntFormat,
+                     TexSize, TexSize, 0,
+                     TexSrcFormat, TexSrcType, NULL);
+        if (glGetError() != GL_NO_ERROR)
+            continue;
+
+        rates[i] = PerfMeasureRate(UploadTexSubImage2D, eglx_PollEvents ) * TexSize * TexSize * MatrixFormats[i].texel_size;
+        if (rates[i] > best)
+            best = rates[i];
+        eglx_SwapBuffers();
+    }
+    free(TexImage);
+    TexImage = NULL;
+
+    printf("glTexSubImage2D(%d x %d)%s:\n", TexSize, TexSize, (DrawPoint) ? " + Draw" : "");
+    for (int i = 0; i < count; i++) {
+        const GLenum internalFormat = MatrixFormats[i].internal_format;
+        const GLenum format = MatrixFormats[i].format;
+        const GLenum type = MatrixFormats[i].type;
+
+        if (rates[i] < 0.0) {
+            printf("  %-18s %-18s %-32s: invalid, skipped\n", glFormatName(internalFormat), glFormatName(format), glTypeName(type));
+            continue;
+        }
+
+        /* the driver's own choice of format/type for the internal format */
+        int isPreferred = 0;
+        if (hasQuery) {
+            GLint preferredFormat = 0, preferredType = 0;
+            glGetInternalformativ(GL_TEXTURE_2D, internalFormat, GL_TEXTURE_IMAGE_FORMAT, 1, &preferredFormat);
+            glGetInternalformativ(GL_TEXTURE_2D, internalFormat, GL_TEXTURE_IMAGE_TYPE, 1, &preferredType);
+            isPreferred = (GLint)format == preferredFormat && (GLint)type == preferredType;
+        }
 
+        printf("  %-18s %-18s %-32s: %8.1f MB/sec%s%s\n", glFormatName(internalFormat), glFormatName(format), glTypeName(type),
+               rates[i] / (1024.0 * 1024.0),
+               isPreferred ? ", preferred format" : "",
+               rates[i] >= best * MatrixFastRatio ? ", no conversion" : ", converted");
+    }
+
+    glErrorCheck();
+}
 
 static void PerfDraw()
 {
@@ -273,6 +628,7 @@ static void PerfDraw()
     /* loop over source data formats */
     for (fmt = 0; SrcFormats[fmt].format; fmt++) {
         TexIntFormat = SrcFormats[fmt].internal_format;
+        TexStorageFormat = SrcFormats[fmt].storage_format;
         TexSrcFormat = SrcFormats[fmt].format;
         TexSrcType = SrcFormats[fmt].type;
 
@@ -294,62 +650,24 @@ static void PerfDraw()
              * ones which are legal for this driver.
              */
             for (TexSize = minsz; TexSize <= maxsz; TexSize *= 4) {
-                double mbPerSec;
-
                 if (TexSize <= maxSize) {
-                    GLint bytesPerImage;
-
-                    bytesPerImage = TexSize * TexSize * SrcFormats[fmt].texel_size;
-                    TexImage = (GLubyte*) malloc(bytesPerImage);
-                    memset( TexImage, 0xff, bytesPerImage );
-
-                    switch (mode) {
-                        case MODE_TEXIMAGE:
-                            rate = PerfMeasureRate(UploadTexImage2D, eglx_PollEvents );
-                            break;
-
-                        case MODE_CREATE_TEXIMAGE:
-                            rate = PerfMeasureRate(CreateUploadTexImage2D, eglx_PollEvents );
-                            break;
-
-                        case MODE_TEXSUBIMAGE:
-                            /* create initial, empty texture */
-                            glTexImage2D(GL_TEXTURE_2D, 0, TexIntFormat,
-                                         TexSize, TexSize, 0,
-                                         TexSrcFormat, TexSrcType, NULL);
-                            rate = PerfMeasureRate(UploadTexSubImage2D, eglx_PollEvents );
-                            break;
-
-                        case MODE_GETTEXIMAGE:
-#if IS_GlEs
-                            continue;
-#else
-                            glTexImage2D(GL_TEXTURE_2D, 0, TexIntFormat,
-                                         TexSize, TexSize, 0,
-                                         TexSrcFormat, TexSrcType, TexImage);
-                            rate = PerfMeasureRate(GetTexImage2D, eglx_PollEvents );
-                            break;
-#endif
-
-                        default:
-                            exit(1);
-                    }
+                    TexImage = (GLubyte*) malloc(TexSize * TexSize * SrcFormats[fmt].texel_size);
+                    memset( TexImage, 0xff, TexSize * TexSize * SrcFormats[fmt].texel_size );
 
-                    mbPerSec = rate * bytesPerImage / (1024.0 * 1024.0);
+                    rate = MeasureMode(mode, SrcFormats[fmt].texel_size);
+                    if (rate < 0.0) {
+                        free(TexImage);
+                        continue;
+                    }
+                    PrintMode(mode, SrcFormats[fmt].name, rate);
                     free(TexImage);
 
                     glErrorCheck();
                 }
                 else {
-                    rate = 0;
-                    mbPerSec = 0;
+                    BytesPerImage = 0;
+                    PrintMode(mode, SrcFormats[fmt].name, 0.0);
                 }
-
-                printf("  %s(%s %d x %d)%s: "
-                       "%.1f images/sec, %.1f MB/sec\n",
-                       mode_name[mode], SrcFormats[fmt].name, TexSize, TexSize,
-                       (DrawPoint) ? " + Draw" : "",
-                       rate, mbPerSec);
                 eglx_SwapBuffers();
             }
         }
@@ -371,6 +689,7 @@ static void PerfDraw2( GLint mode_, GLuint TexSize_ )
     {
         GLint fmt = 0;
         TexIntFormat = SrcFormats[fmt].internal_format;
+        TexStorageFormat = SrcFormats[fmt].storage_format;
         TexSrcFormat = SrcFormats[fmt].format;
         TexSrcType = SrcFormats[fmt].type;
 
@@ -391,62 +710,24 @@ static void PerfDraw2( GLint mode_, GLuint TexSize_ )
 
             TexSize = TexSize_;
             {
-                double mbPerSec;
-
                 if (TexSize <= maxSize) {
-                    GLint bytesPerImage;
-
-                    bytesPerImage = TexSize * TexSize * SrcFormats[fmt].texel_size;
-                    TexImage = (GLubyte*) malloc(bytesPerImage);
-                    memset( TexImage, 0xff, bytesPerImage );
-
-                    switch (mode) {
-                        case MODE_TEXIMAGE:
-                            rate = PerfMeasureRate(UploadTexImage2D, eglx_PollEvents );
-                            break;
-
-                        case MODE_CREATE_TEXIMAGE:
-                            rate = PerfMeasureRate(CreateUploadTexImage2D, eglx_PollEvents );
-                            break;
-
-                        case MODE_TEXSUBIMAGE:
-                            /* create initial, empty texture */
-                            glTexImage2D(GL_TEXTURE_2D, 0, TexIntFormat,
-                                         TexSize, TexSize, 0,
-                                         TexSrcFormat, TexSrcType, NULL);
-                            rate = PerfMeasureRate(UploadTexSubImage2D, eglx_PollEvents );
-                            break;
-
-                        case MODE_GETTEXIMAGE:
-#if IS_GlEs
-                            return;
-#else
-                            glTexImage2D(GL_TEXTURE_2D, 0, TexIntFormat,
-                                         TexSize, TexSize, 0,
-                                         TexSrcFormat, TexSrcType, TexImage);
-                            rate = PerfMeasureRate(GetTexImage2D, eglx_PollEvents );
-                            break;
-#endif
-
-                        default:
-                            exit(1);
-                    }
+                    TexImage = (GLubyte*) malloc(TexSize * TexSize * SrcFormats[fmt].texel_size);
+                    memset( TexImage, 0xff, TexSize * TexSize * SrcFormats[fmt].texel_size );
 
-                    mbPerSec = rate * bytesPerImage / (1024.0 * 1024.0);
+                    rate = MeasureMode(mode, SrcFormats[fmt].texel_size);
+                    if (rate < 0.0) {
+                        free(TexImage);
+                        return;
+                    }
+                    PrintMode(mode, SrcFormats[fmt].name, rate);
                     free(TexImage);
 
                     glErrorCheck();
                 }
                 else {
-                    rate = 0;
-                    mbPerSec = 0;
+                    BytesPerImage = 0;
+                    PrintMode(mode, SrcFormats[fmt].name, 0.0);
                 }
-
-                printf("  %s(%s %d x %d)%s: "
-                       "%.1f images/sec, %.1f MB/sec\n",
-                       mode_name[mode], SrcFormats[fmt].name, TexSize, TexSize,
-                       (DrawPoint) ? " + Draw" : "",
-                       rate, mbPerSec);
                 eglx_SwapBuffers();
             }
         }
@@ -458,16 +739,17 @@ static void PerfDraw2( GLint mode_, GLuint TexSize_ )
 
 int main( int argc, const char* argv[] )
 {
-    api_t api = apiInitial( API_Current, argc, argv );
-    printf("%s: %s\n", argv[0], apiName(api));
+    Api = apiInitial( API_Any, argc, argv );
+    printf("%s: %s\n", argv[0], apiName(Api));
 
     int __mode = integerFromArgs("--mode", argc, argv, NULL );
     int __testcase = integerFromArgs( "--testcase", argc, argv, NULL );
     int __draw = integerFromArgs("--draw", argc, argv, NULL );
+    const int __matrix = flagFromArgs( "--matrix", argc, argv );
 
     // initialize and configure
     // ------------------------------
-    eglx_CreateWindow( api, WinWidth, WinHeight );
+    eglx_CreateWindow( Api, WinWidth, WinHeight );
 
     // init
     // -----------
@@ -477,6 +759,12 @@ int main( int argc, const char* argv[] )
     // -----------
     while (!eglx_ShouldClose())
     {
+        if( __matrix ){
+            DrawPoint = __draw != -1 ? __draw : GL_FALSE;
+            PerfDrawMatrix();
+            exit(0);
+        }
+
         if( __mode != -1 && __testcase != -1 && __draw != -1 ){
             DrawPoint = __draw;
 
@@ -0,0 +1,330 @@
+/**
+ * Measure texture sampling rates, a matrix of:
+ *   --format N: RGBA8, RGB565, RGBA16F, R11F_G11F_B10F, SRGB8_ALPHA8, ETC2 RGB8, S3TC DXT1
+ *   --filter N: nearest, linear, trilinear, anisotropic 2x, 4x, 8x, 16x
+ *   --size N: texture size, 64 (fits in the texture cache), 256, 1024, 4096 (overflows it)
+ *   --pattern N: coherent (1 texel per pixel), rotated (45 degrees, 4:1 anisotropic minification),
+ *                random (random texels, with the gradients of coherent)
+ * The options pick one value of each dimension, by index; the default is the whole matrix.
+ * Every fragment samples the texture Taps times.
+ * One build for gl and gles: --api gl33 or gles32
+ */
+#include <stdio.h>
+#include <string.h>
+#include "glad.h"
+#include "glUtils.h"
+#include "eglUtils.h"
+#include "myUtils.h"
+
+
+// settings
+static const int WinWidth = 200;
+static const int WinHeight = 200;
+
+static const GLsizei TargetSize = 1024;
+static const int Taps = 4;
+
+static api_t Api;
+static GLuint VAO;
+static GLuint VBO;
+static GLuint programs[3];
+static GLuint Tex;
+static GLuint Program;
+static RenderTarget Target;
+
+static const struct {
+    GLenum internalFormat;
+    GLenum format, type;        // GL_NONE for compressed formats
+    const char *name;
+} Formats[] = {
+    { GL_RGBA8,                     GL_RGBA, GL_UNSIGNED_BYTE,          "RGBA8" },
+    { GL_RGB565,                    GL_RGB,  GL_UNSIGNED_SHORT_5_6_5,   "RGB565" },
+    { GL_RGBA16F,                   GL_RGBA, GL_FLOAT,                  "RGBA16F" },
+    { GL_R11F_G11F_B10F,            GL_RGB,  GL_FLOAT,                  "R11F_G11F_B10F" },
+    { GL_SRGB8_ALPHA8,              GL_RGBA, GL_UNSIGNED_BYTE,          "SRGB8_ALPHA8" },
+    { GL_COMPRESSED_RGB8_ETC2,      GL_NONE, GL_NONE,                   "ETC2_RGB8" },
+    { GL_COMPRESSED_RGB_S3TC_DXT1_EXT, GL_NONE, GL_NONE,                "S3TC_DXT1" },
+};
+
+static const struct {
+    GLenum minFilter, magFilter;
+    GLfloat anisotropy;         // 0: not anisotropic
+    const char *name;
+} Filters[] = {
+    { GL_NEAREST,              GL_NEAREST, 0.0f,  "nearest" },
+    { GL_LINEAR,               GL_LINEAR,  0.0f,  "linear" },
+    { GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR,  0.0f,  "trilinear" },
+    { GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR,  2.0f,  "aniso 2x" },
+    { GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR,  4.0f,  "aniso 4x" },
+    { GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR,  8.0f,  "aniso 8x" },
+    { GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR,  16.0f, "aniso 16x" },
+};
+
+static const GLsizei Sizes[] = { 64, 256, 1024, 4096 };
+
+static const char *patternNames[] = { "coherent", "rotated", "random" };
+
+struct vertex
+{
+    GLfloat x, y;
+};
+
+static const struct vertex vertices[4] = {
+    { -1.0, -1.0 },
+    {  1.0, -1.0 },
+    {  1.0,  1.0 },
+    { -1.0,  1.0 }
+};
+
+const char *vertexShaderBody =
+    "uniform float UVScale;\n"
+    "layout (location = 0) in vec2 vPos;\n"
+    "out vec2 v_texCoord;\n"
+    "void main()\n"
+    "{\n"
+    "   gl_Position = vec4( vPos.x, vPos.y, 0.0, 1.0 );\n"
+    "   v_texCoord = (vPos * 0.5 + 0.5) * UVScale;\n"
+    "}\n\0";
+
+// PATTERN is defined before this body, v_texCoord maps 1 texel per pixel
+const char *fragmentShaderBody =
+    "uniform sampler2D Tex;\n"
+    "in vec2 v_texCoord;\n"
+    "layout (location = 0) out vec4 outColor;\n"
+    "void main()\n"
+    "{\n"
+    "   vec2 uv = v_texCoord;\n"
+    "#if PATTERN == 1\n"
+    "   uv = mat2( 0.7071, 0.7071, -0.7071, 0.7071 ) * (uv * vec2( 1.0, 4.0 ));\n"
+    "#endif\n"
+    "   vec2 dx = dFdx( uv );\n"
+    "   vec2 dy = dFdy( uv );\n"
+    "   vec4 c = vec4( 0.0 );\n"
+    "   for( int i = 0; i < 4; i++ ){\n"
+    "       vec2 tap = uv + vec2( float(i) * 0.37, float(i) * 0.21 );\n"
+    "#if PATTERN == 2\n"
+    "       tap = fract( sin( vec2( dot( gl_FragCoord.xy + float(i), vec2(12.9898, 78.233) ),\n"
+    "                               dot( gl_FragCoord.yx + float(i), vec2(39.3468, 11.135) ) ) ) * 43758.5453 );\n"
+    "#endif\n"
+    "       c += textureGrad( Tex, tap, dx, dy );\n"
+    "   }\n"
+    "   outColor = c * 0.25;\n"
+    "}\n\0";
+
+static GLuint CreatePatternProgram( int pattern )
+{
+    char body[4096];
+    snprintf( body, sizeof(body), "#define PATTERN %d\n%s", pattern, fragmentShaderBody );
+
+    GLuint program = CreateProgramFromBody( Api, vertexShaderBody, body );
+    glUseProgram( program );
+    glUniform1i( glGetUniformLocation( program, "Tex" ), 0 );
+    return program;
+}
+
+static void PerfInit()
+{
+    // build and compile our shader program
+    // ------------------------------------
+    for( int p = 0; p < 3; p++ )
+        programs[p] = CreatePatternProgram( p );
+
+    // set up vertex data (and buffer(s)) and configure vertex attributes
+    // ------------------------------------------------------------------
+    glGenVertexArrays(1, &VAO);
+    glBindVertexArray(VAO);
+
+    glGenBuffers(1, &VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+
+    glVertexAttribPointer( 0, 2, GL_FLOAT, GL_FALSE, sizeof(struct vertex), (void*) 0 );
+    glEnableVertexAttribArray(0);
+
+    // offscreen target, independent of the window size
+    // ------------------------------------------------------------------
+    if( !RenderTarget_Create( &Target, TargetSize, TargetSize, GL_RGBA8, GL_NONE, 0 ) )
+        exit(EXIT_FAILURE);
+}
+
+static int FormatSupported( int f )
+{
+    switch( Formats[f].internalFormat ){
+        case GL_COMPRESSED_RGB8_ETC2: return glVersionAtLeast( 4, 3, 3, 0 ) || GLAD_GL_ARB_ES3_compatibility;
+        case GL_COMPRESSED_RGB_S3TC_DXT1_EXT: return GLAD_GL_EXT_texture_compression_s3tc;
+        default: return 1;
+    }
+}
+
+/* a full mipmap chain; the contents don't matter to sampling speed, compressed levels are random blocks */
+static int CreateTexture( int f, GLsizei size )
+{
+    glGenTextures( 1, &Tex );
+    glActiveTexture( GL_TEXTURE0 );
+    glBindTexture( GL_TEXTURE_2D, Tex );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT );
+
+    if( Formats[f].format == GL_NONE ){
+        // 4x4 blocks of 8 bytes, ETC2 RGB8 and DXT1
+        for( GLsizei level = 0, s = size; s > 0; level++, s /= 2 ){
+            const GLsizei blocks = (s + 3) / 4;
+            const GLsizei bytes = blocks * blocks * 8;
+            uint8_t *data = (uint8_t*) malloc( bytes );
+            for( GLsizei i = 0; i < bytes; i++ )
+                data[i] = (uint8_t) rand();
+            glCompressedTexImage2D( GL_TEXTURE_2D, level, Formats[f].internalFormat, s, s, 0, bytes, data );
+            free( data );
+        }
+    }
+    else {
+        uint8_t *rgba = GenerateCheckboard_RGBA( size, size, 8 );
+        void *data = rgba;
+        void *converted = NULL;
+
+        if( Formats[f].type == GL_FLOAT ){
+            const int channels = (Formats[f].format == GL_RGBA) ? 4 : 3;
+            float *floats = (float*) malloc( (size_t)size * size * channels * sizeof(float) );
+            for( size_t i = 0; i < (size_t)size * size; i++ ){
+                for( int c = 0; c < channels; c++ )
+                    floats[i * channels + c] = rgba[i * 4 + c] / 255.0f;
+            }
+            data = converted = floats;
+        }
+        else if( Formats[f].type == GL_UNSIGNED_SHORT_5_6_5 ){
+            uint16_t *rgb565 = (uint16_t*) malloc( (size_t)size * size * sizeof(uint16_t) );
+            for( size_t i = 0; i < (size_t)size * size; i++ )
+                rgb565[i] = ((rgba[i * 4] >> 3) << 11) | ((rgba[i * 4 + 1] >> 2) << 5) | (rgba[i * 4 + 2] >> 3);
+            data = converted = rgb565;
+        }
+
+        glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+        glTexImage2D( GL_TEXTURE_2D, 0, Formats[f].internalFormat, size, size, 0, Formats[f].format, Formats[f].type, data );
+        glGenerateMipmap( GL_TEXTURE_2D );
+        free( converted );
+        free( rgba );
+    }
+
+    const GLenum error = glGetError();
+    if( error != GL_NO_ERROR ){
+        printf("%s %d x %d: %s\n", Formats[f].name, size, size, glErrorName(error));
+        glDeleteTextures( 1, &Tex );
+        return 0;
+    }
+    return 1;
+}
+
+static void SetFilter( int filter, GLfloat maxAnisotropy )
+{
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, Filters[filter].minFilter );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, Filters[filter].magFilter );
+    if( maxAnisotropy > 0.0f )
+        glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY, Filters[filter].anisotropy > 1.0f ? Filters[filter].anisotropy : 1.0f );
+}
+
+static void DrawQuad(unsigned count)
+{
+    for (unsigned i = 0; i < count; i++) {
+        glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+
+        if (i % 128 == 0)
+            glFlush();
+    }
+    glFinish();
+}
+
+static void PerfDraw( int format, int filter, int size, int pattern )
+{
+    GLfloat maxAnisotropy = 0.0f;
+    const int hasAnisotropy = (!glContextIsEs() && glVersionAtLeast( 4, 6, 0, 0 )) ||
+                              GLAD_GL_ARB_texture_filter_anisotropic || GLAD_GL_EXT_texture_filter_anisotropic;
+    if( hasAnisotropy )
+        glGetFloatv( GL_MAX_TEXTURE_MAX_ANISOTROPY, &maxAnisotropy );
+    printf("%d x %d target, %d taps/pixel, GL_MAX_TEXTURE_MAX_ANISOTROPY = %.0f\n", TargetSize, TargetSize, Taps, maxAnisotropy);
+
+    const double texelsPerDraw = (double)TargetSize * TargetSize * Taps;
+
+    for( int f = 0; f < (int)(sizeof(Formats)/sizeof(Formats[0])); f++ ){
+        if( format != -1 && format != f )
+            continue;
+        if( !FormatSupported( f ) ){
+            printf("%s: not supported\n", Formats[f].name);
+            continue;
+        }
+
+        for( int s = 0; s < (int)(sizeof(Sizes)/sizeof(Sizes[0])); s++ ){
+            if( size != -1 && size != s )
+                continue;
+            if( !CreateTexture( f, Sizes[s] ) )
+                continue;
+
+            printf("%s %d x %d:\n", Formats[f].name, Sizes[s], Sizes[s]);
+            for( int t = 0; t < (int)(sizeof(Filters)/sizeof(Filters[0])); t++ ){
+                if( filter != -1 && filter != t )
+                    continue;
+                if( Filters[t].anisotropy > maxAnisotropy )
+                    continue;
+                SetFilter( t, maxAnisotropy );
+
+                printf("   %-10s:", Filters[t].name);
+                for( int p = 0; p < 3; p++ ){
+                    if( pattern != -1 && pattern != p )
+                        continue;
+
+                    Program = programs[p];
+                    glUseProgram( Program );
+                    glUniform1f( glGetUniformLocation( Program, "UVScale" ), (GLfloat)TargetSize / Sizes[s] );
+
+                    const double rate = PerfMeasureRate(DrawQuad, eglx_PollEvents ) * texelsPerDraw;
+                    printf("  %s %s texels/second", patternNames[p], PerfHumanFloat(rate));
+                    fflush(stdout);
+                }
+                printf("\n");
+            }
+
+            glDeleteTextures( 1, &Tex );
+            glErrorCheck();
+        }
+    }
+
+    glErrorCheck();
+    exit(0);
+}
+
+int main( int argc, const char* argv[] )
+{
+    Api = apiInitial( API_AnyShader, argc, argv );
+    printf("%s: %s\n", argv[0], apiName(Api));
+
+    int __format = integerFromArgs("--format", argc, argv, NULL );
+    int __filter = integerFromArgs("--filter", argc, argv, NULL );
+    int __size = integerFromArgs("--size", argc, argv, NULL );
+    int __pattern = integerFromArgs("--pattern", argc, argv, NULL );
+
+    // initialize and configure
+    // ------------------------------
+    eglx_CreateWindow( Api, WinWidth, WinHeight );
+
+    // init
+    // -----------
+    PerfInit();
+
+    // render loop
+    // -----------
+    while (!eglx_ShouldClose())
+    {
+        // render
+        // ------
+        PerfDraw( __format, __filter, __size, __pattern );
+
+        // swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
+        // -------------------------------------------------------------------------------
+        eglx_SwapBuffers();
+        eglx_PollEvents();
+    }
+
+    // terminate, clearing all previously allocated resources.
+    // ------------------------------------------------------------------
+    eglx_Terminate();
+    return 0;
+}
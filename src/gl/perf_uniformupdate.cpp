@@ -0,0 +1,385 @@
+/**
+ * Measure uniform update strategies, for 1 ~ 1000 objects per frame:
+ *   --mode 0: glUniform*() per draw
+ *   --mode 1: one UBO per draw, glBufferSubData() + glBindBufferBase()
+ *   --mode 2: one large UBO, one glBufferSubData() per frame, glBindBufferRange() per draw
+ *   --mode 3: persistent mapped UBO ring (buffer_storage), glBindBufferRange() per draw
+ *   --objects N: only test N objects per frame
+ * One build for gl and gles: --api gl33 or gles32
+ */
+#include <stdio.h>
+#include <string.h>
+#include "linmath.h"
+#include "glad.h"
+#include "glUtils.h"
+#include "eglUtils.h"
+#include "myUtils.h"
+#include <EGL/egl.h>
+
+
+// settings
+static const int WinWidth = 200;
+static const int WinHeight = 200;
+
+#define MaxObjects  1000
+#define RingFrames  3
+
+static const int ObjectCounts[] = { 1, 10, 100, 1000 };
+
+// glBufferStorage() on GL, glBufferStorageEXT() on GLES, which the glad_gl table doesn't load; same bits
+static PFNGLBUFFERSTORAGEPROC BufferStorage = NULL;
+
+// std140 layout of ObjectBlock
+typedef struct ObjectData{
+    mat4x4 MVP;
+    vec4 Color0;
+    vec4 Color1;
+}ObjectData;
+
+static api_t Api;
+static GLuint VAO;
+static GLuint VBO;
+static GLuint uniformProgram;
+static GLuint blockProgram;
+static GLint MVP_uLoc, Color0_uLoc, Color1_uLoc;
+
+static GLuint objectUBOs[MaxObjects];    // mode 1
+static GLuint largeUBO;                  // mode 2
+static GLubyte *largeUBOData;
+static GLuint ringUBO;                   // mode 3
+static GLubyte *ringUBOData;
+static GLsync ringFences[RingFrames];
+static int ringFrame;
+static int hasBufferStorage;
+
+static GLint uboAlignment;
+static GLsizeiptr uboStride;             // sizeof(ObjectData) rounded up to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+
+static ObjectData objects[MaxObjects];
+static int numObjects;
+static unsigned frameCounter;
+
+// CPU time spent submitting, glFinish() excluded
+static uint64_t submitMicroseconds;
+static uint64_t submitDraws;
+
+static const GLfloat vertices[] = {
+    -1.0, -1.0,
+     1.0, -1.0,
+    -1.0,  1.0,
+     1.0,  1.0,
+};
+
+
+const char *uniformVertexShaderBody =
+    "uniform mat4 MVP;\n"
+    "uniform vec4 Color0;\n"
+    "uniform vec4 Color1;\n"
+    "layout (location = 0) in vec2 vPos;\n"
+    "out vec4 Color;\n"
+    "void main()\n"
+    "{\n"
+    "   gl_Position = MVP * vec4( vPos.x, vPos.y, 0.0f, 1.0f );\n"
+    "   Color = Color0 * Color1;\n"
+    "}\n\0";
+
+const char *blockVertexShaderBody =
+    "layout (std140) uniform ObjectBlock {\n"
+    "   mat4 MVP;\n"
+    "   vec4 Color0;\n"
+    "   vec4 Color1;\n"
+    "};\n"
+    "layout (location = 0) in vec2 vPos;\n"
+    "out vec4 Color;\n"
+    "void main()\n"
+    "{\n"
+    "   gl_Position = MVP * vec4( vPos.x, vPos.y, 0.0f, 1.0f );\n"
+    "   Color = Color0 * Color1;\n"
+    "}\n\0";
+
+const char *fragmentShaderBody =
+    "in vec4 Color;\n"
+    "layout (location = 0) out vec4 outColor;\n"
+    "void main()\n"
+    "{\n"
+    "   outColor = Color;\n"
+    "}\n\0";
+
+static void PerfInit()
+{
+    // build and compile our shader program
+    // ------------------------------------
+    uniformProgram = CreateProgramFromBody( Api, uniformVertexShaderBody, fragmentShaderBody );
+    MVP_uLoc = glGetUniformLocation( uniformProgram, "MVP" );
+    Color0_uLoc = glGetUniformLocation( uniformProgram, "Color0" );
+    Color1_uLoc = glGetUniformLocation( uniformProgram, "Color1" );
+
+    blockProgram = CreateProgramFromBody( Api, blockVertexShaderBody, fragmentShaderBody );
+    const GLuint blockIndex = glGetUniformBlockIndex( blockProgram, "ObjectBlock" );
+    glUniformBlockBinding( blockProgram, blockIndex, 0 );
+
+    GLint blockSize;
+    glGetActiveUniformBlockiv( blockProgram, blockIndex, GL_UNIFORM_BLOCK_DATA_SIZE, &blockSize );
+    if( blockSize != sizeof(ObjectData) ){
+        printf("%s: ObjectBlock size = %d, expect %d\n", __func__, blockSize, (int)sizeof(ObjectData));
+        exit(EXIT_FAILURE);
+    }
+
+    // set up vertex data (and buffer(s)) and configure vertex attributes
+    // ------------------------------------------------------------------
+    glGenVertexArrays(1, &VAO);
+    glBindVertexArray(VAO);
+
+    glGenBuffers(1, &VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(GLfloat), (void*) 0);
+    glEnableVertexAttribArray(0);
+
+    // objects: small quads on a grid
+    // ------------------------------------------------------------------
+    const int grid = 32;
+    for( int i = 0; i < MaxObjects; i++ ){
+        mat4x4 m;
+        mat4x4_identity( m );
+        mat4x4_translate( m, -1.0f + (2.0f * (i % grid) + 1.0f) / grid, -1.0f + (2.0f * (i / grid) + 1.0f) / grid, 0.0f );
+        mat4x4_scale_aniso( objects[i].MVP, m, 0.8f / grid, 0.8f / grid, 1.0f );
+
+        objects[i].Color0[0] = (float)(i % 7) / 6.0f;
+        objects[i].Color0[1] = (float)(i % 5) / 4.0f;
+        objects[i].Color0[2] = (float)(i % 3) / 2.0f;
+        objects[i].Color0[3] = 1.0f;
+        objects[i].Color1[0] = objects[i].Color1[1] = objects[i].Color1[2] = objects[i].Color1[3] = 1.0f;
+    }
+
+    // uniform buffers
+    // ------------------------------------------------------------------
+    glGetIntegerv( GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uboAlignment );
+    uboStride = (sizeof(ObjectData) + uboAlignment - 1) / uboAlignment * uboAlignment;
+    printf("GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT = %d, UBO stride = %d\n", uboAlignment, (int)uboStride);
+
+    glGenBuffers( MaxObjects, objectUBOs );
+    for( int i = 0; i < MaxObjects; i++ ){
+        glBindBuffer( GL_UNIFORM_BUFFER, objectUBOs[i] );
+        glBufferData( GL_UNIFORM_BUFFER, sizeof(ObjectData), &objects[i], GL_DYNAMIC_DRAW );
+    }
+
+    largeUBOData = (GLubyte*) calloc( MaxObjects, uboStride );
+    glGenBuffers( 1, &largeUBO );
+    glBindBuffer( GL_UNIFORM_BUFFER, largeUBO );
+    glBufferData( GL_UNIFORM_BUFFER, MaxObjects * uboStride, NULL, GL_DYNAMIC_DRAW );
+
+    if( Api.api == API_GLES ){
+        if( glHasExtension( "GL_EXT_buffer_storage" ) )
+            BufferStorage = (PFNGLBUFFERSTORAGEPROC) eglGetProcAddress( "glBufferStorageEXT" );
+    }else{
+        BufferStorage = glBufferStorage;
+    }
+    hasBufferStorage = BufferStorage != NULL;
+    if( hasBufferStorage ){
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        const GLsizeiptr ringSize = RingFrames * MaxObjects * uboStride;
+        glGenBuffers( 1, &ringUBO );
+        glBindBuffer( GL_UNIFORM_BUFFER, ringUBO );
+        BufferStorage( GL_UNIFORM_BUFFER, ringSize, NULL, flags );
+        ringUBOData = (GLubyte*) glMapBufferRange( GL_UNIFORM_BUFFER, 0, ringSize, flags );
+        if( ringUBOData == NULL ){
+            printf("%s: glMapBufferRange() failed for the persistent UBO ring\n", __func__);
+            exit(EXIT_FAILURE);
+        }
+    }
+    glBindBuffer( GL_UNIFORM_BUFFER, 0 );
+    glErrorCheck();
+}
+
+/* per frame animation, the same CPU work for every mode */
+static inline void UpdateObject( ObjectData *dst, int i )
+{
+    *dst = objects[i];
+    dst->Color1[0] = (float)((frameCounter + i) & 0xFF) / 255.0f;
+}
+
+static void DrawUniform(unsigned count)
+{
+    ObjectData data;
+    glUseProgram( uniformProgram );
+
+    for (unsigned f = 0; f < count; f++) {
+        const uint64_t t0 = PerfGetMicrosecond();
+        for (int i = 0; i < numObjects; i++) {
+            UpdateObject( &data, i );
+            glUniformMatrix4fv( MVP_uLoc, 1, GL_FALSE, (const GLfloat*)data.MVP );
+            glUniform4fv( Color0_uLoc, 1, data.Color0 );
+            glUniform4fv( Color1_uLoc, 1, data.Color1 );
+            glDrawArrays( GL_TRIANGLE_STRIP, 0, 4 );
+        }
+        submitMicroseconds += PerfGetMicrosecond() - t0;
+        submitDraws += numObjects;
+        frameCounter++;
+    }
+    glFinish();
+}
+
+static void DrawUBOPerDraw(unsigned count)
+{
+    ObjectData data;
+    glUseProgram( blockProgram );
+
+    for (unsigned f = 0; f < count; f++) {
+        const uint64_t t0 = PerfGetMicrosecond();
+        for (int i = 0; i < numObjects; i++) {
+            UpdateObject( &data, i );
+            glBindBufferBase( GL_UNIFORM_BUFFER, 0, objectUBOs[i] );
+            glBufferSubData( GL_UNIFORM_BUFFER, 0, sizeof(ObjectData), &data );
+            glDrawArrays( GL_TRIANGLE_STRIP, 0, 4 );
+        }
+        submitMicroseconds += PerfGetMicrosecond() - t0;
+        submitDraws += numObjects;
+        frameCounter++;
+    }
+    glFinish();
+}
+
+static void DrawLargeUBO(unsigned count)
+{
+    glUseProgram( blockProgram );
+    glBindBuffer( GL_UNIFORM_BUFFER, largeUBO );
+
+    for (unsigned f = 0; f < count; f++) {
+        const uint64_t t0 = PerfGetMicrosecond();
+        for (int i = 0; i < numObjects; i++)
+            UpdateObject( (ObjectData*)(largeUBOData + i * uboStride), i );
+        glBufferSubData( GL_UNIFORM_BUFFER, 0, numObjects * uboStride, largeUBOData );
+
+        for (int i = 0; i < numObjects; i++) {
+            glBindBufferRange( GL_UNIFORM_BUFFER, 0, largeUBO, i * uboStride, sizeof(ObjectData) );
+            glDrawArrays( GL_TRIANGLE_STRIP, 0, 4 );
+        }
+        submitMicroseconds += PerfGetMicrosecond() - t0;
+        submitDraws += numObjects;
+        frameCounter++;
+    }
+    glFinish();
+}
+
+static void DrawPersistentRing(unsigned count)
+{
+    glUseProgram( blockProgram );
+
+    for (unsigned f = 0; f < count; f++) {
+        const uint64_t t0 = PerfGetMicrosecond();
+
+        // wait until the GPU is done with this part of the ring
+        if( ringFences[ringFrame] ){
+            glClientWaitSync( ringFences[ringFrame], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED );
+            glDeleteSync( ringFences[ringFrame] );
+            ringFences[ringFrame] = 0;
+        }
+
+        const GLintptr base = ringFrame * MaxObjects * uboStride;
+        for (int i = 0; i < numObjects; i++)
+            UpdateObject( (ObjectData*)(ringUBOData + base + i * uboStride), i );
+
+        for (int i = 0; i < numObjects; i++) {
+            glBindBufferRange( GL_UNIFORM_BUFFER, 0, ringUBO, base + i * uboStride, sizeof(ObjectData) );
+            glDrawArrays( GL_TRIANGLE_STRIP, 0, 4 );
+        }
+
+        ringFences[ringFrame] = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+        ringFrame = (ringFrame + 1) % RingFrames;
+
+        submitMicroseconds += PerfGetMicrosecond() - t0;
+        submitDraws += numObjects;
+        frameCounter++;
+    }
+    glFinish();
+}
+
+static void PerfDraw(int mode, int objectCount)
+{
+    static const struct{
+        const char *name;
+        PerfRateFunc func;
+    }tests[] = {
+        { "glUniform per draw", DrawUniform },
+        { "UBO per draw", DrawUBOPerDraw },
+        { "large UBO + glBindBufferRange", DrawLargeUBO },
+        { "persistent mapped UBO ring", DrawPersistentRing },
+    };
+
+    for( int c = 0; c < (int)(sizeof(ObjectCounts)/sizeof(ObjectCounts[0])); c++ ){
+        numObjects = ObjectCounts[c];
+        if( objectCount != -1 ){
+            if( c > 0 )
+                break;
+            numObjects = objectCount;
+        }
+
+        printf("%d objects:\n", numObjects);
+        for( int m = 0; m < (int)(sizeof(tests)/sizeof(tests[0])); m++ ){
+            if( mode != -1 && mode != m )
+                continue;
+
+            if( m == 3 && !hasBufferStorage ){
+                printf("  %-32s: not supported, no buffer_storage\n", tests[m].name);
+                continue;
+            }
+
+            glClear( GL_COLOR_BUFFER_BIT );
+            submitMicroseconds = 0;
+            submitDraws = 0;
+
+            const double rate = PerfMeasureRate( tests[m].func, eglx_PollEvents );
+            printf("  %-32s: %s frames/sec, %s draws/sec, CPU submit %.3f us/draw\n",
+                   tests[m].name, PerfHumanFloat(rate), PerfHumanFloat(rate * numObjects),
+                   (double)submitMicroseconds / submitDraws);
+            eglx_SwapBuffers();
+        }
+    }
+
+    glErrorCheck();
+    exit(0);
+}
+
+int main( int argc, const char* argv[] )
+{
+    Api = apiInitial( API_AnyShader, argc, argv );
+    printf("%s: %s\n", argv[0], apiName(Api));
+
+    int __mode = integerFromArgs("--mode", argc, argv, NULL );
+    // "--objects -5" is not a number for integerFromArgs(): reject it rather than test all counts
+    int hasObjects;
+    int __objects = integerFromArgs("--objects", argc, argv, &hasObjects );
+    if( argsContain("--objects", argc, argv) && (!hasObjects || __objects < 1 || __objects > MaxObjects) ){
+        printf("--objects must be in [1, %d]\n", MaxObjects);
+        exit(EXIT_FAILURE);
+    }
+
+    // initialize and configure
+    // ------------------------------
+    eglx_CreateWindow( Api, WinWidth, WinHeight );
+
+    // init
+    // -----------
+    PerfInit();
+
+    // render loop
+    // -----------
+    while (!eglx_ShouldClose())
+    {
+        // render
+        // ------
+        PerfDraw( __mode, __objects );
+
+        // swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
+        // -------------------------------------------------------------------------------
+        eglx_SwapBuffers();
+        eglx_PollEvents();
+    }
+
+    // terminate, clearing all previously allocated resources.
+    // ------------------------------------------------------------------
+    eglx_Terminate();
+    return 0;
+}
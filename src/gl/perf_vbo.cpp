@@ -1,6 +1,7 @@
 /**
  * Measure VBO upload speed.
  * That is, measure glBufferData() and glBufferSubData().
+ * One build for all apis: --api gl30 (glLegacy), gl33 or gles32
  */
 #include <stdio.h>
 #include <string.h>
@@ -18,6 +19,7 @@ static const int WinHeight = 200;
 // Copy data out of a large array to avoid caching effects:
 #define DATA_SIZE (16*1024*1024)
 
+static api_t Api;
 static GLuint VAO;
 static GLuint VBO;
 static GLuint program;
@@ -28,28 +30,18 @@ static GLint vPos_location;
 
 static const GLfloat Vertex0[2] = { 0.0, 0.0 };
 
-const char *vertexShaderSource =
-#if IS_GlEs
-    "#version 320 es\n"
-#else
-    "#version 330\n"
-#endif
+// #version is glslVersion( Api )
+const char *vertexShaderBody =
     "layout (location = 0) in vec2 vPos;\n"
     "void main()\n"
     "{\n"
     "   gl_Position = vec4( vPos.x, vPos.y, 0.0f, 1.0f );\n"
-#if IS_GlEs
+    "#ifdef GL_ES\n"
     "   gl_PointSize = 1.0;\n" // make IMG gpu happy
-#endif
+    "#endif\n"
     "}\n\0";
 
-const char *fragmentShaderSource =
-#if IS_GlEs
-    "#version 320 es\n"
-    "precision mediump float;\n"
-#else
-    "#version 330\n"
-#endif
+const char *fragmentShaderBody =
     "layout (location = 0) out vec4 outColor;\n"
     "void main()\n"
     "{\n"
@@ -60,32 +52,32 @@ static void PerfInit()
 {
     // build and compile our shader program
     // ------------------------------------
-#if !IS_GlLegacy
-    program = CreateProgramFromSource( vertexShaderSource, fragmentShaderSource );
-    glUseProgram(program);
-#endif
+    if( Api.api != API_GLLegacy ){
+        program = CreateProgramFromBody( Api, vertexShaderBody, fragmentShaderBody );
+        glUseProgram(program);
+    }
 
     // set up vertex data (and buffer(s)) and configure vertex attributes
     // ------------------------------------------------------------------
-#if IS_GlLegacy
-    glGenBuffers(1, &VBO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-
-    glVertexPointer(2, GL_FLOAT, sizeof(Vertex0), (void *) 0);
-    glEnableClientState(GL_VERTEX_ARRAY);
-#else
-    glGenVertexArrays(1, &VAO);
-    glBindVertexArray(VAO);
-
-    glGenBuffers(1, &VBO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-
-    vPos_location = glGetAttribLocation(program, "vPos");
-    printf("Attrib location: vPos=%d\n", vPos_location);
-    glVertexAttribPointer(vPos_location, 2, GL_FLOAT, GL_FALSE,
-                          sizeof(Vertex0), (void*) 0);
-    glEnableVertexAttribArray(vPos_location);
-#endif
+    if( Api.api == API_GLLegacy ){
+        glGenBuffers(1, &VBO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+
+        glVertexPointer(2, GL_FLOAT, sizeof(Vertex0), (void *) 0);
+        glEnableClientState(GL_VERTEX_ARRAY);
+    }else{
+        glGenVertexArrays(1, &VAO);
+        glBindVertexArray(VAO);
+
+        glGenBuffers(1, &VBO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+
+        vPos_location = glGetAttribLocation(program, "vPos");
+        printf("Attrib location: vPos=%d\n", vPos_location);
+        glVertexAttribPointer(vPos_location, 2, GL_FLOAT, GL_FALSE,
+                              sizeof(Vertex0), (void*) 0);
+        glEnableVertexAttribArray(vPos_location);
+    }
 
     // misc GL state
     // ------------------------------------------------------------------
@@ -164,6 +156,7 @@ static void BatchUploadSubVBO(unsigned count)
  *    draw
  *    destroy VBO
  */
+template<int API>
 static void CreateDrawDestroyVBO(unsigned count)
 {
     unsigned i;
@@ -175,12 +168,11 @@ static void CreateDrawDestroyVBO(unsigned count)
         glBufferData(GL_ARRAY_BUFFER, VBOSize, VBOData, GL_STREAM_DRAW);
 
         /* draw */
-#if IS_GlLegacy
-        glVertexPointer(2, GL_FLOAT, sizeof(Vertex0), (void *) 0);
-#else
-        glVertexAttribPointer(vPos_location, 2, GL_FLOAT, GL_FALSE,
-                              sizeof(Vertex0), (void*) 0);
-#endif
+        if constexpr( API == API_GLLegacy )
+            glVertexPointer(2, GL_FLOAT, sizeof(Vertex0), (void *) 0);
+        else
+            glVertexAttribPointer(vPos_location, 2, GL_FLOAT, GL_FALSE,
+                                  sizeof(Vertex0), (void*) 0);
         glDrawArrays(GL_POINTS, 0, 1);
 
         /* destroy */
@@ -269,7 +261,7 @@ static void PerfDraw()
      */
     for (sz = 0; Sizes[sz]; sz++) {
         SubSize = VBOSize = Sizes[sz];
-        rate = PerfMeasureRate(CreateDrawDestroyVBO, eglx_PollEvents );
+        rate = PerfMeasureRate(API_Select(CreateDrawDestroyVBO, Api), eglx_PollEvents );
         mbPerSec = rate * VBOSize / (1024.0 * 1024.0);
         printf("  VBO Create/Draw/Destroy(size = %d): %.1f draws/sec, %.1f MB/sec\n",
                     VBOSize, rate, mbPerSec);
@@ -341,7 +333,7 @@ static void PerfDraw2( int mode, int Sizes_ )
      */
     if( mode == 3 ){
         SubSize = VBOSize = Sizes_;
-        rate = PerfMeasureRate(CreateDrawDestroyVBO, eglx_PollEvents );
+        rate = PerfMeasureRate(API_Select(CreateDrawDestroyVBO, Api), eglx_PollEvents );
         mbPerSec = rate * VBOSize / (1024.0 * 1024.0);
         printf("  VBO Create/Draw/Destroy(size = %d): %.1f draws/sec, %.1f MB/sec\n",
                VBOSize, rate, mbPerSec);
@@ -355,15 +347,15 @@ static void PerfDraw2( int mode, int Sizes_ )
 
 int main( int argc, const char* argv[] )
 {
-    api_t api = apiInitial( API_Current, argc, argv );
-    printf("%s: %s\n", argv[0], apiName(api));
+    Api = apiInitial( API_Current, argc, argv );
+    printf("%s: %s\n", argv[0], apiName(Api));
 
     int __mode = integerFromArgs("--mode", argc, argv, NULL );
     int __testcase = integerFromArgs( "--testcase", argc, argv, NULL );
 
     // initialize and configure
     // ------------------------------
-    eglx_CreateWindow( api, WinWidth, WinHeight );
+    eglx_CreateWindow( Api, WinWidth, WinHeight );
 
     // init
     // -----------
@@ -7,6 +7,7 @@
  *  - VBO glDrawElements
  *  - glDrawRangeElements
  *  - VBO glDrawRangeElements
+ * One build for all apis: --api gl30 (glLegacy), gl33 or gles32
  */
 #include <stdio.h>
 #include <string.h>
@@ -26,6 +27,7 @@ static const int WinHeight = 500;
 /** glVertex2/3/4 size */
 #define VERT_SIZE 4
 
+static api_t Api;
 static GLuint VAO;
 static GLuint VertexBO, ElementBO;
 static GLuint program;
@@ -39,28 +41,18 @@ static float *VertexData2 = NULL;
 static unsigned NumElements = MAX_VERTS;
 static GLuint *Elements = NULL;
 
-const char *vertexShaderSource =
-#if IS_GlEs
-    "#version 320 es\n"
-#else
-    "#version 330\n"
-#endif
+// #version is glslVersion( Api )
+const char *vertexShaderBody =
     "layout (location = 0) in vec2 vPos;\n"
     "void main()\n"
     "{\n"
     "   gl_Position = vec4( vPos.x, vPos.y, 0.0f, 1.0f );\n"
-#if IS_GlEs
+    "#ifdef GL_ES\n"
     "   gl_PointSize = 1.0;\n" // make IMG gpu happy
-#endif
+    "#endif\n"
     "}\n\0";
 
-const char *fragmentShaderSource =
-#if IS_GlEs
-    "#version 320 es\n"
-    "precision mediump float;\n"
-#else
-    "#version 330\n"
-#endif
+const char *fragmentShaderBody =
     "layout (location = 0) out vec4 outColor;\n"
     "void main()\n"
     "{\n"
@@ -108,66 +100,64 @@ void PerfInit()
 {
     // build and compile our shader program
     // ------------------------------------
-#if !IS_GlLegacy
-    program = CreateProgramFromSource( vertexShaderSource, fragmentShaderSource );
-    glUseProgram(program);
-#endif
+    if( Api.api != API_GLLegacy ){
+        program = CreateProgramFromBody( Api, vertexShaderBody, fragmentShaderBody );
+        glUseProgram(program);
+    }
 
     // set up vertex data (and buffer(s)) and configure vertex attributes
     // ------------------------------------------------------------------
     InitializeVertexData();
 
-#if IS_GlLegacy
-    /* setup VertexBO */
-    glGenBuffers(1, &VertexBO);
-    glBindBuffer(GL_ARRAY_BUFFER, VertexBO);
-    glBufferData(GL_ARRAY_BUFFER, NumVerts * VertBytes, VertexData, GL_STATIC_DRAW);
-
-    glEnableClientState(GL_VERTEX_ARRAY);
-
-    /* setup ElementBO */
-    glGenBuffers(1, &ElementBO);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ElementBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-                    NumElements * sizeof(GLuint), Elements, GL_STATIC_DRAW);
-#else
-    /*
-     * 关于VAO:
-     * 1. DrawArraysMem()测试里的glVertexAttribPointer需要工作在Client模式
-     *   a) OpenGL core profile 不支持该模式
-     *   b) OpenGL ES 支持该模式，方法是：
-     *        glBindVertexArray( 0 );             //注意, OpenGL core profile 不支持绑定0到VAO
-     *        glBindBuffer( GL_ARRAY_BUFFER, 0 );
-     *      并且，OpenGL ES的默认VAO是0
-     */
-    #if IS_GlEs
-    VAO = 0;
-    #else
-    glGenVertexArrays(1, &VAO);
-    #endif
-    glBindVertexArray(VAO);
-
-    /* setup VertexBO */
-    glGenBuffers(1, &VertexBO);
-    glBindBuffer(GL_ARRAY_BUFFER, VertexBO);
-    glBufferData(GL_ARRAY_BUFFER, NumVerts * VertBytes, VertexData, GL_STATIC_DRAW);
-
-    vPos_location = glGetAttribLocation(program, "vPos");
-    printf("Attrib location: vPos=%d\n", vPos_location);
-    glEnableVertexAttribArray(vPos_location);
-
-    /* setup ElementBO */
-    glGenBuffers(1, &ElementBO);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ElementBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, NumElements * sizeof(GLuint), Elements, GL_STATIC_DRAW);
-#endif
+    if( Api.api == API_GLLegacy ){
+        /* setup VertexBO */
+        glGenBuffers(1, &VertexBO);
+        glBindBuffer(GL_ARRAY_BUFFER, VertexBO);
+        glBufferData(GL_ARRAY_BUFFER, NumVerts * VertBytes, VertexData, GL_STATIC_DRAW);
+
+        glEnableClientState(GL_VERTEX_ARRAY);
+
+        /* setup ElementBO */
+        glGenBuffers(1, &ElementBO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ElementBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                        NumElements * sizeof(GLuint), Elements, GL_STATIC_DRAW);
+    }else{
+        /*
+         * 关于VAO:
+         * 1. DrawArraysMem()测试里的glVertexAttribPointer需要工作在Client模式
+         *   a) OpenGL core profile 不支持该模式
+         *   b) OpenGL ES 支持该模式，方法是：
+         *        glBindVertexArray( 0 );             //注意, OpenGL core profile 不支持绑定0到VAO
+         *        glBindBuffer( GL_ARRAY_BUFFER, 0 );
+         *      并且，OpenGL ES的默认VAO是0
+         */
+        if( Api.api == API_GLES )
+            VAO = 0;
+        else
+            glGenVertexArrays(1, &VAO);
+        glBindVertexArray(VAO);
+
+        /* setup VertexBO */
+        glGenBuffers(1, &VertexBO);
+        glBindBuffer(GL_ARRAY_BUFFER, VertexBO);
+        glBufferData(GL_ARRAY_BUFFER, NumVerts * VertBytes, VertexData, GL_STATIC_DRAW);
+
+        vPos_location = glGetAttribLocation(program, "vPos");
+        printf("Attrib location: vPos=%d\n", vPos_location);
+        glEnableVertexAttribArray(vPos_location);
+
+        /* setup ElementBO */
+        glGenBuffers(1, &ElementBO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ElementBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, NumElements * sizeof(GLuint), Elements, GL_STATIC_DRAW);
+    }
 
     // misc GL state
     // ------------------------------------------------------------------
 
 }
 
-#if IS_GlLegacy
 static void DrawImmediate(unsigned count)
 {
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
@@ -194,19 +184,18 @@ static void DrawImmediate(unsigned count)
     glFinish();
     eglx_SwapBuffers();
 }
-#endif
 
+template<int API>
 static void DrawArraysMem(unsigned count)
 {
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 
     //Client模式读取VertexData2，以便与非Client模式做区别
-#if IS_GlLegacy
-    glVertexPointer(VERT_SIZE, GL_FLOAT, VertBytes, VertexData2);
-#else
-    glVertexAttribPointer(vPos_location, 2, GL_FLOAT, GL_FALSE, VertBytes, VertexData2);
-#endif
+    if constexpr( API == API_GLLegacy )
+        glVertexPointer(VERT_SIZE, GL_FLOAT, VertBytes, VertexData2);
+    else
+        glVertexAttribPointer(vPos_location, 2, GL_FLOAT, GL_FALSE, VertBytes, VertexData2);
 
     for (int i = 0; i < count; i++) {
         glDrawArrays(GL_POINTS, 0, NumVerts);
@@ -216,16 +205,16 @@ static void DrawArraysMem(unsigned count)
     eglx_SwapBuffers();
 }
 
+template<int API>
 static void DrawArraysVBO(unsigned count)
 {
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
     glBindBuffer(GL_ARRAY_BUFFER, VertexBO);
 
-#if IS_GlLegacy
-    glVertexPointer(VERT_SIZE, GL_FLOAT, VertBytes, (void *) 0);
-#else
-    glVertexAttribPointer(vPos_location, 2, GL_FLOAT, GL_FALSE, VertBytes, (void*) 0);
-#endif
+    if constexpr( API == API_GLLegacy )
+        glVertexPointer(VERT_SIZE, GL_FLOAT, VertBytes, (void *) 0);
+    else
+        glVertexAttribPointer(vPos_location, 2, GL_FLOAT, GL_FALSE, VertBytes, (void*) 0);
 
     for (int i = 0; i < count; i++) {
         glDrawArrays(GL_POINTS, 0, NumVerts);
@@ -235,17 +224,17 @@ static void DrawArraysVBO(unsigned count)
     eglx_SwapBuffers();
 }
 
+template<int API>
 static void DrawElementsMem(unsigned count)
 {
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 
     //Client模式读取VertexData2，以便与非Client模式做区别
-#if IS_GlLegacy
-    glVertexPointer(VERT_SIZE, GL_FLOAT, VertBytes, VertexData2);
-#else
-    glVertexAttribPointer(vPos_location, 2, GL_FLOAT, GL_FALSE, VertBytes, VertexData2);
-#endif
+    if constexpr( API == API_GLLegacy )
+        glVertexPointer(VERT_SIZE, GL_FLOAT, VertBytes, VertexData2);
+    else
+        glVertexAttribPointer(vPos_location, 2, GL_FLOAT, GL_FALSE, VertBytes, VertexData2);
 
     for (int i = 0; i < count; i++) {
         glDrawElements(GL_POINTS, NumVerts, GL_UNSIGNED_INT, Elements);
@@ -255,16 +244,16 @@ static void DrawElementsMem(unsigned count)
     eglx_SwapBuffers();
 }
 
+template<int API>
 static void DrawElementsBO(unsigned count)
 {
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ElementBO);
     glBindBuffer(GL_ARRAY_BUFFER, VertexBO);
 
-#if IS_GlLegacy
-    glVertexPointer(VERT_SIZE, GL_FLOAT, VertBytes, (void *) 0);
-#else
-    glVertexAttribPointer(vPos_location, 2, GL_FLOAT, GL_FALSE, VertBytes, (void*) 0);
-#endif
+    if constexpr( API == API_GLLegacy )
+        glVertexPointer(VERT_SIZE, GL_FLOAT, VertBytes, (void *) 0);
+    else
+        glVertexAttribPointer(vPos_location, 2, GL_FLOAT, GL_FALSE, VertBytes, (void*) 0);
 
     for (int i = 0; i < count; i++) {
         glDrawElements(GL_POINTS, NumVerts, GL_UNSIGNED_INT, (void *) 0);
@@ -274,17 +263,17 @@ static void DrawElementsBO(unsigned count)
     eglx_SwapBuffers();
 }
 
+template<int API>
 static void DrawRangeElementsMem(unsigned count)
 {
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 
     //Client模式读取VertexData2，以便与非Client模式做区别
-#if IS_GlLegacy
-    glVertexPointer(VERT_SIZE, GL_FLOAT, VertBytes, VertexData2);
-#else
-    glVertexAttribPointer(vPos_location, 2, GL_FLOAT, GL_FALSE, VertBytes, VertexData2);
-#endif
+    if constexpr( API == API_GLLegacy )
+        glVertexPointer(VERT_SIZE, GL_FLOAT, VertBytes, VertexData2);
+    else
+        glVertexAttribPointer(vPos_location, 2, GL_FLOAT, GL_FALSE, VertBytes, VertexData2);
 
     for (int i = 0; i < count; i++) {
         glDrawRangeElements(GL_POINTS, 0, NumVerts - 1,
@@ -295,16 +284,16 @@ static void DrawRangeElementsMem(unsigned count)
     eglx_SwapBuffers();
 }
 
+template<int API>
 static void DrawRangeElementsBO(unsigned count)
 {
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ElementBO);
     glBindBuffer(GL_ARRAY_BUFFER, VertexBO);
 
-#if IS_GlLegacy
-    glVertexPointer(VERT_SIZE, GL_FLOAT, VertBytes, (void *) 0);
-#else
-    glVertexAttribPointer(vPos_location, 2, GL_FLOAT, GL_FALSE, VertBytes, (void*) 0);
-#endif
+    if constexpr( API == API_GLLegacy )
+        glVertexPointer(VERT_SIZE, GL_FLOAT, VertBytes, (void *) 0);
+    else
+        glVertexAttribPointer(vPos_location, 2, GL_FLOAT, GL_FALSE, VertBytes, (void*) 0);
 
     for (int i = 0; i < count; i++) {
         glDrawRangeElements(GL_POINTS, 0, NumVerts - 1,
@@ -320,60 +309,54 @@ static void PerfDraw( int mode )
     double rate;
     printf("Vertex rate (%d x Vertex%df)\n", NumVerts, VERT_SIZE);
 
-#if IS_GlLegacy
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    rate = PerfMeasureRate(DrawImmediate, eglx_PollEvents );
-    rate *= NumVerts;
-    printf("  Immediate mode: %s verts/sec\n", PerfHumanFloat(rate));
-#endif
+    if( Api.api == API_GLLegacy ){
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        rate = PerfMeasureRate(DrawImmediate, eglx_PollEvents );
+        rate *= NumVerts;
+        printf("  Immediate mode: %s verts/sec\n", PerfHumanFloat(rate));
+    }
 
-#if IS_GlLegacy || IS_GlEs
-    if( mode == -1 || mode == 0 ) {
+    if( Api.api != API_GL && (mode == -1 || mode == 0) ) {
         // OpenGL Core profile 不支持让VBO工作在client模式
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        rate = PerfMeasureRate(DrawArraysMem, eglx_PollEvents );
+        rate = PerfMeasureRate(API_Select(DrawArraysMem, Api), eglx_PollEvents );
         rate *= NumVerts;
         printf("  glDrawArrays: %s verts/sec\n", PerfHumanFloat(rate));
     }
-#endif
 
     if( mode == -1 || mode == 1 ) {
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        rate = PerfMeasureRate(DrawArraysVBO, eglx_PollEvents );
+        rate = PerfMeasureRate(API_Select(DrawArraysVBO, Api), eglx_PollEvents );
         rate *= NumVerts;
         printf("  VBO glDrawArrays: %s verts/sec\n", PerfHumanFloat(rate));
     }
 
-#if IS_GlLegacy || IS_GlEs
-    if( mode == -1 || mode == 2 ) {
+    if( Api.api != API_GL && (mode == -1 || mode == 2) ) {
         // OpenGL Core profile 不支持让VBO工作在client模式
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        rate = PerfMeasureRate(DrawElementsMem, eglx_PollEvents );
+        rate = PerfMeasureRate(API_Select(DrawElementsMem, Api), eglx_PollEvents );
         rate *= NumVerts;
         printf("  glDrawElements: %s verts/sec\n", PerfHumanFloat(rate));
     }
-#endif
 
     if( mode == -1 || mode == 3 ) {
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        rate = PerfMeasureRate(DrawElementsBO, eglx_PollEvents );
+        rate = PerfMeasureRate(API_Select(DrawElementsBO, Api), eglx_PollEvents );
         rate *= NumVerts;
         printf("  VBO glDrawElements: %s verts/sec\n", PerfHumanFloat(rate));
     }
 
-#if IS_GlLegacy || IS_GlEs
-    if( mode == -1 || mode == 4 ) {
+    if( Api.api != API_GL && (mode == -1 || mode == 4) ) {
         // OpenGL Core profile 不支持让VBO工作在client模式
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        rate = PerfMeasureRate(DrawRangeElementsMem, eglx_PollEvents );
+        rate = PerfMeasureRate(API_Select(DrawRangeElementsMem, Api), eglx_PollEvents );
         rate *= NumVerts;
         printf("  glDrawRangeElements: %s verts/sec\n", PerfHumanFloat(rate));
     }
-#endif
 
     if( mode == -1 || mode == 5 ) {
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        rate = PerfMeasureRate(DrawRangeElementsBO, eglx_PollEvents );
+        rate = PerfMeasureRate(API_Select(DrawRangeElementsBO, Api), eglx_PollEvents );
         rate *= NumVerts;
         printf("  VBO glDrawRangeElements: %s verts/sec\n", PerfHumanFloat(rate));
     }
@@ -384,14 +367,14 @@ static void PerfDraw( int mode )
 
 int main( int argc, const char* argv[] )
 {
-    api_t api = apiInitial( API_Current, argc, argv );
-    printf("%s: %s\n", argv[0], apiName(api));
+    Api = apiInitial( API_Current, argc, argv );
+    printf("%s: %s\n", argv[0], apiName(Api));
 
     int __mode = integerFromArgs("--mode", argc, argv, NULL );
 
     // initialize and configure
     // ------------------------------
-    eglx_CreateWindow( api, WinWidth, WinHeight );
+    eglx_CreateWindow( Api, WinWidth, WinHeight );
 
     // init
     // -----------
@@ -4,6 +4,7 @@
  *   method 1: glCopyTexImage2D from FBO source texture to destination texture
  *   method 2: glBlitFramebuffer from source FBO texture to destination FBO texture
  *   method 3: render source texture to destination FBO texture
+ * every destination is compared with the source on the GPU, --dump 1 also writes it to /tmp/dstN.png
  */
 #include <stdlib.h>
 #include <stdio.h>
@@ -20,6 +21,17 @@
 static const int WinWidth = 800;
 static const int WinHeight = 600;
 
+static void DumpTexture( GLuint texture, GLenum format, int width, int height, int channels, const char *filename )
+{
+    GLubyte* img = (GLubyte*) malloc( width * height * channels );
+    glBindTexture( GL_TEXTURE_2D, texture );
+    glGetTexImage( GL_TEXTURE_2D, 0, format, GL_UNSIGNED_BYTE, img );
+
+    stbi_write_png( filename, width, height, channels, img, width * channels );
+    printf("dump to %s\n", filename);
+    free( img );
+}
+
 int main( int argc, const char* argv[] )
 {
     api_t api = apiInitial( API_Current, argc, argv );
@@ -30,6 +42,7 @@ int main( int argc, const char* argv[] )
     int imgWidth, imgHeight, imgChannels;
     GLenum imgFormat;
     GLubyte *imgSrc = imageFromFile( imgFile, &imgWidth, &imgHeight, &imgFormat, &imgChannels );
+    int __dump = integerFromArgs( "--dump", argc, argv, NULL );
 
     stbi_flip_vertically_on_write( 1 );
     stbi_write_png("/tmp/src.png", imgWidth, imgHeight, imgChannels, imgSrc, imgWidth * imgChannels );
@@ -76,24 +89,22 @@ int main( int argc, const char* argv[] )
         GLuint texDst;
         glGenTextures( 1, &texDst );
         glBindTexture( GL_TEXTURE_2D, texDst );
+        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
 
         // copy
         glBindTexture( GL_TEXTURE_2D, texDst );
         glReadBuffer( GL_COLOR_ATTACHMENT0 );
         glCopyTexImage2D(GL_TEXTURE_2D, 0, imgFormat, 0, 0, imgWidth, imgHeight, 0 );
 
-        // compare dst, src
-        GLubyte* imgDst = (GLubyte*) malloc( imgWidth * imgHeight * imgChannels );
-        glBindTexture( GL_TEXTURE_2D, texDst );
-        glGetTexImage( GL_TEXTURE_2D, 0, imgFormat, GL_UNSIGNED_BYTE, imgDst );
-
-        stbi_write_png("/tmp/dst1.png", imgWidth, imgHeight, imgChannels, imgDst, imgWidth * imgChannels );
-        printf("dump to /tmp/dst1.png\n");
-        if( memcmp(imgDst, imgSrc, imgWidth * imgHeight * imgChannels) == 0 ){
-            printf("src and dst1 are the same\n\n");
-        }else{
-            printf("src and dst1 are diff !!!\n\n");
-        }
+        // compare dst, src on the GPU
+        ImageCompareResult result;
+        ImageCompare_Textures( texSrc, texDst, imgWidth, imgHeight, imgChannels, &result );
+        ImageCompare_Print( "src and dst1", &result );
+        printf("\n");
+
+        if( __dump == 1 )
+            DumpTexture( texDst, imgFormat, imgWidth, imgHeight, imgChannels, "/tmp/dst1.png" );
         glErrorCheck();
     }
 
@@ -117,6 +128,8 @@ int main( int argc, const char* argv[] )
         glBindTexture( GL_TEXTURE_2D, texDst );
         glTexImage2D( GL_TEXTURE_2D, 0, imgFormat,imgWidth, imgHeight,
                       0, imgFormat, GL_UNSIGNED_BYTE, NULL );
+        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
 
         GLuint fboDst;
         glGenFramebuffers( 1, &fboDst );
@@ -133,18 +146,14 @@ int main( int argc, const char* argv[] )
                            0, 0, imgWidth, imgHeight,
                            GL_COLOR_BUFFER_BIT, GL_NEAREST );
 
-        // compare dst, src
-        GLubyte* imgDst = (GLubyte*) malloc( imgWidth * imgHeight * imgChannels );
-        glBindTexture( GL_TEXTURE_2D, texDst );
-        glGetTexImage( GL_TEXTURE_2D, 0, imgFormat, GL_UNSIGNED_BYTE, imgDst );
-
-        stbi_write_png("/tmp/dst2.png", imgWidth, imgHeight, imgChannels, imgDst, imgWidth * imgChannels );
-        printf("dump to /tmp/dst2.png\n");
-        if( memcmp(imgDst, imgSrc, imgWidth * imgHeight * imgChannels) == 0 ){
-            printf("src and dst2 are the same\n\n");
-        }else{
-            printf("src and dst2 are diff !!!\n\n");
-        }
+        // compare dst, src on the GPU
+        ImageCompareResult result;
+        ImageCompare_Textures( texSrc, texDst, imgWidth, imgHeight, imgChannels, &result );
+        ImageCompare_Print( "src and dst2", &result );
+        printf("\n");
+
+        if( __dump == 1 )
+            DumpTexture( texDst, imgFormat, imgWidth, imgHeight, imgChannels, "/tmp/dst2.png" );
         glErrorCheck();
     }
 
@@ -222,6 +231,8 @@ int main( int argc, const char* argv[] )
         glBindTexture( GL_TEXTURE_2D, texDst );
         glTexImage2D( GL_TEXTURE_2D, 0, imgFormat,imgWidth, imgHeight,
                       0, imgFormat, GL_UNSIGNED_BYTE, NULL );
+        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
 
         GLuint fboDst;
         glGenFramebuffers( 1, &fboDst );
@@ -246,18 +257,14 @@ int main( int argc, const char* argv[] )
         glDrawBuffer( GL_COLOR_ATTACHMENT0 );
         glDrawElements( GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, indices );
 
-        // compare dst, src
-        GLubyte* imgDst = (GLubyte*) malloc( imgWidth * imgHeight * imgChannels );
-        glBindTexture( GL_TEXTURE_2D, texDst );
-        glGetTexImage( GL_TEXTURE_2D, 0, imgFormat, GL_UNSIGNED_BYTE, imgDst );
-
-        stbi_write_png("/tmp/dst3.png", imgWidth, imgHeight, imgChannels, imgDst, imgWidth * imgChannels );
-        printf("dump to /tmp/dst3.png\n");
-        if( memcmp(imgDst, imgSrc, imgWidth * imgHeight * imgChannels) == 0 ){
-            printf("src and dst3 are the same\n\n");
-        }else{
-            printf("src and dst3 are diff !!!\n\n");
-        }
+        // compare dst, src on the GPU
+        ImageCompareResult result;
+        ImageCompare_Textures( texSrc, texDst, imgWidth, imgHeight, imgChannels, &result );
+        ImageCompare_Print( "src and dst3", &result );
+        printf("\n");
+
+        if( __dump == 1 )
+            DumpTexture( texDst, imgFormat, imgWidth, imgHeight, imgChannels, "/tmp/dst3.png" );
         glErrorCheck();
     }
 
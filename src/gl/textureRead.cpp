@@ -80,13 +80,11 @@ int main( int argc, const char* argv[] )
     stbi_write_png("/tmp/dst.png", imgWidth, imgHeight, imgChannels, imageDst, imgWidth * imgChannels );
     printf("dump to /tmp/dst.png\n");
 
-    // compare result
-    if( memcmp(imageDst, imgData, imgWidth * imgHeight * imgChannels) == 0 ){
-        printf("src and dst are the same\n");
-    }else{
-        printf("src and dst are diff !!!\n");
+    // compare result, the readback itself is what is tested, so on the CPU
+    ImageCompareResult result;
+    ImageCompare_CPU( imageDst, imgWidth * imgChannels, imgData, imgWidth * imgChannels, imgWidth, imgHeight, imgChannels, &result );
+    if( !ImageCompare_Print( "src and dst", &result ) )
         exit(1);
-    }
 
     // CPU read texture by glGetTexImage
     // ------------------------------------
@@ -98,12 +96,9 @@ int main( int argc, const char* argv[] )
     stbi_write_png("/tmp/dst2.png", imgWidth, imgHeight, imgChannels, imageDst2, imgWidth * imgChannels );
     printf("\ndump to /tmp/dst2.png\n");
 
-    if( memcmp(imageDst2, imgData, imgWidth * imgHeight * imgChannels) == 0 ){
-        printf("src and dst2 are the same\n");
-    }else{
-        printf("src and dst2 are diff !!!\n");
+    ImageCompare_CPU( imageDst2, imgWidth * imgChannels, imgData, imgWidth * imgChannels, imgWidth, imgHeight, imgChannels, &result );
+    if( !ImageCompare_Print( "src and dst2", &result ) )
         exit(1);
-    }
 #endif
 
     // render loop
@@ -1,5 +1,5 @@
 /*
- * Verify glCopyTex[Sub]Image()
+ * Verify glCopyTex[Sub]Image(), the copy is compared with its source on the GPU
  */
 #include <stdlib.h>
 #include <stdio.h>
@@ -85,14 +85,17 @@ static void test( int texSize, int repeat, int mode, int dump )
         }
         t += PerfGetSecond() - t0;
 
-        // verify by comparing dst, src
-        glBindTexture( GL_TEXTURE_2D, texDst );
-        glGetTexImage( GL_TEXTURE_2D, 0, imgFormat, GL_UNSIGNED_BYTE, imgDst );
-        if( memcmp( imgSrc2, imgDst, texSize * texSize * imgChannels) != 0 ){
-            printf("src2 and dst are diff !!!\n\n");
+        // verify by comparing dst, src on the GPU, only the metrics are read back
+        ImageCompareResult result;
+        ImageCompare_Textures( texSrc, texDst, texSize, texSize, imgChannels, &result );
+        if( result.mismatches != 0 ){
+            ImageCompare_Print( "src2 and dst", &result );
+            printf("\n");
         }
 
         if( dump == 1 ) {
+            glBindTexture( GL_TEXTURE_2D, texDst );
+            glGetTexImage( GL_TEXTURE_2D, 0, imgFormat, GL_UNSIGNED_BYTE, imgDst );
             sprintf(filename, "/tmp/%d_dst%02d.jpg", texSize, i);
             stbi_write_jpg(filename, texSize, texSize, imgChannels, imgDst, 90);
             printf("dump to %s\n", filename);
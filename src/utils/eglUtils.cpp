@@ -4,23 +4,30 @@
 #include <EGL/eglext.h>
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "eglUtils.h"
 #include "x11Utils.h"
+#include "glUtils.h"
+#include "perfTrace.h"
+
+struct eglContext_s{
+    EGLConfig config;
+    EGLContext context;
+    EGLSurface surface;
+};
 
-static EGLNativeDisplayType eglNativeDisplay = NULL;
-static EGLNativeWindowType  eglNativeWindow = NULL;
 static EGLDisplay eglDisplay = EGL_NO_DISPLAY;
-static EGLContext eglContext = EGL_NO_CONTEXT;
-static EGLSurface eglSurface = EGL_NO_SURFACE;
+static eglContext_t *defaultContext = NULL;
 static int shouldClose = 0;
 
-int egl_CreateContext( api_t api, void* nativeDisplayPtr, void* nativeWindowPtr )
+static int egl_InitializeDisplay( void* nativeDisplayPtr )
 {
-    eglNativeWindow = (EGLNativeWindowType) nativeWindowPtr;
-    eglNativeDisplay = (EGLNativeDisplayType) nativeDisplayPtr;
+    if( eglDisplay != EGL_NO_DISPLAY )
+        return 1;
 
-    eglDisplay = eglGetDisplay( eglNativeDisplay );
+    eglDisplay = eglGetDisplay( (EGLNativeDisplayType) nativeDisplayPtr );
     if( eglDisplay == EGL_NO_DISPLAY ){
         printf("%s: eglGetDisplay() fail\n", __func__);
         return 0;
@@ -32,8 +39,20 @@ int egl_CreateContext( api_t api, void* nativeDisplayPtr, void* nativeWindowPtr
     EGLint minorVersion;
     if( !eglInitialize ( eglDisplay, &majorVersion, &minorVersion )){
         printf("%s: eglInitialize() fail\n", __func__);
+        eglDisplay = EGL_NO_DISPLAY;
         return 0;
     }
+    return 1;
+}
+
+eglContext_t* egl_CreateContextEx( api_t api, void* nativeDisplayPtr, void* nativeWindowPtr, int width, int height, eglContext_t *shareContext )
+{
+    if( !egl_InitializeDisplay( nativeDisplayPtr ) )
+        return NULL;
+
+    eglContext_t *ctx = (eglContext_t*) calloc( 1, sizeof(eglContext_t) );
+    ctx->context = EGL_NO_CONTEXT;
+    ctx->surface = EGL_NO_SURFACE;
 
     // Choose config
     // --------------------
@@ -50,24 +69,37 @@ int egl_CreateContext( api_t api, void* nativeDisplayPtr, void* nativeWindowPtr
         EGL_CONFORMANT, EGL_OPENGL_ES3_BIT_KHR,
         EGL_NONE
     };
+    if( nativeWindowPtr == NULL ){
+        attribList[13] = EGL_PBUFFER_BIT;
+    }
     if( api.api == API_GLLegacy || api.api == API_GL ){
         attribList[15] = EGL_OPENGL_BIT;
         attribList[17] = EGL_OPENGL_BIT;
     }
-    EGLConfig config;
-    if( !eglChooseConfig( eglDisplay, attribList, &config, 1, &numConfigs )
+    if( !eglChooseConfig( eglDisplay, attribList, &ctx->config, 1, &numConfigs )
         || numConfigs < 1 )
     {
         printf("%s: eglChooseConfig() fail\n", __func__);
-        return 0;
+        free( ctx );
+        return NULL;
     }
 
     // Create a surface
     // --------------------
-    eglSurface = eglCreateWindowSurface ( eglDisplay, config, eglNativeWindow, NULL );
-    if( eglSurface == EGL_NO_SURFACE ){
-        printf("%s: eglCreateWindowSurface() fail\n", __func__);
-        return 0;
+    if( nativeWindowPtr ){
+        ctx->surface = eglCreateWindowSurface ( eglDisplay, ctx->config, (EGLNativeWindowType) nativeWindowPtr, NULL );
+    }else{
+        const EGLint pbufferAttribs[] = {
+            EGL_WIDTH, width,
+            EGL_HEIGHT, height,
+            EGL_NONE
+        };
+        ctx->surface = eglCreatePbufferSurface( eglDisplay, ctx->config, pbufferAttribs );
+    }
+    if( ctx->surface == EGL_NO_SURFACE ){
+        printf("%s: %s() fail\n", __func__, nativeWindowPtr ? "eglCreateWindowSurface" : "eglCreatePbufferSurface");
+        free( ctx );
+        return NULL;
     }
 
     // Create a GL context
@@ -87,32 +119,239 @@ int egl_CreateContext( api_t api, void* nativeDisplayPtr, void* nativeWindowPtr
         contextAttribs[5] = EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT;
         contextAttribs[6] = EGL_NONE;
     }
-    eglContext = eglCreateContext ( eglDisplay, config, EGL_NO_CONTEXT, contextAttribs );
-    if( eglContext == EGL_NO_CONTEXT ){
+    ctx->context = eglCreateContext ( eglDisplay, ctx->config, shareContext ? shareContext->context : EGL_NO_CONTEXT, contextAttribs );
+    if( ctx->context == EGL_NO_CONTEXT ){
         printf("%s: eglCreateContext() fail\n", __func__);
+        eglDestroySurface( eglDisplay, ctx->surface );
+        free( ctx );
+        return NULL;
+    }
+
+    return ctx;
+}
+
+int egl_MakeCurrent( eglContext_t *ctx )
+{
+    EGLBoolean ok;
+    if( ctx )
+        ok = eglMakeCurrent( eglDisplay, ctx->surface, ctx->surface, ctx->context );
+    else
+        ok = eglMakeCurrent( eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT );
+
+    if( !ok ){
+        printf("%s: eglMakeCurrent() fail\n", __func__);
         return 0;
     }
+    return 1;
+}
+
+void egl_SwapBuffersEx( eglContext_t *ctx )
+{
+    PerfTraceScope scope( "eglSwapBuffers" );
+    eglSwapBuffers( eglDisplay, ctx->surface );
+}
+
+void egl_DestroyContext( eglContext_t *ctx )
+{
+    if( ctx == NULL )
+        return;
+
+    if( eglGetCurrentContext() == ctx->context )
+        eglMakeCurrent( eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT );
+    eglDestroyContext( eglDisplay, ctx->context );
+    eglDestroySurface( eglDisplay, ctx->surface );
+    free( ctx );
+}
+
+eglContext_t* egl_GetDefaultContext()
+{
+    return defaultContext;
+}
+
+int egl_LoadGL()
+{
+    EGLint clientType = EGL_OPENGL_API;
+    eglQueryContext( eglGetCurrentDisplay(), eglGetCurrentContext(), EGL_CONTEXT_CLIENT_TYPE, &clientType );
+    return LoadGLFunctions( eglGetProcAddress, clientType == EGL_OPENGL_ES_API );
+}
+
+int egl_CreateContext( api_t api, void* nativeDisplayPtr, void* nativeWindowPtr )
+{
+    defaultContext = egl_CreateContextEx( api, nativeDisplayPtr, nativeWindowPtr, 0, 0, NULL );
+    if( defaultContext == NULL )
+        return 0;
 
     // Make the context current
     // --------------------
-    if( !eglMakeCurrent ( eglDisplay, eglSurface,eglSurface, eglContext )){
-        printf("%s: eglMakeCurrent() fail\n", __func__);
+    return egl_MakeCurrent( defaultContext );
+}
+
+void egl_SwapBuffers()
+{
+    egl_SwapBuffersEx( defaultContext );
+}
+
+void egl_Terminate()
+{
+    egl_DestroyContext( defaultContext );
+    defaultContext = NULL;
+    eglTerminate( eglDisplay );
+    eglDisplay = EGL_NO_DISPLAY;
+}
+
+int egl_SwapInterval( int interval )
+{
+    if( !eglSwapInterval( eglDisplay, interval ) ){
+        printf("%s: eglSwapInterval(%d) fail\n", __func__, interval);
+        return 0;
+    }
+    return 1;
+}
+
+int egl_HasExtension( const char *name )
+{
+    const char *extensions = eglQueryString( eglDisplay, EGL_EXTENSIONS );
+    if( extensions == NULL )
         return 0;
+
+    const size_t len = strlen( name );
+    for( const char *p = extensions; (p = strstr( p, name )) != NULL; p += len ){
+        if( (p == extensions || p[-1] == ' ') && (p[len] == ' ' || p[len] == '\0') )
+            return 1;
     }
+    return 0;
+}
+
+static PFNEGLGETNEXTFRAMEIDANDROIDPROC _eglGetNextFrameIdANDROID = NULL;
+static PFNEGLGETFRAMETIMESTAMPSANDROIDPROC _eglGetFrameTimestampsANDROID = NULL;
+
+int egl_EnableFrameTimestamps()
+{
+    if( !egl_HasExtension( "EGL_ANDROID_get_frame_timestamps" ) )
+        return 0;
+
+    _eglGetNextFrameIdANDROID = (PFNEGLGETNEXTFRAMEIDANDROIDPROC) eglGetProcAddress( "eglGetNextFrameIdANDROID" );
+    _eglGetFrameTimestampsANDROID = (PFNEGLGETFRAMETIMESTAMPSANDROIDPROC) eglGetProcAddress( "eglGetFrameTimestampsANDROID" );
+    if( !_eglGetNextFrameIdANDROID || !_eglGetFrameTimestampsANDROID )
+        return 0;
+
+    return eglSurfaceAttrib( eglDisplay, defaultContext->surface, EGL_TIMESTAMPS_ANDROID, EGL_TRUE );
+}
 
+int egl_GetNextFrameId( uint64_t *frameId )
+{
+    EGLuint64KHR id;
+    if( !_eglGetNextFrameIdANDROID || !_eglGetNextFrameIdANDROID( eglDisplay, defaultContext->surface, &id ) )
+        return 0;
+    *frameId = id;
     return 1;
 }
 
-void egl_SwapBuffers()
+int egl_GetFramePresentTime( uint64_t frameId, int64_t *presentTimeNs )
 {
-    eglSwapBuffers( eglDisplay, eglSurface );
+    const EGLint names[] = { EGL_DISPLAY_PRESENT_TIME_ANDROID };
+    EGLnsecsANDROID value;
+    if( !_eglGetFrameTimestampsANDROID
+        || !_eglGetFrameTimestampsANDROID( eglDisplay, defaultContext->surface, frameId, 1, names, &value ) )
+        return 0;
+    if( value == EGL_TIMESTAMP_PENDING_ANDROID || value == EGL_TIMESTAMP_INVALID_ANDROID )
+        return 0;
+    *presentTimeNs = value;
+    return 1;
 }
 
-void egl_Terminate()
+static PFNEGLSWAPBUFFERSWITHDAMAGEKHRPROC _eglSwapBuffersWithDamage = NULL;
+static PFNEGLSETDAMAGEREGIONKHRPROC _eglSetDamageRegionKHR = NULL;
+static int damageSupport = -1;
+
+int egl_DamageSupport()
+{
+    if( damageSupport != -1 )
+        return damageSupport;
+
+    damageSupport = 0;
+    if( egl_HasExtension( "EGL_KHR_swap_buffers_with_damage" ) )
+        _eglSwapBuffersWithDamage = (PFNEGLSWAPBUFFERSWITHDAMAGEKHRPROC) eglGetProcAddress( "eglSwapBuffersWithDamageKHR" );
+    else if( egl_HasExtension( "EGL_EXT_swap_buffers_with_damage" ) )
+        _eglSwapBuffersWithDamage = (PFNEGLSWAPBUFFERSWITHDAMAGEKHRPROC) eglGetProcAddress( "eglSwapBuffersWithDamageEXT" );
+    if( _eglSwapBuffersWithDamage )
+        damageSupport |= EGL_Damage_SwapWithDamage;
+
+    if( egl_HasExtension( "EGL_KHR_partial_update" ) ){
+        _eglSetDamageRegionKHR = (PFNEGLSETDAMAGEREGIONKHRPROC) eglGetProcAddress( "eglSetDamageRegionKHR" );
+        if( _eglSetDamageRegionKHR )
+            damageSupport |= EGL_Damage_PartialUpdate | EGL_Damage_BufferAge;
+    }
+    if( egl_HasExtension( "EGL_EXT_buffer_age" ) )
+        damageSupport |= EGL_Damage_BufferAge;
+
+    return damageSupport;
+}
+
+int egl_QueryBufferAge()
+{
+    EGLint age = 0;
+    if( !(egl_DamageSupport() & EGL_Damage_BufferAge)
+        || !eglQuerySurface( eglDisplay, defaultContext->surface, EGL_BUFFER_AGE_EXT, &age ) )
+        return 0;
+    return age;
+}
+
+void egl_SetDamageRegion( const eglRect_t *rects, int numRects )
+{
+    if( egl_DamageSupport() & EGL_Damage_PartialUpdate )
+        _eglSetDamageRegionKHR( eglDisplay, defaultContext->surface, (EGLint*) rects, numRects );
+}
+
+void egl_SwapBuffersWithDamage( const eglRect_t *rects, int numRects )
 {
-    eglDestroyContext(eglDisplay, eglContext);
-    eglDestroySurface(eglDisplay, eglSurface);
-    eglTerminate(eglDisplay);
+    PerfTraceScope scope( "eglSwapBuffers", "rects", numRects );
+    if( egl_DamageSupport() & EGL_Damage_SwapWithDamage )
+        _eglSwapBuffersWithDamage( eglDisplay, defaultContext->surface, (const EGLint*) rects, numRects );
+    else
+        eglSwapBuffers( eglDisplay, defaultContext->surface );
+}
+
+eglRect_t egl_RectUnion( eglRect_t a, eglRect_t b )
+{
+    if( a.width <= 0 || a.height <= 0 )
+        return b;
+    if( b.width <= 0 || b.height <= 0 )
+        return a;
+
+    const int x0 = a.x < b.x ? a.x : b.x;
+    const int y0 = a.y < b.y ? a.y : b.y;
+    const int x1 = (a.x + a.width) > (b.x + b.width) ? (a.x + a.width) : (b.x + b.width);
+    const int y1 = (a.y + a.height) > (b.y + b.height) ? (a.y + a.height) : (b.y + b.height);
+    return { x0, y0, x1 - x0, y1 - y0 };
+}
+
+void DamageTracker_Init( DamageTracker *tracker, int surfaceWidth, int surfaceHeight )
+{
+    memset( tracker, 0, sizeof(*tracker) );
+    tracker->surfaceWidth = surfaceWidth;
+    tracker->surfaceHeight = surfaceHeight;
+}
+
+eglRect_t DamageTracker_RepaintRegion( const DamageTracker *tracker, int age, eglRect_t damage )
+{
+    // unknown content, or older than the history: repaint all
+    if( age <= 0 || age - 1 > tracker->numFrames )
+        return { 0, 0, tracker->surfaceWidth, tracker->surfaceHeight };
+
+    // the back buffer misses the damage of the last (age - 1) frames
+    eglRect_t region = damage;
+    for( int i = 0; i < age - 1; i++ )
+        region = egl_RectUnion( region, tracker->frames[(tracker->current - i + DamageTracker_MaxAge) % DamageTracker_MaxAge] );
+    return region;
+}
+
+void DamageTracker_EndFrame( DamageTracker *tracker, eglRect_t damage )
+{
+    tracker->current = (tracker->current + 1) % DamageTracker_MaxAge;
+    tracker->frames[tracker->current] = damage;
+    if( tracker->numFrames < DamageTracker_MaxAge )
+        tracker->numFrames++;
 }
 
 
@@ -135,11 +374,7 @@ void eglx_CreateWindow(api_t api, int width, int height )
 
     // glad loader
     // --------------------
-#if IS_GlEs
-    int version = gladLoadGLES2(eglGetProcAddress);
-#else
-    int version = gladLoadGL(eglGetProcAddress);
-#endif
+    int version = egl_LoadGL();
     printf("%s: glad load version: %d.%d\n", __func__, GLAD_VERSION_MAJOR(version), GLAD_VERSION_MINOR(version));
 
     // some queries
@@ -194,3 +429,8 @@ void eglx_SetWindowSize( int width, int height )
 {
     xWindowSetSize( width, height );
 }
+
+int eglx_WaitWindowSize( int width, int height, int timeoutMs )
+{
+    return xWindowWaitSize( width, height, timeoutMs );
+}
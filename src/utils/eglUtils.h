@@ -9,6 +9,73 @@
 int egl_CreateContext( api_t api, void* nativeDisplayPtr, void* nativeWindowPtr );
 void egl_SwapBuffers();
 void egl_Terminate();
+int egl_SwapInterval( int interval );     // of the current context, 0: no vsync
+int egl_HasExtension( const char *name );
+
+/*
+ * EGL_ANDROID_get_frame_timestamps of the default context, times are CLOCK_MONOTONIC nanoseconds.
+ * egl_GetFramePresentTime() returns 0 while the time is still pending, or if it is not supported.
+ */
+int egl_EnableFrameTimestamps();
+int egl_GetNextFrameId( uint64_t *frameId );
+int egl_GetFramePresentTime( uint64_t frameId, int64_t *presentTimeNs );
+
+/*
+ * EGL, explicit contexts: several contexts, one current per thread
+ *   nativeDisplayPtr: only used by the first context, all contexts share one EGLDisplay
+ *   nativeWindowPtr = NULL: render to a width x height pbuffer instead of a window
+ *   shareContext: share objects with it, NULL = a new share group
+ * glad function pointers are process wide: after egl_MakeCurrent() to a context of another api, reload them with
+ * egl_LoadGL(). A glad_gl build can drive GLES contexts too, see LoadGLFunctions().
+ */
+typedef struct eglContext_s eglContext_t;
+eglContext_t* egl_CreateContextEx( api_t api, void* nativeDisplayPtr, void* nativeWindowPtr, int width, int height, eglContext_t *shareContext );
+int egl_MakeCurrent( eglContext_t *ctx );  // NULL: release the context of the calling thread
+void egl_SwapBuffersEx( eglContext_t *ctx );
+void egl_DestroyContext( eglContext_t *ctx );
+eglContext_t* egl_GetDefaultContext();    // created by egl_CreateContext() / eglx_CreateWindow()
+int egl_LoadGL();                         // glad loader for the current context, return the glad version
+
+/*
+ * Damage-aware present, EGL_KHR/EXT_swap_buffers_with_damage, EGL_EXT_buffer_age, EGL_KHR_partial_update.
+ * Rects are in surface pixels, origin at the bottom-left like glScissor().
+ * A frame:
+ *   age = egl_QueryBufferAge();
+ *   region = DamageTracker_RepaintRegion( &tracker, age, damage );
+ *   egl_SetDamageRegion( &region, 1 );        // before the first draw
+ *   ... repaint region ...
+ *   egl_SwapBuffersWithDamage( &damage, 1 );
+ *   DamageTracker_EndFrame( &tracker, damage );
+ */
+typedef struct{
+    int x, y;
+    int width, height;
+}eglRect_t;
+
+#define EGL_Damage_SwapWithDamage  0x1
+#define EGL_Damage_BufferAge       0x2
+#define EGL_Damage_PartialUpdate   0x4
+
+int egl_DamageSupport();                 // EGL_Damage_XXX bits
+int egl_QueryBufferAge();                // 0: content unknown
+void egl_SetDamageRegion( const eglRect_t *rects, int numRects );
+void egl_SwapBuffersWithDamage( const eglRect_t *rects, int numRects );  // falls back to eglSwapBuffers()
+
+// bounding rect, an empty rect (width or height <= 0) adds nothing
+eglRect_t egl_RectUnion( eglRect_t a, eglRect_t b );
+
+// buffer age aware dirty rect tracker, one bounding rect per frame
+#define DamageTracker_MaxAge  4
+typedef struct{
+    eglRect_t frames[DamageTracker_MaxAge];  // damage of the last frames, ring
+    int current;
+    int numFrames;
+    int surfaceWidth, surfaceHeight;
+}DamageTracker;
+
+void DamageTracker_Init( DamageTracker *tracker, int surfaceWidth, int surfaceHeight );
+eglRect_t DamageTracker_RepaintRegion( const DamageTracker *tracker, int age, eglRect_t damage );
+void DamageTracker_EndFrame( DamageTracker *tracker, eglRect_t damage );
 
 // EGL + X11
 void eglx_CreateWindow(api_t api, int width, int height );
@@ -18,3 +85,4 @@ int eglx_ShouldClose();
 void eglx_PollEvents();
 void eglx_GetWindowSize( int *width, int *height );
 void eglx_SetWindowSize( int width, int height );
+int eglx_WaitWindowSize( int width, int height, int timeoutMs );  // 0 on timeout
@@ -0,0 +1,241 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include "glCommandBuffer.h"
+#include "glUtils.h"
+
+/*
+ * sort key layout, most significant first:
+ *   [63..52] program
+ *   [51..41] texture unit 0
+ *   [40..30] texture unit 1
+ *   [29..16] material
+ *   [15.. 0] depth
+ * GL object names are small integers in practice, so they are used directly (masked).
+ */
+#define KEY_ProgramShift   52
+#define KEY_Texture0Shift  41
+#define KEY_Texture1Shift  30
+#define KEY_MaterialShift  16
+
+static void CmdBuffer_Grow( CmdBuffer *cb, int capacity )
+{
+    cb->cmds = (DrawCmd*) realloc( cb->cmds, capacity * sizeof(DrawCmd) );
+    cb->keys = (uint64_t*) realloc( cb->keys, capacity * sizeof(uint64_t) );
+    cb->order = (uint32_t*) realloc( cb->order, capacity * sizeof(uint32_t) );
+    cb->tmpKeys = (uint64_t*) realloc( cb->tmpKeys, capacity * sizeof(uint64_t) );
+    cb->tmpOrder = (uint32_t*) realloc( cb->tmpOrder, capacity * sizeof(uint32_t) );
+    if( !cb->cmds || !cb->keys || !cb->order || !cb->tmpKeys || !cb->tmpOrder ){
+        printf("%s: out of memory, capacity = %d\n", __func__, capacity);
+        exit(EXIT_FAILURE);
+    }
+    cb->capacity = capacity;
+}
+
+void CmdBuffer_Init( CmdBuffer *cb, int capacity )
+{
+    memset( cb, 0, sizeof(*cb) );
+    CmdBuffer_Grow( cb, capacity > 0 ? capacity : 64 );
+    CmdBuffer_ResetStats( cb );
+}
+
+void CmdBuffer_Free( CmdBuffer *cb )
+{
+    free( cb->cmds );
+    free( cb->keys );
+    free( cb->order );
+    free( cb->tmpKeys );
+    free( cb->tmpOrder );
+    memset( cb, 0, sizeof(*cb) );
+}
+
+void CmdBuffer_Reset( CmdBuffer *cb )
+{
+    cb->count = 0;
+}
+
+void CmdBuffer_ResetStats( CmdBuffer *cb )
+{
+    memset( &cb->stats, 0, sizeof(cb->stats) );
+
+    // unknown state: the first submitted draw counts all its states as changes
+    cb->lastProgram = 0xFFFFFFFFu;
+    cb->lastVertexArray = 0xFFFFFFFFu;
+    for( int i=0; i < CmdBuffer_MaxTextures; i++ )
+        cb->lastTextures[i] = 0xFFFFFFFFu;
+}
+
+DrawCmd* CmdBuffer_Add( CmdBuffer *cb )
+{
+    if( cb->count == cb->capacity )
+        CmdBuffer_Grow( cb, cb->capacity * 2 );
+
+    const int i = cb->count++;
+    cb->order[i] = i;
+    cb->stats.recorded++;
+
+    DrawCmd *cmd = &cb->cmds[i];
+    memset( cmd, 0, offsetof(DrawCmd, uniforms) );
+    return cmd;
+}
+
+static CmdUniform* CmdBuffer_AddUniform( DrawCmd *cmd, GLint location, GLenum type )
+{
+    if( cmd->numUniforms >= CmdBuffer_MaxUniforms ){
+        printf("%s: too many uniforms, max = %d\n", __func__, CmdBuffer_MaxUniforms);
+        exit(EXIT_FAILURE);
+    }
+
+    CmdUniform *u = &cmd->uniforms[cmd->numUniforms++];
+    u->location = location;
+    u->type = type;
+    return u;
+}
+
+void CmdBuffer_AddUniform4fv( DrawCmd *cmd, GLint location, const GLfloat *value )
+{
+    CmdUniform *u = CmdBuffer_AddUniform( cmd, location, GL_FLOAT_VEC4 );
+    memcpy( u->value, value, 4 * sizeof(GLfloat) );
+    memset( u->value + 4, 0, 12 * sizeof(GLfloat) ); // so that whole uniforms compare in CmdBuffer_CanMerge()
+}
+
+void CmdBuffer_AddUniformMatrix4fv( DrawCmd *cmd, GLint location, const GLfloat *value )
+{
+    CmdUniform *u = CmdBuffer_AddUniform( cmd, location, GL_FLOAT_MAT4 );
+    memcpy( u->value, value, 16 * sizeof(GLfloat) );
+}
+
+uint64_t CmdBuffer_MakeKey( const DrawCmd *cmd )
+{
+    float depth = cmd->depth;
+    if( depth < 0.0f )
+        depth = 0.0f;
+    else if( depth > 1.0f )
+        depth = 1.0f;
+
+    return ((uint64_t)(cmd->program & 0xFFF) << KEY_ProgramShift)
+         | ((uint64_t)(cmd->textures[0] & 0x7FF) << KEY_Texture0Shift)
+         | ((uint64_t)(cmd->textures[1] & 0x7FF) << KEY_Texture1Shift)
+         | ((uint64_t)(cmd->material & 0x3FFF) << KEY_MaterialShift)
+         | (uint64_t)(depth * 0xFFFF);
+}
+
+/*
+ * LSD radix sort of (key, order) pairs, 8 bits per pass.
+ * Passes where every key has the same byte are skipped, so keys which only use a few
+ * fields cost only a few passes.
+ */
+void CmdBuffer_Sort( CmdBuffer *cb )
+{
+    const int n = cb->count;
+    if( n < 2 )
+        return;
+
+    for( int i=0; i < n; i++ ){
+        cb->keys[i] = CmdBuffer_MakeKey( &cb->cmds[i] );
+        cb->order[i] = i;
+    }
+
+    uint64_t *srcKeys = cb->keys, *dstKeys = cb->tmpKeys;
+    uint32_t *srcOrder = cb->order, *dstOrder = cb->tmpOrder;
+
+    for( int shift = 0; shift < 64; shift += 8 ){
+        uint32_t offsets[256] = { 0 };
+        for( int i=0; i < n; i++ )
+            offsets[(srcKeys[i] >> shift) & 0xFF]++;
+
+        if( offsets[(srcKeys[0] >> shift) & 0xFF] == (uint32_t)n )
+            continue;
+
+        uint32_t sum = 0;
+        for( int b=0; b < 256; b++ ){
+            const uint32_t c = offsets[b];
+            offsets[b] = sum;
+            sum += c;
+        }
+
+        for( int i=0; i < n; i++ ){
+            const uint32_t dst = offsets[(srcKeys[i] >> shift) & 0xFF]++;
+            dstKeys[dst] = srcKeys[i];
+            dstOrder[dst] = srcOrder[i];
+        }
+
+        uint64_t *k = srcKeys; srcKeys = dstKeys; dstKeys = k;
+        uint32_t *o = srcOrder; srcOrder = dstOrder; dstOrder = o;
+    }
+
+    if( srcKeys != cb->keys ){
+        memcpy( cb->keys, srcKeys, n * sizeof(uint64_t) );
+        memcpy( cb->order, srcOrder, n * sizeof(uint32_t) );
+    }
+}
+
+static int CmdBuffer_CanMerge( const DrawCmd *a, GLsizei aCount, const DrawCmd *b )
+{
+    if( a->mode != b->mode
+        || (a->mode != GL_POINTS && a->mode != GL_LINES && a->mode != GL_TRIANGLES) )
+        return 0;
+    if( a->first + aCount != b->first )
+        return 0;
+    if( a->program != b->program || a->vertexArray != b->vertexArray
+        || memcmp( a->textures, b->textures, sizeof(a->textures) ) != 0 )
+        return 0;
+    if( a->numUniforms != b->numUniforms
+        || memcmp( a->uniforms, b->uniforms, a->numUniforms * sizeof(CmdUniform) ) != 0 )
+        return 0;
+    return 1;
+}
+
+/*
+ * Replay the recorded draws, in sorted order if CmdBuffer_Sort() was called, then reset the buffer.
+ */
+void CmdBuffer_Submit( CmdBuffer *cb )
+{
+    int i = 0;
+    while( i < cb->count ){
+        const DrawCmd *cmd = &cb->cmds[cb->order[i++]];
+
+        // merge following draws which continue the same vertex range with the same states
+        GLsizei count = cmd->count;
+        while( i < cb->count && CmdBuffer_CanMerge( cmd, count, &cb->cmds[cb->order[i]] ) )
+            count += cb->cmds[cb->order[i++]].count;
+
+        // states
+        if( cmd->program != cb->lastProgram ){
+            cb->lastProgram = cmd->program;
+            cb->stats.stateChanges++;
+        }
+        StateCache_UseProgram( cmd->program );
+
+        if( cmd->vertexArray != cb->lastVertexArray ){
+            cb->lastVertexArray = cmd->vertexArray;
+            cb->stats.stateChanges++;
+        }
+        StateCache_BindVertexArray( cmd->vertexArray );
+
+        for( int t=0; t < CmdBuffer_MaxTextures; t++ ){
+            if( cmd->textures[t] == 0 )
+                continue;
+            if( cmd->textures[t] != cb->lastTextures[t] ){
+                cb->lastTextures[t] = cmd->textures[t];
+                cb->stats.stateChanges++;
+            }
+            StateCache_BindTexture( t, GL_TEXTURE_2D, cmd->textures[t] );
+        }
+
+        for( int u=0; u < cmd->numUniforms; u++ ){
+            const CmdUniform *uniform = &cmd->uniforms[u];
+            if( uniform->type == GL_FLOAT_MAT4 )
+                StateCache_UniformMatrix4fv( uniform->location, 1, GL_FALSE, uniform->value );
+            else
+                StateCache_Uniform4fv( uniform->location, 1, uniform->value );
+        }
+
+        // draw
+        glDrawArrays( cmd->mode, cmd->first, count );
+        cb->stats.submitted++;
+    }
+
+    CmdBuffer_Reset( cb );
+}
@@ -0,0 +1,66 @@
+#pragma once
+/*
+ * Deferred draw command buffer:
+ *   record draws, sort them by a 64-bit key (program, textures, material, depth),
+ *   merge compatible consecutive draws, then replay them through the GL state cache.
+ */
+#include <stdint.h>
+#include "glad.h"
+
+#define CmdBuffer_MaxTextures  2
+#define CmdBuffer_MaxUniforms  3
+
+typedef struct{
+    GLint location;
+    GLenum type;        // GL_FLOAT_VEC4 or GL_FLOAT_MAT4
+    GLfloat value[16];
+}CmdUniform;
+
+typedef struct{
+    GLuint program;
+    GLuint vertexArray;
+    GLuint textures[CmdBuffer_MaxTextures];  // GL_TEXTURE_2D bound to unit i, 0 = unit not used
+    GLuint material;                          // user defined, only used for ordering
+    GLfloat depth;                            // [0, 1], smaller is drawn first within the same state
+    int numUniforms;
+    CmdUniform uniforms[CmdBuffer_MaxUniforms];
+    GLenum mode;
+    GLint first;
+    GLsizei count;
+}DrawCmd;
+
+typedef struct{
+    uint64_t recorded;      // draws recorded
+    uint64_t submitted;     // glDrawArrays issued, after merging
+    uint64_t stateChanges;  // program, vertex array and texture changes between submitted draws
+}CmdBufferStats;
+
+typedef struct{
+    DrawCmd *cmds;
+    uint64_t *keys;
+    uint32_t *order;
+    uint64_t *tmpKeys;
+    uint32_t *tmpOrder;
+    int count;
+    int capacity;
+
+    // state of the last submitted draw, to count state changes
+    GLuint lastProgram;
+    GLuint lastVertexArray;
+    GLuint lastTextures[CmdBuffer_MaxTextures];
+
+    CmdBufferStats stats;
+}CmdBuffer;
+
+void CmdBuffer_Init( CmdBuffer *cb, int capacity );
+void CmdBuffer_Free( CmdBuffer *cb );
+void CmdBuffer_Reset( CmdBuffer *cb );
+void CmdBuffer_ResetStats( CmdBuffer *cb );
+
+DrawCmd* CmdBuffer_Add( CmdBuffer *cb );
+void CmdBuffer_AddUniform4fv( DrawCmd *cmd, GLint location, const GLfloat *value );
+void CmdBuffer_AddUniformMatrix4fv( DrawCmd *cmd, GLint location, const GLfloat *value );
+
+uint64_t CmdBuffer_MakeKey( const DrawCmd *cmd );
+void CmdBuffer_Sort( CmdBuffer *cb );
+void CmdBuffer_Submit( CmdBuffer *cb );
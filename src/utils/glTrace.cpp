@@ -0,0 +1,600 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <mutex>
+#include <type_traits>
+#include <unordered_map>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "glad.h"
+#include "glTrace.h"
+#include "perfTrace.h"
+
+/*
+ * What a call does to the state shadow of its thread
+ */
+enum{
+    TS_None,
+    TS_Enable,          // glEnable( cap )
+    TS_Disable,         // glDisable( cap )
+    TS_Global,          // one value of the context: all the arguments
+    TS_Keyed,           // one value per first argument, e.g. glBindBuffer( target, ... )
+    TS_Keyed2,          // one value per first 2 arguments, e.g. glUniformBlockBinding( program, index, ... )
+    TS_Texture,         // glBindTexture( target, ... ), per texture unit
+    TS_ActiveTexture,
+    TS_UseProgram,
+    TS_VertexArray,     // also changes the GL_ELEMENT_ARRAY_BUFFER binding
+    TS_BufferBase,      // glBindBufferBase/Range( target, index, buffer... ), also the glBindBuffer( target ) binding
+    TS_Framebuffer,     // GL_FRAMEBUFFER is both GL_DRAW_FRAMEBUFFER and GL_READ_FRAMEBUFFER
+    TS_Uniform,         // glUniformXX( location, ... ) of the current program
+    TS_UniformV,        // glUniformXXv( location, count, [transpose,] value ), floats per element in the table
+    TS_Invalidate,      // objects deleted or relinked, names may come back: forget everything
+};
+
+/*
+ * Uploads and readbacks, slices of the $PERF_TRACE timeline
+ */
+#define TL_None             0
+#define TL_Call             1               // a slice
+#define TL_Bytes( arg )     (2 + (arg))     // a slice, with the byte count of argument arg
+
+/*
+ * Traced entry points: X( name, state, floats per element, timeline ), the ones this repo calls.
+ * An entry point missing here is called directly, add it to trace it.
+ */
+#define GLTRACE_ENTRIES_COMMON( X ) \
+    X( glActiveTexture,                     TS_ActiveTexture, 0,  TL_None ) \
+    X( glAttachShader,                      TS_None,          0,  TL_None ) \
+    X( glBindBuffer,                        TS_Keyed,         0,  TL_None ) \
+    X( glBindBufferBase,                    TS_BufferBase,    0,  TL_None ) \
+    X( glBindBufferRange,                   TS_BufferBase,    0,  TL_None ) \
+    X( glBindFramebuffer,                   TS_Framebuffer,   0,  TL_None ) \
+    X( glBindImageTexture,                  TS_Keyed,         0,  TL_None ) \
+    X( glBindRenderbuffer,                  TS_Keyed,         0,  TL_None ) \
+    X( glBindTexture,                       TS_Texture,       0,  TL_None ) \
+    X( glBindVertexArray,                   TS_VertexArray,   0,  TL_None ) \
+    X( glBlendEquation,                     TS_Global,        0,  TL_None ) \
+    X( glBlendFunc,                         TS_Global,        0,  TL_None ) \
+    X( glBlitFramebuffer,                   TS_None,          0,  TL_None ) \
+    X( glBufferData,                        TS_None,          0,  TL_Bytes( 1 ) ) \
+    X( glBufferSubData,                     TS_None,          0,  TL_Bytes( 2 ) ) \
+    X( glCheckFramebufferStatus,            TS_None,          0,  TL_None ) \
+    X( glClear,                             TS_None,          0,  TL_None ) \
+    X( glClearColor,                        TS_Global,        0,  TL_None ) \
+    X( glClearStencil,                      TS_Global,        0,  TL_None ) \
+    X( glClientWaitSync,                    TS_None,          0,  TL_None ) \
+    X( glColorMask,                         TS_Global,        0,  TL_None ) \
+    X( glCompileShader,                     TS_None,          0,  TL_None ) \
+    X( glCompressedTexImage2D,              TS_None,          0,  TL_Bytes( 6 ) ) \
+    X( glCopyTexImage2D,                    TS_None,          0,  TL_None ) \
+    X( glCopyTexSubImage2D,                 TS_None,          0,  TL_None ) \
+    X( glCreateProgram,                     TS_None,          0,  TL_None ) \
+    X( glCreateShader,                      TS_None,          0,  TL_None ) \
+    X( glDeleteBuffers,                     TS_Invalidate,    0,  TL_None ) \
+    X( glDeleteFramebuffers,                TS_Invalidate,    0,  TL_None ) \
+    X( glDeleteProgram,                     TS_Invalidate,    0,  TL_None ) \
+    X( glDeleteRenderbuffers,               TS_Invalidate,    0,  TL_None ) \
+    X( glDeleteShader,                      TS_None,          0,  TL_None ) \
+    X( glDeleteSync,                        TS_None,          0,  TL_None ) \
+    X( glDeleteTextures,                    TS_Invalidate,    0,  TL_None ) \
+    X( glDeleteVertexArrays,                TS_Invalidate,    0,  TL_None ) \
+    X( glDepthFunc,                         TS_Global,        0,  TL_None ) \
+    X( glDepthMask,                         TS_Global,        0,  TL_None ) \
+    X( glDisable,                           TS_Disable,       0,  TL_None ) \
+    X( glDispatchCompute,                   TS_None,          0,  TL_None ) \
+    X( glDrawArrays,                        TS_None,          0,  TL_None ) \
+    X( glDrawArraysInstanced,               TS_None,          0,  TL_None ) \
+    X( glDrawBuffers,                       TS_None,          0,  TL_None ) \
+    X( glDrawElements,                      TS_None,          0,  TL_None ) \
+    X( glDrawElementsInstanced,             TS_None,          0,  TL_None ) \
+    X( glDrawRangeElements,                 TS_None,          0,  TL_None ) \
+    X( glEnable,                            TS_Enable,        0,  TL_None ) \
+    X( glEnableVertexAttribArray,           TS_None,          0,  TL_None ) \
+    X( glFenceSync,                         TS_None,          0,  TL_None ) \
+    X( glFinish,                            TS_None,          0,  TL_None ) \
+    X( glFlush,                             TS_None,          0,  TL_None ) \
+    X( glFramebufferRenderbuffer,           TS_None,          0,  TL_None ) \
+    X( glFramebufferTexture2D,              TS_None,          0,  TL_None ) \
+    X( glGenBuffers,                        TS_None,          0,  TL_None ) \
+    X( glGenFramebuffers,                   TS_None,          0,  TL_None ) \
+    X( glGenRenderbuffers,                  TS_None,          0,  TL_None ) \
+    X( glGenTextures,                       TS_None,          0,  TL_None ) \
+    X( glGenVertexArrays,                   TS_None,          0,  TL_None ) \
+    X( glGenerateMipmap,                    TS_None,          0,  TL_None ) \
+    X( glGetActiveUniformBlockiv,           TS_None,          0,  TL_None ) \
+    X( glGetAttribLocation,                 TS_None,          0,  TL_None ) \
+    X( glGetError,                          TS_None,          0,  TL_None ) \
+    X( glGetFloatv,                         TS_None,          0,  TL_None ) \
+    X( glGetIntegerv,                       TS_None,          0,  TL_None ) \
+    X( glGetInternalformativ,               TS_None,          0,  TL_None ) \
+    X( glGetProgramInfoLog,                 TS_None,          0,  TL_None ) \
+    X( glGetProgramiv,                      TS_None,          0,  TL_None ) \
+    X( glGetShaderInfoLog,                  TS_None,          0,  TL_None ) \
+    X( glGetShaderiv,                       TS_None,          0,  TL_None ) \
+    X( glGetString,                         TS_None,          0,  TL_None ) \
+    X( glGetStringi,                        TS_None,          0,  TL_None ) \
+    X( glGetUniformBlockIndex,              TS_None,          0,  TL_None ) \
+    X( glGetUniformLocation,                TS_None,          0,  TL_None ) \
+    X( glInvalidateFramebuffer,             TS_None,          0,  TL_None ) \
+    X( glInvalidateSubFramebuffer,          TS_None,          0,  TL_None ) \
+    X( glLinkProgram,                       TS_Invalidate,    0,  TL_None ) \
+    X( glMapBufferRange,                    TS_None,          0,  TL_Bytes( 2 ) ) \
+    X( glMemoryBarrier,                     TS_None,          0,  TL_None ) \
+    X( glPixelStorei,                       TS_Keyed,         0,  TL_None ) \
+    X( glReadBuffer,                        TS_None,          0,  TL_None ) \
+    X( glReadPixels,                        TS_None,          0,  TL_Call ) \
+    X( glRenderbufferStorage,               TS_None,          0,  TL_None ) \
+    X( glRenderbufferStorageMultisample,    TS_None,          0,  TL_None ) \
+    X( glScissor,                           TS_Global,        0,  TL_None ) \
+    X( glShaderSource,                      TS_None,          0,  TL_None ) \
+    X( glStencilFunc,                       TS_Global,        0,  TL_None ) \
+    X( glStencilMask,                       TS_Global,        0,  TL_None ) \
+    X( glStencilOp,                         TS_Global,        0,  TL_None ) \
+    X( glTexImage2D,                        TS_None,          0,  TL_Call ) \
+    X( glTexImage3D,                        TS_None,          0,  TL_Call ) \
+    X( glTexParameterf,                     TS_None,          0,  TL_None ) \
+    X( glTexParameteri,                     TS_None,          0,  TL_None ) \
+    X( glTexStorage2D,                      TS_None,          0,  TL_None ) \
+    X( glTexSubImage2D,                     TS_None,          0,  TL_Call ) \
+    X( glTexSubImage3D,                     TS_None,          0,  TL_Call ) \
+    X( glUniform1f,                         TS_Uniform,       0,  TL_None ) \
+    X( glUniform1i,                         TS_Uniform,       0,  TL_None ) \
+    X( glUniform2i,                         TS_Uniform,       0,  TL_None ) \
+    X( glUniform4f,                         TS_Uniform,       0,  TL_None ) \
+    X( glUniform4fv,                        TS_UniformV,      4,  TL_None ) \
+    X( glUniformBlockBinding,               TS_Keyed2,        0,  TL_None ) \
+    X( glUniformMatrix4fv,                  TS_UniformV,      16, TL_None ) \
+    X( glUnmapBuffer,                       TS_None,          0,  TL_None ) \
+    X( glUseProgram,                        TS_UseProgram,    0,  TL_None ) \
+    X( glVertexAttribPointer,               TS_None,          0,  TL_None ) \
+    X( glViewport,                          TS_Global,        0,  TL_None )
+
+// not in gles2.h
+#define GLTRACE_ENTRIES_GL( X ) \
+    X( glAlphaFunc,                         TS_Global,        0,  TL_None ) \
+    X( glBegin,                             TS_None,          0,  TL_None ) \
+    X( glColor3f,                           TS_None,          0,  TL_None ) \
+    X( glColorPointer,                      TS_None,          0,  TL_None ) \
+    X( glDisableClientState,                TS_None,          0,  TL_None ) \
+    X( glDrawBuffer,                        TS_None,          0,  TL_None ) \
+    X( glEnableClientState,                 TS_None,          0,  TL_None ) \
+    X( glEnd,                               TS_None,          0,  TL_None ) \
+    X( glFrustum,                           TS_None,          0,  TL_None ) \
+    X( glGetBufferSubData,                  TS_None,          0,  TL_Bytes( 2 ) ) \
+    X( glGetTexImage,                       TS_None,          0,  TL_Call ) \
+    X( glLoadIdentity,                      TS_None,          0,  TL_None ) \
+    X( glMapBuffer,                         TS_None,          0,  TL_Call ) \
+    X( glMatrixMode,                        TS_Global,        0,  TL_None ) \
+    X( glOrtho,                             TS_None,          0,  TL_None ) \
+    X( glPolygonMode,                       TS_Keyed,         0,  TL_None ) \
+    X( glPopMatrix,                         TS_None,          0,  TL_None ) \
+    X( glPushMatrix,                        TS_None,          0,  TL_None ) \
+    X( glRotatef,                           TS_None,          0,  TL_None ) \
+    X( glTexCoordPointer,                   TS_None,          0,  TL_None ) \
+    X( glTranslatef,                        TS_None,          0,  TL_None ) \
+    X( glVertex2fv,                         TS_None,          0,  TL_None ) \
+    X( glVertex3fv,                         TS_None,          0,  TL_None ) \
+    X( glVertex4fv,                         TS_None,          0,  TL_None ) \
+    X( glVertexPointer,                     TS_None,          0,  TL_None )
+
+#if IS_GlEs
+#define GLTRACE_ENTRIES( X ) GLTRACE_ENTRIES_COMMON( X )
+#else
+#define GLTRACE_ENTRIES( X ) GLTRACE_ENTRIES_COMMON( X ) GLTRACE_ENTRIES_GL( X )
+#endif
+
+enum{
+#define X( name, state, floats, timeline ) TraceId_##name,
+    GLTRACE_ENTRIES( X )
+#undef X
+    TraceId_Count,
+    // shadow key groups shared by several entry points
+    TraceGroup_Cap = TraceId_Count,
+    TraceGroup_Uniform,
+};
+
+static const char *traceNames[] = {
+#define X( name, state, floats, timeline ) #name,
+    GLTRACE_ENTRIES( X )
+#undef X
+};
+static constexpr int8_t traceStates[] = {
+#define X( name, state, floats, timeline ) state,
+    GLTRACE_ENTRIES( X )
+#undef X
+};
+static constexpr int8_t traceFloats[] = {
+#define X( name, state, floats, timeline ) floats,
+    GLTRACE_ENTRIES( X )
+#undef X
+};
+static constexpr int8_t traceTimeline[] = {
+#define X( name, state, floats, timeline ) timeline,
+    GLTRACE_ENTRIES( X )
+#undef X
+};
+
+// the driver's functions, as glad loaded them
+static GLADapiproc traceReal[TraceId_Count];
+
+/*
+ * Per thread counters and state shadow: one context is current per thread, each thread has its own state.
+ * Tables are never freed, the report at exit may outlive the threads.
+ */
+typedef struct TraceThread{
+    uint64_t calls[TraceId_Count];
+    uint64_t ticks[TraceId_Count];
+    uint64_t redundant[TraceId_Count];
+    std::unordered_map<uint64_t, uint64_t> shadow;
+    uint64_t program;
+    uint64_t activeUnit;
+    struct TraceThread *next;
+}TraceThread;
+
+static std::mutex traceMutex;
+static TraceThread *traceThreads = NULL;
+static thread_local TraceThread *traceThread = NULL;
+
+static int traceEnabled = -1;
+static uint64_t traceStartTicks, traceStartNs;
+static uint64_t traceTimerTicks;     // cost of one pair of timestamps
+
+static TraceThread* TraceThreadGet()
+{
+    if( traceThread == NULL ){
+        TraceThread *t = new TraceThread();
+        t->activeUnit = GL_TEXTURE0;
+        std::lock_guard<std::mutex> lock( traceMutex );
+        t->next = traceThreads;
+        traceThreads = t;
+        traceThread = t;
+    }
+    return traceThread;
+}
+
+static uint64_t TraceNs()
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static inline uint64_t TraceTicks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t t;
+    asm volatile( "mrs %0, cntvct_el0" : "=r"(t) );
+    return t;
+#else
+    return TraceNs();
+#endif
+}
+
+/*
+ * State shadow
+ */
+static inline uint64_t TraceMix( uint64_t h, uint64_t v )
+{
+    h = (h ^ v) * 0x9E3779B97F4A7C15ull;
+    return h ^ (h >> 29);
+}
+
+static inline uint64_t TraceHash( const uint64_t *a, int n )
+{
+    uint64_t h = 0;
+    for( int i=0; i < n; i++ )
+        h = TraceMix( h, a[i] );
+    return h;
+}
+
+template<typename T>
+static inline uint64_t TraceBits( T v )
+{
+    if constexpr( std::is_floating_point<T>::value ){
+        double d = v;
+        uint64_t u;
+        memcpy( &u, &d, sizeof(u) );
+        return u;
+    }else if constexpr( std::is_pointer<T>::value ){
+        return (uint64_t)(uintptr_t)v;
+    }else{
+        return (uint64_t)v;
+    }
+}
+
+// remember value under key, return 1 if it was already there
+static int TraceShadowSet( TraceThread *t, uint64_t key, uint64_t value )
+{
+    auto it = t->shadow.try_emplace( key, value );
+    if( it.second )
+        return 0;
+    if( it.first->second == value )
+        return 1;
+    it.first->second = value;
+    return 0;
+}
+
+template<int Id, typename... A>
+static inline void TraceState( TraceThread *t, A... args )
+{
+    constexpr int state = traceStates[Id];
+    if constexpr( state == TS_Invalidate ){
+        t->shadow.clear();
+    }else if constexpr( state != TS_None ){
+        const uint64_t a[] = { TraceBits( args )... };
+        const int n = sizeof...(A);
+        int redundant = 0;
+
+        switch( state ){
+            case TS_Enable:
+            case TS_Disable:
+                redundant = TraceShadowSet( t, TraceMix( TraceGroup_Cap, a[0] ), state == TS_Enable );
+                break;
+            case TS_Global:
+                redundant = TraceShadowSet( t, Id, TraceHash( a, n ) );
+                break;
+            case TS_Keyed:
+                redundant = TraceShadowSet( t, TraceMix( Id, a[0] ), TraceHash( a + 1, n - 1 ) );
+                break;
+            case TS_Keyed2:
+                redundant = TraceShadowSet( t, TraceMix( TraceMix( Id, a[0] ), a[1] ), TraceHash( a + 2, n - 2 ) );
+                break;
+            case TS_Texture:
+                redundant = TraceShadowSet( t, TraceMix( TraceMix( Id, t->activeUnit ), a[0] ), TraceHash( a + 1, n - 1 ) );
+                break;
+            case TS_ActiveTexture:
+                redundant = TraceShadowSet( t, Id, TraceHash( a, n ) );
+                t->activeUnit = a[0];
+                break;
+            case TS_UseProgram:
+                redundant = TraceShadowSet( t, Id, TraceHash( a, n ) );
+                t->program = a[0];
+                break;
+            case TS_VertexArray:
+                redundant = TraceShadowSet( t, Id, TraceHash( a, n ) );
+                if( !redundant )
+                    t->shadow.erase( TraceMix( TraceId_glBindBuffer, GL_ELEMENT_ARRAY_BUFFER ) );
+                break;
+            case TS_BufferBase:
+                redundant = TraceShadowSet( t, TraceMix( TraceMix( Id, a[0] ), a[1] ), TraceHash( a + 2, n - 2 ) );
+                TraceShadowSet( t, TraceMix( TraceId_glBindBuffer, a[0] ), TraceHash( a + 2, 1 ) );
+                break;
+            case TS_Framebuffer:
+                if( a[0] == GL_FRAMEBUFFER ){
+                    const int draw = TraceShadowSet( t, TraceMix( Id, GL_DRAW_FRAMEBUFFER ), a[1] );
+                    const int read = TraceShadowSet( t, TraceMix( Id, GL_READ_FRAMEBUFFER ), a[1] );
+                    redundant = draw && read;
+                }else{
+                    redundant = TraceShadowSet( t, TraceMix( Id, a[0] ), a[1] );
+                }
+                break;
+            case TS_Uniform:
+                redundant = TraceShadowSet( t, TraceMix( TraceMix( TraceGroup_Uniform, t->program ), a[0] ), TraceHash( a + 1, n - 1 ) );
+                break;
+            case TS_UniformV:{
+                // the values, not the pointer: count * floats of the last argument, and transpose
+                const float *value = (const float*)(uintptr_t)a[n - 1];
+                uint64_t h = (n == 4) ? a[2] : 0;
+                for( uint64_t i=0; value != NULL && i < a[1] * traceFloats[Id]; i++ ){
+                    uint32_t u;
+                    memcpy( &u, &value[i], sizeof(u) );
+                    h = TraceMix( h, u );
+                }
+                redundant = TraceShadowSet( t, TraceMix( TraceMix( TraceGroup_Uniform, t->program ), a[0] ), h );
+                break;
+            }
+        }
+        if( redundant )
+            t->redundant[Id]++;
+    }
+}
+
+template<int Id>
+static inline uint64_t TimelineBegin()
+{
+    if constexpr( traceTimeline[Id] == TL_None )
+        return 0;
+    else
+        return PerfTrace_Enabled ? PerfTrace_Now() : 0;
+}
+
+template<int Id, typename... A>
+static inline void TimelineEnd( uint64_t startNs, A... args )
+{
+    constexpr int timeline = traceTimeline[Id];
+    if( timeline == TL_None || !PerfTrace_Enabled )
+        return;
+    if constexpr( timeline >= TL_Bytes( 0 ) ){
+        const uint64_t a[] = { TraceBits( args )... };
+        PerfTrace_Complete( traceNames[Id], startNs, PerfTrace_Now(), "bytes", (double)a[timeline - TL_Bytes( 0 )] );
+    }else if constexpr( timeline == TL_Call ){
+        PerfTrace_Complete( traceNames[Id], startNs, PerfTrace_Now() );
+    }
+}
+
+/*
+ * Wrappers, one instance per entry point: the same signature as the glad pointer it replaces.
+ * Call() with $GL_TRACE=1, Timeline() for the timeline entry points with $PERF_TRACE only.
+ */
+template<int Id, typename F> struct TraceCall;
+
+template<int Id, typename R, typename... A>
+struct TraceCall<Id, R (GLAD_API_PTR *)(A...)>{
+    typedef R (GLAD_API_PTR *Proc)(A...);
+
+    static R GLAD_API_PTR Call( A... args )
+    {
+        TraceThread *t = TraceThreadGet();
+        const uint64_t startNs = TimelineBegin<Id>();
+        const uint64_t t0 = TraceTicks();
+        if constexpr( std::is_void<R>::value ){
+            ((Proc)traceReal[Id])( args... );
+            t->ticks[Id] += TraceTicks() - t0;
+            t->calls[Id]++;
+            TraceState<Id>( t, args... );
+            TimelineEnd<Id>( startNs, args... );
+        }else{
+            R r = ((Proc)traceReal[Id])( args... );
+            t->ticks[Id] += TraceTicks() - t0;
+            t->calls[Id]++;
+            TimelineEnd<Id>( startNs, args... );
+            return r;
+        }
+    }
+
+    static R GLAD_API_PTR Timeline( A... args )
+    {
+        const uint64_t startNs = PerfTrace_Now();
+        if constexpr( std::is_void<R>::value ){
+            ((Proc)traceReal[Id])( args... );
+            TimelineEnd<Id>( startNs, args... );
+        }else{
+            R r = ((Proc)traceReal[Id])( args... );
+            TimelineEnd<Id>( startNs, args... );
+            return r;
+        }
+    }
+};
+
+int GLTrace_IsEnabled()
+{
+    if( traceEnabled < 0 ){
+        const char *env = getenv( "GL_TRACE" );
+        traceEnabled = (env != NULL && atoi( env ) != 0);
+    }
+    return traceEnabled;
+}
+
+static void TraceAtExit()
+{
+    GLTrace_Report();
+}
+
+void GLTrace_Install()
+{
+    const int timelineOnly = !GLTrace_IsEnabled();
+    if( timelineOnly && !PerfTrace_Enabled )
+        return;
+
+    static std::once_flag once;
+    std::call_once( once, [timelineOnly](){
+        if( timelineOnly )
+            return;
+        uint64_t best = ~0ull;
+        for( int i=0; i < 1000; i++ ){
+            const uint64_t t0 = TraceTicks();
+            const uint64_t t1 = TraceTicks();
+            best = std::min( best, t1 - t0 );
+        }
+        traceTimerTicks = best;
+        traceStartNs = TraceNs();
+        traceStartTicks = TraceTicks();
+        atexit( TraceAtExit );
+    });
+
+    // after a reload glad holds the driver's pointers again, take them
+#define X( name, state, floats, timeline ) \
+    { \
+        typedef TraceCall<TraceId_##name, decltype(glad_##name)> Wrapper; \
+        if( glad_##name != NULL && glad_##name != Wrapper::Call && glad_##name != Wrapper::Timeline \
+            && (!timelineOnly || timeline != TL_None) ){ \
+            traceReal[TraceId_##name] = (GLADapiproc)glad_##name; \
+            glad_##name = timelineOnly ? Wrapper::Timeline : Wrapper::Call; \
+        } \
+    }
+    GLTRACE_ENTRIES( X )
+#undef X
+
+    // another context may have been made current
+    if( !timelineOnly )
+        TraceThreadGet()->shadow.clear();
+}
+
+void GLTrace_Reset()
+{
+    std::lock_guard<std::mutex> lock( traceMutex );
+    for( TraceThread *t = traceThreads; t != NULL; t = t->next ){
+        memset( t->calls, 0, sizeof(t->calls) );
+        memset( t->ticks, 0, sizeof(t->ticks) );
+        memset( t->redundant, 0, sizeof(t->redundant) );
+    }
+}
+
+void GLTrace_Report()
+{
+    if( !GLTrace_IsEnabled() )
+        return;
+
+    // TSC frequency from the time since GLTrace_Install(), at least 10 ms of it
+    uint64_t ns = TraceNs() - traceStartNs;
+    while( ns < 10000000 )
+        ns = TraceNs() - traceStartNs;
+    const double ticksPerNs = (double)(TraceTicks() - traceStartTicks) / ns;
+
+    static uint64_t calls[TraceId_Count], ticks[TraceId_Count], redundant[TraceId_Count];
+    memset( calls, 0, sizeof(calls) );
+    memset( ticks, 0, sizeof(ticks) );
+    memset( redundant, 0, sizeof(redundant) );
+    uint64_t totalCalls = 0, totalTicks = 0, totalRedundant = 0;
+    {
+        std::lock_guard<std::mutex> lock( traceMutex );
+        for( TraceThread *t = traceThreads; t != NULL; t = t->next ){
+            for( int i=0; i < TraceId_Count; i++ ){
+                calls[i] += t->calls[i];
+                ticks[i] += t->ticks[i];
+                redundant[i] += t->redundant[i];
+            }
+        }
+    }
+    int order[TraceId_Count];
+    for( int i=0; i < TraceId_Count; i++ ){
+        order[i] = i;
+        totalCalls += calls[i];
+        totalTicks += ticks[i];
+        totalRedundant += redundant[i];
+    }
+    std::sort( order, order + TraceId_Count, []( int a, int b ){ return ticks[a] > ticks[b]; } );
+
+    const char *env = getenv( "GL_TRACE_TOP" );
+    const int top = (env != NULL && atoi( env ) > 0) ? atoi( env ) : 20;
+
+    printf("\nGL trace: %llu calls, %.3f ms in GL, %llu redundant state sets (timer overhead %.1f ns/call, included)\n",
+           (unsigned long long)totalCalls, totalTicks / ticksPerNs / 1e6, (unsigned long long)totalRedundant,
+           traceTimerTicks / ticksPerNs);
+    printf("  %-36s %12s %12s %12s %10s\n", "entry point", "calls", "redundant", "total ms", "ns/call");
+    for( int k=0; k < top && k < TraceId_Count; k++ ){
+        const int i = order[k];
+        if( calls[i] == 0 )
+            break;
+        printf("  %-36s %12llu %12llu %12.3f %10.1f\n", traceNames[i], (unsigned long long)calls[i],
+               (unsigned long long)redundant[i], ticks[i] / ticksPerNs / 1e6, ticks[i] / ticksPerNs / calls[i]);
+    }
+
+    const char *path = getenv( "GL_TRACE_OUT" );
+    if( path == NULL || path[0] == '\0' )
+        return;
+    FILE *fp = fopen( path, "w" );
+    if( fp == NULL ){
+        printf("%s: can't write %s\n", __func__, path);
+        return;
+    }
+    fprintf( fp, "{\n  \"ticksPerNs\": %.6f,\n  \"timerOverheadNs\": %.3f,\n  \"entries\": [", ticksPerNs, traceTimerTicks / ticksPerNs );
+    int first = 1;
+    for( int k=0; k < TraceId_Count; k++ ){
+        const int i = order[k];
+        if( calls[i] == 0 )
+            continue;
+        fprintf( fp, "%s\n    { \"name\": \"%s\", \"calls\": %llu, \"redundant\": %llu, \"ns\": %.0f }",
+                 first ? "" : ",", traceNames[i], (unsigned long long)calls[i], (unsigned long long)redundant[i],
+                 ticks[i] / ticksPerNs );
+        first = 0;
+    }
+    fprintf( fp, "\n  ]\n}\n" );
+    fclose( fp );
+    printf("%s: wrote %s\n", __func__, path);
+}
@@ -0,0 +1,20 @@
+#pragma once
+/*
+ * GL call tracing, off unless $GL_TRACE=1:
+ *   the glad function pointers of the entry points listed in glTrace.cpp are swapped for wrappers that count
+ *   the calls, time them with the CPU timestamp counter and spot redundant state sets, per entry point.
+ *   At exit the top $GL_TRACE_TOP (20) entry points by CPU time are printed, and with $GL_TRACE_OUT=<file>
+ *   all of them are written as JSON.
+ *   A redundant set is one equal to the last value the same thread set, as StateCache_XXX() would drop it.
+ *   Off, the glad pointers are left alone: a GL call costs exactly what it did. On, every traced call pays
+ *   two timestamps and a counter update, printed as "timer overhead" and included in the times.
+ * With $PERF_TRACE (perfTrace.h) the uploads and readbacks among them are also slices of the timeline; without
+ * $GL_TRACE only those are wrapped.
+ */
+// swap the pointers after a glad load if $GL_TRACE=1 or $PERF_TRACE, LoadGLFunctions() calls it
+void GLTrace_Install();
+int GLTrace_IsEnabled();
+// clear the counters of every thread, e.g. once the setup of a benchmark is done
+void GLTrace_Reset();
+// print the top entry points, write $GL_TRACE_OUT; done at exit when enabled
+void GLTrace_Report();
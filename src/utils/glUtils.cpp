@@ -1,6 +1,10 @@
 #include <filesystem>
+#include <unordered_map>
+#include <string.h>
 #include "glUtils.h"
 #include "SGI_rgb.h"
+#include "glTrace.h"
+#include "perfTrace.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_STATIC
@@ -122,6 +126,11 @@ const char* glFormatName( GLenum format )
         case GL_LUMINANCE_ALPHA: return "GL_LUMINANCE_ALPHA";
         case GL_LUMINANCE: return "GL_LUMINANCE";
         case GL_ALPHA: return "GL_ALPHA";
+        case GL_BGRA_EXT: return "GL_BGRA";
+        case GL_STENCIL_INDEX: return "GL_STENCIL_INDEX";
+#if !IS_GlEs
+        case GL_BGR: return "GL_BGR";
+#endif
         case GL_R8: return "GL_R8";
         case GL_R8_SNORM: return "GL_R8_SNORM";
         case GL_R16F: return "GL_R16F";
@@ -180,46 +189,176 @@ const char* glFormatName( GLenum format )
     }
 }
 
+const char* glTypeName( GLenum type )
+{
+    switch( type ){
+        case GL_UNSIGNED_BYTE: return "GL_UNSIGNED_BYTE";
+        case GL_BYTE: return "GL_BYTE";
+        case GL_UNSIGNED_SHORT: return "GL_UNSIGNED_SHORT";
+        case GL_SHORT: return "GL_SHORT";
+        case GL_UNSIGNED_INT: return "GL_UNSIGNED_INT";
+        case GL_INT: return "GL_INT";
+        case GL_HALF_FLOAT: return "GL_HALF_FLOAT";
+        case GL_FLOAT: return "GL_FLOAT";
+        case GL_UNSIGNED_SHORT_5_6_5: return "GL_UNSIGNED_SHORT_5_6_5";
+        case GL_UNSIGNED_SHORT_4_4_4_4: return "GL_UNSIGNED_SHORT_4_4_4_4";
+        case GL_UNSIGNED_SHORT_5_5_5_1: return "GL_UNSIGNED_SHORT_5_5_5_1";
+        case GL_UNSIGNED_INT_2_10_10_10_REV: return "GL_UNSIGNED_INT_2_10_10_10_REV";
+        case GL_UNSIGNED_INT_10F_11F_11F_REV: return "GL_UNSIGNED_INT_10F_11F_11F_REV";
+        case GL_UNSIGNED_INT_5_9_9_9_REV: return "GL_UNSIGNED_INT_5_9_9_9_REV";
+        case GL_UNSIGNED_INT_24_8: return "GL_UNSIGNED_INT_24_8";
+        case GL_FLOAT_32_UNSIGNED_INT_24_8_REV: return "GL_FLOAT_32_UNSIGNED_INT_24_8_REV";
+#if !IS_GlEs
+        case GL_UNSIGNED_INT_8_8_8_8_REV: return "GL_UNSIGNED_INT_8_8_8_8_REV";
+        case GL_UNSIGNED_INT_8_8_8_8: return "GL_UNSIGNED_INT_8_8_8_8";
+#endif
+        default: return "";
+    }
+}
+
+#if !IS_GlEs
+/*
+ * gladLoadGL() loads the GL versions up to GL_VERSION of the context, a GLES context reads as "3.2" and would miss
+ * the GL 4.x entry points GLES 3.1 / 3.2 have, like glDispatchCompute(): tell it "4.6" while it loads.
+ */
+static PFNGLGETSTRINGPROC contextGetString;
+
+static const GLubyte* GLAD_API_PTR GetStringAllVersions( GLenum name )
+{
+    return (name == GL_VERSION) ? (const GLubyte*)"4.6" : contextGetString( name );
+}
+
+static GLADapiproc LoadAllVersions( void *userptr, const char *name )
+{
+    GLADapiproc proc = ((GLADloadfunc)userptr)( name );
+    if( strcmp( name, "glGetString" ) == 0 ){
+        contextGetString = (PFNGLGETSTRINGPROC)proc;
+        return (GLADapiproc)GetStringAllVersions;
+    }
+    return proc;
+}
+#endif
+
+// GL_VERSION of the current context, without the "OpenGL ES " prefix
+static void glContextVersion( int *major, int *minor )
+{
+    const char *version = (const char*)glGetString( GL_VERSION );
+    *major = *minor = 0;
+    if( version == NULL )
+        return;
+    if( strncmp( version, "OpenGL ES ", 10 ) == 0 )
+        version += 10;
+    sscanf( version, "%d.%d", major, minor );
+}
+
+static void GpuTimer_Reset();
+static void GpuTimer_IterationBegin();
+static void GpuTimer_IterationEnd();
+
+int LoadGLFunctions( GLADloadfunc load, int isEs )
+{
+#if IS_GlEs
+    int version = gladLoadGLES2( load );
+#else
+    int version;
+    if( !isEs ){
+        version = gladLoadGL( load );
+    }else{
+        gladLoadGLUserPtr( LoadAllVersions, (void*)load );
+        glad_glGetString = contextGetString;
+
+        int major, minor;
+        glContextVersion( &major, &minor );
+        if( major < 3 ){
+            printf("%s: GLES %d.%d, a glad_gl build needs GLES 3.0 or later\n", __func__, major, minor);
+            return 0;
+        }
+        version = GLAD_MAKE_VERSION( major, minor );
+    }
+#endif
+
+    // $GL_TRACE=1 or $PERF_TRACE: wrap the fresh pointers
+    GLTrace_Install();
+
+    // $PERF_TRACE: PerfMeasureRate() iterations on the GPU track too
+    GpuTimer_Reset();
+    if( PerfTrace_Enabled ){
+        PerfTrace_IterationBegin = GpuTimer_IterationBegin;
+        PerfTrace_IterationEnd = GpuTimer_IterationEnd;
+    }
+    return version;
+}
+
+int glContextIsEs()
+{
+#if IS_GlEs
+    return 1;
+#else
+    const char *version = (const char*)glGetString( GL_VERSION );
+    return version != NULL && strncmp( version, "OpenGL ES", 9 ) == 0;
+#endif
+}
+
+int glVersionAtLeast( int glMajor, int glMinor, int esMajor, int esMinor )
+{
+    int major, minor;
+    glContextVersion( &major, &minor );
+    if( glContextIsEs() )
+        return major > esMajor || (major == esMajor && minor >= esMinor);
+    return major > glMajor || (major == glMajor && minor >= glMinor);
+}
+
+int glHasExtension( const char *name )
+{
+    GLint count = 0;
+    glGetIntegerv( GL_NUM_EXTENSIONS, &count );
+    for( GLint i = 0; i < count; i++ ){
+        if( strcmp( (const char*)glGetStringi( GL_EXTENSIONS, i ), name ) == 0 )
+            return 1;
+    }
+    return 0;
+}
+
 const char* glslVersion( api_t api )
 {
     // https://en.wikipedia.org/wiki/OpenGL_Shading_Language
 
     if( api.api == API_GLLegacy || api.api == API_GL ){
-        if( api.major == 2 || api.minor == 0 )
+        if( api.major == 2 && api.minor == 0 )
             return "#version 110";
-        else if( api.major == 2 || api.minor == 1 )
+        else if( api.major == 2 && api.minor == 1 )
             return "#version 120";
-        else if( api.major == 3 || api.minor == 0 )
+        else if( api.major == 3 && api.minor == 0 )
             return "#version 130";
-        else if( api.major == 3 || api.minor == 1 )
+        else if( api.major == 3 && api.minor == 1 )
             return "#version 140";
-        else if( api.major == 3 || api.minor == 2 )
+        else if( api.major == 3 && api.minor == 2 )
             return "#version 150";
-        else if( api.major == 3 || api.minor == 3 )
+        else if( api.major == 3 && api.minor == 3 )
             return "#version 330";
-        else if( api.major == 4 || api.minor == 0 )
+        else if( api.major == 4 && api.minor == 0 )
             return "#version 400";
-        else if( api.major == 4 || api.minor == 1 )
+        else if( api.major == 4 && api.minor == 1 )
             return "#version 410";
-        else if( api.major == 4 || api.minor == 2 )
+        else if( api.major == 4 && api.minor == 2 )
             return "#version 420";
-        else if( api.major == 4 || api.minor == 3 )
+        else if( api.major == 4 && api.minor == 3 )
             return "#version 430";
-        else if( api.major == 4 || api.minor == 4 )
+        else if( api.major == 4 && api.minor == 4 )
             return "#version 440";
-        else if( api.major == 4 || api.minor == 5 )
+        else if( api.major == 4 && api.minor == 5 )
             return "#version 450";
-        else if( api.major == 4 || api.minor == 6 )
+        else if( api.major == 4 && api.minor == 6 )
             return "#version 460";
     }
     else if( api.api == API_GLES ){
-        if( api.major == 2 || api.minor == 0 )
-            return "#version 110";
-        else if( api.major == 3 || api.minor == 0 )
+        if( api.major == 2 && api.minor == 0 )
+            return "#version 100";
+        else if( api.major == 3 && api.minor == 0 )
             return "#version 300 es";
-        else if( api.major == 3 || api.minor == 1 )
+        else if( api.major == 3 && api.minor == 1 )
             return "#version 310 es";
-        else if( api.major == 3 || api.minor == 2 )
+        else if( api.major == 3 && api.minor == 2 )
             return "#version 320 es";
     }
 
@@ -307,6 +446,52 @@ GLuint CreateProgramFromSource( const char *vertShaderSource, const char *fragSh
     return program;
 }
 
+GLuint CreateProgramFromBody( api_t api, const char *vertBody, const char *fragBody )
+{
+    const char *version = glslVersion( api );
+    const char *precision = (api.api == API_GLES) ? "precision mediump float;\n" : "";
+
+    size_t vertLen = strlen( version ) + strlen( vertBody ) + 2;
+    size_t fragLen = strlen( version ) + strlen( precision ) + strlen( fragBody ) + 2;
+    char *vertSource = (char*) malloc( vertLen );
+    char *fragSource = (char*) malloc( fragLen );
+    snprintf( vertSource, vertLen, "%s\n%s", version, vertBody );
+    snprintf( fragSource, fragLen, "%s\n%s%s", version, precision, fragBody );
+
+    GLuint program = CreateProgramFromSource( vertSource, fragSource );
+    free( vertSource );
+    free( fragSource );
+    return program;
+}
+
+GLuint CreateComputeProgramFromSource( const char *compShaderSource )
+{
+    GLuint compShader = CreateShaderFromSource( GL_COMPUTE_SHADER, compShaderSource );
+    GLuint program = glCreateProgram();
+    glAttachShader( program, compShader );
+    glLinkProgram ( program );
+    glDeleteShader( compShader );
+
+    // Check the link status
+    GLint success;
+    glGetProgramiv ( program, GL_LINK_STATUS, &success );
+    if( !success ){
+        GLint infoLen = 0;
+        glGetProgramiv ( program, GL_INFO_LOG_LENGTH, &infoLen );
+        if( infoLen > 0 ){
+            char *infoLog = (char*)malloc ( sizeof ( char ) * infoLen );
+            glGetProgramInfoLog ( program, infoLen, NULL, infoLog );
+            printf("ERROR: programe link failed\n%s\n", infoLog);
+            free ( infoLog );
+        }
+
+        glDeleteProgram ( program );
+        exit(EXIT_FAILURE);
+    }
+
+    return program;
+}
+
 GLuint CreateTexture_FillWithCheckboard( GLsizei width, GLsizei height )
 {
     GLubyte *img = GenerateCheckboard_RGBA( width, height, 8 );
@@ -360,8 +545,9 @@ GLubyte* imageFromFile( const char *filename, GLsizei *width, GLsizei *height, G
 
 void ReadPixels_FromFboColorAttachment( void *dstData, GLuint texture, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type )
 {
-    GLint originalFBO = 0;
+    GLint originalFBO = 0, originalReadFBO = 0;
     glGetIntegerv( GL_FRAMEBUFFER_BINDING, &originalFBO );
+    glGetIntegerv( GL_READ_FRAMEBUFFER_BINDING, &originalReadFBO );
 
     // create FBO, and its color attachment
     GLuint fbo;
@@ -381,6 +567,7 @@ void ReadPixels_FromFboColorAttachment( void *dstData, GLuint texture, GLint x,
     // Restore the original framebuffer
     glDeleteFramebuffers( 1, &fbo );
     glBindFramebuffer ( GL_FRAMEBUFFER, originalFBO );
+    glBindFramebuffer ( GL_READ_FRAMEBUFFER, originalReadFBO );
 }
 
 #if !IS_GlEs
@@ -396,3 +583,1127 @@ void ReadPixels_FromTexture( void *dstData, GLuint texture, GLenum format, GLenu
 }
 #endif
 
+
+
+/*
+ * 2x2 box filter, one dispatch per level. RGBA8 immutable textures only (glTexStorage2D),
+ * since GLES can only bind immutable textures as images.
+ */
+static const char *mipmapComputeShaderBody =
+    "layout (local_size_x = 8, local_size_y = 8) in;\n"
+    "uniform highp sampler2D srcTex;\n"
+    "uniform int srcLevel;\n"
+    "layout (rgba8, binding = 0) writeonly uniform image2D dstImage;\n"
+    "void main()\n"
+    "{\n"
+    "    ivec2 dst = ivec2( gl_GlobalInvocationID.xy );\n"
+    "    if( any(greaterThanEqual(dst, imageSize(dstImage))) )\n"
+    "        return;\n"
+    "    ivec2 src = dst * 2;\n"
+    "    ivec2 srcMax = textureSize( srcTex, srcLevel ) - 1;\n"
+    "    vec4 c = texelFetch( srcTex, src, srcLevel )\n"
+    "           + texelFetch( srcTex, min(src + ivec2(1, 0), srcMax), srcLevel )\n"
+    "           + texelFetch( srcTex, min(src + ivec2(0, 1), srcMax), srcLevel )\n"
+    "           + texelFetch( srcTex, min(src + ivec2(1, 1), srcMax), srcLevel );\n"
+    "    imageStore( dstImage, dst, c * 0.25 );\n"
+    "}\n";
+
+GLuint CreateComputeProgramFromBody( const char *body )
+{
+    const char *preamble = glContextIsEs() ? "#version 310 es\n"
+                                             "precision highp float;\n"
+                                             "precision highp int;\n"
+                                             "precision highp image2D;\n"
+                                           : "#version 430\n";
+    size_t len = strlen( preamble ) + strlen( body ) + 1;
+    char *source = (char*) malloc( len );
+    snprintf( source, len, "%s%s", preamble, body );
+
+    GLuint program = CreateComputeProgramFromSource( source );
+    free( source );
+    return program;
+}
+
+void GenerateMipmap_Compute( GLuint texture, GLsizei width, GLsizei height, GLint baseLevel, GLint maxLevel )
+{
+    static GLuint program = 0;
+    static GLint srcLevel_uLoc;
+    if( program == 0 ){
+        program = CreateComputeProgramFromBody( mipmapComputeShaderBody );
+        srcLevel_uLoc = glGetUniformLocation( program, "srcLevel" );
+        glUseProgram( program );
+        glUniform1i( glGetUniformLocation( program, "srcTex" ), 0 );
+    }
+
+    glUseProgram( program );
+    glActiveTexture( GL_TEXTURE0 );
+    glBindTexture( GL_TEXTURE_2D, texture );
+
+    for( GLint level = baseLevel + 1; level <= maxLevel; level++ ){
+        const GLsizei w = (width >> level) > 0 ? (width >> level) : 1;
+        const GLsizei h = (height >> level) > 0 ? (height >> level) : 1;
+
+        glUniform1i( srcLevel_uLoc, level - 1 );
+        glBindImageTexture( 0, texture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8 );
+        glDispatchCompute( (w + 7) / 8, (h + 7) / 8, 1 );
+        glMemoryBarrier( GL_TEXTURE_FETCH_BARRIER_BIT );
+    }
+}
+
+
+
+/*
+ * Image compare: per workgroup reduction in shared memory, then one set of atomics per workgroup.
+ * The 64-bit sum of squared errors is 2 words, the high one takes the carry of the low one.
+ */
+static const char *compareComputeShaderBody =
+    "layout (local_size_x = 16, local_size_y = 16) in;\n"
+    "uniform highp sampler2D texA;\n"
+    "uniform highp sampler2D texB;\n"
+    "uniform ivec2 size;\n"
+    "uniform int channels;\n"
+    "layout (std430, binding = 0) buffer Result {\n"
+    "    uint mismatches, maxError, sumLo, sumHi, minX, minY, maxX, maxY;\n"
+    "};\n"
+    "shared uint sMismatches, sMaxError, sSum, sMinX, sMinY, sMaxX, sMaxY;\n"
+    "void main()\n"
+    "{\n"
+    "    if( gl_LocalInvocationIndex == 0u ){\n"
+    "        sMismatches = 0u; sMaxError = 0u; sSum = 0u;\n"
+    "        sMinX = 0xFFFFFFFFu; sMinY = 0xFFFFFFFFu; sMaxX = 0u; sMaxY = 0u;\n"
+    "    }\n"
+    "    barrier();\n"
+    "    ivec2 p = ivec2( gl_GlobalInvocationID.xy );\n"
+    "    if( all(lessThan(p, size)) ){\n"
+    "        ivec4 d = abs( ivec4( texelFetch( texA, p, 0 ) * 255.0 + 0.5 ) - ivec4( texelFetch( texB, p, 0 ) * 255.0 + 0.5 ) );\n"
+    "        d *= ivec4( greaterThan( ivec4(channels), ivec4(0, 1, 2, 3) ) );\n"
+    "        uint e = uint( max( max(d.r, d.g), max(d.b, d.a) ) );\n"
+    "        if( e > 0u ){\n"
+    "            atomicAdd( sMismatches, 1u );\n"
+    "            atomicMax( sMaxError, e );\n"
+    "            atomicAdd( sSum, uint( d.r * d.r + d.g * d.g + d.b * d.b + d.a * d.a ) );\n"
+    "            atomicMin( sMinX, uint(p.x) );\n"
+    "            atomicMin( sMinY, uint(p.y) );\n"
+    "            atomicMax( sMaxX, uint(p.x) );\n"
+    "            atomicMax( sMaxY, uint(p.y) );\n"
+    "        }\n"
+    "    }\n"
+    "    barrier();\n"
+    "    if( gl_LocalInvocationIndex == 0u && sMismatches > 0u ){\n"
+    "        atomicAdd( mismatches, sMismatches );\n"
+    "        atomicMax( maxError, sMaxError );\n"
+    "        uint old = atomicAdd( sumLo, sSum );\n"
+    "        if( old > 0xFFFFFFFFu - sSum )\n"
+    "            atomicAdd( sumHi, 1u );\n"
+    "        atomicMin( minX, sMinX );\n"
+    "        atomicMin( minY, sMinY );\n"
+    "        atomicMax( maxX, sMaxX );\n"
+    "        atomicMax( maxY, sMaxY );\n"
+    "    }\n"
+    "}\n";
+
+int ImageCompare_GPU( GLuint texA, GLuint texB, GLsizei width, GLsizei height, int channels, ImageCompareResult *result )
+{
+    if( !glVersionAtLeast( 4, 3, 3, 1 ) )
+        return 0;
+
+    static GLuint program = 0;
+    static GLuint buffer = 0;
+    static GLuint sampler = 0;
+    static GLint size_uLoc, channels_uLoc;
+    if( program == 0 ){
+        program = CreateComputeProgramFromBody( compareComputeShaderBody );
+        size_uLoc = glGetUniformLocation( program, "size" );
+        channels_uLoc = glGetUniformLocation( program, "channels" );
+        glUseProgram( program );
+        glUniform1i( glGetUniformLocation( program, "texA" ), 0 );
+        glUniform1i( glGetUniformLocation( program, "texB" ), 1 );
+        glGenBuffers( 1, &buffer );
+
+        // complete whatever the filters of the textures are: texelFetch() of an incomplete one returns 0
+        glGenSamplers( 1, &sampler );
+        glSamplerParameteri( sampler, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+        glSamplerParameteri( sampler, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+    }
+
+    const GLuint init[8] = { 0, 0, 0, 0, 0xFFFFFFFF, 0xFFFFFFFF, 0, 0 };
+    glBindBuffer( GL_SHADER_STORAGE_BUFFER, buffer );
+    glBufferData( GL_SHADER_STORAGE_BUFFER, sizeof(init), init, GL_DYNAMIC_READ );
+    glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 0, buffer );
+
+    glUseProgram( program );
+    glUniform2i( size_uLoc, width, height );
+    glUniform1i( channels_uLoc, channels );
+    glActiveTexture( GL_TEXTURE1 );
+    glBindTexture( GL_TEXTURE_2D, texB );
+    glActiveTexture( GL_TEXTURE0 );
+    glBindTexture( GL_TEXTURE_2D, texA );
+    glBindSampler( 0, sampler );
+    glBindSampler( 1, sampler );
+
+    glDispatchCompute( (width + 15) / 16, (height + 15) / 16, 1 );
+    glMemoryBarrier( GL_BUFFER_UPDATE_BARRIER_BIT );
+    glBindSampler( 0, 0 );
+    glBindSampler( 1, 0 );
+
+    // 32 bytes back, GLES has no glGetBufferSubData()
+    const GLuint *r = (const GLuint*) glMapBufferRange( GL_SHADER_STORAGE_BUFFER, 0, sizeof(init), GL_MAP_READ_BIT );
+    if( r == NULL )
+        return 0;
+    memset( result, 0, sizeof(*result) );
+    result->mismatches = r[0];
+    result->maxError = r[1];
+    result->sumSquaredError = ((uint64_t)r[3] << 32) | r[2];
+    result->x0 = (r[0] > 0) ? (int)r[4] : width;
+    result->y0 = (r[0] > 0) ? (int)r[5] : height;
+    result->x1 = (r[0] > 0) ? (int)r[6] : -1;
+    result->y1 = (r[0] > 0) ? (int)r[7] : -1;
+    result->samples = (uint64_t)width * height * channels;
+    glUnmapBuffer( GL_SHADER_STORAGE_BUFFER );
+    glBindBuffer( GL_SHADER_STORAGE_BUFFER, 0 );
+
+    ImageCompare_Finish( result );
+    return 1;
+}
+
+int ImageCompare_Textures( GLuint texA, GLuint texB, GLsizei width, GLsizei height, int channels, ImageCompareResult *result )
+{
+    if( ImageCompare_GPU( texA, texB, width, height, channels, result ) )
+        return 1;
+
+    // RGBA is the readback every implementation supports, keep the first channels of each pixel
+    GLubyte *a = (GLubyte*) malloc( (size_t)width * height * 4 );
+    GLubyte *b = (GLubyte*) malloc( (size_t)width * height * 4 );
+    ReadPixels_FromFboColorAttachment( a, texA, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE );
+    ReadPixels_FromFboColorAttachment( b, texB, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE );
+    if( channels < 4 ){
+        for( size_t i = 0; i < (size_t)width * height; i++ ){
+            memmove( a + i * channels, a + i * 4, channels );
+            memmove( b + i * channels, b + i * 4, channels );
+        }
+    }
+
+    ImageCompare_CPU( a, width * channels, b, width * channels, width, height, channels, result );
+    free( a );
+    free( b );
+    return 0;
+}
+
+void Golden_SubmitFramebuffer( const char *test, const char *api, GLint x, GLint y, GLsizei width, GLsizei height,
+                               const GoldenTolerance *tolerance )
+{
+    GLint packBuffer, packAlignment;
+    glGetIntegerv( GL_PIXEL_PACK_BUFFER_BINDING, &packBuffer );
+    glGetIntegerv( GL_PACK_ALIGNMENT, &packAlignment );
+    glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+    glPixelStorei( GL_PACK_ALIGNMENT, 4 );
+
+    GLubyte *pixels = (GLubyte*) malloc( (size_t)width * height * 4 );
+    glReadPixels( x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels );
+    Golden_Submit( test, api, (const char*)glGetString( GL_RENDERER ), pixels, width, height, tolerance );
+    free( pixels );
+
+    glBindBuffer( GL_PIXEL_PACK_BUFFER, packBuffer );
+    glPixelStorei( GL_PACK_ALIGNMENT, packAlignment );
+}
+
+
+
+/*
+ * Offscreen render target
+ */
+static const RenderTargetFormat renderTargetFormats[] = {
+    { GL_RGBA8,    GL_RGBA, GL_UNSIGNED_BYTE,               4, GL_RGBA, GL_UNSIGNED_BYTE,               4, "RGBA8" },
+    { GL_RGB10_A2, GL_RGBA, GL_UNSIGNED_INT_2_10_10_10_REV, 4, GL_RGBA, GL_UNSIGNED_INT_2_10_10_10_REV, 4, "RGB10_A2" },
+    { GL_RGBA16F,  GL_RGBA, GL_HALF_FLOAT,                  8, GL_RGBA, GL_FLOAT,                      16, "RGBA16F" },
+};
+
+const RenderTargetFormat* RenderTarget_GetFormat( GLenum internalFormat )
+{
+    for( size_t i = 0; i < sizeof(renderTargetFormats)/sizeof(renderTargetFormats[0]); i++ ){
+        if( renderTargetFormats[i].internalFormat == internalFormat )
+            return &renderTargetFormats[i];
+    }
+    return NULL;
+}
+
+GLsizei RenderTarget_MaxSize()
+{
+    GLint maxRenderbufferSize, maxTextureSize, maxViewportDims[2];
+    glGetIntegerv( GL_MAX_RENDERBUFFER_SIZE, &maxRenderbufferSize );
+    glGetIntegerv( GL_MAX_TEXTURE_SIZE, &maxTextureSize );
+    glGetIntegerv( GL_MAX_VIEWPORT_DIMS, maxViewportDims );
+
+    GLint size = maxRenderbufferSize;
+    if( maxTextureSize < size )
+        size = maxTextureSize;
+    if( maxViewportDims[0] < size )
+        size = maxViewportDims[0];
+    if( maxViewportDims[1] < size )
+        size = maxViewportDims[1];
+    return size;
+}
+
+int RenderTarget_Create( RenderTarget *rt, GLsizei width, GLsizei height, GLenum colorFormat, GLenum depthStencilFormat, GLsizei samples )
+{
+    memset( rt, 0, sizeof(*rt) );
+    rt->width = width;
+    rt->height = height;
+    rt->samples = samples;
+    rt->depthStencilFormat = depthStencilFormat;
+    if( colorFormat != GL_NONE ){
+        rt->color = RenderTarget_GetFormat( colorFormat );
+        if( rt->color == NULL ){
+            printf("%s: color format %s not supported\n", __func__, glFormatName(colorFormat));
+            return 0;
+        }
+    }
+
+    // drop pending errors, the ones below are reported as failure
+    while( glGetError() != GL_NO_ERROR )
+        ;
+
+    glGenFramebuffers( 1, &rt->fbo );
+    glBindFramebuffer( GL_FRAMEBUFFER, rt->fbo );
+
+    if( rt->color != NULL && samples == 0 ){
+        glGenTextures( 1, &rt->colorTexture );
+        glBindTexture( GL_TEXTURE_2D, rt->colorTexture );
+        glTexImage2D( GL_TEXTURE_2D, 0, rt->color->internalFormat, width, height, 0, rt->color->format, rt->color->type, NULL );
+        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+        glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, rt->colorTexture, 0 );
+    }
+    else if( rt->color != NULL ){
+        glGenRenderbuffers( 1, &rt->colorRenderbuffer );
+        glBindRenderbuffer( GL_RENDERBUFFER, rt->colorRenderbuffer );
+        glRenderbufferStorageMultisample( GL_RENDERBUFFER, samples, rt->color->internalFormat, width, height );
+        glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, rt->colorRenderbuffer );
+    }
+
+    if( depthStencilFormat != GL_NONE ){
+        glGenRenderbuffers( 1, &rt->depthStencilRenderbuffer );
+        glBindRenderbuffer( GL_RENDERBUFFER, rt->depthStencilRenderbuffer );
+        glRenderbufferStorageMultisample( GL_RENDERBUFFER, samples, depthStencilFormat, width, height );
+        glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, rt->depthStencilRenderbuffer );
+    }
+
+    const GLenum drawBuffer = (rt->color != NULL) ? GL_COLOR_ATTACHMENT0 : GL_NONE;
+    glDrawBuffers( 1, &drawBuffer );
+    glReadBuffer( drawBuffer );
+
+    const GLenum error = glGetError();
+    const GLenum stat = glCheckFramebufferStatus( GL_FRAMEBUFFER );
+    if( error != GL_NO_ERROR || stat != GL_FRAMEBUFFER_COMPLETE ){
+        printf("%s: %d x %d %s%s%s, %d samples: %s\n", __func__, width, height,
+               rt->color ? rt->color->name : "", (rt->color && depthStencilFormat != GL_NONE) ? "+" : "",
+               glFormatName(depthStencilFormat), samples,
+               (error != GL_NO_ERROR) ? glErrorName(error) : framebufferStatusName(stat));
+        RenderTarget_Destroy( rt );
+        return 0;
+    }
+
+    glViewport( 0, 0, width, height );
+    return 1;
+}
+
+void RenderTarget_Destroy( RenderTarget *rt )
+{
+    GLint fbo = 0;
+    glGetIntegerv( GL_FRAMEBUFFER_BINDING, &fbo );
+    if( rt->fbo != 0 && (GLuint)fbo == rt->fbo )
+        glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+
+    glDeleteFramebuffers( 1, &rt->fbo );
+    glDeleteTextures( 1, &rt->colorTexture );
+    glDeleteRenderbuffers( 1, &rt->colorRenderbuffer );
+    glDeleteRenderbuffers( 1, &rt->depthStencilRenderbuffer );
+    rt->fbo = rt->colorTexture = rt->colorRenderbuffer = rt->depthStencilRenderbuffer = 0;
+}
+
+void RenderTarget_Bind( const RenderTarget *rt )
+{
+    glBindFramebuffer( GL_FRAMEBUFFER, rt->fbo );
+    glViewport( 0, 0, rt->width, rt->height );
+}
+
+double RenderTarget_Bytes( const RenderTarget *rt )
+{
+    double bytesPerPixel = 0;
+    if( rt->color != NULL )
+        bytesPerPixel += rt->color->bytesPerPixel;
+    if( rt->depthStencilFormat != GL_NONE )
+        bytesPerPixel += 4;
+    return (double)rt->width * rt->height * (rt->samples > 0 ? rt->samples : 1) * bytesPerPixel;
+}
+
+
+/*
+ * GPU memory traffic from vendor performance counters
+ */
+#define GpuCounters_Max     16
+
+enum {
+    GpuCounters_None,
+    GpuCounters_Intel,
+    GpuCounters_AMD,
+};
+
+static struct{
+    int backend;
+    int numCounters;
+
+    // GL_INTEL_performance_query
+    GLuint queryId;
+    GLuint queryHandle;
+    GLuint dataSize;
+    GLuint offsets[GpuCounters_Max];
+    GLuint dataTypes[GpuCounters_Max];
+
+    // GL_AMD_performance_monitor
+    GLuint monitor;
+    GLuint groups[GpuCounters_Max];
+    GLuint counters[GpuCounters_Max];
+    GLenum types[GpuCounters_Max];
+} gc;
+
+// "... read/write bytes", not rates like "... throughput" or "... bytes/sec", summing those gives no bytes
+static int IsByteCounter( const char *name )
+{
+    char lower[256];
+    size_t i;
+    for( i = 0; name[i] != '\0' && i < sizeof(lower) - 1; i++ )
+        lower[i] = (name[i] >= 'A' && name[i] <= 'Z') ? name[i] - 'A' + 'a' : name[i];
+    lower[i] = '\0';
+
+    // "writ": write and written
+    return (strstr( lower, "read" ) || strstr( lower, "writ" ))
+        && strstr( lower, "byte" )
+        && !strstr( lower, "throughput" ) && !strstr( lower, "bandwidth" )
+        && !strstr( lower, "/s" ) && !strstr( lower, "per s" ) && !strchr( lower, '%' );
+}
+
+static int GpuCounters_InitIntel()
+{
+    GLuint queryId = 0;
+    glGetFirstPerfQueryIdINTEL( &queryId );
+
+    while( queryId != 0 ){
+        GLchar queryName[256];
+        GLuint dataSize, numCounters, numInstances, caps;
+        glGetPerfQueryInfoINTEL( queryId, sizeof(queryName), queryName, &dataSize, &numCounters, &numInstances, &caps );
+
+        gc.numCounters = 0;
+        for( GLuint c = 1; c <= numCounters && gc.numCounters < GpuCounters_Max; c++ ){
+            GLchar name[256], desc[1024];
+            GLuint offset, size, type, dataType;
+            GLuint64 rawMax;
+            glGetPerfCounterInfoINTEL( queryId, c, sizeof(name), name, sizeof(desc), desc, &offset, &size, &type, &dataType, &rawMax );
+            if( !IsByteCounter( name ) || (type != GL_PERFQUERY_COUNTER_EVENT_INTEL && type != GL_PERFQUERY_COUNTER_RAW_INTEL) )
+                continue;
+
+            printf("%s: %s / %s\n", __func__, queryName, name);
+            gc.offsets[gc.numCounters] = offset;
+            gc.dataTypes[gc.numCounters] = dataType;
+            gc.numCounters++;
+        }
+
+        if( gc.numCounters > 0 ){
+            gc.queryId = queryId;
+            gc.dataSize = dataSize;
+            glCreatePerfQueryINTEL( queryId, &gc.queryHandle );
+            return 1;
+        }
+        glGetNextPerfQueryIdINTEL( queryId, &queryId );
+    }
+    return 0;
+}
+
+static int GpuCounters_InitAMD()
+{
+    GLint numGroups = 0;
+    glGetPerfMonitorGroupsAMD( &numGroups, 0, NULL );
+    GLuint *groups = (GLuint*) malloc( numGroups * sizeof(GLuint) );
+    glGetPerfMonitorGroupsAMD( NULL, numGroups, groups );
+
+    gc.numCounters = 0;
+    for( GLint g = 0; g < numGroups; g++ ){
+        GLint numCounters = 0, maxActive = 0;
+        glGetPerfMonitorCountersAMD( groups[g], &numCounters, &maxActive, 0, NULL );
+        GLuint *counters = (GLuint*) malloc( numCounters * sizeof(GLuint) );
+        glGetPerfMonitorCountersAMD( groups[g], NULL, NULL, numCounters, counters );
+
+        GLint active = 0;
+        for( GLint c = 0; c < numCounters && active < maxActive && gc.numCounters < GpuCounters_Max; c++ ){
+            GLchar name[256];
+            GLenum type;
+            glGetPerfMonitorCounterStringAMD( groups[g], counters[c], sizeof(name), NULL, name );
+            glGetPerfMonitorCounterInfoAMD( groups[g], counters[c], GL_COUNTER_TYPE_AMD, &type );
+            if( !IsByteCounter( name ) || type == GL_PERCENTAGE_AMD )
+                continue;
+
+            printf("%s: %s\n", __func__, name);
+            gc.groups[gc.numCounters] = groups[g];
+            gc.counters[gc.numCounters] = counters[c];
+            gc.types[gc.numCounters] = type;
+            gc.numCounters++;
+            active++;
+        }
+        free( counters );
+    }
+    free( groups );
+
+    if( gc.numCounters == 0 )
+        return 0;
+
+    glGenPerfMonitorsAMD( 1, &gc.monitor );
+    for( int i = 0; i < gc.numCounters; i++ )
+        glSelectPerfMonitorCountersAMD( gc.monitor, GL_TRUE, gc.groups[i], 1, &gc.counters[i] );
+    return 1;
+}
+
+int GpuCounters_Init()
+{
+    if( gc.backend != GpuCounters_None )
+        return 1;
+
+    if( GLAD_GL_INTEL_performance_query && GpuCounters_InitIntel() )
+        gc.backend = GpuCounters_Intel;
+    else if( GLAD_GL_AMD_performance_monitor && GpuCounters_InitAMD() )
+        gc.backend = GpuCounters_AMD;
+
+    if( gc.backend == GpuCounters_None )
+        printf("%s: no bandwidth counters exposed\n", __func__);
+    return gc.backend != GpuCounters_None;
+}
+
+void GpuCounters_Begin()
+{
+    if( gc.backend == GpuCounters_Intel )
+        glBeginPerfQueryINTEL( gc.queryHandle );
+    else if( gc.backend == GpuCounters_AMD )
+        glBeginPerfMonitorAMD( gc.monitor );
+}
+
+double GpuCounters_End()
+{
+    double bytes = 0.0;
+
+    if( gc.backend == GpuCounters_Intel ){
+        glEndPerfQueryINTEL( gc.queryHandle );
+
+        GLubyte *data = (GLubyte*) malloc( gc.dataSize );
+        GLuint written = 0;
+        glGetPerfQueryDataINTEL( gc.queryHandle, GL_PERFQUERY_WAIT_INTEL, gc.dataSize, data, &written );
+        for( int i = 0; i < gc.numCounters; i++ ){
+            const GLubyte *v = data + gc.offsets[i];
+            switch( gc.dataTypes[i] ){
+                case GL_PERFQUERY_COUNTER_DATA_UINT32_INTEL: bytes += *(const uint32_t*)v; break;
+                case GL_PERFQUERY_COUNTER_DATA_UINT64_INTEL: bytes += (double)*(const uint64_t*)v; break;
+                case GL_PERFQUERY_COUNTER_DATA_FLOAT_INTEL: bytes += *(const float*)v; break;
+                case GL_PERFQUERY_COUNTER_DATA_DOUBLE_INTEL: bytes += *(const double*)v; break;
+                default: break;
+            }
+        }
+        free( data );
+        return bytes;
+    }
+
+    if( gc.backend == GpuCounters_AMD ){
+        glEndPerfMonitorAMD( gc.monitor );
+
+        GLuint available = 0;
+        while( !available )
+            glGetPerfMonitorCounterDataAMD( gc.monitor, GL_PERFMON_RESULT_AVAILABLE_AMD, sizeof(available), &available, NULL );
+
+        GLuint size = 0;
+        glGetPerfMonitorCounterDataAMD( gc.monitor, GL_PERFMON_RESULT_SIZE_AMD, sizeof(size), &size, NULL );
+        GLuint *data = (GLuint*) malloc( size );
+        GLint written = 0;
+        glGetPerfMonitorCounterDataAMD( gc.monitor, GL_PERFMON_RESULT_AMD, size, data, &written );
+
+        // (group, counter, value) records, the value size depends on the counter type
+        for( GLint i = 0; i + 2 < written / (GLint)sizeof(GLuint); ){
+            const GLuint group = data[i++];
+            const GLuint counter = data[i++];
+            GLenum type = GL_UNSIGNED_INT;
+            for( int k = 0; k < gc.numCounters; k++ ){
+                if( gc.groups[k] == group && gc.counters[k] == counter )
+                    type = gc.types[k];
+            }
+
+            if( type == GL_UNSIGNED_INT64_AMD ){
+                uint64_t v;
+                memcpy( &v, &data[i], sizeof(v) );
+                bytes += (double)v;
+                i += 2;
+            }
+            else if( type == GL_FLOAT ){
+                float v;
+                memcpy( &v, &data[i], sizeof(v) );
+                bytes += v;
+                i++;
+            }
+            else {
+                bytes += data[i];
+                i++;
+            }
+        }
+        free( data );
+        return bytes;
+    }
+
+    return -1.0;
+}
+
+/*
+ * GPU timer, a ring of timestamp query pairs
+ */
+#if IS_GlEs
+#define GpuTimer_TIMESTAMP              GL_TIMESTAMP_EXT
+#define GpuTimer_GenQueries             glGenQueriesEXT
+#define GpuTimer_QueryCounter           glQueryCounterEXT
+#define GpuTimer_GetQueryObjectuiv      glGetQueryObjectuivEXT
+#define GpuTimer_GetQueryObjectui64v    glGetQueryObjectui64vEXT
+#else
+#define GpuTimer_TIMESTAMP              GL_TIMESTAMP
+#define GpuTimer_GenQueries             glGenQueries
+#define GpuTimer_QueryCounter           glQueryCounter
+#define GpuTimer_GetQueryObjectuiv      glGetQueryObjectuiv
+#define GpuTimer_GetQueryObjectui64v    glGetQueryObjectui64v
+#endif
+
+#define GpuTimer_Max        64      // intervals in flight
+#define GpuTimer_MaxDepth   8
+
+typedef struct{
+    const char *name;
+    int ended;
+}GpuInterval;
+
+// per thread, as the context is
+static thread_local struct{
+    int supported;              // -1: not asked yet
+    int64_t offsetNs;           // trace clock - GPU clock
+    GLuint queries[GpuTimer_Max * 2];
+    GpuInterval intervals[GpuTimer_Max];
+    unsigned head, tail;        // intervals [tail, head) are pending
+    unsigned open[GpuTimer_MaxDepth];
+    int depth;
+} gt = { -1 };
+
+// the names of the last context are gone with it
+static void GpuTimer_Reset()
+{
+    gt.supported = -1;
+    gt.head = gt.tail = 0;
+    gt.depth = 0;
+}
+
+int GpuTimer_Supported()
+{
+    if( gt.supported != -1 )
+        return gt.supported;
+
+#if IS_GlEs
+    gt.supported = GLAD_GL_EXT_disjoint_timer_query;
+#else
+    // a GLES context in a glad_gl build has no timestamp queries without the EXT entry points
+    gt.supported = !glContextIsEs() && glVersionAtLeast( 3, 3, 0, 0 );
+#endif
+    if( !gt.supported )
+        return 0;
+
+    GpuTimer_GenQueries( GpuTimer_Max * 2, gt.queries );
+    GLint64 gpuNs = 0;
+    glGetInteger64v( GpuTimer_TIMESTAMP, &gpuNs );
+    gt.offsetNs = (int64_t)PerfTrace_Now() - gpuNs;
+    return 1;
+}
+
+void GpuTimer_Begin( const char *name )
+{
+    if( !GpuTimer_Supported() )
+        return;
+    if( gt.head - gt.tail == GpuTimer_Max )
+        GpuTimer_Collect( 1 );
+    if( gt.head - gt.tail == GpuTimer_Max || gt.depth == GpuTimer_MaxDepth )
+        return;
+
+    const unsigned slot = gt.head % GpuTimer_Max;
+    gt.intervals[slot].name = name;
+    gt.intervals[slot].ended = 0;
+    GpuTimer_QueryCounter( gt.queries[slot * 2], GpuTimer_TIMESTAMP );
+    gt.open[gt.depth++] = slot;
+    gt.head++;
+}
+
+void GpuTimer_End()
+{
+    if( !GpuTimer_Supported() || gt.depth == 0 )
+        return;
+
+    const unsigned slot = gt.open[--gt.depth];
+    GpuTimer_QueryCounter( gt.queries[slot * 2 + 1], GpuTimer_TIMESTAMP );
+    gt.intervals[slot].ended = 1;
+}
+
+void GpuTimer_Collect( int wait )
+{
+    if( !GpuTimer_Supported() )
+        return;
+
+#if IS_GlEs
+    // the GPU was reset or its clock changed: pending results are meaningless
+    GLint disjoint = 0;
+    glGetIntegerv( GL_GPU_DISJOINT_EXT, &disjoint );
+    if( disjoint ){
+        while( gt.tail != gt.head && gt.intervals[gt.tail % GpuTimer_Max].ended )
+            gt.tail++;
+        return;
+    }
+#endif
+
+    while( gt.tail != gt.head ){
+        const unsigned slot = gt.tail % GpuTimer_Max;
+        if( !gt.intervals[slot].ended )
+            break;
+        if( !wait ){
+            GLuint available = 0;
+            GpuTimer_GetQueryObjectuiv( gt.queries[slot * 2 + 1], GL_QUERY_RESULT_AVAILABLE, &available );
+            if( !available )
+                break;
+        }
+
+        GLuint64 start = 0, end = 0;
+        GpuTimer_GetQueryObjectui64v( gt.queries[slot * 2], GL_QUERY_RESULT, &start );
+        GpuTimer_GetQueryObjectui64v( gt.queries[slot * 2 + 1], GL_QUERY_RESULT, &end );
+        PerfTrace_GpuComplete( gt.intervals[slot].name, start + gt.offsetNs, end + gt.offsetNs );
+        gt.tail++;
+    }
+}
+
+// the PerfMeasureRate() iteration hooks
+static void GpuTimer_IterationBegin()
+{
+    GpuTimer_Begin( "iteration" );
+}
+
+static void GpuTimer_IterationEnd()
+{
+    GpuTimer_End();
+    GpuTimer_Collect( 0 );
+}
+
+/*
+ * Redundant GL state filtering (state shadowing cache)
+ */
+#define StateCache_Unknown    0xFFFFFFFFu
+#define StateCache_MaxCaps    32
+#define StateCache_MaxUnits   32
+
+enum {
+    TexTarget_2D,
+    TexTarget_2DArray,
+    TexTarget_3D,
+    TexTarget_CubeMap,
+    TexTarget_2DMultisample,
+    TexTarget_Count
+};
+
+enum {
+    BufTarget_Array,
+    BufTarget_ElementArray,
+    BufTarget_Uniform,
+    BufTarget_PixelPack,
+    BufTarget_PixelUnpack,
+    BufTarget_CopyRead,
+    BufTarget_CopyWrite,
+    BufTarget_ShaderStorage,
+    BufTarget_DrawIndirect,
+    BufTarget_Count
+};
+
+typedef struct{
+    GLsizei bytes;
+    GLubyte data[16 * sizeof(GLfloat)];
+}UniformShadow;
+
+static struct{
+    struct{
+        GLenum cap;
+        int8_t enabled; // -1: unknown
+    } caps[StateCache_MaxCaps];
+    int numCaps;
+
+    GLuint program;
+    GLuint vertexArray;
+    GLuint activeUnit;
+    GLuint textures[StateCache_MaxUnits][TexTarget_Count];
+    GLuint drawFramebuffer;
+    GLuint readFramebuffer;
+    GLuint buffers[BufTarget_Count];
+
+    GLenum blendSrc, blendDst;
+    GLenum blendEquation;
+    GLenum depthFunc;
+    GLuint depthMask;
+    GLenum stencilFunc;
+    GLint stencilRef;
+    GLuint stencilFuncMask;
+    GLenum stencilSfail, stencilDpfail, stencilDppass;
+    GLuint stencilWriteMask;
+    int stencilFuncValid;
+    int stencilWriteMaskValid;
+
+    // key: program << 32 | location
+    std::unordered_map<uint64_t, UniformShadow> uniforms;
+
+    glStateCacheStats_t stats;
+} sc = { .numCaps = -1 };
+
+static inline void StateCache_CheckInit()
+{
+    if( sc.numCaps < 0 )
+        StateCache_Invalidate();
+}
+
+static inline int StateCache_Filter( int redundant )
+{
+    if( redundant ){
+        sc.stats.elided++;
+        return 1;
+    }
+    sc.stats.issued++;
+    return 0;
+}
+
+static int TexTargetIndex( GLenum target )
+{
+    switch( target ){
+        case GL_TEXTURE_2D: return TexTarget_2D;
+        case GL_TEXTURE_2D_ARRAY: return TexTarget_2DArray;
+        case GL_TEXTURE_3D: return TexTarget_3D;
+        case GL_TEXTURE_CUBE_MAP: return TexTarget_CubeMap;
+        case GL_TEXTURE_2D_MULTISAMPLE: return TexTarget_2DMultisample;
+        default: return -1;
+    }
+}
+
+static int BufTargetIndex( GLenum target )
+{
+    switch( target ){
+        case GL_ARRAY_BUFFER: return BufTarget_Array;
+        case GL_ELEMENT_ARRAY_BUFFER: return BufTarget_ElementArray;
+        case GL_UNIFORM_BUFFER: return BufTarget_Uniform;
+        case GL_PIXEL_PACK_BUFFER: return BufTarget_PixelPack;
+        case GL_PIXEL_UNPACK_BUFFER: return BufTarget_PixelUnpack;
+        case GL_COPY_READ_BUFFER: return BufTarget_CopyRead;
+        case GL_COPY_WRITE_BUFFER: return BufTarget_CopyWrite;
+        case GL_SHADER_STORAGE_BUFFER: return BufTarget_ShaderStorage;
+        case GL_DRAW_INDIRECT_BUFFER: return BufTarget_DrawIndirect;
+        default: return -1;
+    }
+}
+
+void StateCache_Invalidate()
+{
+    sc.numCaps = 0;
+
+    sc.program = StateCache_Unknown;
+    sc.vertexArray = StateCache_Unknown;
+    sc.activeUnit = StateCache_Unknown;
+    for( int i=0; i < StateCache_MaxUnits; i++ ){
+        for( int j=0; j < TexTarget_Count; j++ )
+            sc.textures[i][j] = StateCache_Unknown;
+    }
+    sc.drawFramebuffer = StateCache_Unknown;
+    sc.readFramebuffer = StateCache_Unknown;
+    for( int i=0; i < BufTarget_Count; i++ )
+        sc.buffers[i] = StateCache_Unknown;
+
+    sc.blendSrc = sc.blendDst = StateCache_Unknown;
+    sc.blendEquation = StateCache_Unknown;
+    sc.depthFunc = StateCache_Unknown;
+    sc.depthMask = StateCache_Unknown;
+    sc.stencilFuncValid = 0;
+    sc.stencilSfail = sc.stencilDpfail = sc.stencilDppass = StateCache_Unknown;
+    sc.stencilWriteMaskValid = 0;
+
+    sc.uniforms.clear();
+}
+
+void StateCache_ResetStats()
+{
+    sc.stats.issued = 0;
+    sc.stats.elided = 0;
+}
+
+glStateCacheStats_t StateCache_GetStats()
+{
+    return sc.stats;
+}
+
+static void StateCache_SetCap( GLenum cap, int8_t enabled )
+{
+    StateCache_CheckInit();
+
+    int i;
+    for( i=0; i < sc.numCaps; i++ ){
+        if( sc.caps[i].cap == cap )
+            break;
+    }
+    if( i == sc.numCaps ){
+        if( sc.numCaps < StateCache_MaxCaps ){
+            sc.caps[i].cap = cap;
+            sc.caps[i].enabled = -1;
+            sc.numCaps++;
+        }else{
+            i = -1; // table full, pass through
+        }
+    }
+
+    if( StateCache_Filter( i >= 0 && sc.caps[i].enabled == enabled ) )
+        return;
+
+    if( enabled )
+        glEnable( cap );
+    else
+        glDisable( cap );
+    if( i >= 0 )
+        sc.caps[i].enabled = enabled;
+}
+
+void StateCache_Enable( GLenum cap )
+{
+    StateCache_SetCap( cap, 1 );
+}
+
+void StateCache_Disable( GLenum cap )
+{
+    StateCache_SetCap( cap, 0 );
+}
+
+void StateCache_UseProgram( GLuint program )
+{
+    StateCache_CheckInit();
+    if( StateCache_Filter( sc.program == program ) )
+        return;
+
+    glUseProgram( program );
+    sc.program = program;
+}
+
+void StateCache_BindVertexArray( GLuint array )
+{
+    StateCache_CheckInit();
+    if( StateCache_Filter( sc.vertexArray == array ) )
+        return;
+
+    glBindVertexArray( array );
+    sc.vertexArray = array;
+
+    // GL_ELEMENT_ARRAY_BUFFER binding is part of the VAO state
+    sc.buffers[BufTarget_ElementArray] = StateCache_Unknown;
+}
+
+void StateCache_BindTexture( GLuint unit, GLenum target, GLuint texture )
+{
+    StateCache_CheckInit();
+
+    const int t = TexTargetIndex( target );
+    const int known = (t >= 0 && unit < StateCache_MaxUnits);
+    if( StateCache_Filter( known && sc.textures[unit][t] == texture ) )
+        return;
+
+    if( sc.activeUnit != unit ){
+        glActiveTexture( GL_TEXTURE0 + unit );
+        sc.activeUnit = unit;
+        sc.stats.issued++;
+    }
+    glBindTexture( target, texture );
+    if( known )
+        sc.textures[unit][t] = texture;
+}
+
+void StateCache_BindFramebuffer( GLenum target, GLuint framebuffer )
+{
+    StateCache_CheckInit();
+
+    int redundant;
+    if( target == GL_DRAW_FRAMEBUFFER )
+        redundant = (sc.drawFramebuffer == framebuffer);
+    else if( target == GL_READ_FRAMEBUFFER )
+        redundant = (sc.readFramebuffer == framebuffer);
+    else
+        redundant = (sc.drawFramebuffer == framebuffer && sc.readFramebuffer == framebuffer);
+    if( StateCache_Filter( redundant ) )
+        return;
+
+    glBindFramebuffer( target, framebuffer );
+    if( target != GL_READ_FRAMEBUFFER )
+        sc.drawFramebuffer = framebuffer;
+    if( target != GL_DRAW_FRAMEBUFFER )
+        sc.readFramebuffer = framebuffer;
+}
+
+void StateCache_BindBuffer( GLenum target, GLuint buffer )
+{
+    StateCache_CheckInit();
+
+    const int t = BufTargetIndex( target );
+    if( StateCache_Filter( t >= 0 && sc.buffers[t] == buffer ) )
+        return;
+
+    glBindBuffer( target, buffer );
+    if( t >= 0 )
+        sc.buffers[t] = buffer;
+}
+
+void StateCache_BlendFunc( GLenum sfactor, GLenum dfactor )
+{
+    StateCache_CheckInit();
+    if( StateCache_Filter( sc.blendSrc == sfactor && sc.blendDst == dfactor ) )
+        return;
+
+    glBlendFunc( sfactor, dfactor );
+    sc.blendSrc = sfactor;
+    sc.blendDst = dfactor;
+}
+
+void StateCache_BlendEquation( GLenum mode )
+{
+    StateCache_CheckInit();
+    if( StateCache_Filter( sc.blendEquation == mode ) )
+        return;
+
+    glBlendEquation( mode );
+    sc.blendEquation = mode;
+}
+
+void StateCache_DepthFunc( GLenum func )
+{
+    StateCache_CheckInit();
+    if( StateCache_Filter( sc.depthFunc == func ) )
+        return;
+
+    glDepthFunc( func );
+    sc.depthFunc = func;
+}
+
+void StateCache_DepthMask( GLboolean flag )
+{
+    StateCache_CheckInit();
+    if( StateCache_Filter( sc.depthMask == flag ) )
+        return;
+
+    glDepthMask( flag );
+    sc.depthMask = flag;
+}
+
+void StateCache_StencilFunc( GLenum func, GLint ref, GLuint mask )
+{
+    StateCache_CheckInit();
+    if( StateCache_Filter( sc.stencilFuncValid
+                           && sc.stencilFunc == func && sc.stencilRef == ref && sc.stencilFuncMask == mask ) )
+        return;
+
+    glStencilFunc( func, ref, mask );
+    sc.stencilFunc = func;
+    sc.stencilRef = ref;
+    sc.stencilFuncMask = mask;
+    sc.stencilFuncValid = 1;
+}
+
+void StateCache_StencilOp( GLenum sfail, GLenum dpfail, GLenum dppass )
+{
+    StateCache_CheckInit();
+    if( StateCache_Filter( sc.stencilSfail == sfail && sc.stencilDpfail == dpfail && sc.stencilDppass == dppass ) )
+        return;
+
+    glStencilOp( sfail, dpfail, dppass );
+    sc.stencilSfail = sfail;
+    sc.stencilDpfail = dpfail;
+    sc.stencilDppass = dppass;
+}
+
+void StateCache_StencilMask( GLuint mask )
+{
+    StateCache_CheckInit();
+    if( StateCache_Filter( sc.stencilWriteMaskValid && sc.stencilWriteMask == mask ) )
+        return;
+
+    glStencilMask( mask );
+    sc.stencilWriteMask = mask;
+    sc.stencilWriteMaskValid = 1;
+}
+
+/*
+ * Return 1 if uniform 'location' of the current program already holds 'data'.
+ * Otherwise remember 'data' as its new value and return 0.
+ */
+static int UniformIsRedundant( GLint location, const void *data, GLsizei bytes )
+{
+    StateCache_CheckInit();
+
+    if( sc.program == StateCache_Unknown || location < 0 )
+        return 0;
+
+    const uint64_t key = ((uint64_t)sc.program << 32) | (uint32_t)location;
+    if( bytes > (GLsizei)sizeof(UniformShadow::data) ){
+        // too large to shadow: the old value is stale now
+        sc.uniforms.erase( key );
+        return 0;
+    }
+    UniformShadow &shadow = sc.uniforms[key];
+    if( shadow.bytes == bytes && memcmp( shadow.data, data, bytes ) == 0 )
+        return 1;
+
+    shadow.bytes = bytes;
+    memcpy( shadow.data, data, bytes );
+    return 0;
+}
+
+void StateCache_Uniform1i( GLint location, GLint v0 )
+{
+    if( StateCache_Filter( UniformIsRedundant( location, &v0, sizeof(v0) ) ) )
+        return;
+
+    glUniform1i( location, v0 );
+}
+
+void StateCache_Uniform4f( GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3 )
+{
+    const GLfloat v[4] = { v0, v1, v2, v3 };
+    if( StateCache_Filter( UniformIsRedundant( location, v, sizeof(v) ) ) )
+        return;
+
+    glUniform4f( location, v0, v1, v2, v3 );
+}
+
+void StateCache_Uniform4fv( GLint location, GLsizei count, const GLfloat *value )
+{
+    if( StateCache_Filter( UniformIsRedundant( location, value, count * 4 * sizeof(GLfloat) ) ) )
+        return;
+
+    glUniform4fv( location, count, value );
+}
+
+void StateCache_UniformMatrix4fv( GLint location, GLsizei count, GLboolean transpose, const GLfloat *value )
+{
+    StateCache_CheckInit();
+
+    // a transposed upload is not shadowed, just forget what we knew about the location
+    if( transpose ){
+        if( sc.program != StateCache_Unknown )
+            sc.uniforms.erase( ((uint64_t)sc.program << 32) | (uint32_t)location );
+        sc.stats.issued++;
+        glUniformMatrix4fv( location, count, transpose, value );
+        return;
+    }
+
+    if( StateCache_Filter( UniformIsRedundant( location, value, count * 16 * sizeof(GLfloat) ) ) )
+        return;
+
+    glUniformMatrix4fv( location, count, transpose, value );
+}
@@ -4,6 +4,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "myUtils.h"
+#include "imageCompare.h"
+#include "golden.h"
 
 #define glErrorCheck() \
     {\
@@ -20,8 +22,20 @@ const char* framebufferStatusName( GLenum status );
 const char* glContextProfileBitName( GLint profileBit );
 const char* glContextFlagName( GLint flag );
 const char* glFormatName( GLenum format );
+const char* glTypeName( GLenum type );
 const char* glslVersion( api_t api );
 
+/*
+ * glad loader for the current context, isEs: it is a GLES context. return the glad version, 0 on failure.
+ * The glad_gl table is a superset of gles2.h, so a glad_gl build can drive GLES 3.0+ contexts: every entry point is
+ * loaded then and GLAD_GL_VERSION_x tell nothing, ask glContextIsEs() / glVersionAtLeast() instead.
+ * With $GL_TRACE=1 the loaded pointers are wrapped by the call tracer, see glTrace.h.
+ */
+int LoadGLFunctions( GLADloadfunc load, int isEs );
+int glContextIsEs();
+int glVersionAtLeast( int glMajor, int glMinor, int esMajor, int esMinor );    // of the current context
+int glHasExtension( const char *name );     // of the current context, for extensions the glad table doesn't know
+
 #if IS_GlLegacy
 void MatrixPrint( GLenum pname, const char *file, int line );
 #endif
@@ -29,6 +43,11 @@ void MatrixPrint( GLenum pname, const char *file, int line );
 GLuint CreateShaderFromSource( GLenum type, const char *shaderSource );
 GLuint CreateProgramFromShader( GLuint vertShader, GLuint fragShader );
 GLuint CreateProgramFromSource( const char *vertShaderSource, const char *fragShaderSource );
+// shader bodies without #version: glslVersion( api ) is prepended, and a default float precision for GLES fragments
+GLuint CreateProgramFromBody( api_t api, const char *vertBody, const char *fragBody );
+GLuint CreateComputeProgramFromSource( const char *compShaderSource );  // GL 4.3 / GLES 3.1
+// without #version: #version 430, or 310 es and highp defaults, for the kind of the current context
+GLuint CreateComputeProgramFromBody( const char *compShaderBody );
 
 GLuint CreateTexture_FillWithCheckboard( GLsizei width, GLsizei height );
 
@@ -38,3 +57,114 @@ void ReadPixels_FromFboColorAttachment( void *dstData, GLuint texture, GLint x,
 #if !IS_GlEs
 void ReadPixels_FromTexture( void *dstData, GLuint texture, GLenum format, GLenum type );
 #endif
+
+// compute shader version of glGenerateMipmap(), levels (baseLevel, maxLevel]. GL 4.3 / GLES 3.1
+void GenerateMipmap_Compute( GLuint texture, GLsizei width, GLsizei height, GLint baseLevel, GLint maxLevel );
+
+/*
+ * Compare 2 textures of the same size on the GPU, reading back only the metrics of ImageCompare_CPU().
+ *   channels: 1 ~ 4, the first ones compared, as 8-bit values. GL 4.3 / GLES 3.1 compute shader,
+ *   return 0 if not supported, then use ImageCompare_CPU(). Changes the program, texture units 0 and 1.
+ *   Level 0 is read whatever the filters of the textures, a sampler with GL_NEAREST is bound while comparing.
+ */
+int ImageCompare_GPU( GLuint texA, GLuint texB, GLsizei width, GLsizei height, int channels, ImageCompareResult *result );
+// ImageCompare_GPU(), or both textures read back and ImageCompare_CPU(). return 1 if compared on the GPU
+int ImageCompare_Textures( GLuint texA, GLuint texB, GLsizei width, GLsizei height, int channels, ImageCompareResult *result );
+// glReadPixels() RGBA of the read framebuffer, Golden_Submit() under GL_RENDERER; api is API_CurrentName of the caller
+void Golden_SubmitFramebuffer( const char *test, const char *api, GLint x, GLint y, GLsizei width, GLsizei height,
+                               const GoldenTolerance *tolerance );
+
+/*
+ * Offscreen render target, of any size up to RenderTarget_MaxSize(), not tied to the window:
+ *   colorFormat: GL_RGBA8, GL_RGB10_A2, GL_RGBA16F, or GL_NONE
+ *   depthStencilFormat: GL_DEPTH24_STENCIL8, or GL_NONE
+ *   samples: 0 for a single sampled target, whose color is a texture, else multisampled renderbuffers
+ */
+typedef struct{
+    GLenum internalFormat;
+    GLenum format, type;            // glTexImage2D()
+    GLsizei bytesPerPixel;
+    GLenum readFormat, readType;    // glReadPixels() format/type every implementation supports
+    GLsizei readBytesPerPixel;
+    const char *name;
+}RenderTargetFormat;
+
+typedef struct{
+    GLsizei width, height;
+    GLsizei samples;
+    const RenderTargetFormat *color;
+    GLenum depthStencilFormat;
+    GLuint fbo;
+    GLuint colorTexture;            // samples == 0
+    GLuint colorRenderbuffer;       // samples > 0
+    GLuint depthStencilRenderbuffer;
+}RenderTarget;
+
+const RenderTargetFormat* RenderTarget_GetFormat( GLenum internalFormat );  // NULL if not supported here
+GLsizei RenderTarget_MaxSize();     // min of GL_MAX_RENDERBUFFER_SIZE, GL_MAX_TEXTURE_SIZE, GL_MAX_VIEWPORT_DIMS
+
+// return 1 and leave the target bound, or 0 if the driver can't create it (format not renderable, out of memory...)
+int RenderTarget_Create( RenderTarget *rt, GLsizei width, GLsizei height, GLenum colorFormat, GLenum depthStencilFormat, GLsizei samples );
+void RenderTarget_Destroy( RenderTarget *rt );
+// bind as draw and read framebuffer, and set the viewport to the whole target
+void RenderTarget_Bind( const RenderTarget *rt );
+// bytes written by a full target clear or fill, all attachments
+double RenderTarget_Bytes( const RenderTarget *rt );
+
+/*
+ * GPU memory traffic from vendor performance counters, GL_INTEL_performance_query or GL_AMD_performance_monitor.
+ *   Counters are picked by name (read/write/written and bytes, rates excluded), so the result is an estimate;
+ *   GpuCounters_Init() prints the counters it picked.
+ */
+int GpuCounters_Init();         // return 1 if bandwidth counters are exposed
+void GpuCounters_Begin();
+double GpuCounters_End();       // bytes read + written since GpuCounters_Begin(), or -1 if not available
+
+/*
+ * GPU intervals from timestamp queries, GL 3.3 or GL_EXT_disjoint_timer_query (GLES build), recorded on the GPU
+ * track of the $PERF_TRACE timeline, see perfTrace.h. Begin/End nest, up to 8 deep. Results are read back by
+ * GpuTimer_Collect(), which waits for pending queries only if asked to; GPU times are mapped to the trace clock
+ * with one GL_TIMESTAMP read. LoadGLFunctions() resets the timer of the calling thread for the new context.
+ */
+int GpuTimer_Supported();       // of the current context
+void GpuTimer_Begin( const char *name );    // name: a string literal
+void GpuTimer_End();
+void GpuTimer_Collect( int wait );
+
+/*
+ * Redundant GL state filtering (state shadowing cache)
+ *   StateCache_XXX() mirror the corresponding glXXX() calls, but remember the last value that was set
+ *   and drop the call if it would not change anything. The shadow only knows about state that went
+ *   through StateCache_XXX(), so call StateCache_Invalidate() after changing state with raw GL calls,
+ *   or after deleting objects whose names may be reused.
+ */
+typedef struct{
+    uint64_t issued;  // GL calls really issued
+    uint64_t elided;  // redundant calls dropped
+}glStateCacheStats_t;
+
+void StateCache_Invalidate();
+void StateCache_ResetStats();
+glStateCacheStats_t StateCache_GetStats();
+
+void StateCache_Enable( GLenum cap );
+void StateCache_Disable( GLenum cap );
+
+void StateCache_UseProgram( GLuint program );
+void StateCache_BindVertexArray( GLuint array );
+void StateCache_BindTexture( GLuint unit, GLenum target, GLuint texture );
+void StateCache_BindFramebuffer( GLenum target, GLuint framebuffer );
+void StateCache_BindBuffer( GLenum target, GLuint buffer );
+
+void StateCache_BlendFunc( GLenum sfactor, GLenum dfactor );
+void StateCache_BlendEquation( GLenum mode );
+void StateCache_DepthFunc( GLenum func );
+void StateCache_DepthMask( GLboolean flag );
+void StateCache_StencilFunc( GLenum func, GLint ref, GLuint mask );
+void StateCache_StencilOp( GLenum sfail, GLenum dpfail, GLenum dppass );
+void StateCache_StencilMask( GLuint mask );
+
+void StateCache_Uniform1i( GLint location, GLint v0 );
+void StateCache_Uniform4f( GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3 );
+void StateCache_Uniform4fv( GLint location, GLsizei count, const GLfloat *value );
+void StateCache_UniformMatrix4fv( GLint location, GLsizei count, GLboolean transpose, const GLfloat *value );
@@ -3,6 +3,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "glfwUtils.h"
+#include "glUtils.h"
 
 static void error_callback(int error, const char* description)
 {
@@ -62,11 +63,7 @@ GLFWwindow* glfw_CreateWindow(api_t api, int width, int height )
     // ---------------------------------------
     glfwMakeContextCurrent(window);
     glfwSwapInterval(1);
-#if IS_GlEs
-    int version = gladLoadGLES2(glfwGetProcAddress);
-#else
-    int version = gladLoadGL(glfwGetProcAddress);
-#endif
+    int version = LoadGLFunctions(glfwGetProcAddress, api.api == API_GLES);
     printf("%s: glad load version: %d.%d\n", __func__, GLAD_VERSION_MAJOR(version), GLAD_VERSION_MINOR(version));
 
     // some queries
@@ -0,0 +1,510 @@
+#include <filesystem>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "golden.h"
+#include "pixelConvert.h"
+#include "project_config.h"
+
+// static copies, the programs define their own stb implementations; most of the functions are not used here
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+#define STB_IMAGE_IMPLEMENTATION
+#define STB_IMAGE_STATIC
+#include "stb_image.h"
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#define STB_IMAGE_WRITE_STATIC
+#include "stb_image_write.h"
+#pragma GCC diagnostic pop
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+
+static int Update = -1;     // -1: from $GOLDEN_UPDATE
+static int Threads = 0;
+#define MaxThreads 16
+
+GoldenTolerance Golden_DefaultTolerance()
+{
+    GoldenTolerance tolerance;
+    tolerance.maxChannelDelta = 2;
+    tolerance.maxBadPixels = 0.001;
+    tolerance.minPsnr = 0.0;
+    tolerance.minSsim = 0.98;
+    return tolerance;
+}
+
+void Golden_SetUpdate( int update )
+{
+    Update = update;
+}
+
+void Golden_SetThreads( int threads )
+{
+    Threads = (threads > MaxThreads) ? MaxThreads : threads;
+}
+
+static int GetUpdate()
+{
+    if( Update < 0 ){
+        const char *env = getenv( "GOLDEN_UPDATE" );
+        Update = (env != NULL && atoi( env ) != 0);
+    }
+    return Update;
+}
+
+static int GetThreads()
+{
+    if( Threads > 0 )
+        return Threads;
+
+    const long cpus = sysconf( _SC_NPROCESSORS_ONLN );
+    if( cpus < 1 )
+        return 1;
+    return (cpus > MaxThreads) ? MaxThreads : (int)cpus;
+}
+
+static const char* EnvOr( const char *name, const char *fallback )
+{
+    const char *env = getenv( name );
+    return (env != NULL && env[0] != '\0') ? env : fallback;
+}
+
+/* renderer strings such as "llvmpipe (LLVM 15.0.7, 256 bits)" as a file name */
+static void SafeName( char *dst, size_t size, const char *src )
+{
+    size_t n = 0;
+    int underscore = 0;
+    for( ; *src != '\0' && n + 1 < size; src++ ){
+        const char c = *src;
+        if( (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '.' || c == '-' ){
+            dst[n++] = c;
+            underscore = 0;
+        }else if( !underscore && n > 0 ){
+            dst[n++] = '_';
+            underscore = 1;
+        }
+    }
+    while( n > 0 && dst[n-1] == '_' )
+        n--;
+    dst[n] = '\0';
+}
+
+//-----------------------------------------------------------------------------------------
+//  metrics
+//-----------------------------------------------------------------------------------------
+/* RGBA8 pixels with any channel differing more than delta */
+static uint64_t CountBadPixels( const uint8_t *a, const uint8_t *b, size_t pixels, int delta )
+{
+    size_t i = 0;
+    uint64_t bad = 0;
+#if defined(__SSE2__)
+    const __m128i tolerance = _mm_set1_epi8( (char)delta );
+    const __m128i zero = _mm_setzero_si128();
+    for( ; i + 4 <= pixels; i += 4 ){
+        const __m128i va = _mm_loadu_si128( (const __m128i*)(a + i * 4) );
+        const __m128i vb = _mm_loadu_si128( (const __m128i*)(b + i * 4) );
+        const __m128i d = _mm_or_si128( _mm_subs_epu8( va, vb ), _mm_subs_epu8( vb, va ) );
+        // bytes over the tolerance stay non zero, a pixel is good when its 32 bits are zero
+        const __m128i over = _mm_subs_epu8( d, tolerance );
+        const int good = _mm_movemask_ps( _mm_castsi128_ps( _mm_cmpeq_epi32( over, zero ) ) );
+        bad += 4 - __builtin_popcount( good );
+    }
+#elif defined(__aarch64__)
+    const uint8x16_t tolerance = vdupq_n_u8( (uint8_t)delta );
+    for( ; i + 4 <= pixels; i += 4 ){
+        const uint8x16_t d = vabdq_u8( vld1q_u8( a + i * 4 ), vld1q_u8( b + i * 4 ) );
+        const uint32x4_t over = vreinterpretq_u32_u8( vcgtq_u8( d, tolerance ) );
+        bad += vaddvq_u32( vshrq_n_u32( vtstq_u32( over, over ), 31 ) );
+    }
+#endif
+    for( ; i < pixels; i++ ){
+        for( int c=0; c < 4; c++ ){
+            const int d = abs( (int)a[i*4+c] - (int)b[i*4+c] );
+            if( d > delta ){
+                bad++;
+                break;
+            }
+        }
+    }
+    return bad;
+}
+
+static void Luma( const uint8_t *rgba, uint8_t *y, size_t pixels )
+{
+    for( size_t i = 0; i < pixels; i++ )
+        y[i] = (uint8_t)((77 * rgba[i*4] + 150 * rgba[i*4+1] + 29 * rgba[i*4+2] + 128) >> 8);
+}
+
+/* sums of a, b, a*a, b*b, a*b over a window */
+typedef struct{
+    uint32_t a, b, aa, bb, ab;
+}WindowSums;
+
+static void SumWindow( const uint8_t *a, const uint8_t *b, int stride, int w, int h, WindowSums *s )
+{
+    memset( s, 0, sizeof(*s) );
+    int y = 0;
+#if defined(__SSE2__)
+    if( w == 8 ){
+        const __m128i zero = _mm_setzero_si128();
+        __m128i sa = zero, sb = zero, saa = zero, sbb = zero, sab = zero;
+        for( ; y < h; y++ ){
+            const __m128i va = _mm_loadl_epi64( (const __m128i*)(a + y * stride) );
+            const __m128i vb = _mm_loadl_epi64( (const __m128i*)(b + y * stride) );
+            sa = _mm_add_epi32( sa, _mm_sad_epu8( va, zero ) );
+            sb = _mm_add_epi32( sb, _mm_sad_epu8( vb, zero ) );
+            const __m128i a16 = _mm_unpacklo_epi8( va, zero );
+            const __m128i b16 = _mm_unpacklo_epi8( vb, zero );
+            saa = _mm_add_epi32( saa, _mm_madd_epi16( a16, a16 ) );
+            sbb = _mm_add_epi32( sbb, _mm_madd_epi16( b16, b16 ) );
+            sab = _mm_add_epi32( sab, _mm_madd_epi16( a16, b16 ) );
+        }
+        uint32_t lanes[4];
+        s->a = (uint32_t)_mm_cvtsi128_si32( sa );
+        s->b = (uint32_t)_mm_cvtsi128_si32( sb );
+        _mm_storeu_si128( (__m128i*)lanes, saa );
+        s->aa = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+        _mm_storeu_si128( (__m128i*)lanes, sbb );
+        s->bb = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+        _mm_storeu_si128( (__m128i*)lanes, sab );
+        s->ab = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+        return;
+    }
+#elif defined(__aarch64__)
+    if( w == 8 ){
+        uint32x4_t saa = vdupq_n_u32( 0 ), sbb = saa, sab = saa;
+        uint16x8_t sa = vdupq_n_u16( 0 ), sb = sa;
+        for( ; y < h; y++ ){
+            const uint8x8_t va = vld1_u8( a + y * stride );
+            const uint8x8_t vb = vld1_u8( b + y * stride );
+            sa = vaddw_u8( sa, va );
+            sb = vaddw_u8( sb, vb );
+            const uint16x8_t aa = vmull_u8( va, va );
+            const uint16x8_t bb = vmull_u8( vb, vb );
+            const uint16x8_t ab = vmull_u8( va, vb );
+            saa = vpadalq_u16( saa, aa );
+            sbb = vpadalq_u16( sbb, bb );
+            sab = vpadalq_u16( sab, ab );
+        }
+        s->a = vaddlvq_u16( sa );
+        s->b = vaddlvq_u16( sb );
+        s->aa = vaddvq_u32( saa );
+        s->bb = vaddvq_u32( sbb );
+        s->ab = vaddvq_u32( sab );
+        return;
+    }
+#endif
+    for( ; y < h; y++ ){
+        for( int x=0; x < w; x++ ){
+            const uint32_t va = a[y * stride + x];
+            const uint32_t vb = b[y * stride + x];
+            s->a += va;
+            s->b += vb;
+            s->aa += va * va;
+            s->bb += vb * vb;
+            s->ab += va * vb;
+        }
+    }
+}
+
+static double WindowSsim( const WindowSums *s, int n )
+{
+    const double C1 = (0.01 * 255) * (0.01 * 255);
+    const double C2 = (0.03 * 255) * (0.03 * 255);
+    const double ma = (double)s->a / n;
+    const double mb = (double)s->b / n;
+    const double va = (double)s->aa / n - ma * ma;
+    const double vb = (double)s->bb / n - mb * mb;
+    const double cov = (double)s->ab / n - ma * mb;
+    return ((2 * ma * mb + C1) * (2 * cov + C2)) / ((ma * ma + mb * mb + C1) * (va + vb + C2));
+}
+
+double Golden_Ssim( const uint8_t *a, const uint8_t *b, int width, int height )
+{
+    const size_t pixels = (size_t)width * height;
+    if( pixels == 0 )
+        return 1.0;
+    uint8_t *ya = (uint8_t*) malloc( pixels * 2 );
+    uint8_t *yb = ya + pixels;
+    Luma( a, ya, pixels );
+    Luma( b, yb, pixels );
+
+    // images smaller than a window are one window
+    const int win = 8;
+    const int step = 4;
+    const int ww = (width < win) ? width : win;
+    const int wh = (height < win) ? height : win;
+    double sum = 0.0;
+    int windows = 0;
+    WindowSums s;
+    for( int y = 0; y + wh <= height; y += step ){
+        for( int x = 0; x + ww <= width; x += step ){
+            SumWindow( ya + (size_t)y * width + x, yb + (size_t)y * width + x, width, ww, wh, &s );
+            sum += WindowSsim( &s, ww * wh );
+            windows++;
+        }
+    }
+    free( ya );
+    return sum / windows;
+}
+
+int Golden_Compare( const uint8_t *a, const uint8_t *b, int width, int height, const GoldenTolerance *tolerance, GoldenResult *result )
+{
+    const GoldenTolerance tol = tolerance ? *tolerance : Golden_DefaultTolerance();
+    const size_t pixels = (size_t)width * height;
+    ImageCompare_CPU( a, width * 4, b, width * 4, width, height, 4, &result->compare );
+    result->badPixels = CountBadPixels( a, b, pixels, tol.maxChannelDelta );
+    result->ssim = (result->compare.mismatches > 0) ? Golden_Ssim( a, b, width, height ) : 1.0;
+
+    const int pass = result->badPixels <= (uint64_t)(tol.maxBadPixels * pixels)
+                     && (tol.minPsnr <= 0.0 || result->compare.psnr >= tol.minPsnr)
+                     && (tol.minSsim <= 0.0 || result->ssim >= tol.minSsim);
+    result->status = pass ? GOLDEN_PASS : GOLDEN_FAIL;
+    return pass;
+}
+
+//-----------------------------------------------------------------------------------------
+//  files
+//-----------------------------------------------------------------------------------------
+static int WritePng( const char *path, const uint8_t *rgba, int width, int height )
+{
+    std::error_code ec;
+    std::filesystem::create_directories( std::filesystem::path( path ).parent_path(), ec );
+    stbi_write_png_compression_level = 9;
+    return stbi_write_png( path, width, height, 4, rgba, width * 4 );
+}
+
+/* unchanged pixels as dimmed gray, the others from red to yellow as the delta grows */
+static void WriteHeatmap( const char *path, const uint8_t *actual, const uint8_t *reference, int width, int height )
+{
+    const size_t pixels = (size_t)width * height;
+    uint8_t *heat = (uint8_t*) malloc( pixels * 4 );
+    for( size_t i = 0; i < pixels; i++ ){
+        int d = 0;
+        for( int c=0; c < 4; c++ ){
+            const int dc = abs( (int)actual[i*4+c] - (int)reference[i*4+c] );
+            d = (dc > d) ? dc : d;
+        }
+        uint8_t *p = heat + i * 4;
+        if( d == 0 ){
+            const uint8_t gray = (uint8_t)((77 * reference[i*4] + 150 * reference[i*4+1] + 29 * reference[i*4+2]) >> 10);
+            p[0] = p[1] = p[2] = gray;
+        }else{
+            p[0] = 255;
+            p[1] = (d >= 64) ? 255 : (uint8_t)(d * 4);
+            p[2] = 0;
+        }
+        p[3] = 255;
+    }
+    WritePng( path, heat, width, height );
+    free( heat );
+}
+
+//-----------------------------------------------------------------------------------------
+//  check
+//-----------------------------------------------------------------------------------------
+static const char* StatusName( GoldenStatus status )
+{
+    switch( status ){
+        case GOLDEN_PASS:  return "PASS";
+        case GOLDEN_FAIL:  return "FAIL";
+        case GOLDEN_NEW:   return "NEW";
+        case GOLDEN_ERROR: return "ERROR";
+    }
+    return "?";
+}
+
+/* rgba is top-down here */
+static GoldenStatus CheckTopDown( const char *test, const char *api, const char *renderer, const uint8_t *rgba, int width, int height,
+                                  const GoldenTolerance *tol, GoldenResult *result, char *message, size_t messageSize )
+{
+    memset( result, 0, sizeof(*result) );
+    result->compare.psnr = INFINITY;
+    result->ssim = 1.0;
+
+    char name[128];
+    char path[1024];
+    SafeName( name, sizeof(name), renderer );
+    snprintf( path, sizeof(path), "%s/%s/%s/%s.png", EnvOr( "GOLDEN_DIR", PROJECT_SOURCE_DIR "data/golden" ), test, api, name );
+
+    int refWidth = 0, refHeight = 0, refChannels = 0;
+    uint8_t *reference = GetUpdate() ? NULL : stbi_load( path, &refWidth, &refHeight, &refChannels, 4 );
+    if( reference == NULL && GetUpdate() ){
+        if( !WritePng( path, rgba, width, height ) ){
+            snprintf( message, messageSize, "can not write %s", path );
+            return result->status = GOLDEN_ERROR;
+        }
+        snprintf( message, messageSize, "reference written to %s", path );
+        return result->status = GOLDEN_NEW;
+    }
+    if( reference == NULL ){
+        // not into the source tree unasked: the image goes where failures go, to be reviewed and added
+        char out[1024];
+        snprintf( out, sizeof(out), "%s/%s_%s_%s.png", EnvOr( "GOLDEN_OUT", "/tmp/golden" ), test, api, name );
+        WritePng( out, rgba, width, height );
+        snprintf( message, messageSize, "no reference %s, image in %s, $GOLDEN_UPDATE=1 adds it", path, out );
+        return result->status = GOLDEN_NEW;
+    }
+
+    if( refWidth != width || refHeight != height ){
+        snprintf( message, messageSize, "size %dx%d, reference %dx%d", width, height, refWidth, refHeight );
+        result->status = GOLDEN_FAIL;
+    }else{
+        Golden_Compare( rgba, reference, width, height, tol, result );
+        snprintf( message, messageSize, "max error %u, %llu pixels over %d, PSNR %.2f dB, SSIM %.4f",
+                  result->compare.maxError, (unsigned long long)result->badPixels, tol->maxChannelDelta,
+                  result->compare.psnr, result->ssim );
+    }
+
+    if( result->status == GOLDEN_FAIL ){
+        char out[1024];
+        const char *outDir = EnvOr( "GOLDEN_OUT", "/tmp/golden" );
+        snprintf( out, sizeof(out), "%s/%s_%s_%s.png", outDir, test, api, name );
+        WritePng( out, rgba, width, height );
+        if( refWidth == width && refHeight == height ){
+            snprintf( out, sizeof(out), "%s/%s_%s_%s.diff.png", outDir, test, api, name );
+            WriteHeatmap( out, rgba, reference, width, height );
+        }
+    }
+    stbi_image_free( reference );
+    return result->status;
+}
+
+GoldenStatus Golden_Check( const char *test, const char *api, const char *renderer, const uint8_t *rgba, int width, int height,
+                           const GoldenTolerance *tolerance, GoldenResult *result )
+{
+    const GoldenTolerance tol = tolerance ? *tolerance : Golden_DefaultTolerance();
+    uint8_t *topDown = (uint8_t*) malloc( (size_t)width * height * 4 );
+    PixelConvert_Flip( rgba, width * 4, topDown, width * 4, width * 4, height );
+
+    char message[256];
+    CheckTopDown( test, api, renderer, topDown, width, height, &tol, result, message, sizeof(message) );
+    printf("golden %s %s/%s/%s: %s\n", StatusName( result->status ), test, api, renderer, message);
+    free( topDown );
+    return result->status;
+}
+
+//-----------------------------------------------------------------------------------------
+//  worker pool
+//-----------------------------------------------------------------------------------------
+typedef struct GoldenJob{
+    char test[64];
+    char api[32];
+    char renderer[128];
+    uint8_t *pixels;            // top-down
+    int width, height;
+    GoldenTolerance tolerance;
+    GoldenResult result;
+    char message[256];
+    struct GoldenJob *next;
+}GoldenJob;
+
+static pthread_mutex_t Mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t Cond = PTHREAD_COND_INITIALIZER;
+static GoldenJob *Jobs = NULL;          // every job, in submit order
+static GoldenJob *LastJob = NULL;
+static GoldenJob *NextJob = NULL;       // first job not started
+static int Finishing = 0;
+static pthread_t Workers[MaxThreads];
+static int NumWorkers = 0;
+
+static void* WorkerThread( void *arg )
+{
+    (void)arg;
+    for(;;){
+        pthread_mutex_lock( &Mutex );
+        while( NextJob == NULL && !Finishing )
+            pthread_cond_wait( &Cond, &Mutex );
+        GoldenJob *job = NextJob;
+        if( job != NULL )
+            NextJob = job->next;
+        pthread_mutex_unlock( &Mutex );
+        if( job == NULL )
+            return NULL;
+
+        CheckTopDown( job->test, job->api, job->renderer, job->pixels, job->width, job->height, &job->tolerance,
+                      &job->result, job->message, sizeof(job->message) );
+        free( job->pixels );
+        job->pixels = NULL;
+    }
+}
+
+void Golden_Submit( const char *test, const char *api, const char *renderer, const uint8_t *rgba, int width, int height,
+                    const GoldenTolerance *tolerance )
+{
+    GoldenJob *job = (GoldenJob*) calloc( 1, sizeof(GoldenJob) );
+    snprintf( job->test, sizeof(job->test), "%s", test );
+    snprintf( job->api, sizeof(job->api), "%s", api );
+    snprintf( job->renderer, sizeof(job->renderer), "%s", renderer );
+    job->width = width;
+    job->height = height;
+    job->tolerance = tolerance ? *tolerance : Golden_DefaultTolerance();
+    job->pixels = (uint8_t*) malloc( (size_t)width * height * 4 );
+    PixelConvert_Flip( rgba, width * 4, job->pixels, width * 4, width * 4, height );
+
+    pthread_mutex_lock( &Mutex );
+    if( LastJob != NULL )
+        LastJob->next = job;
+    else
+        Jobs = job;
+    LastJob = job;
+    if( NumWorkers < GetThreads() && pthread_create( &Workers[NumWorkers], NULL, WorkerThread, NULL ) == 0 )
+        NumWorkers++;
+    // no worker could start, compare here
+    const int here = (NumWorkers == 0);
+    if( !here && NextJob == NULL )
+        NextJob = job;
+    pthread_cond_signal( &Cond );
+    pthread_mutex_unlock( &Mutex );
+
+    if( here ){
+        CheckTopDown( job->test, job->api, job->renderer, job->pixels, job->width, job->height, &job->tolerance,
+                      &job->result, job->message, sizeof(job->message) );
+        free( job->pixels );
+        job->pixels = NULL;
+    }
+}
+
+int Golden_Finish()
+{
+    pthread_mutex_lock( &Mutex );
+    Finishing = 1;
+    pthread_cond_broadcast( &Cond );
+    pthread_mutex_unlock( &Mutex );
+    for( int i=0; i < NumWorkers; i++ )
+        pthread_join( Workers[i], NULL );
+    NumWorkers = 0;
+    Finishing = 0;
+
+    int failures = 0;
+    int counts[4] = { 0, 0, 0, 0 };
+    GoldenJob *job = Jobs;
+    while( job != NULL ){
+        GoldenJob *next = job->next;
+        printf("golden %s %s/%s/%s: %s\n", StatusName( job->result.status ), job->test, job->api, job->renderer, job->message);
+        counts[job->result.status]++;
+        if( job->result.status == GOLDEN_FAIL || job->result.status == GOLDEN_ERROR ||
+            (job->result.status == GOLDEN_NEW && !GetUpdate()) )
+            failures++;
+        free( job );
+        job = next;
+    }
+    Jobs = LastJob = NextJob = NULL;
+
+    if( counts[GOLDEN_PASS] + counts[GOLDEN_FAIL] + counts[GOLDEN_NEW] + counts[GOLDEN_ERROR] > 0 ){
+        printf("golden: %d passed, %d failed, %d new, %d errors\n", counts[GOLDEN_PASS], counts[GOLDEN_FAIL],
+               counts[GOLDEN_NEW], counts[GOLDEN_ERROR]);
+        if( failures )
+            printf("golden: images and diff heatmaps in %s\n", EnvOr( "GOLDEN_OUT", "/tmp/golden" ));
+    }
+    return failures;
+}
@@ -0,0 +1,54 @@
+#pragma once
+/*
+ * Golden images, reference renderings per (test, API, renderer):
+ *   stored as lossless RGBA8 PNG in <root>/<test>/<api>/<renderer>.png, root is $GOLDEN_DIR,
+ *   PROJECT_SOURCE_DIR "data/golden/" by default. A missing reference is reported as new and counts as a
+ *   failure, the image is written to $GOLDEN_OUT; $GOLDEN_UPDATE=1 (or Golden_SetUpdate(1)) writes the missing
+ *   references and rewrites all the others instead.
+ *   Images are passed bottom-up as read by glReadPixels(). Golden_Submit() copies the image and compares it
+ *   on a worker thread, Golden_Finish() waits for every comparison and prints one line per image.
+ *   Only failures write files to $GOLDEN_OUT, /tmp/golden/ by default: the image and a diff heatmap.
+ */
+#include <stdint.h>
+#include "imageCompare.h"
+
+typedef struct{
+    int maxChannelDelta;        // a pixel is bad when any channel differs more
+    double maxBadPixels;        // fraction of bad pixels allowed
+    double minPsnr;             // dB, 0 to skip
+    double minSsim;             // 0 ~ 1, 0 to skip
+}GoldenTolerance;
+
+typedef enum{
+    GOLDEN_PASS,
+    GOLDEN_FAIL,
+    GOLDEN_NEW,
+    GOLDEN_ERROR,
+}GoldenStatus;
+
+typedef struct{
+    GoldenStatus status;
+    ImageCompareResult compare;
+    uint64_t badPixels;         // over maxChannelDelta
+    double ssim;
+}GoldenResult;
+
+// max delta 2, 0.1% bad pixels, SSIM 0.98: llvmpipe and hardware drivers are stable across runs
+GoldenTolerance Golden_DefaultTolerance();
+void Golden_SetUpdate( int update );
+void Golden_SetThreads( int threads );      // 0: one per CPU
+
+// compare now, on the calling thread
+GoldenStatus Golden_Check( const char *test, const char *api, const char *renderer, const uint8_t *rgba, int width, int height,
+                           const GoldenTolerance *tolerance, GoldenResult *result );
+// compare in the background, tolerance NULL for the default
+void Golden_Submit( const char *test, const char *api, const char *renderer, const uint8_t *rgba, int width, int height,
+                    const GoldenTolerance *tolerance );
+// wait for the submitted images, print the results, return the number of failures and errors, new ones included
+// unless updating
+int Golden_Finish();
+
+// compare 2 RGBA8 images, no file involved; return 1 if within the tolerance
+int Golden_Compare( const uint8_t *a, const uint8_t *b, int width, int height, const GoldenTolerance *tolerance, GoldenResult *result );
+// mean SSIM of the luma, 8x8 windows every 4 pixels; RGBA8, same orientation for both
+double Golden_Ssim( const uint8_t *a, const uint8_t *b, int width, int height );
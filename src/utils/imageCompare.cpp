@@ -0,0 +1,122 @@
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "imageCompare.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+
+/* max and sum of squares of |a - b| over n bytes, return 1 if any byte differs */
+static int RowErrors( const uint8_t *a, const uint8_t *b, int n, uint32_t *maxError, uint64_t *sumSquared )
+{
+    int i = 0;
+    uint32_t maxE = 0;
+    uint64_t sum = 0;
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    __m128i vmax = zero;
+    __m128i vsum = zero;    // 4 x 32 bits, at most 2 * 255^2 per lane and iteration
+    for( ; i + 16 <= n; i += 16 ){
+        const __m128i va = _mm_loadu_si128( (const __m128i*)(a + i) );
+        const __m128i vb = _mm_loadu_si128( (const __m128i*)(b + i) );
+        const __m128i d = _mm_or_si128( _mm_subs_epu8( va, vb ), _mm_subs_epu8( vb, va ) );
+        vmax = _mm_max_epu8( vmax, d );
+        const __m128i lo = _mm_unpacklo_epi8( d, zero );
+        const __m128i hi = _mm_unpackhi_epi8( d, zero );
+        vsum = _mm_add_epi32( vsum, _mm_add_epi32( _mm_madd_epi16( lo, lo ), _mm_madd_epi16( hi, hi ) ) );
+
+        // flush before the 32-bit lanes can overflow
+        if( (i & 0x3FFF) == 0x3FF0 ){
+            uint32_t lanes[4];
+            _mm_storeu_si128( (__m128i*)lanes, vsum );
+            sum += (uint64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+            vsum = zero;
+        }
+    }
+    uint8_t maxBytes[16];
+    uint32_t lanes[4];
+    _mm_storeu_si128( (__m128i*)maxBytes, vmax );
+    _mm_storeu_si128( (__m128i*)lanes, vsum );
+    sum += (uint64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    for( int k=0; k < 16; k++ )
+        maxE = (maxBytes[k] > maxE) ? maxBytes[k] : maxE;
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    uint8x16_t vmax = vdupq_n_u8( 0 );
+    for( ; i + 16 <= n; i += 16 ){
+        const uint8x16_t d = vabdq_u8( vld1q_u8( a + i ), vld1q_u8( b + i ) );
+        vmax = vmaxq_u8( vmax, d );
+        const uint16x8_t lo = vmull_u8( vget_low_u8( d ), vget_low_u8( d ) );
+        const uint16x8_t hi = vmull_u8( vget_high_u8( d ), vget_high_u8( d ) );
+        sum += vaddlvq_u32( vaddq_u32( vpaddlq_u16( lo ), vpaddlq_u16( hi ) ) );
+    }
+    maxE = vmaxvq_u8( vmax );
+#endif
+    for( ; i < n; i++ ){
+        const uint32_t d = (a[i] > b[i]) ? a[i] - b[i] : b[i] - a[i];
+        maxE = (d > maxE) ? d : maxE;
+        sum += d * d;
+    }
+
+    if( maxE > *maxError )
+        *maxError = maxE;
+    *sumSquared += sum;
+    return maxE != 0;
+}
+
+void ImageCompare_CPU( const uint8_t *a, int strideA, const uint8_t *b, int strideB, int width, int height, int channels,
+                       ImageCompareResult *result )
+{
+    memset( result, 0, sizeof(*result) );
+    result->x0 = width;
+    result->y0 = height;
+    result->x1 = -1;
+    result->y1 = -1;
+    result->samples = (uint64_t)width * height * channels;
+
+    for( int y=0; y < height; y++ ){
+        const uint8_t *rowA = a + (int64_t)y * strideA;
+        const uint8_t *rowB = b + (int64_t)y * strideB;
+        if( !RowErrors( rowA, rowB, width * channels, &result->maxError, &result->sumSquaredError ) )
+            continue;
+
+        // rare case: per pixel pass for the count and the bounding box
+        for( int x=0; x < width; x++ ){
+            if( memcmp( rowA + x * channels, rowB + x * channels, channels ) == 0 )
+                continue;
+            result->mismatches++;
+            if( x < result->x0 ) result->x0 = x;
+            if( x > result->x1 ) result->x1 = x;
+            if( y < result->y0 ) result->y0 = y;
+            if( y > result->y1 ) result->y1 = y;
+        }
+    }
+    ImageCompare_Finish( result );
+}
+
+void ImageCompare_Finish( ImageCompareResult *result )
+{
+    if( result->sumSquaredError == 0 || result->samples == 0 ){
+        result->psnr = INFINITY;
+        return;
+    }
+    const double mse = (double)result->sumSquaredError / (double)result->samples;
+    result->psnr = 10.0 * log10( 255.0 * 255.0 / mse );
+}
+
+int ImageCompare_Print( const char *name, const ImageCompareResult *result )
+{
+    if( result->mismatches == 0 ){
+        printf("%s: same\n", name);
+        return 1;
+    }
+
+    printf("%s: diff !!! %llu pixels differ, max error %u, PSNR %.2f dB, box (%d, %d) - (%d, %d)\n",
+           name, (unsigned long long)result->mismatches, result->maxError, result->psnr,
+           result->x0, result->y0, result->x1, result->y1);
+    return 0;
+}
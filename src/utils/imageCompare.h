@@ -0,0 +1,24 @@
+#pragma once
+/*
+ * Image comparison, 8 bits per channel:
+ *   mismatches counts the pixels with any channel different, maxError is the largest channel difference,
+ *   the bounding box covers every mismatching pixel (x0 > x1 when there is none).
+ *   ImageCompare_CPU() is the SSE2 / NEON fallback of ImageCompare_GPU() in glUtils.h, same metrics.
+ */
+#include <stdint.h>
+
+typedef struct{
+    uint64_t mismatches;
+    uint32_t maxError;
+    uint64_t sumSquaredError;
+    double psnr;                // dB, INFINITY when identical
+    int x0, y0, x1, y1;         // inclusive
+    uint64_t samples;           // width * height * channels
+}ImageCompareResult;
+
+void ImageCompare_CPU( const uint8_t *a, int strideA, const uint8_t *b, int strideB, int width, int height, int channels,
+                       ImageCompareResult *result );
+// fill psnr from sumSquaredError and samples
+void ImageCompare_Finish( ImageCompareResult *result );
+// "name: same" or "name: diff, ..." with the metrics, return 1 if same
+int ImageCompare_Print( const char *name, const ImageCompareResult *result );
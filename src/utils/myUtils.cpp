@@ -5,6 +5,8 @@
 #include <math.h>
 
 #include "myUtils.h"
+#include "perfTrace.h"
+#include "perfCounters.h"
 
 
 static int isnumber( const char* str )
@@ -30,6 +32,16 @@ int argsContain( const char* argName, int argc, const char* argv[] )
     return 0;
 }
 
+int flagFromArgs( const char* argName, int argc, const char* argv[] )
+{
+    for( int i=0; i < argc; i++ ){
+        if( strcmp( argName, argv[i] ) == 0 )
+            return 1;
+    }
+
+    return 0;
+}
+
 const char* stringFromArgs( const char* argName, int argc, const char* argv[] )
 {
     for( int i=0; i < argc; i++ ){
@@ -87,6 +99,11 @@ api_t apiDefault( int api_current )
             api.minor = 3;
             break;
 
+        case API_Any:
+        case API_AnyShader:
+            api = apiDefault( API_GL );
+            break;
+
         default:
             api.api = API_Invalid;
             api.major = 0;
@@ -147,7 +164,10 @@ api_t apiInitial( int api_current, int argc, const char* argv[] )
     if( apiValue != NULL ){
         api = apiFromString( apiValue );
 
-        if( api.api != api_current ){
+        int isValid = (api_current == API_Any) ? (api.api == API_GLLegacy || api.api == API_GL || api.api == API_GLES)
+                    : (api_current == API_AnyShader) ? (api.api == API_GL || api.api == API_GLES)
+                    : (api.api == api_current);
+        if( !isValid ){
             printf("%s: \"--api %s\" is invalid for \"%s\"\n", __func__, apiValue, apiName(api_current));
             exit( 1 );
         }
@@ -172,6 +192,8 @@ const char* apiName( int api )
         case API_GL: return "gl";
         case API_GLES: return "gles";
         case API_VULKAN: return "vulkan";
+        case API_Any: return "any";
+        case API_AnyShader: return "gl or gles";
         default:
             return "";
     }
@@ -184,6 +206,13 @@ uint64_t PerfGetMillisecond()
     return now.tv_nsec/1000000 + now.tv_sec*1000;
 }
 
+uint64_t PerfGetMicrosecond()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_nsec/1000 + now.tv_sec*1000000;
+}
+
 double PerfGetSecond()
 {
     //return glutGet(GLUT_ELAPSED_TIME) * 0.001;
@@ -194,11 +223,29 @@ double PerfGetSecond()
  * Run function 'f' for enough iterations to reach a steady state.
  * Return the rate (iterations/second).
  */
+// one call of the rendering function, a slice of the trace when $PERF_TRACE is set
+static void PerfIteration(PerfRateFunc f, unsigned count)
+{
+    if( !PerfTrace_Enabled ){
+        f(count);
+        return;
+    }
+    PerfTraceScope scope( "iteration", "count", count );
+    if( PerfTrace_IterationBegin )
+        PerfTrace_IterationBegin();
+    f(count);
+    if( PerfTrace_IterationEnd )
+        PerfTrace_IterationEnd();
+}
+
 double PerfMeasureRate(PerfRateFunc f, PollEventFunc poolevent)
 {
+    PerfTraceScope scope( "PerfMeasureRate" );
     const double minDuration = 1.0;
     double rate = 0.0, prevRate = 0.0;
     unsigned subiters;
+    PerfCounterSample counters;
+    int counted = 0;
 
     /* Compute initial number of iterations to try.
      * If the test function is pretty slow this helps to avoid
@@ -212,7 +259,7 @@ double PerfMeasureRate(PerfRateFunc f, PollEventFunc poolevent)
         const double t0 = PerfGetSecond();
         double t1;
         do {
-            f(subiters); /* call the rendering function */
+            PerfIteration(f, subiters); /* call the rendering function */
             t1 = PerfGetSecond();
             subiters *= 2;
         } while (t1 - t0 < 0.1 * minDuration);
@@ -223,18 +270,21 @@ double PerfMeasureRate(PerfRateFunc f, PollEventFunc poolevent)
         if( poolevent )
             poolevent();
 
+        const int counting = PerfCounters_IsEnabled() && PerfCounters_Begin();
         const double t0 = PerfGetSecond();
         unsigned iters = 0;
         double t1;
 
         do {
             //printf("f( subiters=%u )\n", subiters);//XXX
-            f(subiters); /* call the rendering function */
+            PerfIteration(f, subiters); /* call the rendering function */
             t1 = PerfGetSecond();
             iters += subiters;
         } while (t1 - t0 < minDuration);
 
         rate = iters / (t1 - t0);
+        PerfTrace_Counter( "rate", rate );
+        counted = counting && PerfCounters_End( &counters, iters );
 
         //printf("prevRate %f  rate  %f  ratio %f  iters %u\n", prevRate, rate, rate/prevRate, iters);
 
@@ -253,6 +303,8 @@ double PerfMeasureRate(PerfRateFunc f, PollEventFunc poolevent)
     }
 
     //printf("%s returning iters %u  rate %f\n", __FUNCTION__, subiters, rate);
+    if( counted )
+        PerfCounters_Print( &counters );
     return rate;
 }
 
@@ -10,6 +10,7 @@
  *   --testcase XX                        Set testcase
  */
 int argsContain( const char* argName, int argc, const char* argv[] );
+int flagFromArgs( const char* argName, int argc, const char* argv[] );    // argName anywhere, with or without a value
 const char* stringFromArgs( const char* argName, int argc, const char* argv[] );
 int integerFromArgs( const char* argName, int argc, const char* argv[], int *isExist );
 
@@ -19,6 +20,8 @@ int integerFromArgs( const char* argName, int argc, const char* argv[], int *isE
 #define API_GL        1
 #define API_GLES      2
 #define API_VULKAN    3
+#define API_Any       4     // one build for glLegacy, gl and gles, picked by --api at runtime
+#define API_AnyShader 5     // API_Any for programs without a fixed-function path: gl or gles
 
 #if IS_GlLegacy
 #define API_Current API_GLLegacy
@@ -29,6 +32,9 @@ int integerFromArgs( const char* argName, int argc, const char* argv[], int *isE
 #elif IS_GlEs
 #define API_Current API_GLES
 #define API_CurrentName  "gles"
+#elif IS_GlAny
+#define API_Current API_Any
+#define API_CurrentName  "any"
 #else
 #define API_Current API_VULKAN
 #define API_CurrentName  "vulkan"
@@ -46,10 +52,20 @@ api_t apiInitial( int api_current, int argc, const char* argv[] );
 const char* apiName( api_t api );
 const char* apiName( int api );
 
+/*
+ * API_Any builds: the instance of a hot loop template<int Api> for the api picked at runtime, e.g.
+ *   rate = PerfMeasureRate( API_Select(DrawArrays, api), eglx_PollEvents );
+ * the loop itself tests Api with "if constexpr", nothing is decided per draw call.
+ */
+#define API_Select( f, api_ ) \
+    (((api_).api == API_GLLegacy) ? f<API_GLLegacy> : ((api_).api == API_GLES) ? f<API_GLES> : f<API_GL>)
+
 uint64_t PerfGetMillisecond();
+uint64_t PerfGetMicrosecond();
 double PerfGetSecond();
 typedef void (*PerfRateFunc)(unsigned count);
 typedef void (*PollEventFunc)(void);
+// $PERF_COUNTERS=1: also prints CPU counters per iteration (perfCounters.h), $PERF_TRACE: timeline (perfTrace.h)
 double PerfMeasureRate(PerfRateFunc f, PollEventFunc poolevent = NULL);
 const char* PerfHumanFloat( double d );
 
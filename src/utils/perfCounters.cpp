@@ -0,0 +1,195 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include <atomic>
+#include "perfCounters.h"
+#include "perfTrace.h"
+
+static const struct{
+    const char *name;
+    uint32_t type;
+    uint64_t config;
+}counterEvents[PerfCounter_Count] = {
+    { "cycles",           PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { "instructions",     PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { "LLC misses",       PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },     // last level cache on most CPUs
+    { "branch misses",    PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+    { "context switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES },
+};
+
+static int Enabled = -1;    // -1: from $PERF_COUNTERS
+static std::atomic<int> reasonPrinted( 0 );
+
+// per thread: counters count the thread that opened them
+static thread_local struct{
+    int opened;
+    int fds[PerfCounter_Count];
+    int numFds;
+    int userOnly;
+    int hasLast;
+    PerfCounterSample last;
+} pc;
+
+int PerfCounters_IsEnabled()
+{
+    if( Enabled < 0 ){
+        const char *env = getenv( "PERF_COUNTERS" );
+        Enabled = (env != NULL && atoi( env ) != 0);
+    }
+    return Enabled;
+}
+
+void PerfCounters_SetEnabled( int enabled )
+{
+    Enabled = enabled;
+}
+
+static const char* OpenErrorReason( int error )
+{
+    switch( error ){
+        case ENOENT:
+        case EOPNOTSUPP:
+            return "not supported here, no PMU exposed (VM or container?)";
+        case EACCES:
+        case EPERM:
+            return "not permitted, see /proc/sys/kernel/perf_event_paranoid";
+        case ENOSYS:
+            return "no perf_event_open(), kernel or seccomp";
+        default:
+            return strerror( error );
+    }
+}
+
+/* software events happen in the kernel, excluding it would count nothing */
+static int IsSoftware( int counter )
+{
+    return counterEvents[counter].type == PERF_TYPE_SOFTWARE;
+}
+
+static int OpenCounter( int counter, int excludeKernel )
+{
+    struct perf_event_attr attr;
+    memset( &attr, 0, sizeof(attr) );
+    attr.size = sizeof(attr);
+    attr.type = counterEvents[counter].type;
+    attr.config = counterEvents[counter].config;
+    attr.disabled = 1;
+    attr.exclude_kernel = IsSoftware( counter ) ? 0 : excludeKernel;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall( SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC );
+}
+
+static void Open()
+{
+    pc.opened = 1;
+    pc.numFds = 0;
+    pc.userOnly = 0;
+
+    int errors[PerfCounter_Count] = {};
+    for( int i=0; i < PerfCounter_Count; i++ ){
+        int fd = OpenCounter( i, pc.userOnly );
+        if( fd < 0 && (errno == EACCES || errno == EPERM) && !pc.userOnly && !IsSoftware( i ) ){
+            // perf_event_paranoid 2: user space only, for every counter so that they stay comparable
+            fd = OpenCounter( i, 1 );
+            if( fd >= 0 ){
+                pc.userOnly = 1;
+                for( int k=0; k < i; k++ ){
+                    if( pc.fds[k] >= 0 && !IsSoftware( k ) ){
+                        close( pc.fds[k] );
+                        pc.fds[k] = OpenCounter( k, 1 );
+                    }
+                }
+            }
+        }
+        if( fd < 0 )
+            errors[i] = errno;
+        pc.fds[i] = fd;
+    }
+    for( int i=0; i < PerfCounter_Count; i++ )
+        pc.numFds += (pc.fds[i] >= 0);
+
+    if( reasonPrinted.exchange( 1 ) == 0 ){
+        for( int i=0; i < PerfCounter_Count; i++ ){
+            if( pc.fds[i] < 0 )
+                printf("PerfCounters: %s unavailable, %s\n", counterEvents[i].name, OpenErrorReason( errors[i] ));
+        }
+        if( pc.numFds > 0 && pc.userOnly )
+            printf("PerfCounters: user space only, see /proc/sys/kernel/perf_event_paranoid\n");
+    }
+}
+
+int PerfCounters_Begin()
+{
+    if( !pc.opened )
+        Open();
+    for( int i=0; i < PerfCounter_Count; i++ ){
+        if( pc.fds[i] >= 0 ){
+            ioctl( pc.fds[i], PERF_EVENT_IOC_RESET, 0 );
+            ioctl( pc.fds[i], PERF_EVENT_IOC_ENABLE, 0 );
+        }
+    }
+    return pc.numFds > 0;
+}
+
+int PerfCounters_End( PerfCounterSample *sample, double iterations )
+{
+    for( int i=0; i < PerfCounter_Count; i++ ){
+        if( pc.fds[i] >= 0 )
+            ioctl( pc.fds[i], PERF_EVENT_IOC_DISABLE, 0 );
+    }
+
+    int numValues = 0;
+    sample->iterations = iterations;
+    sample->userOnly = pc.userOnly;
+    for( int i=0; i < PerfCounter_Count; i++ ){
+        sample->value[i] = -1.0;
+        uint64_t v[3];     // value, time enabled, time running
+        if( pc.fds[i] < 0 || read( pc.fds[i], v, sizeof(v) ) != sizeof(v) || v[2] == 0 )
+            continue;
+
+        // scale up if the PMU was shared with other counters part of the time
+        double value = (double)v[0];
+        if( v[2] < v[1] )
+            value *= (double)v[1] / v[2];
+        sample->value[i] = value / iterations;
+        numValues++;
+    }
+    if( numValues == 0 )
+        return 0;
+
+    pc.last = *sample;
+    pc.hasLast = 1;
+    const double *v = sample->value;
+    if( v[PerfCounter_Cycles] > 0 && v[PerfCounter_Instructions] >= 0 )
+        PerfTrace_Counter( "IPC", v[PerfCounter_Instructions] / v[PerfCounter_Cycles] );
+    if( v[PerfCounter_LLCMisses] >= 0 )
+        PerfTrace_Counter( "LLC misses/iteration", v[PerfCounter_LLCMisses] );
+    return 1;
+}
+
+void PerfCounters_Print( const PerfCounterSample *sample )
+{
+    const double *v = sample->value;
+    printf("    cpu counters per iteration:");
+    if( v[PerfCounter_Cycles] > 0 && v[PerfCounter_Instructions] >= 0 )
+        printf(" %.2f IPC,", v[PerfCounter_Instructions] / v[PerfCounter_Cycles]);
+    const char *sep = "";
+    for( int i=0; i < PerfCounter_Count; i++ ){
+        if( v[i] < 0 )
+            continue;
+        printf("%s %.4g %s", sep, v[i], counterEvents[i].name);
+        sep = ",";
+    }
+    printf("%s\n", sample->userOnly ? " (user space)" : "");
+}
+
+const PerfCounterSample* PerfCounters_Last()
+{
+    return pc.hasLast ? &pc.last : NULL;
+}
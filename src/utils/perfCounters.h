@@ -0,0 +1,37 @@
+#pragma once
+/*
+ * CPU hardware counters of the calling thread, perf_event_open(2), around PerfMeasureRate() samples:
+ *   $PERF_COUNTERS=1 counts every sample and prints, per iteration of the sample the rate comes from, IPC,
+ *   cycles, instructions, LLC misses, branch misses and context switches. Work of driver threads is not counted.
+ *   A counter the kernel refuses (no PMU in a VM or container, perf_event_paranoid, seccomp) is left out, the
+ *   reason is printed once; kernel time is left out too where only user space may be counted, except for
+ *   context switches, which only the kernel sees.
+ *   With $PERF_TRACE the counters are also on the timeline, see perfTrace.h.
+ */
+enum{
+    PerfCounter_Cycles,
+    PerfCounter_Instructions,
+    PerfCounter_LLCMisses,
+    PerfCounter_BranchMisses,
+    PerfCounter_ContextSwitches,
+    PerfCounter_Count,
+};
+
+typedef struct{
+    double value[PerfCounter_Count];    // per iteration, < 0: not available
+    double iterations;
+    int userOnly;                       // kernel time is not counted
+}PerfCounterSample;
+
+int PerfCounters_IsEnabled();           // $PERF_COUNTERS=1, or PerfCounters_SetEnabled()
+void PerfCounters_SetEnabled( int enabled );
+
+// count on the calling thread, return 0 if no counter can be read
+int PerfCounters_Begin();
+// the counts since PerfCounters_Begin() divided by iterations, return 0 if no counter can be read
+int PerfCounters_End( PerfCounterSample *sample, double iterations );
+void PerfCounters_Print( const PerfCounterSample *sample );
+
+// the last sample PerfCounters_End() read on the calling thread, NULL if none;
+// after PerfMeasureRate() the one its rate comes from
+const PerfCounterSample* PerfCounters_Last();
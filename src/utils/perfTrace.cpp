@@ -0,0 +1,224 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <atomic>
+#include <mutex>
+#include "perfTrace.h"
+
+enum{
+    PT_Slice,       // Begin/End or Complete, on the thread track
+    PT_GpuSlice,    // on the GPU track of the thread
+    PT_Counter,
+};
+
+typedef struct{
+    const char *name;
+    const char *argName;
+    double value;           // the counter, or the argument of a slice
+    uint64_t ts, dur;       // ns
+    int type;
+}PerfTraceEvent;
+
+#define MaxDepth  64
+#define MaxRingEvents  (1 << 24)
+
+/*
+ * One per thread, never freed: the file is written at exit, after the threads are gone.
+ * Only the owner writes events and head; the writer reads head with acquire.
+ */
+typedef struct PerfTraceRing{
+    PerfTraceEvent *events;             // ringEvents
+    std::atomic<uint64_t> head;
+    int tid;
+    char threadName[32];
+    int depth;
+    PerfTraceEvent stack[MaxDepth];     // open Begin() scopes
+    struct PerfTraceRing *next;
+}PerfTraceRing;
+
+static std::mutex ringsMutex;
+static PerfTraceRing *rings = NULL;
+static thread_local PerfTraceRing *ring = NULL;
+static const char *tracePath = NULL;
+static uint64_t ringEvents = PerfTrace_RingEvents;     // a power of 2
+
+PerfTraceHook PerfTrace_IterationBegin = NULL;
+PerfTraceHook PerfTrace_IterationEnd = NULL;
+
+static void PerfTrace_AtExit()
+{
+    PerfTrace_Write();
+}
+
+static int PerfTrace_Init()
+{
+    const char *env = getenv( "PERF_TRACE" );
+    if( env == NULL || env[0] == '\0' )
+        return 0;
+    tracePath = env;
+
+    const char *events = getenv( "PERF_TRACE_EVENTS" );
+    const long long n = (events != NULL) ? atoll( events ) : 0;
+    if( n > 0 ){
+        ringEvents = 1;
+        while( ringEvents < (uint64_t)n && ringEvents < MaxRingEvents )
+            ringEvents <<= 1;
+    }
+    atexit( PerfTrace_AtExit );
+    return 1;
+}
+
+int PerfTrace_Enabled = PerfTrace_Init();
+
+uint64_t PerfTrace_Now()
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static PerfTraceRing* GetRing()
+{
+    if( ring == NULL ){
+        PerfTraceRing *r = new PerfTraceRing();
+        r->events = new PerfTraceEvent[ringEvents];
+        r->tid = (int)syscall( SYS_gettid );
+        if( pthread_getname_np( pthread_self(), r->threadName, sizeof(r->threadName) ) != 0 )
+            snprintf( r->threadName, sizeof(r->threadName), "thread %d", r->tid );
+
+        std::lock_guard<std::mutex> lock( ringsMutex );
+        r->next = rings;
+        rings = r;
+        ring = r;
+    }
+    return ring;
+}
+
+static void Push( PerfTraceRing *r, const PerfTraceEvent *e )
+{
+    const uint64_t h = r->head.load( std::memory_order_relaxed );
+    r->events[h & (ringEvents - 1)] = *e;
+    r->head.store( h + 1, std::memory_order_release );
+}
+
+void PerfTrace_SetThreadName( const char *name )
+{
+    if( !PerfTrace_Enabled )
+        return;
+    PerfTraceRing *r = GetRing();
+    snprintf( r->threadName, sizeof(r->threadName), "%s", name );
+}
+
+void PerfTrace_BeginSlow( const char *name, const char *argName, double arg )
+{
+    PerfTraceRing *r = GetRing();
+    if( r->depth < MaxDepth ){
+        PerfTraceEvent *e = &r->stack[r->depth];
+        e->name = name;
+        e->argName = argName;
+        e->value = arg;
+        e->type = PT_Slice;
+        e->ts = PerfTrace_Now();
+    }
+    r->depth++;
+}
+
+void PerfTrace_EndSlow()
+{
+    const uint64_t now = PerfTrace_Now();
+    PerfTraceRing *r = GetRing();
+    if( r->depth == 0 )
+        return;
+    r->depth--;
+    if( r->depth < MaxDepth ){
+        PerfTraceEvent *e = &r->stack[r->depth];
+        e->dur = now - e->ts;
+        Push( r, e );
+    }
+}
+
+void PerfTrace_CounterSlow( const char *name, double value )
+{
+    PerfTraceEvent e = { name, NULL, value, PerfTrace_Now(), 0, PT_Counter };
+    Push( GetRing(), &e );
+}
+
+void PerfTrace_CompleteSlow( const char *name, const char *argName, double arg, uint64_t startNs, uint64_t endNs, int gpu )
+{
+    PerfTraceEvent e = { name, argName, arg, startNs, (endNs > startNs) ? endNs - startNs : 0, gpu ? PT_GpuSlice : PT_Slice };
+    Push( GetRing(), &e );
+}
+
+/*
+ * Chrome JSON trace: ts / dur in us, "X" slices, "C" counters, "M" names of the process and tracks.
+ * The GPU track of a thread is a pseudo thread, tid + GpuTidOffset.
+ */
+#define GpuTidOffset  10000000
+
+void PerfTrace_Write()
+{
+    if( !PerfTrace_Enabled )
+        return;
+
+    FILE *fp = fopen( tracePath, "w" );
+    if( fp == NULL ){
+        printf("%s: can't write %s\n", __func__, tracePath);
+        return;
+    }
+
+    const int pid = (int)getpid();
+    char processName[64] = "";
+    FILE *comm = fopen( "/proc/self/comm", "r" );
+    if( comm != NULL ){
+        if( fgets( processName, sizeof(processName), comm ) != NULL )
+            processName[strcspn( processName, "\n" )] = '\0';
+        fclose( comm );
+    }
+
+    fprintf( fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n" );
+    fprintf( fp, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}", pid, pid, processName );
+
+    uint64_t events = 0, dropped = 0;
+    std::lock_guard<std::mutex> lock( ringsMutex );
+    for( PerfTraceRing *r = rings; r != NULL; r = r->next ){
+        const uint64_t head = r->head.load( std::memory_order_acquire );
+        const uint64_t first = (head > ringEvents) ? head - ringEvents : 0;
+        int hasGpu = 0;
+
+        fprintf( fp, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                 pid, r->tid, r->threadName );
+        for( uint64_t i = first; i < head; i++ ){
+            const PerfTraceEvent *e = &r->events[i & (ringEvents - 1)];
+            if( e->type == PT_Counter ){
+                fprintf( fp, ",\n{\"name\":\"%s\",\"ph\":\"C\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"args\":{\"value\":%.6g}}",
+                         e->name, pid, r->tid, e->ts / 1000.0, e->value );
+                continue;
+            }
+            const int tid = (e->type == PT_GpuSlice) ? r->tid + GpuTidOffset : r->tid;
+            hasGpu |= (e->type == PT_GpuSlice);
+            fprintf( fp, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f",
+                     e->name, pid, tid, e->ts / 1000.0, e->dur / 1000.0 );
+            if( e->argName != NULL )
+                fprintf( fp, ",\"args\":{\"%s\":%.6g}", e->argName, e->value );
+            fprintf( fp, "}" );
+        }
+        if( hasGpu ){
+            fprintf( fp, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"GPU (%s)\"}}",
+                     pid, r->tid + GpuTidOffset, r->threadName );
+        }
+        events += head - first;
+        dropped += first;
+    }
+    fprintf( fp, "\n]}\n" );
+    fclose( fp );
+
+    printf("%s: %llu events written to %s", __func__, (unsigned long long)events, tracePath);
+    if( dropped > 0 )
+        printf(", %llu older ones overwritten, the rings keep %llu per thread, see $PERF_TRACE_EVENTS",
+               (unsigned long long)dropped, (unsigned long long)ringEvents);
+    printf("\n");
+}
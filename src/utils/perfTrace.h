@@ -0,0 +1,69 @@
+#pragma once
+/*
+ * Timeline of a run as a Chrome JSON trace, opens in ui.perfetto.dev or chrome://tracing:
+ *   $PERF_TRACE=<file.json> turns it on, the file is written at exit or by PerfTrace_Write().
+ *   Each thread records into its own ring of $PERF_TRACE_EVENTS events, default PerfTrace_RingEvents, rounded up
+ *   to a power of 2; the oldest events are overwritten. Only the owner thread writes a ring, so recording takes
+ *   no lock. Names are kept by pointer: use string literals.
+ *   Off, a call is one test of PerfTrace_Enabled.
+ * Recorded by the harness: PerfMeasureRate() passes, iterations and rates, EGL swaps, GL uploads and readbacks
+ * (wrapped like glTrace.h does), and GpuTimer_XXX() intervals (glUtils.h) on a GPU track per thread.
+ */
+#include <stdint.h>
+#include <stddef.h>
+
+#define PerfTrace_RingEvents  (1 << 16)     // default size of the ring of a thread
+
+extern int PerfTrace_Enabled;
+
+uint64_t PerfTrace_Now();       // ns of CLOCK_MONOTONIC, the clock of the trace
+void PerfTrace_SetThreadName( const char *name );
+void PerfTrace_Write();
+
+void PerfTrace_BeginSlow( const char *name, const char *argName, double arg );
+void PerfTrace_EndSlow();
+void PerfTrace_CounterSlow( const char *name, double value );
+void PerfTrace_CompleteSlow( const char *name, const char *argName, double arg, uint64_t startNs, uint64_t endNs, int gpu );
+
+// a scope of the calling thread, Begin/End nest; argName: NULL, or one number shown with the slice
+static inline void PerfTrace_Begin( const char *name, const char *argName = NULL, double arg = 0 )
+{
+    if( PerfTrace_Enabled )
+        PerfTrace_BeginSlow( name, argName, arg );
+}
+
+static inline void PerfTrace_End()
+{
+    if( PerfTrace_Enabled )
+        PerfTrace_EndSlow();
+}
+
+static inline void PerfTrace_Counter( const char *name, double value )
+{
+    if( PerfTrace_Enabled )
+        PerfTrace_CounterSlow( name, value );
+}
+
+// an interval timed by the caller, on the calling thread
+static inline void PerfTrace_Complete( const char *name, uint64_t startNs, uint64_t endNs, const char *argName = NULL, double arg = 0 )
+{
+    if( PerfTrace_Enabled )
+        PerfTrace_CompleteSlow( name, argName, arg, startNs, endNs, 0 );
+}
+
+// an interval of GPU work, in trace clock ns, on the GPU track of the calling thread
+static inline void PerfTrace_GpuComplete( const char *name, uint64_t startNs, uint64_t endNs )
+{
+    if( PerfTrace_Enabled )
+        PerfTrace_CompleteSlow( name, NULL, 0, startNs, endNs, 1 );
+}
+
+struct PerfTraceScope{
+    PerfTraceScope( const char *name, const char *argName = NULL, double arg = 0 ) { PerfTrace_Begin( name, argName, arg ); }
+    ~PerfTraceScope() { PerfTrace_End(); }
+};
+
+// called around every PerfMeasureRate() iteration while tracing, the GL layer sets them to time iterations on the GPU
+typedef void (*PerfTraceHook)();
+extern PerfTraceHook PerfTrace_IterationBegin;
+extern PerfTraceHook PerfTrace_IterationEnd;
@@ -0,0 +1,671 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "pixelConvert.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+
+static int Threads = 0;
+#define MaxThreads 16
+static const int MinBandPixels = 64 * 1024;     // fewer pixels per band are not worth a thread
+
+void PixelConvert_SetThreads( int threads )
+{
+    Threads = (threads > MaxThreads) ? MaxThreads : threads;
+}
+
+int PixelConvert_GetThreads()
+{
+    if( Threads > 0 )
+        return Threads;
+
+    const long cpus = sysconf( _SC_NPROCESSORS_ONLN );
+    if( cpus < 1 )
+        return 1;
+    return (cpus > MaxThreads) ? MaxThreads : (int)cpus;
+}
+
+const char* PixelConvert_SimdName()
+{
+#if defined(__SSSE3__)
+    return "SSSE3";
+#elif defined(__SSE2__)
+    return "SSE2";
+#elif defined(__ARM_NEON)
+    return "NEON";
+#else
+    return "scalar";
+#endif
+}
+
+//-----------------------------------------------------------------------------------------
+//  row bands
+//-----------------------------------------------------------------------------------------
+typedef void (*BandFunc)( void *ctx, int y0, int y1 );
+
+typedef struct{
+    BandFunc f;
+    void *ctx;
+    int y0, y1;
+}BandJob;
+
+static void* BandThread( void *arg )
+{
+    BandJob *job = (BandJob*)arg;
+    job->f( job->ctx, job->y0, job->y1 );
+    return NULL;
+}
+
+/* f() over rows [0, rows), in bands; the calling thread converts the first band */
+static void ParallelBands( int rows, int pixelsPerRow, BandFunc f, void *ctx )
+{
+    int n = PixelConvert_GetThreads();
+    const int64_t byPixels = (int64_t)rows * pixelsPerRow / MinBandPixels;
+    if( n > byPixels )
+        n = (int)byPixels;
+    if( n > rows )
+        n = rows;
+    if( n <= 1 ){
+        f( ctx, 0, rows );
+        return;
+    }
+
+    pthread_t threads[MaxThreads];
+    int started[MaxThreads];
+    BandJob jobs[MaxThreads];
+    for( int i=0; i < n; i++ ){
+        jobs[i].f = f;
+        jobs[i].ctx = ctx;
+        jobs[i].y0 = (int)((int64_t)rows * i / n);
+        jobs[i].y1 = (int)((int64_t)rows * (i + 1) / n);
+    }
+
+    for( int i=1; i < n; i++ )
+        started[i] = pthread_create( &threads[i], NULL, BandThread, &jobs[i] ) == 0;
+    f( ctx, jobs[0].y0, jobs[0].y1 );
+    for( int i=1; i < n; i++ ){
+        if( started[i] )
+            pthread_join( threads[i], NULL );
+        else
+            f( ctx, jobs[i].y0, jobs[i].y1 );
+    }
+}
+
+typedef void (*RowFunc)( const uint8_t *src, uint8_t *dst, int width );
+
+typedef struct{
+    RowFunc row;
+    const uint8_t *src;
+    int srcStride;
+    uint8_t *dst;
+    int dstStride;
+    int width, height;
+    int flip;
+}RowsJob;
+
+static void ConvertBand( void *ctx, int y0, int y1 )
+{
+    const RowsJob *job = (const RowsJob*)ctx;
+    for( int y = y0; y < y1; y++ ){
+        const int srcY = job->flip ? job->height - 1 - y : y;
+        job->row( job->src + (int64_t)srcY * job->srcStride, job->dst + (int64_t)y * job->dstStride, job->width );
+    }
+}
+
+static void ConvertRows( RowFunc row, const uint8_t *src, int srcStride, uint8_t *dst, int dstStride, int width, int height, int flip )
+{
+    RowsJob job = { row, src, srcStride, dst, dstStride, width, height, flip };
+    ParallelBands( height, width, ConvertBand, &job );
+}
+
+static inline uint32_t Load32( const uint8_t *p )
+{
+    uint32_t v;
+    memcpy( &v, p, 4 );
+    return v;
+}
+
+static inline void Store32( uint8_t *p, uint32_t v )
+{
+    memcpy( p, &v, 4 );
+}
+
+static inline uint16_t Load16( const uint8_t *p )
+{
+    uint16_t v;
+    memcpy( &v, p, 2 );
+    return v;
+}
+
+static inline void Store16( uint8_t *p, uint16_t v )
+{
+    memcpy( p, &v, 2 );
+}
+
+//-----------------------------------------------------------------------------------------
+//  swizzle, RGB24, premultiply, flip
+//-----------------------------------------------------------------------------------------
+static void RowRGBAtoBGRA( const uint8_t *src, uint8_t *dst, int width )
+{
+    int x = 0;
+#if defined(__SSSE3__)
+    const __m128i shuffle = _mm_setr_epi8( 2,1,0,3, 6,5,4,7, 10,9,8,11, 14,13,12,15 );
+    for( ; x + 4 <= width; x += 4 ){
+        const __m128i p = _mm_loadu_si128( (const __m128i*)(src + x * 4) );
+        _mm_storeu_si128( (__m128i*)(dst + x * 4), _mm_shuffle_epi8( p, shuffle ) );
+    }
+#elif defined(__SSE2__)
+    const __m128i maskGA = _mm_set1_epi32( (int)0xFF00FF00 );
+    const __m128i maskLow = _mm_set1_epi32( 0x000000FF );
+    for( ; x + 4 <= width; x += 4 ){
+        const __m128i p = _mm_loadu_si128( (const __m128i*)(src + x * 4) );
+        const __m128i ga = _mm_and_si128( p, maskGA );
+        const __m128i b = _mm_and_si128( _mm_srli_epi32( p, 16 ), maskLow );
+        const __m128i r = _mm_slli_epi32( _mm_and_si128( p, maskLow ), 16 );
+        _mm_storeu_si128( (__m128i*)(dst + x * 4), _mm_or_si128( ga, _mm_or_si128( r, b ) ) );
+    }
+#elif defined(__ARM_NEON)
+    for( ; x + 16 <= width; x += 16 ){
+        uint8x16x4_t p = vld4q_u8( src + x * 4 );
+        const uint8x16_t r = p.val[0];
+        p.val[0] = p.val[2];
+        p.val[2] = r;
+        vst4q_u8( dst + x * 4, p );
+    }
+#endif
+    for( ; x < width; x++ ){
+        const uint32_t p = Load32( src + x * 4 );
+        Store32( dst + x * 4, (p & 0xFF00FF00) | ((p >> 16) & 0xFF) | ((p & 0xFF) << 16) );
+    }
+}
+
+static void RowRGBAtoRGB( const uint8_t *src, uint8_t *dst, int width )
+{
+    int x = 0;
+#if defined(__SSSE3__)
+    // 12 bytes out of 16 are used, so stop while the 4 extra bytes still fall in the row
+    const __m128i shuffle = _mm_setr_epi8( 0,1,2, 4,5,6, 8,9,10, 12,13,14, -1,-1,-1,-1 );
+    for( ; x + 6 <= width; x += 4 ){
+        const __m128i p = _mm_loadu_si128( (const __m128i*)(src + x * 4) );
+        _mm_storeu_si128( (__m128i*)(dst + x * 3), _mm_shuffle_epi8( p, shuffle ) );
+    }
+#elif defined(__ARM_NEON)
+    for( ; x + 16 <= width; x += 16 ){
+        const uint8x16x4_t p = vld4q_u8( src + x * 4 );
+        uint8x16x3_t q;
+        q.val[0] = p.val[0];
+        q.val[1] = p.val[1];
+        q.val[2] = p.val[2];
+        vst3q_u8( dst + x * 3, q );
+    }
+#endif
+    for( ; x < width; x++ ){
+        dst[x * 3 + 0] = src[x * 4 + 0];
+        dst[x * 3 + 1] = src[x * 4 + 1];
+        dst[x * 3 + 2] = src[x * 4 + 2];
+    }
+}
+
+/* round(c * a / 255) */
+static inline uint8_t MulDiv255( unsigned c, unsigned a )
+{
+    const unsigned t = c * a + 128;
+    return (uint8_t)((t + (t >> 8)) >> 8);
+}
+
+static void RowPremultiply( const uint8_t *src, uint8_t *dst, int width )
+{
+    int x = 0;
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i maskRGB = _mm_setr_epi16( -1, -1, -1, 0, -1, -1, -1, 0 );
+    const __m128i alphaOne = _mm_setr_epi16( 0, 0, 0, 255, 0, 0, 0, 255 );
+    const __m128i half = _mm_set1_epi16( 128 );
+    for( ; x + 4 <= width; x += 4 ){
+        const __m128i p = _mm_loadu_si128( (const __m128i*)(src + x * 4) );
+        __m128i out[2];
+        for( int i=0; i < 2; i++ ){
+            const __m128i c = i ? _mm_unpackhi_epi8( p, zero ) : _mm_unpacklo_epi8( p, zero );
+            // alpha in every lane, 255 in the alpha lane so that alpha is kept
+            __m128i a = _mm_shufflehi_epi16( _mm_shufflelo_epi16( c, _MM_SHUFFLE(3,3,3,3) ), _MM_SHUFFLE(3,3,3,3) );
+            a = _mm_or_si128( _mm_and_si128( a, maskRGB ), alphaOne );
+            const __m128i t = _mm_add_epi16( _mm_mullo_epi16( c, a ), half );
+            out[i] = _mm_srli_epi16( _mm_add_epi16( t, _mm_srli_epi16( t, 8 ) ), 8 );
+        }
+        _mm_storeu_si128( (__m128i*)(dst + x * 4), _mm_packus_epi16( out[0], out[1] ) );
+    }
+#elif defined(__ARM_NEON)
+    for( ; x + 8 <= width; x += 8 ){
+        uint8x8x4_t p = vld4_u8( src + x * 4 );
+        for( int c=0; c < 3; c++ ){
+            const uint16x8_t t = vmull_u8( p.val[c], p.val[3] );
+            p.val[c] = vrshrn_n_u16( vaddq_u16( t, vrshrq_n_u16( t, 8 ) ), 8 );
+        }
+        vst4_u8( dst + x * 4, p );
+    }
+#endif
+    for( ; x < width; x++ ){
+        const unsigned a = src[x * 4 + 3];
+        dst[x * 4 + 0] = MulDiv255( src[x * 4 + 0], a );
+        dst[x * 4 + 1] = MulDiv255( src[x * 4 + 1], a );
+        dst[x * 4 + 2] = MulDiv255( src[x * 4 + 2], a );
+        dst[x * 4 + 3] = (uint8_t)a;
+    }
+}
+
+void PixelConvert_RGBAtoBGRA( const uint8_t *src, int srcStride, uint8_t *dst, int dstStride, int width, int height, int flip )
+{
+    ConvertRows( RowRGBAtoBGRA, src, srcStride, dst, dstStride, width, height, flip );
+}
+
+void PixelConvert_RGBAtoRGB( const uint8_t *src, int srcStride, uint8_t *dst, int dstStride, int width, int height, int flip )
+{
+    ConvertRows( RowRGBAtoRGB, src, srcStride, dst, dstStride, width, height, flip );
+}
+
+void PixelConvert_Premultiply( const uint8_t *src, int srcStride, uint8_t *dst, int dstStride, int width, int height, int flip )
+{
+    ConvertRows( RowPremultiply, src, srcStride, dst, dstStride, width, height, flip );
+}
+
+typedef struct{
+    const uint8_t *src;
+    int srcStride;
+    uint8_t *dst;
+    int dstStride;
+    int rowBytes, height;
+}FlipJob;
+
+/* band of destination rows [y0, y1) of the top half, swapped with their mirror */
+static void FlipBand( void *ctx, int y0, int y1 )
+{
+    const FlipJob *job = (const FlipJob*)ctx;
+    uint8_t *tmp = (uint8_t*)malloc( job->rowBytes );
+    for( int y = y0; y < y1; y++ ){
+        const int m = job->height - 1 - y;
+        const uint8_t *srcTop = job->src + (int64_t)y * job->srcStride;
+        const uint8_t *srcBottom = job->src + (int64_t)m * job->srcStride;
+        uint8_t *dstTop = job->dst + (int64_t)y * job->dstStride;
+        uint8_t *dstBottom = job->dst + (int64_t)m * job->dstStride;
+
+        memcpy( tmp, srcTop, job->rowBytes );
+        memmove( dstTop, srcBottom, job->rowBytes );
+        if( y != m )
+            memcpy( dstBottom, tmp, job->rowBytes );
+    }
+    free( tmp );
+}
+
+void PixelConvert_Flip( const uint8_t *src, int srcStride, uint8_t *dst, int dstStride, int rowBytes, int height )
+{
+    FlipJob job = { src, srcStride, dst, dstStride, rowBytes, height };
+    ParallelBands( (height + 1) / 2, rowBytes / 4, FlipBand, &job );
+}
+
+//-----------------------------------------------------------------------------------------
+//  packed formats
+//-----------------------------------------------------------------------------------------
+/* 8 bits to fewer, rounded like GL does: round(c * max / 255); for 1 bit that is c >= 128 */
+static inline uint16_t Pack565( uint32_t p )
+{
+    return (uint16_t)((MulDiv255( p & 0xFF, 31 ) << 11) | (MulDiv255( (p >> 8) & 0xFF, 63 ) << 5) | MulDiv255( (p >> 16) & 0xFF, 31 ));
+}
+
+static inline uint16_t Pack5551( uint32_t p )
+{
+    return (uint16_t)((MulDiv255( p & 0xFF, 31 ) << 11) | (MulDiv255( (p >> 8) & 0xFF, 31 ) << 6) | (MulDiv255( (p >> 16) & 0xFF, 31 ) << 1) | (p >> 31));
+}
+
+/* 1023 = 4 * 255 + 3 */
+static inline uint32_t To10( uint32_t c )
+{
+    return (c << 2) + MulDiv255( c, 3 );
+}
+
+static inline uint32_t Pack1010102( uint32_t p )
+{
+    return To10( p & 0xFF ) | (To10( (p >> 8) & 0xFF ) << 10) | (To10( (p >> 16) & 0xFF ) << 20) | ((uint32_t)MulDiv255( p >> 24, 3 ) << 30);
+}
+
+static inline uint32_t Unpack565( uint32_t v )
+{
+    const uint32_t r = v >> 11, g = (v >> 5) & 0x3F, b = v & 0x1F;
+    return ((r << 3) | (r >> 2)) | (((g << 2) | (g >> 4)) << 8) | (((b << 3) | (b >> 2)) << 16) | 0xFF000000;
+}
+
+static inline uint32_t Unpack5551( uint32_t v )
+{
+    const uint32_t r = (v >> 11) & 0x1F, g = (v >> 6) & 0x1F, b = (v >> 1) & 0x1F;
+    return ((r << 3) | (r >> 2)) | (((g << 3) | (g >> 2)) << 8) | (((b << 3) | (b >> 2)) << 16) | ((v & 1) ? 0xFF000000 : 0);
+}
+
+static inline uint32_t Unpack1010102( uint32_t v )
+{
+    return ((v >> 2) & 0xFF) | (((v >> 12) & 0xFF) << 8) | (((v >> 22) & 0xFF) << 16) | ((v >> 30) * 0x55u << 24);
+}
+
+#if defined(__SSE2__)
+static inline __m128i AndShift( __m128i v, int right, int mask )
+{
+    return _mm_and_si128( _mm_srli_epi32( v, right ), _mm_set1_epi32( mask ) );
+}
+
+/* 4 x 32-bit lanes, low 16 bits each, to 8 bytes */
+static inline void Store4x16( uint8_t *dst, __m128i v )
+{
+    v = _mm_srai_epi32( _mm_slli_epi32( v, 16 ), 16 );
+    _mm_storel_epi64( (__m128i*)dst, _mm_packs_epi32( v, v ) );
+}
+
+static inline __m128i Load4x16( const uint8_t *src )
+{
+    return _mm_unpacklo_epi16( _mm_loadl_epi64( (const __m128i*)src ), _mm_setzero_si128() );
+}
+
+/* 5 or 6 bits to 8 bits, by replicating the high bits */
+static inline __m128i Expand( __m128i c, int bits )
+{
+    return _mm_or_si128( _mm_slli_epi32( c, 8 - bits ), _mm_srli_epi32( c, 2 * bits - 8 ) );
+}
+
+/* MulDiv255() of 32-bit lanes, c and a up to 255 */
+static inline __m128i MulDiv255x4( __m128i c, int a )
+{
+    const __m128i t = _mm_add_epi32( _mm_madd_epi16( c, _mm_set1_epi32( a ) ), _mm_set1_epi32( 128 ) );
+    return _mm_srli_epi32( _mm_add_epi32( t, _mm_srli_epi32( t, 8 ) ), 8 );
+}
+
+/* 8 bits to 10 bits, as To10() */
+static inline __m128i To10x4( __m128i c )
+{
+    return _mm_add_epi32( _mm_slli_epi32( c, 2 ), MulDiv255x4( c, 3 ) );
+}
+#endif
+
+static void RowRGBAto565( const uint8_t *src, uint8_t *dst, int width )
+{
+    int x = 0;
+#if defined(__SSE2__)
+    for( ; x + 4 <= width; x += 4 ){
+        const __m128i p = _mm_loadu_si128( (const __m128i*)(src + x * 4) );
+        const __m128i r = _mm_slli_epi32( MulDiv255x4( AndShift( p, 0, 0xFF ), 31 ), 11 );
+        const __m128i g = _mm_slli_epi32( MulDiv255x4( AndShift( p, 8, 0xFF ), 63 ), 5 );
+        const __m128i b = MulDiv255x4( AndShift( p, 16, 0xFF ), 31 );
+        Store4x16( dst + x * 2, _mm_or_si128( r, _mm_or_si128( g, b ) ) );
+    }
+#endif
+    for( ; x < width; x++ )
+        Store16( dst + x * 2, Pack565( Load32( src + x * 4 ) ) );
+}
+
+static void RowRGBAto5551( const uint8_t *src, uint8_t *dst, int width )
+{
+    int x = 0;
+#if defined(__SSE2__)
+    for( ; x + 4 <= width; x += 4 ){
+        const __m128i p = _mm_loadu_si128( (const __m128i*)(src + x * 4) );
+        const __m128i r = _mm_slli_epi32( MulDiv255x4( AndShift( p, 0, 0xFF ), 31 ), 11 );
+        const __m128i g = _mm_slli_epi32( MulDiv255x4( AndShift( p, 8, 0xFF ), 31 ), 6 );
+        const __m128i b = _mm_slli_epi32( MulDiv255x4( AndShift( p, 16, 0xFF ), 31 ), 1 );
+        const __m128i a = _mm_srli_epi32( p, 31 );
+        Store4x16( dst + x * 2, _mm_or_si128( _mm_or_si128( r, g ), _mm_or_si128( b, a ) ) );
+    }
+#endif
+    for( ; x < width; x++ )
+        Store16( dst + x * 2, Pack5551( Load32( src + x * 4 ) ) );
+}
+
+static void RowRGBAto1010102( const uint8_t *src, uint8_t *dst, int width )
+{
+    int x = 0;
+#if defined(__SSE2__)
+    for( ; x + 4 <= width; x += 4 ){
+        const __m128i p = _mm_loadu_si128( (const __m128i*)(src + x * 4) );
+        const __m128i r = To10x4( AndShift( p, 0, 0xFF ) );
+        const __m128i g = _mm_slli_epi32( To10x4( AndShift( p, 8, 0xFF ) ), 10 );
+        const __m128i b = _mm_slli_epi32( To10x4( AndShift( p, 16, 0xFF ) ), 20 );
+        const __m128i a = _mm_slli_epi32( MulDiv255x4( _mm_srli_epi32( p, 24 ), 3 ), 30 );
+        _mm_storeu_si128( (__m128i*)(dst + x * 4), _mm_or_si128( _mm_or_si128( r, g ), _mm_or_si128( b, a ) ) );
+    }
+#endif
+    for( ; x < width; x++ )
+        Store32( dst + x * 4, Pack1010102( Load32( src + x * 4 ) ) );
+}
+
+static void Row565toRGBA( const uint8_t *src, uint8_t *dst, int width )
+{
+    int x = 0;
+#if defined(__SSE2__)
+    const __m128i alpha = _mm_set1_epi32( (int)0xFF000000 );
+    for( ; x + 4 <= width; x += 4 ){
+        const __m128i v = Load4x16( src + x * 2 );
+        const __m128i r = Expand( _mm_srli_epi32( v, 11 ), 5 );
+        const __m128i g = _mm_slli_epi32( Expand( AndShift( v, 5, 0x3F ), 6 ), 8 );
+        const __m128i b = _mm_slli_epi32( Expand( AndShift( v, 0, 0x1F ), 5 ), 16 );
+        _mm_storeu_si128( (__m128i*)(dst + x * 4), _mm_or_si128( _mm_or_si128( r, g ), _mm_or_si128( b, alpha ) ) );
+    }
+#endif
+    for( ; x < width; x++ )
+        Store32( dst + x * 4, Unpack565( Load16( src + x * 2 ) ) );
+}
+
+static void Row5551toRGBA( const uint8_t *src, uint8_t *dst, int width )
+{
+    int x = 0;
+#if defined(__SSE2__)
+    for( ; x + 4 <= width; x += 4 ){
+        const __m128i v = Load4x16( src + x * 2 );
+        const __m128i r = Expand( AndShift( v, 11, 0x1F ), 5 );
+        const __m128i g = _mm_slli_epi32( Expand( AndShift( v, 6, 0x1F ), 5 ), 8 );
+        const __m128i b = _mm_slli_epi32( Expand( AndShift( v, 1, 0x1F ), 5 ), 16 );
+        const __m128i a = _mm_slli_epi32( _mm_sub_epi32( _mm_setzero_si128(), AndShift( v, 0, 1 ) ), 24 );
+        _mm_storeu_si128( (__m128i*)(dst + x * 4), _mm_or_si128( _mm_or_si128( r, g ), _mm_or_si128( b, a ) ) );
+    }
+#endif
+    for( ; x < width; x++ )
+        Store32( dst + x * 4, Unpack5551( Load16( src + x * 2 ) ) );
+}
+
+static void Row1010102toRGBA( const uint8_t *src, uint8_t *dst, int width )
+{
+    int x = 0;
+#if defined(__SSE2__)
+    for( ; x + 4 <= width; x += 4 ){
+        const __m128i v = _mm_loadu_si128( (const __m128i*)(src + x * 4) );
+        const __m128i r = AndShift( v, 2, 0xFF );
+        const __m128i g = _mm_slli_epi32( AndShift( v, 12, 0xFF ), 8 );
+        const __m128i b = _mm_slli_epi32( AndShift( v, 22, 0xFF ), 16 );
+        __m128i a = _mm_srli_epi32( v, 30 );
+        a = _mm_or_si128( a, _mm_slli_epi32( a, 2 ) );
+        a = _mm_slli_epi32( _mm_or_si128( a, _mm_slli_epi32( a, 4 ) ), 24 );
+        _mm_storeu_si128( (__m128i*)(dst + x * 4), _mm_or_si128( _mm_or_si128( r, g ), _mm_or_si128( b, a ) ) );
+    }
+#endif
+    for( ; x < width; x++ )
+        Store32( dst + x * 4, Unpack1010102( Load32( src + x * 4 ) ) );
+}
+
+void PixelConvert_RGBAto565( const uint8_t *src, int srcStride, uint8_t *dst, int dstStride, int width, int height, int flip )
+{
+    ConvertRows( RowRGBAto565, src, srcStride, dst, dstStride, width, height, flip );
+}
+
+void PixelConvert_565toRGBA( const uint8_t *src, int srcStride, uint8_t *dst, int dstStride, int width, int height, int flip )
+{
+    ConvertRows( Row565toRGBA, src, srcStride, dst, dstStride, width, height, flip );
+}
+
+void PixelConvert_RGBAto5551( const uint8_t *src, int srcStride, uint8_t *dst, int dstStride, int width, int height, int flip )
+{
+    ConvertRows( RowRGBAto5551, src, srcStride, dst, dstStride, width, height, flip );
+}
+
+void PixelConvert_5551toRGBA( const uint8_t *src, int srcStride, uint8_t *dst, int dstStride, int width, int height, int flip )
+{
+    ConvertRows( Row5551toRGBA, src, srcStride, dst, dstStride, width, height, flip );
+}
+
+void PixelConvert_RGBAto1010102( const uint8_t *src, int srcStride, uint8_t *dst, int dstStride, int width, int height, int flip )
+{
+    ConvertRows( RowRGBAto1010102, src, srcStride, dst, dstStride, width, height, flip );
+}
+
+void PixelConvert_1010102toRGBA( const uint8_t *src, int srcStride, uint8_t *dst, int dstStride, int width, int height, int flip )
+{
+    ConvertRows( Row1010102toRGBA, src, srcStride, dst, dstStride, width, height, flip );
+}
+
+//-----------------------------------------------------------------------------------------
+//  half float
+//-----------------------------------------------------------------------------------------
+/* exponent rebias by a float multiply, which also normalizes denormals */
+float PixelConvert_HalfToFloat1( uint16_t h )
+{
+    const uint32_t expmant = h & 0x7FFF;
+    union { uint32_t u; float f; } v, magic;
+    magic.u = (254 - 15) << 23;
+    v.u = expmant << 13;
+    v.f *= magic.f;
+    if( expmant > 0x7BFF )
+        v.u |= 255 << 23;   // inf, nan
+    v.u |= (uint32_t)(h & 0x8000) << 16;
+    return v.f;
+}
+
+static void RowHalfToFloat( const uint8_t *src, uint8_t *dst, int width )
+{
+    const int count = width * 4;
+    int i = 0;
+#if defined(__SSE2__)
+    const __m128i maskNoSign = _mm_set1_epi32( 0x7FFF );
+    const __m128 magic = _mm_castsi128_ps( _mm_set1_epi32( (254 - 15) << 23 ) );
+    const __m128i wasInfNan = _mm_set1_epi32( 0x7BFF );
+    const __m128i expInfNan = _mm_set1_epi32( 255 << 23 );
+    for( ; i + 4 <= count; i += 4 ){
+        const __m128i h = Load4x16( src + i * 2 );
+        const __m128i expmant = _mm_and_si128( h, maskNoSign );
+        const __m128i sign = _mm_slli_epi32( _mm_xor_si128( h, expmant ), 16 );
+        const __m128 scaled = _mm_mul_ps( _mm_castsi128_ps( _mm_slli_epi32( expmant, 13 ) ), magic );
+        const __m128i infNan = _mm_and_si128( _mm_cmpgt_epi32( expmant, wasInfNan ), expInfNan );
+        const __m128 f = _mm_or_ps( scaled, _mm_castsi128_ps( _mm_or_si128( sign, infNan ) ) );
+        _mm_storeu_ps( (float*)(dst + i * 4), f );
+    }
+#elif defined(__aarch64__)
+    for( ; i + 4 <= count; i += 4 )
+        vst1q_f32( (float*)(dst + i * 4), vcvt_f32_f16( vreinterpret_f16_u16( vld1_u16( (const uint16_t*)(src + i * 2) ) ) ) );
+#endif
+    for( ; i < count; i++ ){
+        const float f = PixelConvert_HalfToFloat1( Load16( src + i * 2 ) );
+        memcpy( dst + i * 4, &f, 4 );
+    }
+}
+
+void PixelConvert_HalfToFloat( const uint8_t *src, int srcStride, uint8_t *dst, int dstStride, int width, int height, int flip )
+{
+    ConvertRows( RowHalfToFloat, src, srcStride, dst, dstStride, width, height, flip );
+}
+
+//-----------------------------------------------------------------------------------------
+//  YUV
+//-----------------------------------------------------------------------------------------
+static inline uint8_t LumaBT601( unsigned r, unsigned g, unsigned b )
+{
+    return (uint8_t)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+}
+
+static void RowY( const uint8_t *src, uint8_t *dst, int width )
+{
+    int x = 0;
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i coeffs = _mm_setr_epi16( 66, 129, 25, 0, 66, 129, 25, 0 );
+    const __m128i round = _mm_set1_epi32( 128 );
+    const __m128i offset = _mm_set1_epi32( 16 );
+    for( ; x + 4 <= width; x += 4 ){
+        const __m128i p = _mm_loadu_si128( (const __m128i*)(src + x * 4) );
+        // per pixel: { 66r + 129g, 25b }, for pixels 0,1 then 2,3
+        const __m128 lo = _mm_castsi128_ps( _mm_madd_epi16( _mm_unpacklo_epi8( p, zero ), coeffs ) );
+        const __m128 hi = _mm_castsi128_ps( _mm_madd_epi16( _mm_unpackhi_epi8( p, zero ), coeffs ) );
+        const __m128i rg = _mm_castps_si128( _mm_shuffle_ps( lo, hi, _MM_SHUFFLE(2,0,2,0) ) );
+        const __m128i b = _mm_castps_si128( _mm_shuffle_ps( lo, hi, _MM_SHUFFLE(3,1,3,1) ) );
+        __m128i y = _mm_add_epi32( _mm_srli_epi32( _mm_add_epi32( _mm_add_epi32( rg, b ), round ), 8 ), offset );
+        y = _mm_packs_epi32( y, y );
+        y = _mm_packus_epi16( y, y );
+        Store32( dst + x, (uint32_t)_mm_cvtsi128_si32( y ) );
+    }
+#endif
+    for( ; x < width; x++ )
+        dst[x] = LumaBT601( src[x * 4 + 0], src[x * 4 + 1], src[x * 4 + 2] );
+}
+
+/* u, v written every 'step' bytes: 2 for NV12 interleaved, 1 for I420 planes */
+static void RowUV( const uint8_t *row0, const uint8_t *row1, uint8_t *u, uint8_t *v, int step, int width )
+{
+    for( int cx = 0; cx < (width + 1) / 2; cx++ ){
+        const int x0 = cx * 2;
+        const int x1 = (x0 + 1 < width) ? x0 + 1 : x0;
+        int sum[3];
+        for( int c=0; c < 3; c++ )
+            sum[c] = row0[x0 * 4 + c] + row0[x1 * 4 + c] + row1[x0 * 4 + c] + row1[x1 * 4 + c];
+        const int r = (sum[0] + 2) >> 2, g = (sum[1] + 2) >> 2, b = (sum[2] + 2) >> 2;
+
+        u[cx * step] = (uint8_t)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+        v[cx * step] = (uint8_t)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+    }
+}
+
+typedef struct{
+    const uint8_t *src;
+    int srcStride;
+    uint8_t *y;
+    int strideY;
+    uint8_t *u, *v;
+    int strideU, strideV;
+    int step;
+    int width, height;
+    int flip;
+}YuvJob;
+
+/* band of chroma rows, each with its 2 luma rows */
+static void YuvBand( void *ctx, int cy0, int cy1 )
+{
+    const YuvJob *job = (const YuvJob*)ctx;
+    for( int cy = cy0; cy < cy1; cy++ ){
+        const int y0 = cy * 2;
+        const int y1 = (y0 + 1 < job->height) ? y0 + 1 : y0;
+        const int srcY0 = job->flip ? job->height - 1 - y0 : y0;
+        const int srcY1 = job->flip ? job->height - 1 - y1 : y1;
+        const uint8_t *row0 = job->src + (int64_t)srcY0 * job->srcStride;
+        const uint8_t *row1 = job->src + (int64_t)srcY1 * job->srcStride;
+
+        RowY( row0, job->y + (int64_t)y0 * job->strideY, job->width );
+        if( y1 != y0 )
+            RowY( row1, job->y + (int64_t)y1 * job->strideY, job->width );
+        RowUV( row0, row1, job->u + (int64_t)cy * job->strideU, job->v + (int64_t)cy * job->strideV, job->step, job->width );
+    }
+}
+
+void PixelConvert_RGBAtoNV12( const uint8_t *src, int srcStride, uint8_t *dstY, int strideY, uint8_t *dstUV, int strideUV,
+                              int width, int height, int flip )
+{
+    YuvJob job = { src, srcStride, dstY, strideY, dstUV, dstUV + 1, strideUV, strideUV, 2, width, height, flip };
+    ParallelBands( (height + 1) / 2, width * 2, YuvBand, &job );
+}
+
+void PixelConvert_RGBAtoI420( const uint8_t *src, int srcStride, uint8_t *dstY, int strideY, uint8_t *dstU, int strideU,
+                              uint8_t *dstV, int strideV, int width, int height, int flip )
+{
+    YuvJob job = { src, srcStride, dstY, strideY, dstU, dstV, strideU, strideV, 1, width, height, flip };
+    ParallelBands( (height + 1) / 2, width * 2, YuvBand, &job );
+}
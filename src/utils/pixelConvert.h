@@ -0,0 +1,40 @@
+#pragma once
+/*
+ * CPU pixel conversion, for glReadPixels() consumers:
+ *   source is RGBA8 (or the packed format being unpacked), rows 'srcStride' bytes apart, bottom-up as read by GL.
+ *   flip != 0 writes the rows top-down, like stbi_flip_vertically_on_write(). src and dst may be the same
+ *   buffer only when flip is 0 and the pixel size does not grow.
+ *   SSE2 / SSSE3 / NEON inner loops when the compiler targets them, scalar otherwise.
+ *   Images are split in row bands converted in parallel, PixelConvert_SetThreads() sets how many threads.
+ */
+#include <stdint.h>
+
+void PixelConvert_SetThreads( int threads );    // 0: one per CPU, 1: no worker thread
+int PixelConvert_GetThreads();
+const char* PixelConvert_SimdName();
+
+// RGBA8 <-> BGRA8, the same function both ways
+void PixelConvert_RGBAtoBGRA( const uint8_t *src, int srcStride, uint8_t *dst, int dstStride, int width, int height, int flip );
+void PixelConvert_RGBAtoRGB( const uint8_t *src, int srcStride, uint8_t *dst, int dstStride, int width, int height, int flip );
+void PixelConvert_Premultiply( const uint8_t *src, int srcStride, uint8_t *dst, int dstStride, int width, int height, int flip );
+// any pixel size, in place when src == dst
+void PixelConvert_Flip( const uint8_t *src, int srcStride, uint8_t *dst, int dstStride, int rowBytes, int height );
+
+// packed formats, as GL_UNSIGNED_SHORT_5_6_5 / GL_UNSIGNED_SHORT_5_5_5_1 / GL_UNSIGNED_INT_2_10_10_10_REV
+// packing rounds to the nearest value like GL, unpacking replicates the high bits
+void PixelConvert_RGBAto565( const uint8_t *src, int srcStride, uint8_t *dst, int dstStride, int width, int height, int flip );
+void PixelConvert_565toRGBA( const uint8_t *src, int srcStride, uint8_t *dst, int dstStride, int width, int height, int flip );
+void PixelConvert_RGBAto5551( const uint8_t *src, int srcStride, uint8_t *dst, int dstStride, int width, int height, int flip );
+void PixelConvert_5551toRGBA( const uint8_t *src, int srcStride, uint8_t *dst, int dstStride, int width, int height, int flip );
+void PixelConvert_RGBAto1010102( const uint8_t *src, int srcStride, uint8_t *dst, int dstStride, int width, int height, int flip );
+void PixelConvert_1010102toRGBA( const uint8_t *src, int srcStride, uint8_t *dst, int dstStride, int width, int height, int flip );
+
+// RGBA16F -> RGBA32F
+void PixelConvert_HalfToFloat( const uint8_t *src, int srcStride, uint8_t *dst, int dstStride, int width, int height, int flip );
+float PixelConvert_HalfToFloat1( uint16_t h );
+
+// BT.601 limited range, chroma is the average of 2x2 pixels; odd sizes repeat the last row/column
+void PixelConvert_RGBAtoNV12( const uint8_t *src, int srcStride, uint8_t *dstY, int strideY, uint8_t *dstUV, int strideUV,
+                              int width, int height, int flip );
+void PixelConvert_RGBAtoI420( const uint8_t *src, int srcStride, uint8_t *dstY, int strideY, uint8_t *dstU, int strideU,
+                              uint8_t *dstV, int strideV, int width, int height, int flip );
@@ -0,0 +1,718 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "softRaster.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+
+#define TileSize        64
+#define TileShift       6
+#define SubpixelBits    8
+#define SubpixelOne     (1 << SubpixelBits)
+#define MaxClipVertices 9
+
+// interpolated attributes, each premultiplied by q = 1/w
+enum{ ATTR_Q, ATTR_R, ATTR_G, ATTR_B, ATTR_A, ATTR_S, ATTR_T, NumAttrs };
+
+typedef struct{
+    int isPoint;
+    int blend;
+    int textured;
+    SoftRasterTexture texture;
+    int x0, y0, x1, y1;             // pixel bounding box, inclusive
+    // triangle: pixel (x, y) is inside when A*x + B*y + C >= 0 for the 3 edges, C has the fill rule
+    int32_t A[3], B[3];
+    int64_t C[3];
+    // attribute planes at pixel centers: v0 + dx * (px - x0f) + dy * (py - y0f)
+    float xf, yf;
+    float v0[NumAttrs], dx[NumAttrs], dy[NumAttrs];
+}Prim;
+
+typedef struct{
+    uint32_t *prims;
+    int count, capacity;
+}Bin;
+
+struct SoftRaster{
+    int width, height;
+    uint32_t *color;
+    int threads;
+
+    float matrix[16];
+    SoftRasterTexture texture;
+    int textured;
+    int blend;
+    float pointSize;
+
+    int clearPending;
+    uint32_t clearColor;
+    Prim *prims;
+    int numPrims, primCapacity;
+    int tilesX, tilesY;
+    Bin *bins;
+    int nextTile;                   // shared by the workers of SoftRaster_Finish()
+};
+
+typedef struct{
+    float clip[4];
+    float attr[NumAttrs];           // q unused here, color and texcoord
+}ClipVertex;
+
+static uint32_t PackColor( float r, float g, float b, float a );
+
+SoftRaster* SoftRaster_Create( int width, int height )
+{
+    if( width < 1 || height < 1 || width > SoftRaster_MaxSize || height > SoftRaster_MaxSize ){
+        printf("%s: %dx%d is not supported, max %d\n", __func__, width, height, SoftRaster_MaxSize);
+        return NULL;
+    }
+
+    SoftRaster *sr = (SoftRaster*) calloc( 1, sizeof(SoftRaster) );
+    sr->width = width;
+    sr->height = height;
+    sr->color = (uint32_t*) calloc( (size_t)width * height, 4 );
+    sr->tilesX = (width + TileSize - 1) / TileSize;
+    sr->tilesY = (height + TileSize - 1) / TileSize;
+    sr->bins = (Bin*) calloc( sr->tilesX * sr->tilesY, sizeof(Bin) );
+    sr->pointSize = 1.0f;
+    SoftRaster_SetMatrix( sr, NULL );
+    return sr;
+}
+
+void SoftRaster_Destroy( SoftRaster *sr )
+{
+    if( sr == NULL )
+        return;
+    for( int i=0; i < sr->tilesX * sr->tilesY; i++ )
+        free( sr->bins[i].prims );
+    free( sr->bins );
+    free( sr->prims );
+    free( sr->color );
+    free( sr );
+}
+
+void SoftRaster_SetThreads( SoftRaster *sr, int threads )
+{
+    sr->threads = (threads > SoftRaster_MaxThreads) ? SoftRaster_MaxThreads : threads;
+}
+
+void SoftRaster_SetMatrix( SoftRaster *sr, const float *matrix )
+{
+    if( matrix ){
+        memcpy( sr->matrix, matrix, sizeof(sr->matrix) );
+        return;
+    }
+    memset( sr->matrix, 0, sizeof(sr->matrix) );
+    sr->matrix[0] = sr->matrix[5] = sr->matrix[10] = sr->matrix[15] = 1.0f;
+}
+
+void SoftRaster_SetTexture( SoftRaster *sr, const SoftRasterTexture *texture )
+{
+    sr->textured = (texture != NULL);
+    if( texture )
+        sr->texture = *texture;
+}
+
+void SoftRaster_SetBlend( SoftRaster *sr, int enable )
+{
+    sr->blend = enable;
+}
+
+void SoftRaster_SetPointSize( SoftRaster *sr, float size )
+{
+    sr->pointSize = size;
+}
+
+void SoftRaster_Clear( SoftRaster *sr, float r, float g, float b, float a )
+{
+    // a clear replaces everything drawn before it
+    sr->numPrims = 0;
+    for( int i=0; i < sr->tilesX * sr->tilesY; i++ )
+        sr->bins[i].count = 0;
+    sr->clearPending = 1;
+    sr->clearColor = PackColor( r, g, b, a );
+}
+
+//-----------------------------------------------------------------------------------------
+//  pixels
+//-----------------------------------------------------------------------------------------
+static inline int ToByte( float v )
+{
+    v = (v > 0.0f) ? v : 0.0f;
+    v = (v < 1.0f) ? v : 1.0f;
+    return (int)(v * 255.0f + 0.5f);
+}
+
+static uint32_t PackColor( float r, float g, float b, float a )
+{
+    return (uint32_t)ToByte( r ) | ((uint32_t)ToByte( g ) << 8) | ((uint32_t)ToByte( b ) << 16) | ((uint32_t)ToByte( a ) << 24);
+}
+
+static inline int Wrap( int i, int size, int repeat )
+{
+    if( repeat ){
+        i %= size;
+        return (i < 0) ? i + size : i;
+    }
+    return (i < 0) ? 0 : (i >= size) ? size - 1 : i;
+}
+
+static inline uint32_t Texel( const SoftRasterTexture *t, int x, int y )
+{
+    uint32_t p;
+    memcpy( &p, t->rgba + ((size_t)y * t->width + x) * 4, 4 );
+    return p;
+}
+
+/* 8 bits of subtexel precision for linear, like most GPUs */
+static uint32_t Sample( const SoftRasterTexture *t, float s, float tc )
+{
+    if( !t->linear ){
+        const int x = Wrap( (int)floorf( s * t->width ), t->width, t->repeat );
+        const int y = Wrap( (int)floorf( tc * t->height ), t->height, t->repeat );
+        return Texel( t, x, y );
+    }
+
+    const float u = s * t->width - 0.5f;
+    const float v = tc * t->height - 0.5f;
+    const float fu = floorf( u );
+    const float fv = floorf( v );
+    const int wu = (int)((u - fu) * 256.0f);
+    const int wv = (int)((v - fv) * 256.0f);
+    const int x0 = Wrap( (int)fu, t->width, t->repeat ), x1 = Wrap( (int)fu + 1, t->width, t->repeat );
+    const int y0 = Wrap( (int)fv, t->height, t->repeat ), y1 = Wrap( (int)fv + 1, t->height, t->repeat );
+    const uint32_t p00 = Texel( t, x0, y0 ), p10 = Texel( t, x1, y0 );
+    const uint32_t p01 = Texel( t, x0, y1 ), p11 = Texel( t, x1, y1 );
+
+    uint32_t out = 0;
+    for( int c=0; c < 32; c += 8 ){
+        const uint32_t top = ((p00 >> c) & 0xFF) * (256 - wu) + ((p10 >> c) & 0xFF) * wu;
+        const uint32_t bottom = ((p01 >> c) & 0xFF) * (256 - wu) + ((p11 >> c) & 0xFF) * wu;
+        out |= ((top * (256 - wv) + bottom * wv + 32768) >> 16) << c;
+    }
+    return out;
+}
+
+static inline uint32_t Modulate( uint32_t a, uint32_t b )
+{
+    uint32_t out = 0;
+    for( int c=0; c < 32; c += 8 )
+        out |= ((((a >> c) & 0xFF) * ((b >> c) & 0xFF) + 127) / 255) << c;
+    return out;
+}
+
+/* GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, for color and alpha */
+static inline uint32_t Blend( uint32_t src, uint32_t dst )
+{
+    const uint32_t a = src >> 24;
+    uint32_t out = 0;
+    for( int c=0; c < 32; c += 8 )
+        out |= ((((src >> c) & 0xFF) * a + ((dst >> c) & 0xFF) * (255 - a) + 127) / 255) << c;
+    return out;
+}
+
+/* attrs already divided by q */
+static inline void ShadePixel( const Prim *p, const float *attrs, uint32_t *dst )
+{
+    uint32_t c = PackColor( attrs[ATTR_R], attrs[ATTR_G], attrs[ATTR_B], attrs[ATTR_A] );
+    if( p->textured )
+        c = Modulate( Sample( &p->texture, attrs[ATTR_S], attrs[ATTR_T] ), c );
+    if( p->blend )
+        c = Blend( c, *dst );
+    *dst = c;
+}
+
+//-----------------------------------------------------------------------------------------
+//  tile rasterization
+//-----------------------------------------------------------------------------------------
+static void RasterPoint( SoftRaster *sr, const Prim *p, int x0, int y0, int x1, int y1 )
+{
+    float attrs[NumAttrs];
+    for( int i=0; i < NumAttrs; i++ )
+        attrs[i] = p->v0[i];
+    for( int y = y0; y <= y1; y++ ){
+        uint32_t *row = sr->color + (size_t)y * sr->width;
+        for( int x = x0; x <= x1; x++ )
+            ShadePixel( p, attrs, row + x );
+    }
+}
+
+static void RasterTriangle( SoftRaster *sr, const Prim *p, int x0, int y0, int x1, int y1 )
+{
+    // edges over the region: reject, accept, or 32-bit stepping from the region origin
+    int32_t A[3], B[3], E[3];
+    for( int i=0; i < 3; i++ ){
+        const int64_t e = (int64_t)p->A[i] * x0 + (int64_t)p->B[i] * y0 + p->C[i];
+        const int64_t ax = (int64_t)p->A[i] * (x1 - x0);
+        const int64_t by = (int64_t)p->B[i] * (y1 - y0);
+        const int64_t eMin = e + ((ax < 0) ? ax : 0) + ((by < 0) ? by : 0);
+        const int64_t eMax = e + ((ax > 0) ? ax : 0) + ((by > 0) ? by : 0);
+        if( eMax < 0 )
+            return;
+        if( eMin >= 0 ){
+            A[i] = B[i] = 0;
+            E[i] = 0;
+        }else{
+            A[i] = p->A[i];
+            B[i] = p->B[i];
+            E[i] = (int32_t)e;      // |e| < the range of the region, which fits
+        }
+    }
+
+    const int fast = !p->textured && !p->blend;
+    for( int y = y0; y <= y1; y++ ){
+        const int dyRow = y - y0;
+        const int32_t e0 = E[0] + B[0] * dyRow, e1 = E[1] + B[1] * dyRow, e2 = E[2] + B[2] * dyRow;
+        uint32_t *row = sr->color + (size_t)y * sr->width;
+
+        float base[NumAttrs];
+        const float px = ((float)x0 + 0.5f) - p->xf;
+        const float py = ((float)y + 0.5f) - p->yf;
+        for( int i=0; i < NumAttrs; i++ )
+            base[i] = p->v0[i] + p->dx[i] * px + p->dy[i] * py;
+
+        int x = x0;
+#if defined(__SSE2__)
+        __m128i ve0 = _mm_add_epi32( _mm_set1_epi32( e0 ), _mm_set_epi32( 3 * A[0], 2 * A[0], A[0], 0 ) );
+        __m128i ve1 = _mm_add_epi32( _mm_set1_epi32( e1 ), _mm_set_epi32( 3 * A[1], 2 * A[1], A[1], 0 ) );
+        __m128i ve2 = _mm_add_epi32( _mm_set1_epi32( e2 ), _mm_set_epi32( 3 * A[2], 2 * A[2], A[2], 0 ) );
+        const __m128i step0 = _mm_set1_epi32( 4 * A[0] ), step1 = _mm_set1_epi32( 4 * A[1] ), step2 = _mm_set1_epi32( 4 * A[2] );
+        __m128 vk = _mm_set_ps( 3.0f, 2.0f, 1.0f, 0.0f );
+        const __m128 four = _mm_set1_ps( 4.0f );
+        const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps( 1.0f );
+        const __m128 scale = _mm_set1_ps( 255.0f ), half = _mm_set1_ps( 0.5f );
+        for( ; x + 3 <= x1; x += 4 ){
+            const __m128i outside = _mm_srai_epi32( _mm_or_si128( _mm_or_si128( ve0, ve1 ), ve2 ), 31 );
+            const int mask = _mm_movemask_ps( _mm_castsi128_ps( outside ) ) ^ 0xF;
+            if( mask ){
+                __m128 v[NumAttrs];
+                for( int i=0; i < NumAttrs; i++ )
+                    v[i] = _mm_add_ps( _mm_set1_ps( base[i] ), _mm_mul_ps( _mm_set1_ps( p->dx[i] ), vk ) );
+                for( int i=1; i < NumAttrs; i++ )
+                    v[i] = _mm_div_ps( v[i], v[ATTR_Q] );
+
+                if( fast ){
+                    __m128i c[4];
+                    for( int i=0; i < 4; i++ ){
+                        const __m128 f = _mm_min_ps( _mm_max_ps( v[ATTR_R + i], zero ), one );
+                        c[i] = _mm_cvttps_epi32( _mm_add_ps( _mm_mul_ps( f, scale ), half ) );
+                    }
+                    const __m128i rgba = _mm_or_si128( _mm_or_si128( c[0], _mm_slli_epi32( c[1], 8 ) ),
+                                                       _mm_or_si128( _mm_slli_epi32( c[2], 16 ), _mm_slli_epi32( c[3], 24 ) ) );
+                    __m128i *dst = (__m128i*)(row + x);
+                    const __m128i old = _mm_loadu_si128( dst );
+                    _mm_storeu_si128( dst, _mm_or_si128( _mm_and_si128( outside, old ), _mm_andnot_si128( outside, rgba ) ) );
+                }else{
+                    float lanes[NumAttrs][4];
+                    for( int i=0; i < NumAttrs; i++ )
+                        _mm_storeu_ps( lanes[i], v[i] );
+                    for( int k=0; k < 4; k++ ){
+                        if( !(mask & (1 << k)) )
+                            continue;
+                        float attrs[NumAttrs];
+                        for( int i=0; i < NumAttrs; i++ )
+                            attrs[i] = lanes[i][k];
+                        ShadePixel( p, attrs, row + x + k );
+                    }
+                }
+            }
+            ve0 = _mm_add_epi32( ve0, step0 );
+            ve1 = _mm_add_epi32( ve1, step1 );
+            ve2 = _mm_add_epi32( ve2, step2 );
+            vk = _mm_add_ps( vk, four );
+        }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+        const int32_t lane[4] = { 0, 1, 2, 3 };
+        const int32x4_t vlane = vld1q_s32( lane );
+        int32x4_t ve0 = vmlaq_n_s32( vdupq_n_s32( e0 ), vlane, A[0] );
+        int32x4_t ve1 = vmlaq_n_s32( vdupq_n_s32( e1 ), vlane, A[1] );
+        int32x4_t ve2 = vmlaq_n_s32( vdupq_n_s32( e2 ), vlane, A[2] );
+        float32x4_t vk = vcvtq_f32_s32( vlane );
+        for( ; x + 3 <= x1; x += 4 ){
+            const int32x4_t outside = vshrq_n_s32( vorrq_s32( vorrq_s32( ve0, ve1 ), ve2 ), 31 );
+            const uint32_t inside[4] = { (uint32_t)~vgetq_lane_s32( outside, 0 ), (uint32_t)~vgetq_lane_s32( outside, 1 ),
+                                         (uint32_t)~vgetq_lane_s32( outside, 2 ), (uint32_t)~vgetq_lane_s32( outside, 3 ) };
+            if( inside[0] | inside[1] | inside[2] | inside[3] ){
+                float32x4_t v[NumAttrs];
+                for( int i=0; i < NumAttrs; i++ )
+                    v[i] = vaddq_f32( vdupq_n_f32( base[i] ), vmulq_f32( vdupq_n_f32( p->dx[i] ), vk ) );
+                for( int i=1; i < NumAttrs; i++ )
+                    v[i] = vdivq_f32( v[i], v[ATTR_Q] );
+
+                if( fast ){
+                    uint32x4_t c[4];
+                    for( int i=0; i < 4; i++ ){
+                        const float32x4_t f = vminq_f32( vmaxq_f32( v[ATTR_R + i], vdupq_n_f32( 0.0f ) ), vdupq_n_f32( 1.0f ) );
+                        c[i] = vcvtq_u32_f32( vaddq_f32( vmulq_f32( f, vdupq_n_f32( 255.0f ) ), vdupq_n_f32( 0.5f ) ) );
+                    }
+                    const uint32x4_t rgba = vorrq_u32( vorrq_u32( c[0], vshlq_n_u32( c[1], 8 ) ),
+                                                       vorrq_u32( vshlq_n_u32( c[2], 16 ), vshlq_n_u32( c[3], 24 ) ) );
+                    const uint32x4_t old = vld1q_u32( row + x );
+                    vst1q_u32( row + x, vbslq_u32( vreinterpretq_u32_s32( outside ), old, rgba ) );
+                }else{
+                    float lanes[NumAttrs][4];
+                    for( int i=0; i < NumAttrs; i++ )
+                        vst1q_f32( lanes[i], v[i] );
+                    for( int k=0; k < 4; k++ ){
+                        if( !inside[k] )
+                            continue;
+                        float attrs[NumAttrs];
+                        for( int i=0; i < NumAttrs; i++ )
+                            attrs[i] = lanes[i][k];
+                        ShadePixel( p, attrs, row + x + k );
+                    }
+                }
+            }
+            ve0 = vaddq_s32( ve0, vdupq_n_s32( 4 * A[0] ) );
+            ve1 = vaddq_s32( ve1, vdupq_n_s32( 4 * A[1] ) );
+            ve2 = vaddq_s32( ve2, vdupq_n_s32( 4 * A[2] ) );
+            vk = vaddq_f32( vk, vdupq_n_f32( 4.0f ) );
+        }
+#endif
+        // same arithmetic per pixel
+        for( ; x <= x1; x++ ){
+            const int k = x - x0;
+            if( ((e0 + A[0] * k) | (e1 + A[1] * k) | (e2 + A[2] * k)) < 0 )
+                continue;
+            float attrs[NumAttrs];
+            for( int i=0; i < NumAttrs; i++ )
+                attrs[i] = base[i] + p->dx[i] * (float)k;
+            for( int i=1; i < NumAttrs; i++ )
+                attrs[i] = attrs[i] / attrs[ATTR_Q];
+            ShadePixel( p, attrs, row + x );
+        }
+    }
+}
+
+static void RasterTile( SoftRaster *sr, int tile )
+{
+    const int tx = tile % sr->tilesX;
+    const int ty = tile / sr->tilesX;
+    const int x0 = tx * TileSize, y0 = ty * TileSize;
+    const int x1 = (x0 + TileSize < sr->width) ? x0 + TileSize - 1 : sr->width - 1;
+    const int y1 = (y0 + TileSize < sr->height) ? y0 + TileSize - 1 : sr->height - 1;
+
+    if( sr->clearPending ){
+        for( int y = y0; y <= y1; y++ ){
+            uint32_t *row = sr->color + (size_t)y * sr->width;
+            for( int x = x0; x <= x1; x++ )
+                row[x] = sr->clearColor;
+        }
+    }
+
+    const Bin *bin = &sr->bins[tile];
+    for( int i=0; i < bin->count; i++ ){
+        const Prim *p = &sr->prims[bin->prims[i]];
+        const int rx0 = (p->x0 > x0) ? p->x0 : x0, rx1 = (p->x1 < x1) ? p->x1 : x1;
+        const int ry0 = (p->y0 > y0) ? p->y0 : y0, ry1 = (p->y1 < y1) ? p->y1 : y1;
+        if( rx0 > rx1 || ry0 > ry1 )
+            continue;
+        if( p->isPoint )
+            RasterPoint( sr, p, rx0, ry0, rx1, ry1 );
+        else
+            RasterTriangle( sr, p, rx0, ry0, rx1, ry1 );
+    }
+}
+
+static void* TileThread( void *arg )
+{
+    SoftRaster *sr = (SoftRaster*)arg;
+    const int tiles = sr->tilesX * sr->tilesY;
+    for(;;){
+        const int tile = __atomic_fetch_add( &sr->nextTile, 1, __ATOMIC_RELAXED );
+        if( tile >= tiles )
+            return NULL;
+        RasterTile( sr, tile );
+    }
+}
+
+const uint8_t* SoftRaster_Finish( SoftRaster *sr )
+{
+    const int tiles = sr->tilesX * sr->tilesY;
+    int n = sr->threads;
+    if( n <= 0 ){
+        const long cpus = sysconf( _SC_NPROCESSORS_ONLN );
+        n = (cpus < 1) ? 1 : (cpus > SoftRaster_MaxThreads) ? SoftRaster_MaxThreads : (int)cpus;
+    }
+    if( n > tiles )
+        n = tiles;
+
+    // the calling thread works too
+    sr->nextTile = 0;
+    pthread_t threads[SoftRaster_MaxThreads];
+    int started = 0;
+    for( int i=1; i < n; i++ ){
+        if( pthread_create( &threads[started], NULL, TileThread, sr ) == 0 )
+            started++;
+    }
+    TileThread( sr );
+    for( int i=0; i < started; i++ )
+        pthread_join( threads[i], NULL );
+
+    sr->clearPending = 0;
+    sr->numPrims = 0;
+    for( int i=0; i < tiles; i++ )
+        sr->bins[i].count = 0;
+    return (const uint8_t*)sr->color;
+}
+
+//-----------------------------------------------------------------------------------------
+//  setup
+//-----------------------------------------------------------------------------------------
+static Prim* NewPrim( SoftRaster *sr )
+{
+    if( sr->numPrims == sr->primCapacity ){
+        sr->primCapacity = sr->primCapacity ? sr->primCapacity * 2 : 256;
+        sr->prims = (Prim*) realloc( sr->prims, sr->primCapacity * sizeof(Prim) );
+    }
+    Prim *p = &sr->prims[sr->numPrims];
+    memset( p, 0, sizeof(*p) );
+    p->blend = sr->blend;
+    p->textured = sr->textured;
+    p->texture = sr->texture;
+    return p;
+}
+
+static void BinPrim( SoftRaster *sr, const Prim *p )
+{
+    const uint32_t index = (uint32_t)(p - sr->prims);
+    for( int ty = p->y0 >> TileShift; ty <= (p->y1 >> TileShift); ty++ ){
+        for( int tx = p->x0 >> TileShift; tx <= (p->x1 >> TileShift); tx++ ){
+            Bin *bin = &sr->bins[ty * sr->tilesX + tx];
+            if( bin->count == bin->capacity ){
+                bin->capacity = bin->capacity ? bin->capacity * 2 : 64;
+                bin->prims = (uint32_t*) realloc( bin->prims, bin->capacity * sizeof(uint32_t) );
+            }
+            bin->prims[bin->count++] = index;
+        }
+    }
+    sr->numPrims++;
+}
+
+/* window position in subpixels, and the attributes premultiplied by q */
+typedef struct{
+    int32_t X, Y;
+    float attr[NumAttrs];
+}WindowVertex;
+
+static void ToWindow( const SoftRaster *sr, const ClipVertex *c, WindowVertex *w )
+{
+    const float q = 1.0f / c->clip[3];
+    const float x = (c->clip[0] * q + 1.0f) * 0.5f * (float)sr->width;
+    const float y = (c->clip[1] * q + 1.0f) * 0.5f * (float)sr->height;
+    w->X = (int32_t)lrintf( x * SubpixelOne );
+    w->Y = (int32_t)lrintf( y * SubpixelOne );
+    w->attr[ATTR_Q] = q;
+    for( int i=1; i < NumAttrs; i++ )
+        w->attr[i] = c->attr[i] * q;
+}
+
+static void SetupTriangle( SoftRaster *sr, const WindowVertex *v0, const WindowVertex *v1, const WindowVertex *v2 )
+{
+    int64_t area = (int64_t)(v1->X - v0->X) * (v2->Y - v0->Y) - (int64_t)(v2->X - v0->X) * (v1->Y - v0->Y);
+    if( area == 0 )
+        return;
+    // counter-clockwise, inside is left of each edge
+    const WindowVertex *v[3] = { v0, v1, v2 };
+    if( area < 0 ){
+        v[1] = v2;
+        v[2] = v1;
+        area = -area;
+    }
+
+    Prim *p = NewPrim( sr );
+    int32_t minX = v[0]->X, maxX = v[0]->X, minY = v[0]->Y, maxY = v[0]->Y;
+    for( int i=0; i < 3; i++ ){
+        const WindowVertex *a = v[i];
+        const WindowVertex *b = v[(i + 1) % 3];
+        const int32_t ex = b->X - a->X;
+        const int32_t ey = b->Y - a->Y;
+        // y up: top edges go left, left edges go down; the others exclude their pixel centers
+        const int topLeft = (ey < 0) || (ey == 0 && ex < 0);
+        // at pixel centers the subpixel edge function is SubpixelOne * (A*x + B*y) + c: the floor of c / SubpixelOne
+        // keeps the same sign, with whole pixel steps small enough for 32 bits
+        const int64_t c = (int64_t)ex * (SubpixelOne / 2 - a->Y) - (int64_t)ey * (SubpixelOne / 2 - a->X) - (topLeft ? 0 : 1);
+        p->A[i] = -ey;
+        p->B[i] = ex;
+        p->C[i] = c >> SubpixelBits;
+
+        minX = (a->X < minX) ? a->X : minX;
+        maxX = (a->X > maxX) ? a->X : maxX;
+        minY = (a->Y < minY) ? a->Y : minY;
+        maxY = (a->Y > maxY) ? a->Y : maxY;
+    }
+    p->x0 = (minX >> SubpixelBits > 0) ? minX >> SubpixelBits : 0;
+    p->y0 = (minY >> SubpixelBits > 0) ? minY >> SubpixelBits : 0;
+    p->x1 = (maxX >> SubpixelBits < sr->width - 1) ? maxX >> SubpixelBits : sr->width - 1;
+    p->y1 = (maxY >> SubpixelBits < sr->height - 1) ? maxY >> SubpixelBits : sr->height - 1;
+    if( p->x0 > p->x1 || p->y0 > p->y1 )
+        return;
+
+    // attribute planes from the snapped positions
+    const double x0 = v[0]->X / (double)SubpixelOne, y0 = v[0]->Y / (double)SubpixelOne;
+    const double x1 = v[1]->X / (double)SubpixelOne - x0, y1 = v[1]->Y / (double)SubpixelOne - y0;
+    const double x2 = v[2]->X / (double)SubpixelOne - x0, y2 = v[2]->Y / (double)SubpixelOne - y0;
+    const double det = x1 * y2 - x2 * y1;
+    p->xf = (float)x0;
+    p->yf = (float)y0;
+    for( int i=0; i < NumAttrs; i++ ){
+        const double d1 = (double)v[1]->attr[i] - v[0]->attr[i];
+        const double d2 = (double)v[2]->attr[i] - v[0]->attr[i];
+        p->v0[i] = v[0]->attr[i];
+        p->dx[i] = (float)((d1 * y2 - d2 * y1) / det);
+        p->dy[i] = (float)((d2 * x1 - d1 * x2) / det);
+    }
+    BinPrim( sr, p );
+}
+
+static void Transform( const SoftRaster *sr, const SoftRasterVertex *in, ClipVertex *out )
+{
+    const float *m = sr->matrix;
+    for( int r=0; r < 4; r++ )
+        out->clip[r] = m[r] * in->pos[0] + m[4 + r] * in->pos[1] + m[8 + r] * in->pos[2] + m[12 + r] * in->pos[3];
+    out->attr[ATTR_Q] = 1.0f;
+    out->attr[ATTR_R] = in->color[0];
+    out->attr[ATTR_G] = in->color[1];
+    out->attr[ATTR_B] = in->color[2];
+    out->attr[ATTR_A] = in->color[3];
+    out->attr[ATTR_S] = in->texCoord[0];
+    out->attr[ATTR_T] = in->texCoord[1];
+}
+
+/* signed distance to clip plane 0 ~ 5: w + x, w - x, w + y, w - y, w + z, w - z */
+static inline float PlaneDistance( const ClipVertex *v, int plane )
+{
+    const float c = v->clip[plane >> 1];
+    return (plane & 1) ? v->clip[3] - c : v->clip[3] + c;
+}
+
+static void ClipTriangle( SoftRaster *sr, const ClipVertex *a, const ClipVertex *b, const ClipVertex *c )
+{
+    ClipVertex buffers[2][MaxClipVertices];
+    ClipVertex *in = buffers[0], *out = buffers[1];
+    int n = 3;
+    in[0] = *a;
+    in[1] = *b;
+    in[2] = *c;
+
+    for( int plane=0; plane < 6 && n >= 3; plane++ ){
+        int outside = 0;
+        for( int i=0; i < n; i++ )
+            outside += PlaneDistance( &in[i], plane ) < 0.0f;
+        if( outside == 0 )
+            continue;
+
+        int m = 0;
+        for( int i=0; i < n; i++ ){
+            const ClipVertex *p = &in[i];
+            const ClipVertex *q = &in[(i + 1) % n];
+            const float dp = PlaneDistance( p, plane );
+            const float dq = PlaneDistance( q, plane );
+            if( dp >= 0.0f )
+                out[m++] = *p;
+            if( (dp >= 0.0f) != (dq >= 0.0f) && m < MaxClipVertices ){
+                const float t = dp / (dp - dq);
+                ClipVertex *v = &out[m++];
+                for( int k=0; k < 4; k++ )
+                    v->clip[k] = p->clip[k] + (q->clip[k] - p->clip[k]) * t;
+                for( int k=0; k < NumAttrs; k++ )
+                    v->attr[k] = p->attr[k] + (q->attr[k] - p->attr[k]) * t;
+            }
+        }
+        ClipVertex *tmp = in;
+        in = out;
+        out = tmp;
+        n = m;
+    }
+    if( n < 3 )
+        return;
+
+    WindowVertex w[MaxClipVertices];
+    for( int i=0; i < n; i++ )
+        ToWindow( sr, &in[i], &w[i] );
+    for( int i=1; i + 1 < n; i++ )
+        SetupTriangle( sr, &w[0], &w[i], &w[i + 1] );
+}
+
+static inline int32_t CeilSubpixel( int32_t n )
+{
+    return -((-n) >> SubpixelBits);
+}
+
+static void SetupPoint( SoftRaster *sr, const ClipVertex *c )
+{
+    // points are clipped by their center
+    for( int plane=0; plane < 6; plane++ ){
+        if( PlaneDistance( c, plane ) < 0.0f )
+            return;
+    }
+    WindowVertex w;
+    ToWindow( sr, c, &w );
+
+    // pixel centers in [X - half, X + half)
+    const int32_t half = (int32_t)lrintf( sr->pointSize * (SubpixelOne / 2) );
+    const int32_t centerBias = SubpixelOne / 2;
+    Prim *p = NewPrim( sr );
+    p->isPoint = 1;
+    p->x0 = CeilSubpixel( w.X - half - centerBias );
+    p->x1 = CeilSubpixel( w.X + half - centerBias ) - 1;
+    p->y0 = CeilSubpixel( w.Y - half - centerBias );
+    p->y1 = CeilSubpixel( w.Y + half - centerBias ) - 1;
+    p->x0 = (p->x0 > 0) ? p->x0 : 0;
+    p->y0 = (p->y0 > 0) ? p->y0 : 0;
+    p->x1 = (p->x1 < sr->width - 1) ? p->x1 : sr->width - 1;
+    p->y1 = (p->y1 < sr->height - 1) ? p->y1 : sr->height - 1;
+    if( p->x0 > p->x1 || p->y0 > p->y1 )
+        return;
+    for( int i=0; i < NumAttrs; i++ )
+        p->v0[i] = c->attr[i];
+    BinPrim( sr, p );
+}
+
+void SoftRaster_DrawElements( SoftRaster *sr, SoftRasterMode mode, const SoftRasterVertex *vertices, const uint16_t *indices, int count )
+{
+    ClipVertex v[3];
+    for( int i=0; i < count; i++ ){
+        const int index = indices ? indices[i] : i;
+        if( mode == SR_POINTS ){
+            Transform( sr, &vertices[index], &v[0] );
+            SetupPoint( sr, &v[0] );
+            continue;
+        }
+
+        // v[0]: first vertex of the fan, v[1], v[2]: last two vertices
+        if( i == 0 ){
+            Transform( sr, &vertices[index], &v[0] );
+            continue;
+        }
+        if( mode == SR_TRIANGLES ){
+            Transform( sr, &vertices[index], &v[i % 3] );
+            if( i % 3 == 2 )
+                ClipTriangle( sr, &v[0], &v[1], &v[2] );
+        }else if( mode == SR_TRIANGLE_STRIP ){
+            Transform( sr, &vertices[index], &v[i % 3] );
+            if( i >= 2 )
+                ClipTriangle( sr, &v[(i - 2) % 3], &v[(i - 1) % 3], &v[i % 3] );
+        }else{
+            if( i >= 2 )
+                v[1] = v[2];
+            Transform( sr, &vertices[index], &v[2] );
+            if( i >= 2 )
+                ClipTriangle( sr, &v[0], &v[1], &v[2] );
+        }
+    }
+}
+
+void SoftRaster_Draw( SoftRaster *sr, SoftRasterMode mode, const SoftRasterVertex *vertices, int count )
+{
+    SoftRaster_DrawElements( sr, mode, vertices, NULL, count );
+}
@@ -0,0 +1,54 @@
+#pragma once
+/*
+ * Deterministic CPU reference rasterizer, to check driver output without trusting a GPU:
+ *   RGBA8 color buffer with rows bottom-up like glReadPixels(), GL conventions: the viewport is the whole buffer,
+ *   pixel centers at .5, no culling, column major matrices like linmath and glLoadMatrixf().
+ *   Triangles: fixed-point edges with 8 bits of subpixel and a top-left fill rule, perspective correct color and
+ *   texture coordinates. Points: glPointSize() squares of one color. Texture: RGBA8, nearest or linear, modulated
+ *   by the vertex color like GL_MODULATE. Blend: off, or glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA ).
+ *   Draws are transformed, clipped and binned into 64x64 tiles. SoftRaster_Finish() rasterizes the tiles on
+ *   worker threads, each tile in draw order, with SSE2 / NEON spans; the result is the same with any thread count
+ *   and with the scalar path. Drivers round differently, compare with a tolerance, see Golden_Compare().
+ */
+#include <stdint.h>
+
+#define SoftRaster_MaxSize  2048
+#define SoftRaster_MaxThreads 16
+
+typedef enum{
+    SR_POINTS,
+    SR_TRIANGLES,
+    SR_TRIANGLE_STRIP,
+    SR_TRIANGLE_FAN,
+}SoftRasterMode;
+
+typedef struct{
+    float pos[4];           // transformed by the matrix, w = 1 for 2D / 3D positions
+    float color[4];
+    float texCoord[2];
+}SoftRasterVertex;
+
+typedef struct{
+    const uint8_t *rgba;    // bottom row first, as glTexImage2D(); must live until SoftRaster_Finish()
+    int width, height;
+    int linear;             // 0: GL_NEAREST, 1: GL_LINEAR
+    int repeat;             // 0: GL_CLAMP_TO_EDGE, 1: GL_REPEAT
+}SoftRasterTexture;
+
+typedef struct SoftRaster SoftRaster;
+
+SoftRaster* SoftRaster_Create( int width, int height );     // NULL if larger than SoftRaster_MaxSize
+void SoftRaster_Destroy( SoftRaster *sr );
+void SoftRaster_SetThreads( SoftRaster *sr, int threads );  // 0: one per CPU, 1: no worker thread; at most SoftRaster_MaxThreads
+
+// state of the next draws
+void SoftRaster_SetMatrix( SoftRaster *sr, const float *matrix );              // 4x4, NULL for identity
+void SoftRaster_SetTexture( SoftRaster *sr, const SoftRasterTexture *texture ); // NULL: vertex color only
+void SoftRaster_SetBlend( SoftRaster *sr, int enable );
+void SoftRaster_SetPointSize( SoftRaster *sr, float size );
+
+void SoftRaster_Clear( SoftRaster *sr, float r, float g, float b, float a );
+void SoftRaster_Draw( SoftRaster *sr, SoftRasterMode mode, const SoftRasterVertex *vertices, int count );
+void SoftRaster_DrawElements( SoftRaster *sr, SoftRasterMode mode, const SoftRasterVertex *vertices, const uint16_t *indices, int count );
+// rasterize the pending draws, return the color buffer, width * height RGBA8
+const uint8_t* SoftRaster_Finish( SoftRaster *sr );
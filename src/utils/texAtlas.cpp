@@ -0,0 +1,142 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "texAtlas.h"
+
+static int AlignUp( int v, int align )
+{
+    return (v + align - 1) / align * align;
+}
+
+void TexAtlas_Init( TexAtlas *atlas, int width, int height, int padding )
+{
+    memset( atlas, 0, sizeof(*atlas) );
+    atlas->width = width;
+    atlas->height = height;
+    atlas->padding = padding;
+    atlas->align = 1 << TexAtlas_MaxMipLevel( atlas );
+}
+
+void TexAtlas_Free( TexAtlas *atlas )
+{
+    free( atlas->shelves );
+    atlas->shelves = NULL;
+    atlas->numShelves = atlas->maxShelves = 0;
+}
+
+void TexAtlas_Reset( TexAtlas *atlas )
+{
+    atlas->numShelves = 0;
+    atlas->usedHeight = 0;
+}
+
+int TexAtlas_Insert( TexAtlas *atlas, int width, int height, AtlasRect *rect )
+{
+    // slots start aligned, the padding before the image is rounded up so that the image origin is too
+    const int lead = AlignUp( atlas->padding, atlas->align );
+    const int w = AlignUp( lead + width + atlas->padding, atlas->align );
+    const int h = AlignUp( lead + height + atlas->padding, atlas->align );
+
+    // best fit: the lowest shelf which is high enough
+    AtlasShelf *best = NULL;
+    for( int i=0; i < atlas->numShelves; i++ ){
+        AtlasShelf *shelf = &atlas->shelves[i];
+        if( shelf->height >= h && atlas->width - shelf->used >= w
+            && (best == NULL || shelf->height < best->height) )
+            best = shelf;
+    }
+
+    // open a new shelf
+    if( best == NULL ){
+        if( w > atlas->width || atlas->usedHeight + h > atlas->height )
+            return 0;
+
+        if( atlas->numShelves == atlas->maxShelves ){
+            atlas->maxShelves = atlas->maxShelves ? atlas->maxShelves * 2 : 8;
+            atlas->shelves = (AtlasShelf*) realloc( atlas->shelves, atlas->maxShelves * sizeof(AtlasShelf) );
+            if( atlas->shelves == NULL ){
+                printf("%s: out of memory\n", __func__);
+                exit(EXIT_FAILURE);
+            }
+        }
+
+        best = &atlas->shelves[atlas->numShelves++];
+        best->y = atlas->usedHeight;
+        best->height = h;
+        best->used = 0;
+        atlas->usedHeight += h;
+    }
+
+    rect->x = best->used + lead;
+    rect->y = best->y + lead;
+    rect->width = width;
+    rect->height = height;
+    best->used += w;
+    return 1;
+}
+
+int TexAtlas_InsertAll( TexAtlas *atlas, int count, const int *widths, const int *heights, AtlasRect *rects )
+{
+    int *order = (int*) malloc( count * sizeof(int) );
+    for( int i=0; i < count; i++ )
+        order[i] = i;
+
+    // insertion sort, by height descending
+    for( int i=1; i < count; i++ ){
+        const int k = order[i];
+        int j = i - 1;
+        while( j >= 0 && heights[order[j]] < heights[k] ){
+            order[j + 1] = order[j];
+            j--;
+        }
+        order[j + 1] = k;
+    }
+
+    int ok = 1;
+    for( int i=0; i < count && ok; i++ )
+        ok = TexAtlas_Insert( atlas, widths[order[i]], heights[order[i]], &rects[order[i]] );
+
+    free( order );
+    return ok;
+}
+
+int TexAtlas_MaxMipLevel( const TexAtlas *atlas )
+{
+    int level = 0;
+    while( (atlas->padding >> (level + 1)) > 0 )
+        level++;
+    return level;
+}
+
+static inline int WrapCoord( int v, int size, int wrap )
+{
+    if( wrap )
+        return ((v % size) + size) % size;
+    return v < 0 ? 0 : (v >= size ? size - 1 : v);
+}
+
+void TexAtlas_Blit( const TexAtlas *atlas, uint8_t *atlasPixels, const AtlasRect *rect, const uint8_t *src, int srcChannels, int wrap )
+{
+    const int p = atlas->padding;
+
+    for( int y = -p; y < rect->height + p; y++ ){
+        const uint8_t *srcRow = src + WrapCoord( y, rect->height, wrap ) * rect->width * srcChannels;
+        uint8_t *dst = atlasPixels + ((rect->y + y) * atlas->width + rect->x - p) * 4;
+
+        for( int x = -p; x < rect->width + p; x++, dst += 4 ){
+            const uint8_t *s = srcRow + WrapCoord( x, rect->width, wrap ) * srcChannels;
+            dst[0] = s[0];
+            dst[1] = s[1];
+            dst[2] = s[2];
+            dst[3] = (srcChannels == 4) ? s[3] : 0xFF;
+        }
+    }
+}
+
+void TexAtlas_ScaleOffset( const TexAtlas *atlas, const AtlasRect *rect, float scaleOffset[4] )
+{
+    scaleOffset[0] = (float)rect->width / atlas->width;
+    scaleOffset[1] = (float)rect->height / atlas->height;
+    scaleOffset[2] = (float)rect->x / atlas->width;
+    scaleOffset[3] = (float)rect->y / atlas->height;
+}
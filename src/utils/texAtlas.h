@@ -0,0 +1,51 @@
+#pragma once
+/*
+ * Texture atlas builder:
+ *   shelf packer, every image gets 'padding' texels around it, so that bilinear filtering and
+ *   the first mipmap levels do not bleed the neighbours in. Image origins are aligned to
+ *   (1 << TexAtlas_MaxMipLevel()), whatever the padding, so image borders stay on texel boundaries in those levels.
+ */
+#include <stdint.h>
+
+typedef struct{
+    int x, y;           // image area, padding excluded
+    int width, height;
+}AtlasRect;
+
+typedef struct{
+    int y;
+    int height;         // padding included
+    int used;           // width used from the left
+}AtlasShelf;
+
+typedef struct{
+    int width, height;
+    int padding;
+    int align;
+    AtlasShelf *shelves;
+    int numShelves;
+    int maxShelves;
+    int usedHeight;
+}TexAtlas;
+
+void TexAtlas_Init( TexAtlas *atlas, int width, int height, int padding );
+void TexAtlas_Free( TexAtlas *atlas );
+void TexAtlas_Reset( TexAtlas *atlas );
+
+// return 1 if packed, 0 if the atlas is full
+int TexAtlas_Insert( TexAtlas *atlas, int width, int height, AtlasRect *rect );
+// pack tallest first, which wastes less space with shelves. return 1 if all images are packed
+int TexAtlas_InsertAll( TexAtlas *atlas, int count, const int *widths, const int *heights, AtlasRect *rects );
+
+// highest mipmap level which does not bleed, for GL_TEXTURE_MAX_LEVEL
+int TexAtlas_MaxMipLevel( const TexAtlas *atlas );
+
+/*
+ * Copy a RGB/RGBA image into a RGBA8 atlas image of atlas->width x atlas->height, and fill its padding:
+ *   wrap = 0: replicate the borders, like GL_CLAMP_TO_EDGE
+ *   wrap = 1: copy the opposite borders, like GL_REPEAT
+ */
+void TexAtlas_Blit( const TexAtlas *atlas, uint8_t *atlasPixels, const AtlasRect *rect, const uint8_t *src, int srcChannels, int wrap );
+
+// texture coordinates [0, 1] of the image -> atlas: uv * scaleOffset.xy + scaleOffset.zw
+void TexAtlas_ScaleOffset( const TexAtlas *atlas, const AtlasRect *rect, float scaleOffset[4] );
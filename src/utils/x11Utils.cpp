@@ -3,6 +3,7 @@
 #include <string.h>
 #include <stdarg.h>
 #include <sys/time.h>
+#include <poll.h>
 
 #include  <X11/Xlib.h>
 #include  <X11/Xatom.h>
@@ -15,6 +16,8 @@ static Display *x_display = NULL;
 static Window x_win = NULL;
 static Atom s_wmDeleteMessage;
 static xWindowResizeFunc resizeCallback = NULL;
+static int x_width = 0, x_height = 0;   // size from the last ConfigureNotify
+static int x_interrupt = 0;             // user interrupt seen by xWindowWaitSize()
 
 // This function initialized the native X11 display and window
 int xWindowCreate( void** nativeDisplayPtr, void** nativeWindowPtr, const char *title, int width, int height )
@@ -59,6 +62,9 @@ int xWindowCreate( void** nativeDisplayPtr, void** nativeWindowPtr, const char *
     hints.flags = InputHint;
     XSetWMHints(x_display, x_win, &hints);
 
+    x_width = width;
+    x_height = height;
+
     // make the window visible on the screen
     XMapWindow (x_display, x_win);
     XStoreName (x_display, x_win, title);
@@ -91,6 +97,43 @@ void xWindowSetTitle( const char *name )
         XStoreName( x_display, x_win, name );
 }
 
+// Handle one event, return 1 if the user interrupts the program
+static int xWindowHandleEvent( XEvent *xev )
+{
+    int userinterrupt = 0;
+
+    if( xev->type == KeyPress )
+    {
+        //KeySym key;
+        //char text;
+        //if( XLookupString( &xev->xkey, &text, 1, &key, 0 ) == 1 )
+        //{
+            //if (esContext->keyFunc != NULL)
+            //    esContext->keyFunc(esContext, text, 0, 0);
+        //}
+
+        //printf("keycode = %u\n", xev->xkey.keycode);
+        if( xev->xkey.keycode == 9 ) //Escape
+            userinterrupt = 1;
+    }
+    else if( xev->type == ClientMessage ){
+        if( xev->xclient.data.l[0] == s_wmDeleteMessage ){
+            userinterrupt = 1;
+        }
+    }
+    else if( xev->type == DestroyNotify ) {
+        userinterrupt = 1;
+    }
+    else if( xev->type == ConfigureNotify ){
+        XConfigureEvent xce = xev->xconfigure;
+        x_width = xce.width;
+        x_height = xce.height;
+        if( resizeCallback != NULL )
+            resizeCallback( xce.width, xce.height );
+    }
+    return userinterrupt;
+}
+
 // Reads from X11 event loop and interrupt program if there is a keypress, or window close action.
 int xWindowPoolEvents()
 {
@@ -98,39 +141,13 @@ int xWindowPoolEvents()
         return 0;
 
     // Pump all messages from X server. Keypresses are directed to keyfunc (if defined)
-    int userinterrupt = 0;
+    int userinterrupt = x_interrupt;
+    x_interrupt = 0;
     while( XPending( x_display ))
     {
         XEvent xev;
         XNextEvent( x_display, &xev );
-
-        if( xev.type == KeyPress )
-        {
-            //KeySym key;
-            //char text;
-            //if( XLookupString( &xev.xkey, &text, 1, &key, 0 ) == 1 )
-            //{
-                //if (esContext->keyFunc != NULL)
-                //    esContext->keyFunc(esContext, text, 0, 0);
-            //}
-
-            //printf("keycode = %u\n", xev.xkey.keycode);
-            if( xev.xkey.keycode == 9 ) //Escape
-                userinterrupt = 1;
-        }
-        else if( xev.type == ClientMessage ){
-            if( xev.xclient.data.l[0] == s_wmDeleteMessage ){
-                userinterrupt = 1;
-            }
-        }
-        else if( xev.type == DestroyNotify ) {
-            userinterrupt = 1;
-        }
-        else if( xev.type == ConfigureNotify ){
-            XConfigureEvent xce = xev.xconfigure;
-            if( resizeCallback != NULL )
-                resizeCallback( xce.width, xce.height );
-        }
+        userinterrupt |= xWindowHandleEvent( &xev );
     }
     return userinterrupt;
 }
@@ -171,6 +188,38 @@ void xWindowSetSize( int width, int height )
     XConfigureWindow( x_display, x_win, CWWidth | CWHeight, &change );
 }
 
+int xWindowWaitSize( int width, int height, int timeoutMs )
+{
+    if( x_display == NULL )
+        return 0;
+
+    struct timeval start, now;
+    gettimeofday( &start, NULL );
+    XFlush( x_display );
+
+    while( 1 ){
+        // handle what is already queued, the size may be there
+        while( XPending( x_display ) ){
+            XEvent xev;
+            XNextEvent( x_display, &xev );
+            x_interrupt |= xWindowHandleEvent( &xev );
+        }
+        if( x_width == width && x_height == height )
+            return 1;
+
+        // sleep until the X connection has data, or timeout
+        gettimeofday( &now, NULL );
+        const int elapsedMs = (now.tv_sec - start.tv_sec) * 1000 + (now.tv_usec - start.tv_usec) / 1000;
+        if( elapsedMs >= timeoutMs )
+            return 0;
+
+        struct pollfd fd;
+        fd.fd = ConnectionNumber( x_display );
+        fd.events = POLLIN;
+        poll( &fd, 1, timeoutMs - elapsedMs );
+    }
+}
+
 void xWindowSetWindowResizeCallback( xWindowResizeFunc func )
 {
     resizeCallback = func;
@@ -8,5 +8,7 @@ int xWindowPoolEvents();
 void xWindowDestroy();
 void xWindowGetSize( int *width, int *height );
 void xWindowSetSize( int width, int height );
+// wait for the ConfigureNotify of width x height, return 0 on timeout. events seen meanwhile are handled
+int xWindowWaitSize( int width, int height, int timeoutMs );
 
 void xWindowSetWindowResizeCallback( xWindowResizeFunc func );